@@ -0,0 +1,19 @@
+# Sources for the optional compression streams.  These are kept out of
+# src/file_lists.cmake because they are only built when the corresponding
+# library was found (see protobuf_WITH_ZSTD and protobuf_WITH_LZ4).
+
+set(libprotobuf_zstd_srcs
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/io/zstd_stream.cc
+)
+
+set(libprotobuf_zstd_hdrs
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/io/zstd_stream.h
+)
+
+set(libprotobuf_lz4_srcs
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/io/lz4_stream.cc
+)
+
+set(libprotobuf_lz4_hdrs
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/io/lz4_stream.h
+)
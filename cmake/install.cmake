@@ -44,6 +44,7 @@ endif (protobuf_BUILD_PROTOC_BINARIES)
 install(FILES ${CMAKE_CURRENT_BINARY_DIR}/protobuf.pc ${CMAKE_CURRENT_BINARY_DIR}/protobuf-lite.pc DESTINATION "${CMAKE_INSTALL_LIBDIR}/pkgconfig")
 
 include(${protobuf_SOURCE_DIR}/src/file_lists.cmake)
+include(${protobuf_SOURCE_DIR}/cmake/compression.cmake)
 set(protobuf_HEADERS
   ${libprotobuf_hdrs}
   ${libprotoc_hdrs}
@@ -51,6 +52,12 @@ set(protobuf_HEADERS
   ${descriptor_proto_proto_srcs}
   ${plugin_proto_proto_srcs}
 )
+if (HAVE_ZSTD)
+  list(APPEND protobuf_HEADERS ${libprotobuf_zstd_hdrs})
+endif (HAVE_ZSTD)
+if (HAVE_LZ4)
+  list(APPEND protobuf_HEADERS ${libprotobuf_lz4_hdrs})
+endif (HAVE_LZ4)
 foreach(_header ${protobuf_HEADERS})
   string(REPLACE "${protobuf_SOURCE_DIR}/src" "" _header ${_header})
   get_filename_component(_extract_from "${protobuf_SOURCE_DIR}/src/${_header}" ABSOLUTE)
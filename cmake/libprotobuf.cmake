@@ -1,6 +1,7 @@
 # CMake definitions for libprotobuf (the "full" C++ protobuf runtime).
 
 include(${protobuf_SOURCE_DIR}/src/file_lists.cmake)
+include(${protobuf_SOURCE_DIR}/cmake/compression.cmake)
 
 add_library(libprotobuf ${protobuf_SHARED_OR_STATIC}
   ${libprotobuf_srcs}
@@ -19,6 +20,14 @@ target_link_libraries(libprotobuf PRIVATE ${CMAKE_THREAD_LIBS_INIT})
 if(protobuf_WITH_ZLIB)
   target_link_libraries(libprotobuf PRIVATE ${ZLIB_LIBRARIES})
 endif()
+if(HAVE_ZSTD)
+  target_sources(libprotobuf PRIVATE ${libprotobuf_zstd_srcs} ${libprotobuf_zstd_hdrs})
+  target_link_libraries(libprotobuf PRIVATE ${ZSTD_LIBRARY})
+endif()
+if(HAVE_LZ4)
+  target_sources(libprotobuf PRIVATE ${libprotobuf_lz4_srcs} ${libprotobuf_lz4_hdrs})
+  target_link_libraries(libprotobuf PRIVATE ${LZ4_LIBRARY})
+endif()
 if(protobuf_LINK_LIBATOMIC)
   target_link_libraries(libprotobuf PRIVATE atomic)
 endif()
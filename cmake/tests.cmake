@@ -165,6 +165,114 @@ target_link_libraries(lite-test
 add_test(NAME lite-test
   COMMAND lite-test ${protobuf_GTEST_ARGS})
 
+# generated_message_tctable_serialization_test is built against test protos
+# compiled with experimental_table_driven_serialization, once as is and once
+# with force_split.  The generated code goes to its own include directory, ahead
+# of the source tree, and the usual test protos are not linked in.
+set(table_driven_serialization_protos
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_import.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_import_public.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_proto3.proto
+)
+
+foreach(variant table_driven table_driven_split)
+  set(cpp_opts experimental_table_driven_serialization)
+  if(variant STREQUAL table_driven_split)
+    set(cpp_opts ${cpp_opts},force_split)
+  endif()
+  set(out_dir ${CMAKE_CURRENT_BINARY_DIR}/${variant})
+  set(${variant}_proto_files)
+  foreach(proto_file ${table_driven_serialization_protos})
+    string(REPLACE ${protobuf_SOURCE_DIR}/src ${out_dir} pb_src ${proto_file})
+    string(REPLACE .proto .pb.cc pb_src ${pb_src})
+    string(REPLACE .pb.cc .pb.h pb_hdr ${pb_src})
+    list(APPEND ${variant}_proto_files ${pb_src} ${pb_hdr})
+  endforeach(proto_file)
+  add_custom_command(
+    OUTPUT ${${variant}_proto_files}
+    DEPENDS ${protobuf_PROTOC_EXE} ${table_driven_serialization_protos}
+    COMMAND ${CMAKE_COMMAND} -E make_directory ${out_dir}
+    COMMAND ${protobuf_PROTOC_EXE} ${table_driven_serialization_protos}
+        --proto_path=${protobuf_SOURCE_DIR}/src
+        --cpp_out=${cpp_opts}:${out_dir}
+  )
+
+  add_executable(${variant}-serialization-test
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/generated_message_tctable_serialization_test.cc
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/test_util.cc
+    ${common_test_hdrs}
+    ${common_test_srcs}
+    ${${variant}_proto_files}
+  )
+  target_include_directories(${variant}-serialization-test BEFORE PRIVATE
+    ${out_dir})
+  target_link_libraries(${variant}-serialization-test
+    ${protobuf_LIB_PROTOC}
+    ${protobuf_LIB_PROTOBUF}
+    ${protobuf_ABSL_USED_TARGETS}
+    GTest::gmock_main
+  )
+
+  add_test(NAME ${variant}-serialization-test
+    COMMAND ${variant}-serialization-test ${protobuf_GTEST_ARGS}
+    WORKING_DIRECTORY ${protobuf_SOURCE_DIR})
+endforeach(variant)
+
+# profile_driven_codegen_test is built the same way against test protos
+# compiled with inject_field_listener_events, force_inline_string and
+# access_profile, and with PROTOBUF_FIELD_ACCESS_PROFILING defined.
+set(profile_driven_protos
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_import.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_import_public.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_lite.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_import_lite.proto
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_import_public_lite.proto
+)
+set(profile_driven_access_profile
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/testdata/unittest_access_profile.txt)
+set(profile_driven_out_dir ${CMAKE_CURRENT_BINARY_DIR}/profile_driven)
+set(profile_driven_proto_files)
+foreach(proto_file ${profile_driven_protos})
+  string(REPLACE ${protobuf_SOURCE_DIR}/src ${profile_driven_out_dir}
+    pb_src ${proto_file})
+  string(REPLACE .proto .pb.cc pb_src ${pb_src})
+  string(REPLACE .pb.cc .pb.h pb_hdr ${pb_src})
+  list(APPEND profile_driven_proto_files ${pb_src} ${pb_hdr})
+endforeach(proto_file)
+add_custom_command(
+  OUTPUT ${profile_driven_proto_files}
+  DEPENDS ${protobuf_PROTOC_EXE} ${profile_driven_protos}
+      ${profile_driven_access_profile}
+  COMMAND ${CMAKE_COMMAND} -E make_directory ${profile_driven_out_dir}
+  COMMAND ${protobuf_PROTOC_EXE} ${profile_driven_protos}
+      --proto_path=${protobuf_SOURCE_DIR}/src
+      --cpp_out=inject_field_listener_events,force_inline_string,access_profile=${profile_driven_access_profile}:${profile_driven_out_dir}
+)
+
+add_executable(profile-driven-codegen-test
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/profile_driven_codegen_test.cc
+  ${protobuf_SOURCE_DIR}/src/google/protobuf/test_util.cc
+  ${common_test_hdrs}
+  ${common_test_srcs}
+  ${profile_driven_proto_files}
+)
+target_include_directories(profile-driven-codegen-test BEFORE PRIVATE
+  ${profile_driven_out_dir})
+target_compile_definitions(profile-driven-codegen-test PRIVATE
+  PROTOBUF_FIELD_ACCESS_PROFILING)
+target_link_libraries(profile-driven-codegen-test
+  ${protobuf_LIB_PROTOC}
+  ${protobuf_LIB_PROTOBUF}
+  ${protobuf_ABSL_USED_TARGETS}
+  GTest::gmock_main
+)
+
+add_test(NAME profile-driven-codegen-test
+  COMMAND profile-driven-codegen-test ${protobuf_GTEST_ARGS}
+  WORKING_DIRECTORY ${protobuf_SOURCE_DIR})
+
 add_custom_target(check
   COMMAND tests
   DEPENDS tests lite-test test_plugin
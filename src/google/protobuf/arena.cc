@@ -277,9 +277,7 @@ void SerialArena::CleanupList() {
     char* limit = b->Limit();
     char* it = reinterpret_cast<char*>(b->cleanup_nodes);
     GOOGLE_DCHECK(!b->IsSentry() || it == limit);
-    while (it < limit) {
-      it += cleanup::DestroyNode(it);
-    }
+    cleanup::DestroyNodes(it, limit);
     b = b->next;
   } while (b);
 }
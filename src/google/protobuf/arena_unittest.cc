@@ -42,6 +42,7 @@
 #include "google/protobuf/stubs/logging.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/barrier.h"
 #include "google/protobuf/arena_test_util.h"
@@ -1538,6 +1539,41 @@ TEST(ArenaTest, AddCleanup) {
   }
 }
 
+TEST(ArenaTest, CleanupRunsInReverseOrderAcrossNodeTypes) {
+  struct Recorder {
+    Recorder(int id, std::vector<int>* destroyed)
+        : id(id), destroyed(destroyed) {}
+    ~Recorder() { destroyed->push_back(id); }
+    int id;
+    std::vector<int>* destroyed;
+  };
+
+  std::vector<int> destroyed;
+  std::vector<int> expected;
+  {
+    Arena arena;
+    // Interleave runs of strings and Cords, which get specialized cleanup
+    // nodes, with objects that use a generic one.  Enough of them to span
+    // several blocks.
+    for (int i = 0; i < 200; ++i) {
+      Arena::Create<Recorder>(&arena, i, &destroyed);
+      expected.push_back(i);
+      for (int j = 0; j < i % 13; ++j) {
+        Arena::Create<std::string>(&arena, 100, 'x');
+      }
+      if (i % 3 == 0) {
+        Arena::Create<Recorder>(&arena, -i, &destroyed);
+        expected.push_back(-i);
+      }
+      for (int j = 0; j < i % 7; ++j) {
+        Arena::Create<absl::Cord>(&arena, std::string(100, 'y'));
+      }
+    }
+  }
+  std::reverse(expected.begin(), expected.end());
+  EXPECT_EQ(expected, destroyed);
+}
+
 TEST(ArenaTest, SpaceReuseForArraysSizeChecks) {
   // Limit to 1<<20 to avoid using too much memory on the test.
   for (int i = 0; i < 20; ++i) {
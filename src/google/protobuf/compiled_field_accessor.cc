@@ -0,0 +1,132 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/compiled_field_accessor.h"
+
+#include <string>
+#include <utility>
+
+#include "google/protobuf/arenastring.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/generated_message_reflection.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+CompiledFieldAccessor::CompiledFieldAccessor(const Reflection* reflection,
+                                             const FieldDescriptor* field)
+    : reflection_(reflection),
+      field_(field),
+      number_(static_cast<uint32_t>(field->number())) {
+  GOOGLE_CHECK(!field->is_repeated())
+      << "CompiledFieldAccessor does not support repeated field "
+      << field->full_name();
+  GOOGLE_CHECK_NE(field->cpp_type(), FieldDescriptor::CPPTYPE_MESSAGE)
+      << "CompiledFieldAccessor does not support message field "
+      << field->full_name();
+  GOOGLE_CHECK(field->is_extension() ||
+               field->containing_type() == reflection->descriptor_)
+      << "Field " << field->full_name() << " does not belong to "
+      << reflection->descriptor_->full_name();
+
+  closed_enum_ = field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
+                 !internal::CreateUnknownEnumValues(field);
+
+  const internal::ReflectionSchema& schema = reflection->schema_;
+  if (field->is_extension() || schema.IsSplit(field) ||
+      field->options().weak()) {
+    return;
+  }
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING &&
+      (schema.IsStringPieceField(field) || schema.IsFieldInlined(field))) {
+    return;
+  }
+
+  direct_ = true;
+  offset_ = schema.GetFieldOffset(field);
+  if (schema.InRealOneof(field)) {
+    oneof_case_offset_ = schema.GetOneofCaseOffset(field->containing_oneof());
+  } else if (schema.HasHasbits()) {
+    has_bits_offset_ = schema.HasBitsOffset();
+    has_bit_index_ = schema.HasBitIndex(field);
+  }
+}
+
+bool CompiledFieldAccessor::HasField(const Message& message) const {
+  GOOGLE_DCHECK_EQ(message.GetReflection(), reflection_);
+  if (direct_) {
+    if (oneof_case_offset_ != kNone) {
+      return internal::GetConstRefAtOffset<uint32_t>(
+                 message, oneof_case_offset_) == number_;
+    }
+    if (has_bit_index_ != kNone) {
+      const uint32_t* has_bits =
+          &internal::GetConstRefAtOffset<uint32_t>(message, has_bits_offset_);
+      return (has_bits[has_bit_index_ / 32] >> (has_bit_index_ % 32)) & 1;
+    }
+  }
+  // No explicit presence: Reflection compares the value against zero.
+  return reflection_->HasField(message, field_);
+}
+
+const std::string& CompiledFieldAccessor::GetStringReference(
+    const Message& message, std::string* scratch) const {
+  GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_STRING);
+  if (CanLoad(message)) {
+    const auto& str =
+        internal::GetConstRefAtOffset<internal::ArenaStringPtr>(message,
+                                                                offset_);
+    return str.IsDefault() ? field_->default_value_string() : str.Get();
+  }
+  return reflection_->GetStringReference(message, field_, scratch);
+}
+
+void CompiledFieldAccessor::SetString(Message* message,
+                                      std::string value) const {
+  GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_STRING);
+  if (CanStore(*message)) {
+    internal::GetPointerAtOffset<internal::ArenaStringPtr>(message, offset_)
+        ->Set(std::move(value),
+              reflection_->GetInternalMetadata(*message).arena());
+    SetHasBit(message);
+    return;
+  }
+  reflection_->SetString(message, field_, std::move(value));
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,237 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Defines CompiledFieldAccessor, which reads and writes one singular field
+// of many messages without going through the checks that every Reflection
+// accessor performs on each call.
+
+#ifndef GOOGLE_PROTOBUF_COMPILED_FIELD_ACCESSOR_H__
+#define GOOGLE_PROTOBUF_COMPILED_FIELD_ACCESSOR_H__
+
+#include <cstdint>
+#include <string>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/port.h"
+
+#ifdef SWIG
+#error "You cannot SWIG proto headers"
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// A CompiledFieldAccessor resolves a singular field against the memory layout
+// of one Reflection once, up front: the field's offset, its has-bit and its
+// oneof case slot.  Reading or writing the field afterwards is an inlined load
+// or store plus a has-bit update, which makes it suitable for tight loops that
+// touch the same fields of many messages, e.g.:
+//
+//   const Reflection* reflection = prototype.GetReflection();
+//   CompiledFieldAccessor id(reflection, descriptor->FindFieldByName("id"));
+//   for (const Message* row : rows) sum += id.GetInt64(*row);
+//
+// Accessors work with both generated messages and DynamicMessage, but every
+// message passed to an accessor must use the Reflection it was built from
+// (i.e. be of the same concrete type).  Fields whose representation does not
+// allow direct access -- extensions, cords, inlined or split fields and the
+// like -- and the rare paths of the others, such as switching the active
+// member of a oneof, are forwarded to the corresponding Reflection method, so
+// an accessor always behaves exactly like Reflection.
+//
+// Messages and repeated fields are not supported; use Reflection::GetMessage()
+// and Reflection::GetRepeatedFieldRef() for those.
+class PROTOBUF_EXPORT CompiledFieldAccessor {
+ public:
+  // `field` must be a singular, non-message field of the message type that
+  // `reflection` describes.
+  CompiledFieldAccessor(const Reflection* reflection,
+                        const FieldDescriptor* field);
+
+  CompiledFieldAccessor(const CompiledFieldAccessor&) = default;
+  CompiledFieldAccessor& operator=(const CompiledFieldAccessor&) = default;
+
+  const FieldDescriptor* field() const { return field_; }
+
+  // True if accesses to this field bypass Reflection on the common path.
+  bool is_direct() const { return direct_; }
+
+  // Equivalent to Reflection::HasField().
+  bool HasField(const Message& message) const;
+
+  // Getters; equivalent to the Reflection methods of the same name.  The
+  // field's cpp_type() must match the getter.
+  int32_t GetInt32(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_INT32);
+    if (CanLoad(message)) return Load<int32_t>(message);
+    return reflection_->GetInt32(message, field_);
+  }
+  int64_t GetInt64(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_INT64);
+    if (CanLoad(message)) return Load<int64_t>(message);
+    return reflection_->GetInt64(message, field_);
+  }
+  uint32_t GetUInt32(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_UINT32);
+    if (CanLoad(message)) return Load<uint32_t>(message);
+    return reflection_->GetUInt32(message, field_);
+  }
+  uint64_t GetUInt64(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_UINT64);
+    if (CanLoad(message)) return Load<uint64_t>(message);
+    return reflection_->GetUInt64(message, field_);
+  }
+  float GetFloat(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_FLOAT);
+    if (CanLoad(message)) return Load<float>(message);
+    return reflection_->GetFloat(message, field_);
+  }
+  double GetDouble(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_DOUBLE);
+    if (CanLoad(message)) return Load<double>(message);
+    return reflection_->GetDouble(message, field_);
+  }
+  bool GetBool(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_BOOL);
+    if (CanLoad(message)) return Load<bool>(message);
+    return reflection_->GetBool(message, field_);
+  }
+  int GetEnumValue(const Message& message) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_ENUM);
+    if (CanLoad(message)) return Load<int>(message);
+    return reflection_->GetEnumValue(message, field_);
+  }
+  // See Reflection::GetStringReference() for the meaning of `scratch`.
+  const std::string& GetStringReference(const Message& message,
+                                        std::string* scratch) const;
+
+  // Setters; equivalent to the Reflection methods of the same name.
+  void SetInt32(Message* message, int32_t value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_INT32);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetInt32(message, field_, value);
+  }
+  void SetInt64(Message* message, int64_t value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_INT64);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetInt64(message, field_, value);
+  }
+  void SetUInt32(Message* message, uint32_t value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_UINT32);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetUInt32(message, field_, value);
+  }
+  void SetUInt64(Message* message, uint64_t value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_UINT64);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetUInt64(message, field_, value);
+  }
+  void SetFloat(Message* message, float value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_FLOAT);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetFloat(message, field_, value);
+  }
+  void SetDouble(Message* message, double value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_DOUBLE);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetDouble(message, field_, value);
+  }
+  void SetBool(Message* message, bool value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_BOOL);
+    if (CanStore(*message)) return Store(message, value);
+    reflection_->SetBool(message, field_, value);
+  }
+  // Values unknown to a closed enum are stored as unknown fields, exactly as
+  // Reflection::SetEnumValue() does.
+  void SetEnumValue(Message* message, int value) const {
+    GOOGLE_DCHECK_EQ(field_->cpp_type(), FieldDescriptor::CPPTYPE_ENUM);
+    if (!closed_enum_ && CanStore(*message)) return Store(message, value);
+    reflection_->SetEnumValue(message, field_, value);
+  }
+  void SetString(Message* message, std::string value) const;
+
+ private:
+  static constexpr uint32_t kNone = static_cast<uint32_t>(-1);
+
+  // True if the field can be read in place: it is directly accessible and,
+  // for a oneof member, currently set.
+  bool CanLoad(const Message& message) const {
+    GOOGLE_DCHECK_EQ(message.GetReflection(), reflection_);
+    return PROTOBUF_PREDICT_TRUE(direct_) &&
+           (oneof_case_offset_ == kNone ||
+            internal::GetConstRefAtOffset<uint32_t>(
+                message, oneof_case_offset_) == number_);
+  }
+  // Storing in place is possible under the same conditions; setting a oneof
+  // member that is not active has to clear the active one first.
+  bool CanStore(const Message& message) const { return CanLoad(message); }
+
+  template <typename T>
+  T Load(const Message& message) const {
+    return internal::GetConstRefAtOffset<T>(message, offset_);
+  }
+
+  template <typename T>
+  void Store(Message* message, T value) const {
+    *internal::GetPointerAtOffset<T>(message, offset_) = value;
+    SetHasBit(message);
+  }
+
+  void SetHasBit(Message* message) const {
+    if (has_bit_index_ != kNone) {
+      internal::GetPointerAtOffset<uint32_t>(
+          message, has_bits_offset_)[has_bit_index_ / 32] |=
+          static_cast<uint32_t>(1) << (has_bit_index_ % 32);
+    }
+  }
+
+  const Reflection* reflection_;
+  const FieldDescriptor* field_;
+  uint32_t number_;
+  uint32_t offset_ = 0;
+  uint32_t has_bits_offset_ = 0;
+  uint32_t has_bit_index_ = kNone;
+  // kNone if the field is not a member of a real oneof.
+  uint32_t oneof_case_offset_ = kNone;
+  bool direct_ = false;
+  // Closed enums have to validate values before storing them.
+  bool closed_enum_ = false;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_COMPILED_FIELD_ACCESSOR_H__
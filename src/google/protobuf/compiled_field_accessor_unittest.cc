@@ -0,0 +1,312 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/compiled_field_accessor.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/message.h"
+#include <gtest/gtest.h>
+#include "google/protobuf/arena.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+// Returns accessors for all singular non-message fields of `descriptor`.
+std::vector<CompiledFieldAccessor> AccessorsFor(const Reflection* reflection,
+                                                const Descriptor* descriptor) {
+  std::vector<CompiledFieldAccessor> accessors;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (field->is_repeated() ||
+        field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      continue;
+    }
+    accessors.emplace_back(reflection, field);
+  }
+  return accessors;
+}
+
+// Copies one field using only the accessors.
+void CopyField(const CompiledFieldAccessor& from, const Message& source,
+               const CompiledFieldAccessor& to, Message* dest) {
+  if (!from.HasField(source)) return;
+  std::string scratch;
+  switch (from.field()->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      to.SetInt32(dest, from.GetInt32(source));
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      to.SetInt64(dest, from.GetInt64(source));
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      to.SetUInt32(dest, from.GetUInt32(source));
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      to.SetUInt64(dest, from.GetUInt64(source));
+      break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      to.SetFloat(dest, from.GetFloat(source));
+      break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      to.SetDouble(dest, from.GetDouble(source));
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      to.SetBool(dest, from.GetBool(source));
+      break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+      to.SetEnumValue(dest, from.GetEnumValue(source));
+      break;
+    case FieldDescriptor::CPPTYPE_STRING:
+      to.SetString(dest, from.GetStringReference(source, &scratch));
+      break;
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      GOOGLE_LOG(FATAL) << "Unexpected message field";
+  }
+}
+
+TEST(CompiledFieldAccessorTest, MatchesReflection) {
+  unittest::TestAllTypes message;
+  const Reflection* reflection = message.GetReflection();
+  const Descriptor* descriptor = message.GetDescriptor();
+  std::vector<CompiledFieldAccessor> accessors =
+      AccessorsFor(reflection, descriptor);
+
+  std::string scratch;
+  for (const CompiledFieldAccessor& accessor : accessors) {
+    EXPECT_FALSE(accessor.HasField(message));
+  }
+  EXPECT_EQ(accessors[0].field()->name(), "optional_int32");
+  EXPECT_TRUE(accessors[0].is_direct());
+  EXPECT_EQ(accessors[0].GetInt32(message), 0);
+
+  const FieldDescriptor* default_string =
+      descriptor->FindFieldByName("default_string");
+  CompiledFieldAccessor default_string_accessor(reflection, default_string);
+  EXPECT_EQ(default_string_accessor.GetStringReference(message, &scratch),
+            "hello");
+
+  TestUtil::SetAllFields(&message);
+  message.set_oneof_string("oneof");
+  for (const CompiledFieldAccessor& accessor : accessors) {
+    const FieldDescriptor* field = accessor.field();
+    EXPECT_EQ(accessor.HasField(message), reflection->HasField(message, field))
+        << field->full_name();
+  }
+  EXPECT_EQ(default_string_accessor.GetStringReference(message, &scratch),
+            "415");
+}
+
+TEST(CompiledFieldAccessorTest, CopyGenerated) {
+  unittest::TestAllTypes source, dest;
+  TestUtil::SetAllFields(&source);
+  source.set_oneof_bytes("oneof");
+
+  std::vector<CompiledFieldAccessor> accessors =
+      AccessorsFor(source.GetReflection(), source.GetDescriptor());
+  for (const CompiledFieldAccessor& accessor : accessors) {
+    CopyField(accessor, source, accessor, &dest);
+  }
+
+  // Only singular scalar and string fields were copied.
+  for (int i = 0; i < source.GetDescriptor()->field_count(); ++i) {
+    const FieldDescriptor* field = source.GetDescriptor()->field(i);
+    if (field->is_repeated() ||
+        field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      source.GetReflection()->ClearField(&source, field);
+    }
+  }
+  EXPECT_EQ(source.SerializeAsString(), dest.SerializeAsString());
+  EXPECT_EQ(dest.oneof_bytes(), "oneof");
+}
+
+TEST(CompiledFieldAccessorTest, CopyToDynamicMessage) {
+  unittest::TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+
+  DynamicMessageFactory factory;
+  std::unique_ptr<Message> dest(
+      factory.GetPrototype(source.GetDescriptor())->New());
+  const Reflection* dynamic_reflection = dest->GetReflection();
+  ASSERT_NE(dynamic_reflection, source.GetReflection());
+
+  std::vector<CompiledFieldAccessor> from =
+      AccessorsFor(source.GetReflection(), source.GetDescriptor());
+  std::vector<CompiledFieldAccessor> to =
+      AccessorsFor(dynamic_reflection, source.GetDescriptor());
+  ASSERT_EQ(from.size(), to.size());
+  for (size_t i = 0; i < from.size(); ++i) {
+    EXPECT_TRUE(to[i].is_direct()) << to[i].field()->full_name();
+    CopyField(from[i], source, to[i], dest.get());
+  }
+
+  unittest::TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(dest->SerializeAsString()));
+  EXPECT_EQ(parsed.optional_int32(), 101);
+  EXPECT_EQ(parsed.optional_uint64(), 104);
+  EXPECT_EQ(parsed.optional_double(), 112);
+  EXPECT_TRUE(parsed.optional_bool());
+  EXPECT_EQ(parsed.optional_string(), "115");
+  EXPECT_EQ(parsed.optional_bytes(), "116");
+  EXPECT_EQ(parsed.optional_nested_enum(), unittest::TestAllTypes::BAZ);
+  EXPECT_EQ(parsed.default_string(), "415");
+  EXPECT_EQ(parsed.oneof_bytes(), "604");
+
+  // And back, from the dynamic message into a generated one.
+  unittest::TestAllTypes round_trip;
+  for (size_t i = 0; i < from.size(); ++i) {
+    CopyField(to[i], *dest, from[i], &round_trip);
+  }
+  EXPECT_EQ(round_trip.SerializeAsString(), parsed.SerializeAsString());
+}
+
+TEST(CompiledFieldAccessorTest, Oneof) {
+  unittest::TestAllTypes message;
+  const Descriptor* descriptor = message.GetDescriptor();
+  CompiledFieldAccessor oneof_uint32(
+      message.GetReflection(), descriptor->FindFieldByName("oneof_uint32"));
+  CompiledFieldAccessor oneof_string(
+      message.GetReflection(), descriptor->FindFieldByName("oneof_string"));
+  std::string scratch;
+
+  EXPECT_EQ(oneof_uint32.GetUInt32(message), 0);
+  EXPECT_EQ(oneof_string.GetStringReference(message, &scratch), "");
+
+  oneof_uint32.SetUInt32(&message, 7);
+  EXPECT_TRUE(oneof_uint32.HasField(message));
+  EXPECT_EQ(message.oneof_uint32(), 7);
+  oneof_uint32.SetUInt32(&message, 8);
+  EXPECT_EQ(oneof_uint32.GetUInt32(message), 8);
+
+  // Switching the active member clears the other one.
+  oneof_string.SetString(&message, "abc");
+  EXPECT_FALSE(oneof_uint32.HasField(message));
+  EXPECT_TRUE(oneof_string.HasField(message));
+  EXPECT_EQ(oneof_uint32.GetUInt32(message), 0);
+  EXPECT_EQ(oneof_string.GetStringReference(message, &scratch), "abc");
+  EXPECT_EQ(message.oneof_string(), "abc");
+
+  oneof_string.SetString(&message, "defg");
+  EXPECT_EQ(message.oneof_string(), "defg");
+}
+
+TEST(CompiledFieldAccessorTest, Proto3ImplicitPresence) {
+  proto3_unittest::TestAllTypes message;
+  const Descriptor* descriptor = message.GetDescriptor();
+  CompiledFieldAccessor optional_int32(
+      message.GetReflection(), descriptor->FindFieldByName("optional_int32"));
+  CompiledFieldAccessor optional_string(
+      message.GetReflection(), descriptor->FindFieldByName("optional_string"));
+  CompiledFieldAccessor optional_nested_enum(
+      message.GetReflection(),
+      descriptor->FindFieldByName("optional_nested_enum"));
+  std::string scratch;
+
+  EXPECT_FALSE(optional_int32.HasField(message));
+  optional_int32.SetInt32(&message, 5);
+  EXPECT_TRUE(optional_int32.HasField(message));
+  EXPECT_EQ(message.optional_int32(), 5);
+  optional_int32.SetInt32(&message, 0);
+  EXPECT_FALSE(optional_int32.HasField(message));
+
+  optional_string.SetString(&message, "x");
+  EXPECT_TRUE(optional_string.HasField(message));
+  EXPECT_EQ(optional_string.GetStringReference(message, &scratch), "x");
+
+  // Open enums store unknown values in the field.
+  optional_nested_enum.SetEnumValue(&message, 12345);
+  EXPECT_EQ(optional_nested_enum.GetEnumValue(message), 12345);
+  EXPECT_EQ(message.optional_nested_enum(), 12345);
+}
+
+TEST(CompiledFieldAccessorTest, ClosedEnumUnknownValue) {
+  unittest::TestAllTypes message;
+  CompiledFieldAccessor accessor(
+      message.GetReflection(),
+      message.GetDescriptor()->FindFieldByName("optional_nested_enum"));
+
+  accessor.SetEnumValue(&message, unittest::TestAllTypes::BAR);
+  EXPECT_EQ(message.optional_nested_enum(), unittest::TestAllTypes::BAR);
+
+  accessor.SetEnumValue(&message, 12345);
+  EXPECT_EQ(accessor.GetEnumValue(message), unittest::TestAllTypes::BAR);
+  ASSERT_EQ(message.GetReflection()->GetUnknownFields(message).field_count(),
+            1);
+  EXPECT_EQ(
+      message.GetReflection()->GetUnknownFields(message).field(0).varint(),
+      12345);
+}
+
+TEST(CompiledFieldAccessorTest, Extensions) {
+  unittest::TestAllExtensions message;
+  CompiledFieldAccessor int32_extension(
+      message.GetReflection(),
+      DescriptorPool::generated_pool()->FindExtensionByName(
+          "protobuf_unittest.optional_int32_extension"));
+  CompiledFieldAccessor string_extension(
+      message.GetReflection(),
+      DescriptorPool::generated_pool()->FindExtensionByName(
+          "protobuf_unittest.optional_string_extension"));
+  std::string scratch;
+
+  EXPECT_FALSE(int32_extension.is_direct());
+  EXPECT_FALSE(int32_extension.HasField(message));
+  int32_extension.SetInt32(&message, 17);
+  string_extension.SetString(&message, "ext");
+  EXPECT_TRUE(int32_extension.HasField(message));
+  EXPECT_EQ(int32_extension.GetInt32(message), 17);
+  EXPECT_EQ(message.GetExtension(unittest::optional_int32_extension), 17);
+  EXPECT_EQ(string_extension.GetStringReference(message, &scratch), "ext");
+}
+
+TEST(CompiledFieldAccessorTest, Arena) {
+  Arena arena;
+  auto* message = Arena::CreateMessage<unittest::TestAllTypes>(&arena);
+  CompiledFieldAccessor accessor(
+      message->GetReflection(),
+      message->GetDescriptor()->FindFieldByName("optional_string"));
+
+  accessor.SetString(message, std::string(100, 'x'));
+  EXPECT_EQ(message->optional_string(), std::string(100, 'x'));
+  accessor.SetString(message, "short");
+  EXPECT_EQ(message->optional_string(), "short");
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,131 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/compiler/access_info_map.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+bool AccessInfoMap::Parse(absl::string_view contents, std::string* error) {
+  int line_number = 0;
+  for (absl::string_view line : absl::StrSplit(contents, '\n')) {
+    ++line_number;
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || line[0] == '#') continue;
+
+    std::vector<absl::string_view> parts =
+        absl::StrSplit(line, absl::ByAnyChar(" \t"), absl::SkipEmpty());
+    uint64_t count;
+    if (parts.size() != 2 || !absl::SimpleAtoi(parts[1], &count)) {
+      *error = absl::StrCat("line ", line_number,
+                            ": expected \"<field name> <count>\", got \"",
+                            line, "\"");
+      return false;
+    }
+    absl::string_view field_name = parts[0];
+    size_t dot = field_name.rfind('.');
+    if (dot == absl::string_view::npos || dot == 0 ||
+        dot == field_name.size() - 1) {
+      *error = absl::StrCat("line ", line_number,
+                            ": not a fully-qualified field name: \"",
+                            field_name, "\"");
+      return false;
+    }
+
+    uint64_t& total = field_counts_[field_name];
+    total += count;
+    uint64_t& max = max_counts_[field_name.substr(0, dot)];
+    max = std::max(max, total);
+  }
+  return true;
+}
+
+bool AccessInfoMap::ParseFile(const std::string& path, std::string* error) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  if (!input) {
+    *error = absl::StrCat(path, ": could not open access profile");
+    return false;
+  }
+  std::stringstream contents;
+  contents << input.rdbuf();
+  if (!Parse(contents.str(), error)) {
+    *error = absl::StrCat(path, ": ", *error);
+    return false;
+  }
+  return true;
+}
+
+uint64_t AccessInfoMap::MaxAccessCount(const Descriptor* descriptor) const {
+  auto it = max_counts_.find(descriptor->full_name());
+  return it == max_counts_.end() ? 0 : it->second;
+}
+
+bool AccessInfoMap::HasProfile(const Descriptor* descriptor) const {
+  return MaxAccessCount(descriptor) > 0;
+}
+
+uint64_t AccessInfoMap::AccessCount(const FieldDescriptor* field) const {
+  auto it = field_counts_.find(field->full_name());
+  return it == field_counts_.end() ? 0 : it->second;
+}
+
+bool AccessInfoMap::IsCold(const FieldDescriptor* field, double ratio) const {
+  if (field->is_extension()) return false;
+  uint64_t max = MaxAccessCount(field->containing_type());
+  return max > 0 && AccessCount(field) <= ratio * max;
+}
+
+bool AccessInfoMap::IsHot(const FieldDescriptor* field, double ratio) const {
+  if (field->is_extension()) return false;
+  uint64_t max = MaxAccessCount(field->containing_type());
+  uint64_t count = AccessCount(field);
+  return max > 0 && count > 0 && count >= ratio * max;
+}
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,131 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Field access profiles for profile-guided code generation.
+//
+// A profile is a text file with one line per field:
+//
+//   <fully-qualified field name> <access count>
+//
+// for example "foo.Bar.baz 1234".  Blank lines and lines starting with '#'
+// are ignored, and counts of fields that appear more than once are added up,
+// so profiles from several runs can simply be concatenated.
+// google::protobuf::GetFieldAccessProfile() (field_access_listener.h) writes
+// this format; the C++ generator reads it with the access_profile option.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_ACCESS_INFO_MAP_H__
+#define GOOGLE_PROTOBUF_COMPILER_ACCESS_INFO_MAP_H__
+
+#include <cstdint>
+#include <string>
+
+#include "google/protobuf/descriptor.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+// Per-field access counts loaded from a profile.
+//
+// Counts are only meaningful relative to the other fields of the same
+// message, so the predicates below compare a field against the most accessed
+// field of its message.  Messages without any recorded access have no
+// profile, and every predicate is false for their fields, as it is for
+// extensions.
+class PROTOC_EXPORT AccessInfoMap {
+ public:
+  AccessInfoMap() = default;
+  AccessInfoMap(const AccessInfoMap&) = delete;
+  AccessInfoMap& operator=(const AccessInfoMap&) = delete;
+
+  // Adds the counts in `contents`.  On failure returns false and sets
+  // `*error`; counts from lines before the bad one are kept.
+  bool Parse(absl::string_view contents, std::string* error);
+  // Like Parse() for the contents of the file at `path`.
+  bool ParseFile(const std::string& path, std::string* error);
+
+  // Returns true if any field of `descriptor` has been accessed.
+  bool HasProfile(const Descriptor* descriptor) const;
+
+  // Returns the number of recorded accesses of `field`.
+  uint64_t AccessCount(const FieldDescriptor* field) const;
+
+  // Returns true if `field` was accessed at most `ratio` times as often as
+  // the most accessed field of its message.
+  bool IsCold(const FieldDescriptor* field, double ratio) const;
+  // Returns true if `field` was accessed at least `ratio` times as often as
+  // the most accessed field of its message.
+  bool IsHot(const FieldDescriptor* field, double ratio) const;
+
+ private:
+  uint64_t MaxAccessCount(const Descriptor* descriptor) const;
+
+  // Keyed by the full name of the field.
+  absl::flat_hash_map<std::string, uint64_t> field_counts_;
+  // Keyed by the full name of the containing message.
+  absl::flat_hash_map<std::string, uint64_t> max_counts_;
+};
+
+// Decides which fields are moved out of line into the split struct of their
+// message (see ShouldSplit() in the C++ generator): those that the profile
+// shows to be cold.
+class PROTOC_EXPORT SplitMap {
+ public:
+  // Fields accessed at most this many times as often as the hottest field of
+  // their message are split by default.
+  static constexpr double kDefaultColdRatio = 0.005;
+
+  explicit SplitMap(const AccessInfoMap* access_info_map,
+                    double cold_ratio = kDefaultColdRatio)
+      : access_info_map_(access_info_map), cold_ratio_(cold_ratio) {}
+  SplitMap(const SplitMap&) = delete;
+  SplitMap& operator=(const SplitMap&) = delete;
+
+  bool ShouldSplit(const FieldDescriptor* field) const {
+    return access_info_map_->IsCold(field, cold_ratio_);
+  }
+
+ private:
+  const AccessInfoMap* access_info_map_;
+  double cold_ratio_;
+};
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_COMPILER_ACCESS_INFO_MAP_H__
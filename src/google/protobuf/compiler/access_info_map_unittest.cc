@@ -0,0 +1,215 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "google/protobuf/compiler/access_info_map.h"
+
+#include <string>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/field_access_listener.h"
+#include "google/protobuf/unittest.pb.h"
+#include <gtest/gtest.h>
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/compiler/cpp/helpers.h"
+#include "google/protobuf/compiler/cpp/options.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace {
+
+const FieldDescriptor* Field(absl::string_view name) {
+  const FieldDescriptor* field =
+      protobuf_unittest::TestAllTypes::descriptor()->FindFieldByName(
+          std::string(name));
+  GOOGLE_CHECK(field != nullptr) << name;
+  return field;
+}
+
+TEST(AccessInfoMapTest, ParsesCounts) {
+  AccessInfoMap map;
+  std::string error;
+  ASSERT_TRUE(map.Parse(
+      "# comment\n"
+      "protobuf_unittest.TestAllTypes.optional_int32 1000\n"
+      "\n"
+      "  protobuf_unittest.TestAllTypes.optional_string\t40  \n"
+      "protobuf_unittest.TestAllTypes.optional_string 60\n",
+      &error))
+      << error;
+
+  EXPECT_TRUE(map.HasProfile(protobuf_unittest::TestAllTypes::descriptor()));
+  EXPECT_FALSE(
+      map.HasProfile(protobuf_unittest::TestPackedTypes::descriptor()));
+  EXPECT_EQ(1000, map.AccessCount(Field("optional_int32")));
+  EXPECT_EQ(100, map.AccessCount(Field("optional_string")));
+  EXPECT_EQ(0, map.AccessCount(Field("optional_bytes")));
+}
+
+TEST(AccessInfoMapTest, RejectsMalformedLines) {
+  std::string error;
+  EXPECT_FALSE(AccessInfoMap().Parse("foo.Bar.baz\n", &error));
+  EXPECT_EQ("line 1: expected \"<field name> <count>\", got \"foo.Bar.baz\"",
+            error);
+  EXPECT_FALSE(
+      AccessInfoMap().Parse("foo.Bar.baz 1\nfoo.Bar.qux -1\n", &error));
+  EXPECT_EQ("line 2: expected \"<field name> <count>\", got \"foo.Bar.qux -1\"",
+            error);
+  EXPECT_FALSE(AccessInfoMap().Parse("baz 1\n", &error));
+  EXPECT_EQ("line 1: not a fully-qualified field name: \"baz\"", error);
+}
+
+TEST(AccessInfoMapTest, ClassifiesRelativeToHottestField) {
+  AccessInfoMap map;
+  std::string error;
+  ASSERT_TRUE(map.Parse(
+      "protobuf_unittest.TestAllTypes.optional_int32 1000\n"
+      "protobuf_unittest.TestAllTypes.optional_int64 500\n"
+      "protobuf_unittest.TestAllTypes.optional_uint32 5\n",
+      &error));
+
+  EXPECT_TRUE(map.IsHot(Field("optional_int32"), 0.5));
+  EXPECT_TRUE(map.IsHot(Field("optional_int64"), 0.5));
+  EXPECT_FALSE(map.IsHot(Field("optional_uint32"), 0.5));
+  EXPECT_FALSE(map.IsHot(Field("optional_uint64"), 0.0));
+
+  EXPECT_FALSE(map.IsCold(Field("optional_int64"), 0.005));
+  EXPECT_TRUE(map.IsCold(Field("optional_uint32"), 0.005));
+  EXPECT_TRUE(map.IsCold(Field("optional_uint64"), 0.005));
+
+  // Without a profile for the message nothing is hot or cold.
+  const FieldDescriptor* packed =
+      protobuf_unittest::TestPackedTypes::descriptor()->field(0);
+  EXPECT_FALSE(map.IsHot(packed, 0.0));
+  EXPECT_FALSE(map.IsCold(packed, 1.0));
+  const FieldDescriptor* extension =
+      DescriptorPool::generated_pool()->FindExtensionByName(
+          "protobuf_unittest.optional_int32_extension");
+  ASSERT_TRUE(extension != nullptr);
+  EXPECT_FALSE(map.IsCold(extension, 1.0));
+
+  SplitMap split_map(&map);
+  EXPECT_FALSE(split_map.ShouldSplit(Field("optional_int64")));
+  EXPECT_TRUE(split_map.ShouldSplit(Field("optional_uint32")));
+}
+
+TEST(AccessInfoMapTest, DrivesCppGeneratorDecisions) {
+  AccessInfoMap map;
+  std::string error;
+  ASSERT_TRUE(map.Parse(
+      "protobuf_unittest.TestAllTypes.optional_string 1000\n"
+      "protobuf_unittest.TestAllTypes.default_string 1000\n"
+      "protobuf_unittest.TestAllTypes.optional_int32 1\n"
+      "protobuf_unittest.TestAllTypes.oneof_uint32 1\n",
+      &error));
+  SplitMap split_map(&map);
+  cpp::Options options;
+  options.access_info_map = &map;
+  options.split_map = &split_map;
+
+  EXPECT_TRUE(cpp::ShouldSplit(protobuf_unittest::TestAllTypes::descriptor(),
+                               options));
+  EXPECT_TRUE(cpp::ShouldSplit(Field("optional_int32"), options));
+  EXPECT_FALSE(cpp::ShouldSplit(Field("optional_string"), options));
+  // Oneof members keep their own storage.
+  EXPECT_FALSE(cpp::ShouldSplit(Field("oneof_uint32"), options));
+
+  EXPECT_TRUE(cpp::IsStringInlined(Field("optional_string"), options));
+  // Strings with a default value need the default instance.
+  EXPECT_FALSE(cpp::IsStringInlined(Field("default_string"), options));
+  // Cold strings are split rather than inlined.
+  EXPECT_TRUE(cpp::ShouldSplit(Field("optional_bytes"), options));
+  EXPECT_FALSE(cpp::IsStringInlined(Field("optional_bytes"), options));
+
+  options.profile_driven_split = false;
+  options.profile_driven_inline_string = false;
+  EXPECT_FALSE(cpp::ShouldSplit(Field("optional_int32"), options));
+  EXPECT_FALSE(cpp::IsStringInlined(Field("optional_string"), options));
+}
+
+TEST(AccessInfoMapTest, NoListenersInLiteCode) {
+  // GetFieldAccessProfile() names fields through descriptors, so lite code,
+  // including code made lite by the generator's lite option, has no listener.
+  cpp::Options options;
+  options.field_listener_options.inject_field_listener_events = true;
+  const Descriptor* descriptor = protobuf_unittest::TestAllTypes::descriptor();
+  EXPECT_TRUE(cpp::HasTracker(descriptor, options));
+  options.enforce_mode = cpp::EnforceOptimizeMode::kLiteRuntime;
+  EXPECT_FALSE(cpp::HasTracker(descriptor, options));
+}
+
+// Stands in for TestAllTypes generated with inject_field_listener_events.
+struct ProfiledTestAllTypes {
+  static constexpr int _kInternalFieldNumber = 76;
+  static absl::string_view FullMessageName() {
+    return "protobuf_unittest.TestAllTypes";
+  }
+};
+
+TEST(AccessInfoMapTest, ReadsCountingAccessListenerProfile) {
+  const Descriptor* descriptor = protobuf_unittest::TestAllTypes::descriptor();
+  ASSERT_EQ(ProfiledTestAllTypes::_kInternalFieldNumber,
+            descriptor->field_count());
+  static CountingAccessListener<ProfiledTestAllTypes> listener(
+      &ProfiledTestAllTypes::FullMessageName);
+  ResetFieldAccessProfile();
+
+  constexpr int kInt32Index = 0;
+  constexpr int kStringIndex = 13;
+  ASSERT_EQ(kInt32Index, Field("optional_int32")->index());
+  ASSERT_EQ(kStringIndex, Field("optional_string")->index());
+  for (int i = 0; i < 3; ++i) {
+    listener.OnGet<kInt32Index>(nullptr, nullptr);
+  }
+  listener.OnSet<kStringIndex>(nullptr, nullptr);
+
+  std::string profile = GetFieldAccessProfile();
+  EXPECT_TRUE(absl::StrContains(
+      profile, "protobuf_unittest.TestAllTypes.optional_int32 3\n"))
+      << profile;
+
+  AccessInfoMap map;
+  std::string error;
+  ASSERT_TRUE(map.Parse(profile, &error)) << error;
+  EXPECT_EQ(3, map.AccessCount(Field("optional_int32")));
+  EXPECT_EQ(1, map.AccessCount(Field("optional_string")));
+  EXPECT_EQ(0, map.AccessCount(Field("optional_int64")));
+
+  ResetFieldAccessProfile();
+  EXPECT_FALSE(absl::StrContains(GetFieldAccessProfile(),
+                                 "protobuf_unittest.TestAllTypes."));
+}
+
+}  // namespace
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
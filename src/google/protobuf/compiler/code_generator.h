@@ -118,6 +118,15 @@ class PROTOC_EXPORT CodeGenerator {
   // This must be a bitwise OR of values from the Feature enum above (or zero).
   virtual uint64_t GetSupportedFeatures() const { return 0; }
 
+  // Returns true if GenerateAll() may be called concurrently from multiple
+  // threads, each call with a single file and its own GeneratorContext.
+  // CommandLineInterface uses this (with --jobs) to generate independent
+  // files in parallel.  Generators that keep mutable state across calls, or
+  // whose output for one file depends on the others, must leave this false;
+  // they are still run in parallel with other generators, but each of their
+  // GenerateAll() calls sees every file at once, exactly as before.
+  virtual bool SupportsConcurrentGeneration() const { return false; }
+
   // This is no longer used, but this class is part of the opensource protobuf
   // library, so it has to remain to keep vtables the same for the current
   // version of the library. When protobufs does a api breaking change, the
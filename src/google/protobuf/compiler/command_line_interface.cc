@@ -56,6 +56,8 @@
 #include <ctype.h>
 #include <errno.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 
@@ -63,6 +65,7 @@
 
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -78,11 +81,13 @@
 #include "google/protobuf/compiler/plugin.pb.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/compiler/code_generator.h"
 #include "google/protobuf/compiler/importer.h"
 #include "google/protobuf/compiler/zip_writer.h"
@@ -897,6 +902,126 @@ CommandLineInterface::MemoryOutputStream::~MemoryOutputStream() {
   UpdateMetadata(data_, pos, data_.size() + indent_size, indent_.size());
 }
 
+// -------------------------------------------------------------------
+
+// A GeneratorContext that only records what is written to it, so that a
+// generator can run on a worker thread and have its output applied to the
+// real GeneratorContextImpl later (see GenerateOutputInParallel()).  Streams
+// are recorded in the order they are closed, which is the order in which
+// MemoryOutputStream would have applied them.
+class CommandLineInterface::RecordingGeneratorContext
+    : public GeneratorContext {
+ public:
+  explicit RecordingGeneratorContext(
+      const std::vector<const FileDescriptor*>& parsed_files)
+      : parsed_files_(parsed_files) {}
+
+  // Re-opens every recorded stream on target and writes the recorded data.
+  void Replay(GeneratorContext* target) const;
+
+  // implements GeneratorContext --------------------------------------
+  io::ZeroCopyOutputStream* Open(const std::string& filename) override {
+    return NewStream(Output::kOpen, filename, "", nullptr);
+  }
+  io::ZeroCopyOutputStream* OpenForAppend(
+      const std::string& filename) override {
+    return NewStream(Output::kAppend, filename, "", nullptr);
+  }
+  io::ZeroCopyOutputStream* OpenForInsert(
+      const std::string& filename,
+      const std::string& insertion_point) override {
+    return NewStream(Output::kInsert, filename, insertion_point, nullptr);
+  }
+  io::ZeroCopyOutputStream* OpenForInsertWithGeneratedCodeInfo(
+      const std::string& filename, const std::string& insertion_point,
+      const google::protobuf::GeneratedCodeInfo& info) override {
+    return NewStream(Output::kInsert, filename, insertion_point, &info);
+  }
+  void ListParsedFiles(std::vector<const FileDescriptor*>* output) override {
+    *output = parsed_files_;
+  }
+
+ private:
+  struct Output {
+    enum Kind { kOpen, kAppend, kInsert };
+    Kind kind;
+    std::string filename;
+    std::string insertion_point;
+    std::unique_ptr<google::protobuf::GeneratedCodeInfo> info;
+    std::string data;
+  };
+
+  // Collects data into an Output and hands it back to the context when
+  // destroyed.
+  class RecordingOutputStream : public io::ZeroCopyOutputStream {
+   public:
+    RecordingOutputStream(RecordingGeneratorContext* context,
+                          std::unique_ptr<Output> output)
+        : context_(context),
+          output_(std::move(output)),
+          inner_(&output_->data) {}
+    ~RecordingOutputStream() override {
+      context_->outputs_.push_back(std::move(output_));
+    }
+
+    // implements ZeroCopyOutputStream -------------------------------
+    bool Next(void** data, int* size) override {
+      return inner_.Next(data, size);
+    }
+    void BackUp(int count) override { inner_.BackUp(count); }
+    int64_t ByteCount() const override { return inner_.ByteCount(); }
+
+   private:
+    RecordingGeneratorContext* context_;
+    std::unique_ptr<Output> output_;
+    io::StringOutputStream inner_;
+  };
+
+  io::ZeroCopyOutputStream* NewStream(
+      Output::Kind kind, const std::string& filename,
+      const std::string& insertion_point,
+      const google::protobuf::GeneratedCodeInfo* info) {
+    auto output = std::make_unique<Output>();
+    output->kind = kind;
+    output->filename = filename;
+    output->insertion_point = insertion_point;
+    if (info != nullptr) {
+      output->info =
+          std::make_unique<google::protobuf::GeneratedCodeInfo>(*info);
+    }
+    return new RecordingOutputStream(this, std::move(output));
+  }
+
+  const std::vector<const FileDescriptor*>& parsed_files_;
+  std::vector<std::unique_ptr<Output>> outputs_;
+};
+
+void CommandLineInterface::RecordingGeneratorContext::Replay(
+    GeneratorContext* target) const {
+  for (const auto& output : outputs_) {
+    std::unique_ptr<io::ZeroCopyOutputStream> stream;
+    switch (output->kind) {
+      case Output::kOpen:
+        stream.reset(target->Open(output->filename));
+        break;
+      case Output::kAppend:
+        stream.reset(target->OpenForAppend(output->filename));
+        break;
+      case Output::kInsert:
+        if (output->info != nullptr) {
+          stream.reset(target->OpenForInsertWithGeneratedCodeInfo(
+              output->filename, output->insertion_point, *output->info));
+        } else {
+          stream.reset(target->OpenForInsert(output->filename,
+                                             output->insertion_point));
+        }
+        break;
+    }
+    io::CodedOutputStream writer(stream.get());
+    writer.WriteString(output->data);
+  }
+}
+
 // ===================================================================
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
@@ -995,6 +1120,7 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
       databases_per_descriptor_set;
   std::unique_ptr<MergedDescriptorDatabase> descriptor_set_in_database;
 
+  std::unique_ptr<DiskParseCache> parse_cache;
   std::unique_ptr<SourceTreeDescriptorDatabase> source_tree_database;
 
   // Any --descriptor_set_in FileDescriptorSet objects will be used as a
@@ -1045,6 +1171,10 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
     source_tree_database.reset(new SourceTreeDescriptorDatabase(
         disk_source_tree.get(), descriptor_set_in_database.get()));
     source_tree_database->RecordErrorsTo(error_collector.get());
+    if (!descriptor_cache_dir_.empty()) {
+      parse_cache.reset(new DiskParseCache(descriptor_cache_dir_));
+      source_tree_database->UseParseCache(parse_cache.get());
+    }
 
     descriptor_pool.reset(new DescriptorPool(
         source_tree_database.get(),
@@ -1065,6 +1195,7 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
 
   // Generate output.
   if (mode_ == MODE_COMPILE) {
+    std::vector<GeneratorContextImpl*> contexts;
     for (int i = 0; i < output_directives_.size(); i++) {
       std::string output_location = output_directives_[i].output_location;
       if (!absl::EndsWith(output_location, ".zip") &&
@@ -1079,11 +1210,20 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
         // First time we've seen this output location.
         generator = std::make_unique<GeneratorContextImpl>(parsed_files);
       }
+      contexts.push_back(generator.get());
+    }
 
-      if (!GenerateOutput(parsed_files, output_directives_[i],
-                          generator.get())) {
+    if (jobs_ > 1) {
+      if (!GenerateOutputInParallel(parsed_files, contexts)) {
         return 1;
       }
+    } else {
+      for (int i = 0; i < output_directives_.size(); i++) {
+        if (!GenerateOutput(parsed_files, output_directives_[i],
+                            contexts[i])) {
+          return 1;
+        }
+      }
     }
   }
 
@@ -1334,6 +1474,7 @@ void CommandLineInterface::Clear() {
   descriptor_set_in_names_.clear();
   descriptor_set_out_name_.clear();
   dependency_out_name_.clear();
+  descriptor_cache_dir_.clear();
 
 
   mode_ = MODE_COMPILE;
@@ -1343,6 +1484,7 @@ void CommandLineInterface::Clear() {
   disallow_services_ = false;
   direct_dependencies_explicitly_set_ = false;
   deterministic_output_ = false;
+  jobs_ = 1;
 }
 
 bool CommandLineInterface::MakeProtoProtoPathRelative(
@@ -1826,6 +1968,17 @@ CommandLineInterface::InterpretArgument(const std::string& name,
     }
     dependency_out_name_ = value;
 
+  } else if (name == "--descriptor_cache_dir") {
+    if (!descriptor_cache_dir_.empty()) {
+      std::cerr << name << " may only be passed once." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    if (value.empty()) {
+      std::cerr << name << " requires a non-empty value." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    descriptor_cache_dir_ = value;
+
   } else if (name == "--include_imports") {
     if (imports_in_descriptor_set_) {
       std::cerr << name << " may only be passed once." << std::endl;
@@ -1907,6 +2060,11 @@ CommandLineInterface::InterpretArgument(const std::string& name,
       return PARSE_ARGUMENT_FAIL;
     }
     fatal_warnings_ = true;
+  } else if (name == "--jobs") {
+    if (!absl::SimpleAtoi(value, &jobs_) || jobs_ < 1) {
+      std::cerr << "Invalid value for --jobs: " << value << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
   } else if (name == "--plugin") {
     if (plugin_prefix_.empty()) {
       std::cerr << "This compiler does not support plugins." << std::endl;
@@ -2079,6 +2237,10 @@ Parse PROTO_FILES and generate output based on the options given:
   --dependency_out=FILE       Write a dependency output file in the format
                               expected by make. This writes the transitive
                               set of input file paths to FILE
+  --descriptor_cache_dir=DIR  Cache the result of parsing each .proto file in
+                              DIR, which must exist, and reuse it as long as
+                              the file's contents are unchanged.  DIR may be
+                              shared by concurrent invocations of protoc.
   --error_format=FORMAT       Set the format in which to print errors.
                               FORMAT may be 'gcc' (the default) or 'msvs'
                               (Microsoft Visual Studio format).
@@ -2086,6 +2248,10 @@ Parse PROTO_FILES and generate output based on the options given:
                               gcc). This flag will make protoc return
                               with a non-zero exit code if any warnings
                               are generated.
+  --jobs=N                    Run up to N code generators (including
+                              plugins) at the same time.  Output is
+                              identical to a sequential run.  Defaults
+                              to 1.
   --print_free_field_numbers  Print the free field numbers of the messages
                               defined in the given proto files. Groups share
                               the same field number space with the parent
@@ -2155,12 +2321,33 @@ bool CommandLineInterface::EnforceProto3OptionalSupport(
   return true;
 }
 
+std::string CommandLineInterface::GetOutputParameters(
+    const OutputDirective& output_directive) const {
+  const absl::flat_hash_map<std::string, std::string>& extra_parameters =
+      output_directive.generator == nullptr ? plugin_parameters_
+                                            : generator_parameters_;
+  auto it = extra_parameters.find(
+      output_directive.generator == nullptr
+          ? PluginName(plugin_prefix_, output_directive.name)
+          : output_directive.name);
+
+  std::string parameters = output_directive.parameter;
+  if (it != extra_parameters.end() && !it->second.empty()) {
+    if (!parameters.empty()) {
+      parameters.append(",");
+    }
+    parameters.append(it->second);
+  }
+  return parameters;
+}
+
 bool CommandLineInterface::GenerateOutput(
     const std::vector<const FileDescriptor*>& parsed_files,
     const OutputDirective& output_directive,
     GeneratorContext* generator_context) {
   // Call the generator.
   std::string error;
+  std::string parameters = GetOutputParameters(output_directive);
   if (output_directive.generator == nullptr) {
     // This is a plugin.
     GOOGLE_CHECK(absl::StartsWith(output_directive.name, "--") &&
@@ -2168,13 +2355,6 @@ bool CommandLineInterface::GenerateOutput(
         << "Bad name for plugin generator: " << output_directive.name;
 
     std::string plugin_name = PluginName(plugin_prefix_, output_directive.name);
-    std::string parameters = output_directive.parameter;
-    if (!plugin_parameters_[plugin_name].empty()) {
-      if (!parameters.empty()) {
-        parameters.append(",");
-      }
-      parameters.append(plugin_parameters_[plugin_name]);
-    }
     if (!GeneratePluginOutput(parsed_files, plugin_name, parameters,
                               generator_context, &error)) {
       std::cerr << output_directive.name << ": " << error << std::endl;
@@ -2182,13 +2362,6 @@ bool CommandLineInterface::GenerateOutput(
     }
   } else {
     // Regular generator.
-    std::string parameters = output_directive.parameter;
-    if (!generator_parameters_[output_directive.name].empty()) {
-      if (!parameters.empty()) {
-        parameters.append(",");
-      }
-      parameters.append(generator_parameters_[output_directive.name]);
-    }
     if (!EnforceProto3OptionalSupport(
             output_directive.name,
             output_directive.generator->GetSupportedFeatures(), parsed_files)) {
@@ -2206,6 +2379,151 @@ bool CommandLineInterface::GenerateOutput(
   return true;
 }
 
+bool CommandLineInterface::GenerateOutputInParallel(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const std::vector<GeneratorContextImpl*>& contexts) {
+  // A unit of work that can run on any thread.  Plugins are run once per
+  // directive; built-in generators that support it are run once per file,
+  // and the rest once per directive.  Nothing here touches the real
+  // GeneratorContexts: results are applied afterwards, on this thread.
+  struct Task {
+    const OutputDirective* directive;
+    std::string plugin_name;
+    std::string parameters;
+    std::vector<const FileDescriptor*> files;
+    absl::Mutex* generator_mutex = nullptr;
+
+    std::unique_ptr<RecordingGeneratorContext> recording;
+    CodeGeneratorResponse response;
+    bool success = false;
+    std::string error;
+  };
+
+  // The tasks for output_directives_[i] are
+  // tasks[first_task[i]] .. tasks[first_task[i + 1] - 1].
+  std::vector<std::unique_ptr<Task>> tasks;
+  std::vector<size_t> first_task;
+  // Generators which aren't known to be thread-safe may still appear in more
+  // than one directive, so calls into each of them are serialized.
+  absl::flat_hash_map<const CodeGenerator*, std::unique_ptr<absl::Mutex>>
+      generator_mutexes;
+
+  for (const OutputDirective& directive : output_directives_) {
+    first_task.push_back(tasks.size());
+    std::string parameters = GetOutputParameters(directive);
+
+    if (directive.generator == nullptr) {
+      GOOGLE_CHECK(absl::StartsWith(directive.name, "--") &&
+            absl::EndsWith(directive.name, "_out"))
+          << "Bad name for plugin generator: " << directive.name;
+      auto task = std::make_unique<Task>();
+      task->directive = &directive;
+      task->plugin_name = PluginName(plugin_prefix_, directive.name);
+      task->parameters = parameters;
+      tasks.push_back(std::move(task));
+      continue;
+    }
+
+    // This directive is going to fail anyway; the error is reported below.
+    if (!(directive.generator->GetSupportedFeatures() &
+          CodeGenerator::FEATURE_PROTO3_OPTIONAL) &&
+        std::any_of(parsed_files.begin(), parsed_files.end(),
+                    [](const FileDescriptor* file) {
+                      return ContainsProto3Optional(file);
+                    })) {
+      continue;
+    }
+
+    if (directive.generator->SupportsConcurrentGeneration()) {
+      for (const FileDescriptor* file : parsed_files) {
+        auto task = std::make_unique<Task>();
+        task->directive = &directive;
+        task->parameters = parameters;
+        task->files.push_back(file);
+        tasks.push_back(std::move(task));
+      }
+    } else {
+      auto& mutex = generator_mutexes[directive.generator];
+      if (mutex == nullptr) mutex = std::make_unique<absl::Mutex>();
+      auto task = std::make_unique<Task>();
+      task->directive = &directive;
+      task->parameters = parameters;
+      task->files = parsed_files;
+      task->generator_mutex = mutex.get();
+      tasks.push_back(std::move(task));
+    }
+  }
+  first_task.push_back(tasks.size());
+
+  std::atomic<size_t> next_task(0);
+  auto run_tasks = [&] {
+    for (size_t i = next_task++; i < tasks.size(); i = next_task++) {
+      Task* task = tasks[i].get();
+      if (task->directive->generator == nullptr) {
+        task->success = RunPlugin(parsed_files, task->plugin_name,
+                                  task->parameters, &task->response,
+                                  &task->error);
+      } else {
+        task->recording =
+            std::make_unique<RecordingGeneratorContext>(parsed_files);
+        absl::MutexLockMaybe lock(task->generator_mutex);
+        task->success = task->directive->generator->GenerateAll(
+            task->files, task->parameters, task->recording.get(),
+            &task->error);
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  size_t num_workers = std::min<size_t>(jobs_, tasks.size());
+  for (size_t i = 1; i < num_workers; i++) {
+    workers.emplace_back(run_tasks);
+  }
+  run_tasks();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  // Apply the results in the order GenerateOutput() would have produced
+  // them, stopping at the first error.
+  for (size_t i = 0; i < output_directives_.size(); i++) {
+    const OutputDirective& directive = output_directives_[i];
+    if (directive.generator != nullptr &&
+        !EnforceProto3OptionalSupport(
+            directive.name, directive.generator->GetSupportedFeatures(),
+            parsed_files)) {
+      return false;
+    }
+
+    for (size_t j = first_task[i]; j < first_task[i + 1]; j++) {
+      Task* task = tasks[j].get();
+      if (directive.generator == nullptr) {
+        if (!task->success ||
+            !WritePluginOutput(parsed_files, task->plugin_name, task->response,
+                               contexts[i], &task->error)) {
+          std::cerr << directive.name << ": " << task->error << std::endl;
+          return false;
+        }
+        continue;
+      }
+
+      task->recording->Replay(contexts[i]);
+      if (!task->success) {
+        // Generator returned an error.
+        std::cerr << directive.name << ": " << task->error << std::endl;
+        return false;
+      }
+      if (!task->error.empty()) {
+        // CodeGenerator::GenerateAll() stops after the first file that
+        // reports an error, even when it succeeds; so do we.
+        break;
+      }
+    }
+  }
+
+  return true;
+}
+
 bool CommandLineInterface::GenerateDependencyManifestFile(
     const std::vector<const FileDescriptor*>& parsed_files,
     const GeneratorContextMap& output_directories,
@@ -2282,8 +2600,17 @@ bool CommandLineInterface::GeneratePluginOutput(
     const std::vector<const FileDescriptor*>& parsed_files,
     const std::string& plugin_name, const std::string& parameter,
     GeneratorContext* generator_context, std::string* error) {
-  CodeGeneratorRequest request;
   CodeGeneratorResponse response;
+  return RunPlugin(parsed_files, plugin_name, parameter, &response, error) &&
+         WritePluginOutput(parsed_files, plugin_name, response,
+                           generator_context, error);
+}
+
+bool CommandLineInterface::RunPlugin(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const std::string& plugin_name, const std::string& parameter,
+    CodeGeneratorResponse* response, std::string* error) const {
+  CodeGeneratorRequest request;
   std::string processed_parameter = parameter;
 
 
@@ -2312,18 +2639,26 @@ bool CommandLineInterface::GeneratePluginOutput(
   // Invoke the plugin.
   Subprocess subprocess;
 
-  if (plugins_.count(plugin_name) > 0) {
-    subprocess.Start(plugins_[plugin_name], Subprocess::EXACT_NAME);
+  auto it = plugins_.find(plugin_name);
+  if (it != plugins_.end()) {
+    subprocess.Start(it->second, Subprocess::EXACT_NAME);
   } else {
     subprocess.Start(plugin_name, Subprocess::SEARCH_PATH);
   }
 
   std::string communicate_error;
-  if (!subprocess.Communicate(request, &response, &communicate_error)) {
+  if (!subprocess.Communicate(request, response, &communicate_error)) {
     *error = absl::Substitute("$0: $1", plugin_name, communicate_error);
     return false;
   }
 
+  return true;
+}
+
+bool CommandLineInterface::WritePluginOutput(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const std::string& plugin_name, const CodeGeneratorResponse& response,
+    GeneratorContext* generator_context, std::string* error) const {
   // Write the files.  We do this even if there was a generator error in order
   // to match the behavior of a compiled-in generator.
   std::unique_ptr<io::ZeroCopyOutputStream> current_output;
@@ -69,9 +69,10 @@ class SimpleDescriptorDatabase;  // descriptor_database.h
 
 namespace compiler {
 
-class CodeGenerator;     // code_generator.h
-class GeneratorContext;  // code_generator.h
-class DiskSourceTree;    // importer.h
+class CodeGenerator;          // code_generator.h
+class CodeGeneratorResponse;  // plugin.pb.h
+class GeneratorContext;       // code_generator.h
+class DiskSourceTree;         // importer.h
 
 // This class implements the command-line interface to the protocol compiler.
 // It is designed to make it very easy to create a custom protocol compiler
@@ -215,6 +216,7 @@ class PROTOC_EXPORT CommandLineInterface {
   class ErrorPrinter;
   class GeneratorContextImpl;
   class MemoryOutputStream;
+  class RecordingGeneratorContext;
   using GeneratorContextMap =
       absl::flat_hash_map<std::string, std::unique_ptr<GeneratorContextImpl>>;
 
@@ -296,6 +298,31 @@ class PROTOC_EXPORT CommandLineInterface {
       const std::string& plugin_name, const std::string& parameter,
       GeneratorContext* generator_context, std::string* error);
 
+  // Implements --jobs: runs every output directive concurrently on up to
+  // jobs_ threads, then applies the results to the contexts (which are
+  // parallel to output_directives_) in the same order GenerateOutput() would
+  // have.  Prints errors and returns false on the first failure.
+  bool GenerateOutputInParallel(
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const std::vector<GeneratorContextImpl*>& contexts);
+
+  // Returns the parameter string for the given directive: the one given in
+  // the _out flag combined with any matching _opt flag.
+  std::string GetOutputParameters(
+      const OutputDirective& output_directive) const;
+
+  // The two halves of GeneratePluginOutput().  RunPlugin() only builds the
+  // request and talks to the subprocess, so it may be called from several
+  // threads at once; WritePluginOutput() applies the response.
+  bool RunPlugin(const std::vector<const FileDescriptor*>& parsed_files,
+                 const std::string& plugin_name, const std::string& parameter,
+                 CodeGeneratorResponse* response, std::string* error) const;
+  bool WritePluginOutput(const std::vector<const FileDescriptor*>& parsed_files,
+                         const std::string& plugin_name,
+                         const CodeGeneratorResponse& response,
+                         GeneratorContext* generator_context,
+                         std::string* error) const;
+
   // Implements --encode and --decode.
   bool EncodeOrDecode(const DescriptorPool* pool);
 
@@ -443,6 +470,10 @@ class PROTOC_EXPORT CommandLineInterface {
   // dependency file will be written. Otherwise, empty.
   std::string dependency_out_name_;
 
+  // If --descriptor_cache_dir was given, parsed .proto files are cached in
+  // this directory (see DiskParseCache).  Otherwise, empty.
+  std::string descriptor_cache_dir_;
+
   // True if --include_imports was given, meaning that we should
   // write all transitive dependencies to the DescriptorSet.  Otherwise, only
   // the .proto files listed on the command-line are added.
@@ -457,6 +488,10 @@ class PROTOC_EXPORT CommandLineInterface {
 
   // When using --encode, this will be passed to SetSerializationDeterministic.
   bool deterministic_output_ = false;
+
+  // Number of threads to use for code generation (--jobs).  1 means
+  // generate everything sequentially on the calling thread.
+  int jobs_ = 1;
 };
 
 }  // namespace compiler
@@ -1227,6 +1227,108 @@ TEST_F(CommandLineInterfaceTest, InsertWithAnnotationFixup) {
   CheckGeneratedAnnotations("test_plugin", "foo.proto");
 }
 
+TEST_F(CommandLineInterfaceTest, DescriptorCacheDir) {
+  // The second run parses foo.proto from the cache, and must behave the same
+  // way, including where errors are reported.
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo { optional Bar bar = 1; }\n");
+  CreateTempDir("cache");
+
+  for (int i = 0; i < 2; i++) {
+    Run("protocol_compiler --descriptor_cache_dir=$tmpdir/cache "
+        "--test_out=$tmpdir --proto_path=$tmpdir foo.proto");
+    ExpectErrorText("foo.proto:2:24: \"Bar\" is not defined.\n");
+  }
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  for (int i = 0; i < 2; i++) {
+    Run("protocol_compiler --descriptor_cache_dir=$tmpdir/cache "
+        "--test_out=$tmpdir --proto_path=$tmpdir foo.proto");
+    ExpectNoErrors();
+    ExpectGenerated("test_generator", "", "foo.proto", "Foo");
+  }
+}
+
+TEST_F(CommandLineInterfaceTest, Jobs) {
+  // Test that running generators and plugins in parallel produces the same
+  // output as running them one at a time.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Bar {}\n");
+
+  Run("protocol_compiler --jobs=4 --test_out=$tmpdir --plug_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto bar.proto");
+
+  ExpectNoErrors();
+  ExpectGeneratedWithMultipleInputs("test_generator", "foo.proto,bar.proto",
+                                    "foo.proto", "Foo");
+  ExpectGeneratedWithMultipleInputs("test_generator", "foo.proto,bar.proto",
+                                    "bar.proto", "Bar");
+  ExpectGeneratedWithMultipleInputs("test_plugin", "foo.proto,bar.proto",
+                                    "foo.proto", "Foo");
+  ExpectGeneratedWithMultipleInputs("test_plugin", "foo.proto,bar.proto",
+                                    "bar.proto", "Bar");
+}
+
+TEST_F(CommandLineInterfaceTest, JobsInsert) {
+  // Insertions are applied in command-line order even when the generators
+  // run in parallel.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+
+  Run("protocol_compiler --jobs=4 "
+      "--test_out=TestParameter:$tmpdir "
+      "--plug_out=TestPluginParameter:$tmpdir "
+      "--test_out=insert=test_generator,test_plugin:$tmpdir "
+      "--plug_out=insert=test_generator,test_plugin:$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+
+  ExpectNoErrors();
+  ExpectGeneratedWithInsertions("test_generator", "TestParameter",
+                                "test_generator,test_plugin", "foo.proto",
+                                "Foo");
+  ExpectGeneratedWithInsertions("test_plugin", "TestPluginParameter",
+                                "test_generator,test_plugin", "foo.proto",
+                                "Foo");
+}
+
+TEST_F(CommandLineInterfaceTest, JobsGeneratorError) {
+  // Errors are reported for the first failing file, as in a sequential run.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message MockCodeGenerator_Error {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "package bar;\n"
+                 "message MockCodeGenerator_Error {}\n");
+
+  Run("protocol_compiler --jobs=2 --test_out=$tmpdir --plug_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto bar.proto");
+
+  ExpectErrorText(
+      "--test_out: foo.proto: Saw message type MockCodeGenerator_Error.\n");
+}
+
+TEST_F(CommandLineInterfaceTest, InvalidJobs) {
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+
+  Run("protocol_compiler --jobs=0 --test_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+  ExpectErrorText("Invalid value for --jobs: 0\n");
+}
+
 #if defined(_WIN32)
 
 TEST_F(CommandLineInterfaceTest, WindowsOutputPath) {
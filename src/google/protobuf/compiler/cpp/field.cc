@@ -78,13 +78,11 @@ void MaySetAnnotationVariable(
 }
 
 std::string GenerateTemplateForOneofString(const FieldDescriptor* descriptor,
-                                           absl::string_view proto_ns,
+                                           const Options& options,
                                            absl::string_view field_member) {
   std::string field_name = google::protobuf::compiler::cpp::FieldName(descriptor);
   std::string field_pointer =
-      descriptor->options().ctype() == google::protobuf::FieldOptions::STRING
-          ? "$0.UnsafeGetPointer()"
-          : "$0";
+      IsString(descriptor, options) ? "$0.UnsafeGetPointer()" : "$0";
   std::string has_field = absl::StrFormat(
       "%s_case() == k%s", descriptor->containing_oneof()->name(),
       UnderscoresToCamelCase(descriptor->name(), true));
@@ -95,16 +93,14 @@ std::string GenerateTemplateForOneofString(const FieldDescriptor* descriptor,
         field_member);
   }
 
-  if (descriptor->options().ctype() == google::protobuf::FieldOptions::STRING_PIECE) {
+  if (IsStringPiece(descriptor, options)) {
     return absl::Substitute(
         absl::StrCat(has_field, " ? ", field_pointer, ": nullptr"),
         field_member);
   }
 
   std::string default_value_pointer =
-      descriptor->options().ctype() == google::protobuf::FieldOptions::STRING
-          ? "&$1.get()"
-          : "&$1";
+      IsString(descriptor, options) ? "&$1.get()" : "&$1";
   return absl::Substitute(absl::StrCat(has_field, " ? ", field_pointer, " : ",
                                        default_value_pointer),
                           field_member, MakeDefaultFieldName(descriptor));
@@ -150,8 +146,7 @@ void AddAccessorAnnotations(
   if (!options.field_listener_options.inject_field_listener_events) {
     return;
   }
-  if (descriptor->file()->options().optimize_for() ==
-      google::protobuf::FileOptions::LITE_RUNTIME) {
+  if (!HasDescriptorMethods(descriptor->file(), options)) {
     return;
   }
   std::string field_member = (*variables)["field"];
@@ -183,8 +178,8 @@ void AddAccessorAnnotations(
     prepared_template = "nullptr";
   } else if (descriptor->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
     if (oneof_member) {
-      prepared_template = GenerateTemplateForOneofString(
-          descriptor, ProtobufNamespace(options), field_member);
+      prepared_template =
+          GenerateTemplateForOneofString(descriptor, options, field_member);
     } else {
       prepared_template =
           GenerateTemplateForSingleString(descriptor, field_member);
@@ -450,8 +445,14 @@ FieldGenerator* FieldGeneratorMap::MakeGenerator(
   } else {
     switch (field->cpp_type()) {
       case FieldDescriptor::CPPTYPE_MESSAGE:
+        if (IsLazy(field, options, scc_analyzer)) {
+          return new LazyMessageFieldGenerator(field, options, scc_analyzer);
+        }
         return new MessageFieldGenerator(field, options, scc_analyzer);
       case FieldDescriptor::CPPTYPE_STRING:
+        if (IsStringPiece(field, options)) {
+          return new StringPieceFieldGenerator(field, options);
+        }
         return new StringFieldGenerator(field, options);
       case FieldDescriptor::CPPTYPE_ENUM:
         return new EnumFieldGenerator(field, options);
@@ -121,6 +121,11 @@ class FieldGenerator {
   virtual void GenerateInternalAccessorDeclarations(
       io::Printer* /*printer*/) const {}
 
+  // Returns the number of functions that
+  // GenerateNonInlineAccessorDefinitions() and
+  // GenerateInternalAccessorDefinitions() define.
+  virtual int NumOutOfLineAccessors() const { return 0; }
+
   // Generate lines of code (statements, not declarations) which clear the
   // field.  This is used to define the clear_$name$() method
   virtual void GenerateClearingCode(io::Printer* printer) const = 0;
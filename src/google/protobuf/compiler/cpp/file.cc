@@ -60,6 +60,7 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/io/printer.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 // Must be last.
 #include "google/protobuf/port_def.inc"
@@ -779,6 +780,49 @@ void FileGenerator::GenerateGlobalSource(io::Printer* p) {
   }
 }
 
+void FileGenerator::GenerateSizeReport(
+    const absl::flat_hash_map<absl::string_view, std::string>& vars,
+    io::Printer* p) {
+  // Columns:
+  //   functions:        functions defined for the message in the .pb.cc.
+  //   source_bytes:     bytes of C++ generated for the message, excluding
+  //                     the class definition; a proxy for its code size.
+  //   tctable_bytes:    size of the tail-call parse table, if any.
+  //   instance_bytes:   estimated size of the default instance.
+  //   descriptor_bytes: size of the message's serialized DescriptorProto,
+  //                     excluding nested messages, embedded for reflection.
+  //   fallback_fields:  fields the table parser hands to MpFallback.
+  p->PrintRaw(
+      "# message\tfunctions\tsource_bytes\ttctable_bytes\tinstance_bytes\t"
+      "descriptor_bytes\tfallback_fields\n");
+  for (const auto& generator : message_generators_) {
+    std::string code;
+    {
+      io::StringOutputStream output(&code);
+      io::Printer printer(&output);
+      auto v = printer.WithVars(vars);
+      auto fv = printer.WithVars(FileVars(file_, options_));
+      generator->GenerateInlineMethods(&printer);
+      generator->GenerateClassMethods(&printer);
+    }
+
+    size_t descriptor_bytes = 0;
+    if (HasDescriptorMethods(file_, options_)) {
+      DescriptorProto proto;
+      generator->descriptor()->CopyTo(&proto);
+      proto.clear_nested_type();
+      descriptor_bytes = proto.ByteSizeLong();
+    }
+
+    p->PrintRaw(absl::StrCat(
+        generator->descriptor()->full_name(), "\t",
+        generator->NumOutOfLineFunctions(), "\t",
+        code.size(), "\t", generator->TailCallTableSize(), "\t",
+        generator->EstimateInstanceSize(), "\t", descriptor_bytes, "\t",
+        generator->NumMpFallbackFields(), "\n"));
+  }
+}
+
 void FileGenerator::GenerateSource(io::Printer* p) {
   auto v = p->WithVars(FileVars(file_, options_));
 
@@ -1244,7 +1288,6 @@ void FileGenerator::GenerateLibraryIncludes(io::Printer* p) {
     IncludeFile("third_party/protobuf/weak_field_map.h", p);
   }
   if (HasLazyFields(file_, options_, &scc_analyzer_)) {
-    GOOGLE_CHECK(!options_.opensource_runtime);
     IncludeFile("third_party/protobuf/lazy_field.h", p);
   }
   if (ShouldVerify(file_, options_, &scc_analyzer_)) {
@@ -1280,8 +1323,9 @@ void FileGenerator::GenerateLibraryIncludes(io::Printer* p) {
   IncludeFile("third_party/protobuf/io/coded_stream.h", p);
   IncludeFile("third_party/protobuf/arena.h", p);
   IncludeFile("third_party/protobuf/arenastring.h", p);
-  if ((options_.force_inline_string || options_.profile_driven_inline_string) &&
-      !options_.opensource_runtime) {
+  if (options_.force_inline_string ||
+      (options_.profile_driven_inline_string &&
+       (!options_.opensource_runtime || IsProfileDriven(options_)))) {
     IncludeFile("third_party/protobuf/inlined_string_field.h", p);
   }
   if (HasSimpleBaseClasses(file_, options_)) {
@@ -1304,11 +1348,17 @@ void FileGenerator::GenerateLibraryIncludes(io::Printer* p) {
     } else {
       IncludeFile("third_party/protobuf/message_lite.h", p);
     }
+    if (options_.field_listener_options.inject_field_listener_events) {
+      IncludeFile("third_party/protobuf/field_access_listener.h", p);
+    }
   }
   if (options_.opensource_runtime) {
     // Open-source relies on unconditional includes of these.
     IncludeFileAndExport("third_party/protobuf/repeated_field.h", p);
     IncludeFileAndExport("third_party/protobuf/extension_set.h", p);
+    if (HasStringPieceFields(file_, options_)) {
+      IncludeFile("third_party/protobuf/string_piece_field.h", p);
+    }
   } else {
     // Google3 includes these files only when they are necessary.
     if (HasExtensionsOrExtendableMessage(file_)) {
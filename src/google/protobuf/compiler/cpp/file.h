@@ -94,6 +94,16 @@ class FileGenerator {
   // extensions.
   void GenerateGlobalSource(io::Printer* p);
 
+  // Generates the report requested by the size_report option: one
+  // tab-separated line per message with statistics about the code and data
+  // generated for it, to find the messages that dominate binary size and
+  // startup cost.  `vars` are the variables the generator sets for every
+  // output file; the report renders each message's code with them to measure
+  // it.
+  void GenerateSizeReport(
+      const absl::flat_hash_map<absl::string_view, std::string>& vars,
+      io::Printer* p);
+
  private:
   // Generates a file, setting up the necessary accoutrements that start and
   // end the file, calling `cb` in between.
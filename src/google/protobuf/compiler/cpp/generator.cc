@@ -43,6 +43,7 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/compiler/access_info_map.h"
 #include "google/protobuf/compiler/cpp/file.h"
 #include "google/protobuf/compiler/cpp/helpers.h"
 #include "google/protobuf/descriptor.pb.h"
@@ -123,6 +124,7 @@ bool CppGenerator::Generate(const FileDescriptor* file,
   // If the lite option is passed to the compiler, we will generate the
   // current files and all transitive dependencies using the LITE runtime.
   Options file_options;
+  std::string access_profile;
 
   file_options.opensource_runtime = opensource_runtime_;
   file_options.runtime_include_base = runtime_include_base_;
@@ -178,6 +180,16 @@ bool CppGenerator::Generate(const FileDescriptor* file,
       file_options.message_owned_arena_trial = true;
     } else if (key == "force_eagerly_verified_lazy") {
       file_options.force_eagerly_verified_lazy = true;
+    } else if (key == "access_profile") {
+      access_profile = value;
+    } else if (key == "force_split") {
+      file_options.force_split = true;
+    } else if (key == "force_inline_string") {
+      file_options.force_inline_string = true;
+    } else if (key == "size_report") {
+      file_options.size_report = true;
+    } else if (key == "experimental_table_driven_serialization") {
+      file_options.table_driven_serialization = true;
     } else if (key == "experimental_tail_call_table_mode") {
       if (value == "never") {
         file_options.tctable_mode = Options::kTCTableNever;
@@ -204,6 +216,34 @@ bool CppGenerator::Generate(const FileDescriptor* file,
     return false;
   }
 
+  // The experimental_table_driven_serialization option makes messages
+  // serialize by walking their parse tables instead of through per-field
+  // generated code, so the tables must always be generated.
+  if (file_options.table_driven_serialization) {
+    if (file_options.tctable_mode == Options::kTCTableGuarded) {
+      *error =
+          "experimental_table_driven_serialization requires "
+          "experimental_tail_call_table_mode=always.";
+      return false;
+    }
+    file_options.tctable_mode = Options::kTCTableAlways;
+  }
+
+  // The access_profile option names a field access profile (see
+  // compiler/access_info_map.h) that drives field ordering, splitting of cold
+  // fields and inlining of hot strings.
+  std::unique_ptr<AccessInfoMap> access_info_map;
+  std::unique_ptr<SplitMap> split_map;
+  if (!access_profile.empty()) {
+    access_info_map = std::make_unique<AccessInfoMap>();
+    if (!access_info_map->ParseFile(access_profile, error)) {
+      return false;
+    }
+    split_map = std::make_unique<SplitMap>(access_info_map.get());
+    file_options.access_info_map = access_info_map.get();
+    file_options.split_map = split_map.get();
+  }
+
   // -----------------------------------------------------------------
 
 
@@ -339,6 +379,15 @@ bool CppGenerator::Generate(const FileDescriptor* file,
     file_generator.GenerateSource(&p);
   }
 
+  // The size_report option writes per-message statistics about the generated
+  // code next to it (see FileGenerator::GenerateSizeReport()).
+  if (file_options.size_report) {
+    auto output = absl::WrapUnique(
+        generator_context->Open(absl::StrCat(basename, ".pb.size_report.tsv")));
+    io::Printer p(output.get());
+    file_generator.GenerateSizeReport(CommonVars(file_options), &p);
+  }
+
   return true;
 }
 }  // namespace cpp
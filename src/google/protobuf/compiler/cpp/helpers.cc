@@ -46,6 +46,7 @@
 
 #include "google/protobuf/stubs/common.h"
 #include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/compiler/access_info_map.h"
 #include "google/protobuf/compiler/scc.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
@@ -220,14 +221,32 @@ inline bool IsEagerlyVerifiedLazyByProfile(const FieldDescriptor* field,
   return false;
 }
 
+// Returns true if "field" is an explicitly lazy field that the runtime can
+// back by LazyField. Only singular, non-oneof message fields qualify;
+// everything else is parsed eagerly.
+inline bool IsSupportedExplicitLazy(const FieldDescriptor* field,
+                                    const Options& options) {
+  return IsExplicitLazy(field) &&
+         field->type() == FieldDescriptor::TYPE_MESSAGE &&
+         !field->is_repeated() && !field->is_extension() &&
+         field->real_containing_oneof() == nullptr &&
+         !field->options().weak() &&
+         !UsingImplicitWeakFields(field->file(), options) &&
+         !ShouldSplit(field, options);
+}
+
 bool IsEagerlyVerifiedLazy(const FieldDescriptor* field, const Options& options,
                            MessageSCCAnalyzer* scc_analyzer) {
-  return false;
+  // [lazy] fields are verified when the enclosing message is parsed.
+  return IsEagerlyVerifiedLazyByProfile(field, options, scc_analyzer) ||
+         (IsSupportedExplicitLazy(field, options) &&
+          !field->options().unverified_lazy());
 }
 
 bool IsLazilyVerifiedLazy(const FieldDescriptor* field,
                           const Options& options) {
-  return false;
+  return IsSupportedExplicitLazy(field, options) &&
+         field->options().unverified_lazy();
 }
 
 absl::flat_hash_map<absl::string_view, std::string> MessageVars(
@@ -903,11 +922,32 @@ std::string SafeFunctionName(const Descriptor* descriptor,
 bool IsProfileDriven(const Options& options) {
   return options.access_info_map != nullptr;
 }
+
+// Strings are inlined when the profile shows them to be accessed at least
+// this many times as often as the hottest field of their message.  Inlining
+// saves an indirection on every access but makes the message bigger.
+static constexpr double kInlineStringHotRatio = 0.1;
+
 bool IsStringInlined(const FieldDescriptor* descriptor,
                      const Options& options) {
-  (void)descriptor;
-  (void)options;
-  return false;
+  if (!IsString(descriptor, options) || descriptor->is_repeated() ||
+      descriptor->is_extension() || descriptor->real_containing_oneof()) {
+    return false;
+  }
+  // Inlined strings have no default instance to point to, and we rely on
+  // has bits to distinguish field presence for release_$name$.
+  if (!descriptor->default_value_string().empty() ||
+      !internal::cpp::HasHasbit(descriptor)) {
+    return false;
+  }
+  if (descriptor->containing_type()->options().map_entry() ||
+      IsAnyMessage(descriptor->containing_type(), options) ||
+      ShouldSplit(descriptor, options)) {
+    return false;
+  }
+  if (options.force_inline_string) return true;
+  return options.profile_driven_inline_string && IsProfileDriven(options) &&
+         options.access_info_map->IsHot(descriptor, kInlineStringHotRatio);
 }
 
 static bool HasLazyFields(const Descriptor* descriptor, const Options& options,
@@ -947,8 +987,33 @@ bool HasLazyFields(const FileDescriptor* file, const Options& options,
   return false;
 }
 
-bool ShouldSplit(const Descriptor*, const Options&) { return false; }
-bool ShouldSplit(const FieldDescriptor*, const Options&) { return false; }
+bool ShouldSplit(const Descriptor* desc, const Options& options) {
+  if (!options.force_split &&
+      (!options.profile_driven_split || options.split_map == nullptr)) {
+    return false;
+  }
+  for (int i = 0; i < desc->field_count(); ++i) {
+    if (ShouldSplit(desc->field(i), options)) return true;
+  }
+  return false;
+}
+
+bool ShouldSplit(const FieldDescriptor* field, const Options& options) {
+  // Repeated, oneof, extension, weak and lazy fields keep their own storage.
+  if (field->is_repeated() || field->real_containing_oneof() ||
+      field->is_extension() || field->options().weak() ||
+      IsExplicitLazy(field)) {
+    return false;
+  }
+  const Descriptor* desc = field->containing_type();
+  if (desc->options().map_entry() ||
+      !HasDescriptorMethods(desc->file(), options)) {
+    return false;
+  }
+  if (options.force_split) return true;
+  return options.profile_driven_split && options.split_map != nullptr &&
+         options.split_map->ShouldSplit(field);
+}
 
 bool ShouldForceAllocationOnConstruction(const Descriptor* desc,
                                          const Options& options) {
@@ -1127,7 +1192,15 @@ FieldOptions::CType EffectiveStringCType(const FieldDescriptor* field,
                                          const Options& options) {
   GOOGLE_DCHECK(field->cpp_type() == FieldDescriptor::CPPTYPE_STRING);
   if (options.opensource_runtime) {
-    // Open-source protobuf release only supports STRING ctype.
+    // Open-source protobuf release supports STRING, and STRING_PIECE for
+    // fields that can be backed by StringPieceField.
+    if (field->options().ctype() == FieldOptions::STRING_PIECE &&
+        !field->is_repeated() && !field->is_extension() &&
+        field->real_containing_oneof() == nullptr &&
+        field->default_value_string().empty() &&
+        !ShouldSplit(field, options)) {
+      return FieldOptions::STRING_PIECE;
+    }
     return FieldOptions::STRING;
   } else {
     // Google-internal supports all ctypes.
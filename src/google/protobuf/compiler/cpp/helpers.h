@@ -751,11 +751,11 @@ inline std::string SimpleBaseClass(const Descriptor* desc,
   return "";
 }
 
-// Returns true if this message has a _tracker_ field.
+// Returns true if this message has a _tracker_ field.  Lite messages have
+// none: listeners name fields through descriptors, which lite code lacks.
 inline bool HasTracker(const Descriptor* desc, const Options& options) {
   return options.field_listener_options.inject_field_listener_events &&
-         desc->file()->options().optimize_for() !=
-             google::protobuf::FileOptions::LITE_RUNTIME;
+         HasDescriptorMethods(desc->file(), options);
 }
 
 // Returns true if this message needs an Impl_ struct for it's data.
@@ -58,6 +58,7 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "google/protobuf/compiler/access_info_map.h"
 #include "google/protobuf/compiler/cpp/enum.h"
 #include "google/protobuf/compiler/cpp/extension.h"
 #include "google/protobuf/compiler/cpp/field.h"
@@ -87,6 +88,27 @@ namespace {
 
 static constexpr int kNoHasbit = -1;
 
+// Approximate in-object size of `field` in the generated class.  Map fields
+// are counted as their Map<>; the reflection wrapper around maps of the full
+// runtime is ignored.
+size_t EstimateFieldSize(const FieldDescriptor* field, const Options& options) {
+  if (field->is_map()) return sizeof(Map<int32_t, int32_t>);
+  if (field->is_repeated()) {
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_STRING:
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        return sizeof(RepeatedPtrField<std::string>);
+      default:
+        return sizeof(RepeatedField<int64_t>);
+    }
+  }
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING &&
+      IsStringInlined(field, options)) {
+    return sizeof(std::string);
+  }
+  return EstimateAlignmentSize(field);
+}
+
 // Create an expression that evaluates to
 //  "for all i, (_has_bits_[i] & masks[i]) == masks[i]"
 // masks is allowed to be shorter than _has_bits_, but at least one element of
@@ -388,7 +410,8 @@ class ColdChunkSkipper {
       const Descriptor* descriptor, const Options& options,
       const std::vector<std::vector<const FieldDescriptor*>>& chunks,
       const std::vector<int>& has_bit_indices, const double cold_threshold)
-      : chunks_(chunks),
+      : options_(options),
+        chunks_(chunks),
         has_bit_indices_(has_bit_indices),
         access_info_map_(options.access_info_map),
         cold_threshold_(cold_threshold) {
@@ -409,6 +432,7 @@ class ColdChunkSkipper {
     return has_bit_indices_[chunks_[chunk][offset]->index()] / 32;
   }
 
+  const Options& options_;
   const std::vector<std::vector<const FieldDescriptor*>>& chunks_;
   const std::vector<int>& has_bit_indices_;
   const AccessInfoMap* access_info_map_;
@@ -420,10 +444,19 @@ class ColdChunkSkipper {
 // Tuning parameters for ColdChunkSkipper.
 const double kColdRatio = 0.005;
 
+// A chunk is cold if every field in it is rarely accessed according to the
+// profile.  The fields must all have has bits so that a run of cold chunks can
+// be skipped with a single check, and split fields are excluded because their
+// chunks are already guarded by a check of the split struct.
 bool ColdChunkSkipper::IsColdChunk(int chunk) {
-  // Mark this variable as used until it is actually used
-  (void)cold_threshold_;
-  return false;
+  if (has_bit_indices_.empty()) return false;
+  for (const FieldDescriptor* field : chunks_[chunk]) {
+    if (has_bit_indices_[field->index()] < 0 || ShouldSplit(field, options_) ||
+        !access_info_map_->IsCold(field, cold_threshold_)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 
@@ -716,6 +749,83 @@ size_t MessageGenerator::InlinedStringDonatedSize() const {
   return (max_inlined_string_index_ + 31) / 32;
 }
 
+size_t MessageGenerator::EstimateInstanceSize() const {
+  // The vtable pointer and _internal_metadata_ of MessageLite, and
+  // _cached_size_.
+  size_t size = 2 * sizeof(void*) + sizeof(int);
+  size += (HasBitsSize() + InlinedStringDonatedSize()) * sizeof(uint32_t);
+  if (descriptor_->extension_range_count() > 0) {
+    size += sizeof(internal::ExtensionSet);
+  }
+  if (num_weak_fields_ > 0) {
+    // Weak fields live in a WeakFieldMap; count it as one pointer.
+    size += sizeof(void*);
+  }
+  bool has_split = false;
+  for (auto field : optimized_order_) {
+    if (ShouldSplit(field, options_)) {
+      has_split = true;
+    } else {
+      size += EstimateFieldSize(field, options_);
+    }
+  }
+  if (has_split) size += sizeof(void*);
+  for (auto oneof : OneOfRange(descriptor_)) {
+    size_t largest = 0;
+    for (auto field : FieldRange(oneof)) {
+      largest = std::max(largest, EstimateFieldSize(field, options_));
+    }
+    size += largest + sizeof(uint32_t);
+  }
+  return size;
+}
+
+int MessageGenerator::NumOutOfLineFunctions() const {
+  // This follows GenerateClassMethods() and the functions it calls.  Functions
+  // defined inside the class body of _Internal, like set_has_$name$(), are
+  // inline and not counted.
+  const bool has_descriptor_methods =
+      HasDescriptorMethods(descriptor_->file(), options_);
+  if (IsMapEntryMessage(descriptor_)) {
+    // Both constructors, MergeFrom() and GetMetadata().
+    return has_descriptor_methods ? 4 : 3;
+  }
+
+  int functions = 0;
+  if (IsAnyMessage(descriptor_, options_)) {
+    // ParseAnyTypeUrl() and GetAnyFieldDescriptors().
+    functions += has_descriptor_methods ? 2 : 1;
+  }
+  for (auto field : FieldRange(descriptor_)) {
+    if (IsFieldStripped(field, options_)) continue;
+    functions += field_generators_.get(field).NumOutOfLineAccessors();
+    if (IsCrossFileMaybeMap(field)) ++functions;  // clear_$name$()
+  }
+
+  // Both constructors, and with a base class that is not simple, SharedCtor(),
+  // the destructor, SharedDtor() and SetCachedSize().
+  const bool simple_base = HasSimpleBaseClass(descriptor_, options_);
+  functions += simple_base ? 2 : 6;
+  if (NeedsArenaDestructor() > ArenaDtorNeeds::kNone) ++functions;
+  functions += descriptor_->real_oneof_decl_count();  // clear_$oneof$()
+
+  if (HasGeneratedMethods(descriptor_->file(), options_)) {
+    // GetClassData(), or CheckTypeAndMergeFrom() in the lite runtime.
+    ++functions;
+    if (!simple_base) {
+      // Clear(), _InternalSerialize(), ByteSizeLong(), MergeImpl() or
+      // MergeFrom(), CopyFrom() and IsInitialized().
+      functions += 6 + parse_function_generator_->NumOutOfLineFunctions();
+    }
+  }
+  if (ShouldSplit(descriptor_, options_)) {
+    ++functions;  // PrepareSplitMessageForWrite()
+  }
+  if (!simple_base) ++functions;  // InternalSwap()
+  ++functions;  // GetMetadata() or GetTypeName()
+  return functions;
+}
+
 int MessageGenerator::HasBitIndex(const FieldDescriptor* field) const {
   return has_bit_indices_.empty() ? kNoHasbit
                                   : has_bit_indices_[field->index()];
@@ -1893,8 +2003,9 @@ void MessageGenerator::GenerateClassDefinition(io::Printer* p) {
         "  typedef void InternalArenaConstructable_;\n"
         "  typedef void DestructorSkippable_;\n"
         "};\n"
-        "static_assert(std::is_trivially_copy_constructible<Split>::value);\n"
-        "static_assert(std::is_trivially_destructible<Split>::value);\n"
+        "static_assert(std::is_trivially_copy_constructible<Split>::value,\n"
+        "              \"\");\n"
+        "static_assert(std::is_trivially_destructible<Split>::value, \"\");\n"
         "Split* _split_;\n");
   }
 
@@ -2287,17 +2398,20 @@ std::pair<size_t, size_t> MessageGenerator::GenerateOffsets(io::Printer* p) {
     // offset of the field, so that the information is available when
     // reflectively accessing the field at run time.
     //
-    // We embed whether the field is cold to the MSB of the offset, and whether
-    // the field is eagerly verified lazy or inlined string to the LSB of the
-    // offset.
+    // We embed whether the field is cold to the MSB of the offset, whether
+    // the field is backed by LazyField or is an inlined string to the LSB of
+    // the offset, and whether it is backed by StringPieceField to the bit
+    // above it.
 
     if (ShouldSplit(field, options_)) {
       format(" | ::_pbi::kSplitFieldOffsetMask /*split*/");
     }
-    if (IsEagerlyVerifiedLazy(field, options_, scc_analyzer_)) {
-      format(" | 0x1u /*eagerly verified lazy*/");
+    if (IsLazy(field, options_, scc_analyzer_)) {
+      format(" | 0x1u /*lazy*/");
     } else if (IsStringInlined(field, options_)) {
       format(" | 0x1u /*inlined*/");
+    } else if (IsStringPiece(field, options_)) {
+      format(" | 0x2u /*string piece*/");
     }
     format(",\n");
   }
@@ -3730,6 +3844,48 @@ void MessageGenerator::GenerateSerializeOneExtensionRange(
       "internal_default_instance(), $start$, $end$, target, stream);\n\n");
 }
 
+void MessageGenerator::GenerateSerializeUnknownFields(io::Printer* p) {
+  Formatter format(p);
+  format("if (PROTOBUF_PREDICT_FALSE($have_unknown_fields$)) {\n");
+  format.Indent();
+  if (UseUnknownFieldSet(descriptor_->file(), options_)) {
+    format(
+        "target = "
+        "::_pbi::WireFormat::"
+        "InternalSerializeUnknownFieldsToArray(\n"
+        "    $unknown_fields$, target, stream);\n");
+  } else {
+    format(
+        "target = stream->WriteRaw($unknown_fields$.data(),\n"
+        "    static_cast<int>($unknown_fields$.size()), target);\n");
+  }
+  format.Outdent();
+  format("}\n");
+}
+
+bool MessageGenerator::UseTableDrivenSerialization() const {
+  // The serializer walks the parse table, so the table has to be generated
+  // unconditionally and describe every field.  The generator forces
+  // tctable_mode to "always" when table_driven_serialization is set.
+  if (!options_.table_driven_serialization ||
+      options_.tctable_mode != Options::kTCTableAlways ||
+      HasSimpleBaseClass(descriptor_, options_) ||
+      descriptor_->options().message_set_wire_format() ||
+      !ShouldSerializeInOrder(descriptor_, options_) ||
+      descriptor_->extension_range_count() > 1) {
+    return false;
+  }
+  for (auto field : FieldRange(descriptor_)) {
+    if (field->is_map() || field->options().weak() ||
+        IsFieldStripped(field, options_) ||
+        IsLazy(field, options_, scc_analyzer_) ||
+        IsStringInlined(field, options_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void MessageGenerator::GenerateSerializeWithCachedSizesToArray(io::Printer* p) {
   if (HasSimpleBaseClass(descriptor_, options_)) return;
   Formatter format(p);
@@ -3763,6 +3919,20 @@ void MessageGenerator::GenerateSerializeWithCachedSizesToArray(io::Printer* p) {
 
   format("// @@protoc_insertion_point(serialize_to_array_start:$full_name$)\n");
 
+  if (UseTableDrivenSerialization()) {
+    format(
+        "target = ::_pbi::TcParser::SerializeFields(this, &_table_.header, "
+        "target, stream);\n");
+    GenerateSerializeUnknownFields(p);
+    format(
+        "// @@protoc_insertion_point(serialize_to_array_end:$full_name$)\n");
+    format.Outdent();
+    format(
+        "  return target;\n"
+        "}\n");
+    return;
+  }
+
   if (!ShouldSerializeInOrder(descriptor_, options_)) {
     format.Outdent();
     format("#ifdef NDEBUG\n");
@@ -3979,21 +4149,7 @@ void MessageGenerator::GenerateSerializeWithCachedSizesBody(io::Printer* p) {
     e.EmitIfNotNull(largest_weak_field.Release());
   }
 
-  format("if (PROTOBUF_PREDICT_FALSE($have_unknown_fields$)) {\n");
-  format.Indent();
-  if (UseUnknownFieldSet(descriptor_->file(), options_)) {
-    format(
-        "target = "
-        "::_pbi::WireFormat::"
-        "InternalSerializeUnknownFieldsToArray(\n"
-        "    $unknown_fields$, target, stream);\n");
-  } else {
-    format(
-        "target = stream->WriteRaw($unknown_fields$.data(),\n"
-        "    static_cast<int>($unknown_fields$.size()), target);\n");
-  }
-  format.Outdent();
-  format("}\n");
+  GenerateSerializeUnknownFields(p);
 }
 
 void MessageGenerator::GenerateSerializeWithCachedSizesBodyShuffled(
@@ -4157,6 +4313,16 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
       "$annotate_bytesize$"
       "// @@protoc_insertion_point(message_byte_size_start:$full_name$)\n");
   format.Indent();
+  if (UseTableDrivenSerialization()) {
+    format(
+        "::size_t total_size = "
+        "::_pbi::TcParser::ByteSizeFields(this, &_table_.header);\n"
+        "\n");
+    GenerateUnknownFieldsByteSize(p);
+    format.Outdent();
+    format("}\n");
+    return;
+  }
   format(
       "::size_t total_size = 0;\n"
       "\n");
@@ -4324,6 +4490,14 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
     format("total_size += $weak_field_map$.ByteSizeLong();\n");
   }
 
+  GenerateUnknownFieldsByteSize(p);
+
+  format.Outdent();
+  format("}\n");
+}
+
+void MessageGenerator::GenerateUnknownFieldsByteSize(io::Printer* p) {
+  Formatter format(p);
   if (UseUnknownFieldSet(descriptor_->file(), options_)) {
     // We go out of our way to put the computation of the uncommon path of
     // unknown fields in tail position. This allows for better code generation
@@ -4348,9 +4522,6 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
         "SetCachedSize(cached_size);\n"
         "return total_size;\n");
   }
-
-  format.Outdent();
-  format("}\n");
 }
 
 void MessageGenerator::GenerateIsInitialized(io::Printer* p) {
@@ -102,6 +102,20 @@ class MessageGenerator {
 
   const Descriptor* descriptor() const { return descriptor_; }
 
+  // Statistics for the size report (see FileGenerator::GenerateSizeReport):
+  //
+  // Returns a rough estimate of sizeof() the generated class, which is also
+  // the static footprint of its default instance.  Padding is ignored.
+  size_t EstimateInstanceSize() const;
+  size_t TailCallTableSize() const {
+    return parse_function_generator_->TailCallTableSize();
+  }
+  int NumMpFallbackFields() const {
+    return parse_function_generator_->NumMpFallbackFields();
+  }
+  // Returns the number of functions GenerateClassMethods() defines.
+  int NumOutOfLineFunctions() const;
+
  private:
   // Generate declarations and definitions of accessors for fields.
   void GenerateFieldAccessorDeclarations(io::Printer* p);
@@ -149,6 +163,13 @@ class MessageGenerator {
       io::Printer* p, const std::vector<const FieldDescriptor*>& fields);
   void GenerateSerializeOneExtensionRange(
       io::Printer* p, const Descriptor::ExtensionRange* range);
+  void GenerateSerializeUnknownFields(io::Printer* p);
+  void GenerateUnknownFieldsByteSize(io::Printer* p);
+
+  // Returns true if _InternalSerialize() and ByteSizeLong() should call the
+  // table-driven serializer (TcParser::SerializeFields()) rather than emit
+  // code for each field.
+  bool UseTableDrivenSerialization() const;
 
   // Generates has_foo() functions and variables for singular field has-bits.
   void GenerateSingularFieldHasBits(const FieldDescriptor* field,
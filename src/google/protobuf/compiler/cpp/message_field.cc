@@ -555,6 +555,220 @@ void MessageFieldGenerator::GenerateAggregateInitializer(
 
 // ===================================================================
 
+LazyMessageFieldGenerator::LazyMessageFieldGenerator(
+    const FieldDescriptor* descriptor, const Options& options,
+    MessageSCCAnalyzer* scc_analyzer)
+    : MessageFieldGenerator(descriptor, options, scc_analyzer) {
+  GOOGLE_CHECK(!implicit_weak_field_);
+  variables_["lazy_prototype"] =
+      absl::StrCat("reinterpret_cast<const ", variables_["type"], "&>(",
+                   variables_["type_default_instance"], ")");
+}
+
+LazyMessageFieldGenerator::~LazyMessageFieldGenerator() {}
+
+void LazyMessageFieldGenerator::GeneratePrivateMembers(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("::$proto_ns$::internal::LazyField $name$_;\n");
+}
+
+void LazyMessageFieldGenerator::GenerateInlineAccessorDefinitions(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "inline const $type$& $classname$::_internal_$name$() const {\n"
+      "  return static_cast<const $type$&>($field$.GetByPrototype(\n"
+      "      $lazy_prototype$, GetArenaForAllocation()));\n"
+      "}\n"
+      "inline const $type$& $classname$::$name$() const {\n"
+      "$annotate_get$"
+      "  // @@protoc_insertion_point(field_get:$full_name$)\n"
+      "  return _internal_$name$();\n"
+      "}\n");
+
+  format(
+      "inline void $classname$::unsafe_arena_set_allocated_$name$(\n"
+      "    $type$* $name$) {\n"
+      "  $field$.UnsafeArenaSetAllocated($name$, GetArenaForAllocation());\n");
+  if (HasHasbit(descriptor_)) {
+    format(
+        "  if ($name$) {\n"
+        "    $set_hasbit$\n"
+        "  } else {\n"
+        "    $clear_hasbit$\n"
+        "  }\n");
+  }
+  format(
+      "$annotate_set$"
+      "  // @@protoc_insertion_point(field_unsafe_arena_set_allocated"
+      ":$full_name$)\n"
+      "}\n");
+  format(
+      "inline $type$* $classname$::$release_name$() {\n"
+      "$annotate_release$"
+      "  $clear_hasbit$\n"
+      "  return static_cast<$type$*>($field$.ReleaseByPrototype(\n"
+      "      $lazy_prototype$, GetArenaForAllocation()));\n"
+      "}\n"
+      "inline $type$* $classname$::unsafe_arena_release_$name$() {\n"
+      "$annotate_release$"
+      "  // @@protoc_insertion_point(field_release:$full_name$)\n"
+      "  $clear_hasbit$\n"
+      "  return static_cast<$type$*>($field$.UnsafeArenaReleaseByPrototype(\n"
+      "      $lazy_prototype$, GetArenaForAllocation()));\n"
+      "}\n");
+
+  format(
+      "inline $type$* $classname$::_internal_mutable_$name$() {\n"
+      "  $set_hasbit$\n"
+      "  return static_cast<$type$*>($field$.MutableByPrototype(\n"
+      "      $lazy_prototype$, GetArenaForAllocation()));\n"
+      "}\n"
+      "inline $type$* $classname$::mutable_$name$() {\n"
+      "  $type$* _msg = _internal_mutable_$name$();\n"
+      "$annotate_mutable$"
+      "  // @@protoc_insertion_point(field_mutable:$full_name$)\n"
+      "  return _msg;\n"
+      "}\n");
+
+  format(
+      "inline void $classname$::set_allocated_$name$($type$* $name$) {\n"
+      "  ::$proto_ns$::Arena* message_arena = GetArenaForAllocation();\n"
+      "  if ($name$) {\n");
+  if (IsCrossFileMessage(descriptor_)) {
+    format(
+        "    ::$proto_ns$::Arena* submessage_arena =\n"
+        "        ::$proto_ns$::Arena::InternalGetOwningArena(\n"
+        "                reinterpret_cast<::$proto_ns$::MessageLite*>("
+        "$name$));\n");
+  } else {
+    format(
+        "    ::$proto_ns$::Arena* submessage_arena =\n"
+        "        ::$proto_ns$::Arena::InternalGetOwningArena("
+        "$name$);\n");
+  }
+  format(
+      "    if (message_arena != submessage_arena) {\n"
+      "      $name$ = ::$proto_ns$::internal::GetOwnedMessage(\n"
+      "          message_arena, $name$, submessage_arena);\n"
+      "    }\n"
+      "    $set_hasbit$\n"
+      "  } else {\n"
+      "    $clear_hasbit$\n"
+      "  }\n"
+      "  $field$.UnsafeArenaSetAllocated($name$, message_arena);\n"
+      "$annotate_set$"
+      "  // @@protoc_insertion_point(field_set_allocated:$full_name$)\n"
+      "}\n");
+}
+
+void LazyMessageFieldGenerator::GenerateClearingCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("$field$.Clear();\n");
+}
+
+void LazyMessageFieldGenerator::GenerateMessageClearingCode(
+    io::Printer* printer) const {
+  GenerateClearingCode(printer);
+}
+
+void LazyMessageFieldGenerator::GenerateMergingCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "_this->$field$.MergeFrom($lazy_prototype$, from.$field$,\n"
+      "                         _this->GetArenaForAllocation());\n");
+  if (HasHasbit(descriptor_)) {
+    format("_this->$set_hasbit$\n");
+  }
+}
+
+void LazyMessageFieldGenerator::GenerateSwappingCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("$field$.InternalSwap(&other->$field$);\n");
+}
+
+void LazyMessageFieldGenerator::GenerateDestructorCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  // Like other members of Impl_, the LazyField is not destroyed implicitly.
+  format(
+      "$field$.Destroy();\n"
+      "$field$.~LazyField();\n");
+}
+
+void LazyMessageFieldGenerator::GenerateArenaDestructorCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  // _this is the object being destructed (we are inside a static method here).
+  // The message object, if any, lives on the arena; only the bytes need
+  // releasing.
+  format("_this->$field$.~LazyField();\n");
+}
+
+void LazyMessageFieldGenerator::GenerateCopyConstructorCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "_this->$field$.MergeFrom($lazy_prototype$, from.$field$,\n"
+      "                         _this->GetArenaForAllocation());\n");
+}
+
+void LazyMessageFieldGenerator::GenerateSerializeWithCachedSizesToArray(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("target = $field$.InternalWrite($number$, target, stream);\n");
+}
+
+void LazyMessageFieldGenerator::GenerateByteSize(io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "total_size += $tag_size$ +\n"
+      "  ::$proto_ns$::internal::WireFormatLite::LengthDelimitedSize(\n"
+      "    $field$.ByteSizeLong());\n");
+}
+
+void LazyMessageFieldGenerator::GenerateIsInitialized(
+    io::Printer* printer) const {
+  // [unverified_lazy] submessages are not checked at parse time, so their
+  // required fields are not checked either.
+  if (!has_required_fields_ ||
+      ShouldIgnoreRequiredFieldCheck(descriptor_, options_)) {
+    return;
+  }
+
+  Formatter format(printer, variables_);
+  format(
+      "if (!$field$.IsCleared()) {\n"
+      "  if (!_internal_$name$().IsInitialized()) return false;\n"
+      "}\n");
+}
+
+// LazyField is neither copyable nor movable, so it is always initialized in
+// place from an empty braced list.
+void LazyMessageFieldGenerator::GenerateConstexprAggregateInitializer(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("/*decltype($field$)*/{}");
+}
+
+void LazyMessageFieldGenerator::GenerateCopyAggregateInitializer(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("/*decltype($field$)*/{}");
+}
+
+void LazyMessageFieldGenerator::GenerateAggregateInitializer(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("/*decltype($field$)*/{}");
+}
+
+// ===================================================================
+
 MessageOneofFieldGenerator::MessageOneofFieldGenerator(
     const FieldDescriptor* descriptor, const Options& options,
     MessageSCCAnalyzer* scc_analyzer)
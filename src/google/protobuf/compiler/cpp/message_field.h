@@ -63,6 +63,9 @@ class MessageFieldGenerator : public FieldGenerator {
   void GenerateInternalAccessorDeclarations(
       io::Printer* printer) const override;
   void GenerateInternalAccessorDefinitions(io::Printer* printer) const override;
+  int NumOutOfLineAccessors() const override {
+    return implicit_weak_field_ ? 2 : 1;
+  }
   void GenerateClearingCode(io::Printer* printer) const override;
   void GenerateMessageClearingCode(io::Printer* printer) const override;
   void GenerateMergingCode(io::Printer* printer) const override;
@@ -84,6 +87,46 @@ class MessageFieldGenerator : public FieldGenerator {
   const bool has_required_fields_;
 };
 
+// Generates a singular [lazy]/[unverified_lazy] submessage backed by
+// internal::LazyField, which keeps the wire bytes until first access.
+class LazyMessageFieldGenerator : public MessageFieldGenerator {
+ public:
+  LazyMessageFieldGenerator(const FieldDescriptor* descriptor,
+                            const Options& options,
+                            MessageSCCAnalyzer* scc_analyzer);
+  LazyMessageFieldGenerator(const LazyMessageFieldGenerator&) = delete;
+  LazyMessageFieldGenerator& operator=(const LazyMessageFieldGenerator&) =
+      delete;
+  ~LazyMessageFieldGenerator() override;
+
+  // implements FieldGenerator ---------------------------------------
+  void GeneratePrivateMembers(io::Printer* printer) const override;
+  void GenerateInlineAccessorDefinitions(io::Printer* printer) const override;
+  void GenerateInternalAccessorDeclarations(
+      io::Printer* printer) const override {}
+  void GenerateInternalAccessorDefinitions(
+      io::Printer* printer) const override {}
+  int NumOutOfLineAccessors() const override { return 0; }
+  void GenerateClearingCode(io::Printer* printer) const override;
+  void GenerateMessageClearingCode(io::Printer* printer) const override;
+  void GenerateMergingCode(io::Printer* printer) const override;
+  void GenerateSwappingCode(io::Printer* printer) const override;
+  void GenerateDestructorCode(io::Printer* printer) const override;
+  void GenerateArenaDestructorCode(io::Printer* printer) const override;
+  void GenerateCopyConstructorCode(io::Printer* printer) const override;
+  void GenerateSerializeWithCachedSizesToArray(
+      io::Printer* printer) const override;
+  void GenerateByteSize(io::Printer* printer) const override;
+  void GenerateIsInitialized(io::Printer* printer) const override;
+  void GenerateConstexprAggregateInitializer(
+      io::Printer* printer) const override;
+  void GenerateAggregateInitializer(io::Printer* printer) const override;
+  void GenerateCopyAggregateInitializer(io::Printer* printer) const override;
+  ArenaDtorNeeds NeedsArenaDestructor() const override {
+    return ArenaDtorNeeds::kRequired;
+  }
+};
+
 class MessageOneofFieldGenerator : public MessageFieldGenerator {
  public:
   MessageOneofFieldGenerator(const FieldDescriptor* descriptor,
@@ -98,6 +141,9 @@ class MessageOneofFieldGenerator : public MessageFieldGenerator {
   void GenerateInlineAccessorDefinitions(io::Printer* printer) const override;
   void GenerateNonInlineAccessorDefinitions(
       io::Printer* printer) const override;
+  int NumOutOfLineAccessors() const override {
+    return MessageFieldGenerator::NumOutOfLineAccessors() + 1;
+  }
   void GenerateClearingCode(io::Printer* printer) const override;
 
   // MessageFieldGenerator, from which we inherit, overrides this so we need to
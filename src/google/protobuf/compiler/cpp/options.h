@@ -87,12 +87,15 @@ struct Options {
   bool message_owned_arena_trial = false;
   bool force_split = false;
   bool profile_driven_split = true;
+  bool table_driven_serialization = false;
+  bool size_report = false;
+  // Only set explicitly: inlining changes the layout of string fields, so
+  // it is not part of PROTOBUF_STABLE_EXPERIMENTS.
+  bool force_inline_string = false;
 #ifdef PROTOBUF_STABLE_EXPERIMENTS
   bool force_eagerly_verified_lazy = true;
-  bool force_inline_string = true;
 #else   // PROTOBUF_STABLE_EXPERIMENTS
   bool force_eagerly_verified_lazy = false;
-  bool force_inline_string = false;
 #endif  // !PROTOBUF_STABLE_EXPERIMENTS
 };
 
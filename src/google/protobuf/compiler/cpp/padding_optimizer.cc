@@ -30,6 +30,11 @@
 
 #include "google/protobuf/compiler/cpp/padding_optimizer.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "google/protobuf/compiler/access_info_map.h"
 #include "google/protobuf/compiler/cpp/helpers.h"
 
 namespace google {
@@ -83,6 +88,36 @@ class FieldGroup {
   // used in a vector.
 };
 
+// Returns the preferred location of each field in 'fields'.  Without an access
+// profile for the message this is the field number.  With one, it is the rank
+// of the field by decreasing access count, so that hot fields end up next to
+// each other at the start of their family; field number breaks ties.
+absl::flat_hash_map<const FieldDescriptor*, double> PreferredLocations(
+    const std::vector<const FieldDescriptor*>& fields, const Options& options) {
+  absl::flat_hash_map<const FieldDescriptor*, double> locations;
+  const AccessInfoMap* access_info_map = options.access_info_map;
+  if (access_info_map == nullptr ||
+      !access_info_map->HasProfile(fields[0]->containing_type())) {
+    for (const FieldDescriptor* field : fields) {
+      locations[field] = field->number();
+    }
+    return locations;
+  }
+
+  std::vector<const FieldDescriptor*> by_access = fields;
+  std::sort(by_access.begin(), by_access.end(),
+            [&](const FieldDescriptor* a, const FieldDescriptor* b) {
+              uint64_t a_count = access_info_map->AccessCount(a);
+              uint64_t b_count = access_info_map->AccessCount(b);
+              if (a_count != b_count) return a_count > b_count;
+              return a->number() < b->number();
+            });
+  for (int i = 0; i < by_access.size(); ++i) {
+    locations[by_access[i]] = i;
+  }
+  return locations;
+}
+
 }  // namespace
 
 static void OptimizeLayoutHelper(std::vector<const FieldDescriptor*>* fields,
@@ -90,6 +125,9 @@ static void OptimizeLayoutHelper(std::vector<const FieldDescriptor*>* fields,
                                  MessageSCCAnalyzer* scc_analyzer) {
   if (fields->empty()) return;
 
+  const absl::flat_hash_map<const FieldDescriptor*, double> locations =
+      PreferredLocations(*fields, options);
+
   // The sorted numeric order of Family determines the declaration order in the
   // memory layout.
   enum Family {
@@ -125,7 +163,7 @@ static void OptimizeLayoutHelper(std::vector<const FieldDescriptor*>* fields,
       f = ZERO_INITIALIZABLE;
     }
 
-    const int j = field->number();
+    const double j = locations.at(field);
     switch (EstimateAlignmentSize(field)) {
       case 1:
         aligned_to_1[f].push_back(FieldGroup(j, field));
@@ -204,6 +242,10 @@ static void OptimizeLayoutHelper(std::vector<const FieldDescriptor*>* fields,
 // MessageGenerator::optimized_order_).  Since the serializers use field number
 // order, we use that as a tie-breaker.
 //
+// With an access profile (see compiler/access_info_map.h), fields within each
+// family are instead ordered by decreasing access count, so the fields that
+// are touched most often share cache lines.
+//
 // We classify each field into a particular "family" of fields, that we perform
 // the same operation on in our generated functions.
 //
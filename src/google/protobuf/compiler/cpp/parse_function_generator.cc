@@ -104,7 +104,8 @@ class ParseFunctionGenerator::GeneratedOptionProvider final
             UseDirectTcParserTable(field, gen_->options_),
             GetOptimizeFor(field->file(), gen_->options_) ==
                 FileOptions::LITE_RUNTIME,
-            ShouldSplit(field, gen_->options_)};
+            ShouldSplit(field, gen_->options_),
+            IsStringPiece(field, gen_->options_)};
   }
 
  private:
@@ -209,6 +210,34 @@ bool ParseFunctionGenerator::should_generate_tctable() const {
   return true;
 }
 
+size_t ParseFunctionGenerator::TailCallTableSize() const {
+  if (!should_generate_tctable()) return 0;
+  // Mirrors the layout of TcParseTable<>.
+  return sizeof(internal::TcParseTableBase) +
+         (size_t{1} << tc_table_info_->table_size_log2) *
+             sizeof(internal::TcParseTableBase::FastFieldEntry) +
+         tc_table_info_->num_to_entry_table.size16() * sizeof(uint16_t) +
+         tc_table_info_->field_entries.size() *
+             sizeof(internal::TcParseTableBase::FieldEntry) +
+         tc_table_info_->aux_entries.size() *
+             sizeof(internal::TcParseTableBase::FieldAux) +
+         tc_table_info_->field_name_data.size();
+}
+
+int ParseFunctionGenerator::NumMpFallbackFields() const {
+  if (!should_generate_tctable()) return 0;
+  return static_cast<int>(tc_table_info_->fallback_fields.size());
+}
+
+int ParseFunctionGenerator::NumOutOfLineFunctions() const {
+  // `_InternalParse` (for MessageSets, the one that parses the extensions),
+  // and the fallback that the table may call.
+  if (should_generate_tctable() && tc_table_info_->use_generated_fallback) {
+    return 2;
+  }
+  return 1;
+}
+
 void ParseFunctionGenerator::GenerateTailcallParseFunction(Formatter& format) {
   GOOGLE_CHECK(should_generate_tctable());
 
@@ -631,7 +660,10 @@ void ParseFunctionGenerator::GenerateTailCallTable(Formatter& format) {
                            aux_entry.field->message_type(), options_));
                 break;
               case TailCallTableInfo::kMessageVerifyFunc:
-                if (aux_entry.field != nullptr) {
+                // Without generated verifiers, [lazy] fields are verified
+                // by parsing them.
+                if (aux_entry.field != nullptr &&
+                    ShouldVerify(descriptor_, options_, scc_analyzer_)) {
                   format("{$1$::InternalVerify},\n",
                          QualifiedClassName(aux_entry.field->message_type(),
                                             options_));
@@ -955,6 +987,14 @@ void ParseFunctionGenerator::GenerateStrings(Formatter& format,
       field->default_value_string().empty() &&
       !field->real_containing_oneof() && ctype == FieldOptions::STRING) {
     GenerateArenaString(format, field);
+  } else if (IsStringPiece(field, options_)) {
+    if (internal::cpp::HasHasbit(field)) {
+      format("_Internal::set_has_$1$(&$has_bits$);\n", FieldName(field));
+    }
+    format(
+        "ptr = ctx->ReadStringPieceField(ptr, &$msg$$field$, "
+        "$msg$GetArenaForAllocation());\n"
+        "::absl::string_view str = $msg$$field$.Get();\n");
   } else {
     std::string parser_name;
     switch (ctype) {
@@ -1068,33 +1108,15 @@ void ParseFunctionGenerator::GenerateLengthDelim(Formatter& format,
                                    "::InternalVerify")
                     : "nullptr");
           }
-          if (field->real_containing_oneof()) {
-            format(
-                "if ($msg$$1$_case() != k$2$) {\n"
-                "  $msg$clear_$1$();\n"
-                "  $msg$$field$ = ::$proto_ns$::Arena::CreateMessage<\n"
-                "      ::$proto_ns$::internal::LazyField>("
-                "$msg$GetArenaForAllocation());\n"
-                "  $msg$set_has_$name$();\n"
-                "}\n"
-                "auto* lazy_field = $msg$$field$;\n",
-                field->containing_oneof()->name(),
-                UnderscoresToCamelCase(field->name(), true));
-          } else if (internal::cpp::HasHasbit(field)) {
-            format(
-                "_Internal::set_has_$name$(&$has_bits$);\n"
-                "auto* lazy_field = &$msg$$field$;\n");
-          } else {
-            format("auto* lazy_field = &$msg$$field$;\n");
+          // Only singular, non-oneof fields are backed by LazyField.
+          GOOGLE_CHECK(!field->real_containing_oneof());
+          if (internal::cpp::HasHasbit(field)) {
+            format("_Internal::set_has_$name$(&$has_bits$);\n");
           }
           format(
-              "::$proto_ns$::internal::LazyFieldParseHelper<\n"
-              "  ::$proto_ns$::internal::LazyField> parse_helper(\n"
-              "    $1$::default_instance(),\n"
-              "    $msg$GetArenaForAllocation(),\n"
-              "    ::google::protobuf::internal::LazyVerifyOption::$2$,\n"
-              "    lazy_field);\n"
-              "ptr = ctx->ParseMessage(&parse_helper, ptr);\n",
+              "ptr = $msg$$field$._InternalParse(\n"
+              "    $1$::default_instance(), $msg$GetArenaForAllocation(),\n"
+              "    ::$proto_ns$::internal::LazyVerifyOption::$2$, ptr, ctx);\n",
               FieldMessageTypeName(field, options_),
               eager_verify ? "kEager" : "kLazy");
           if (ShouldVerify(descriptor_, options_, scc_analyzer_) &&
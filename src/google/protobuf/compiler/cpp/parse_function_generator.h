@@ -70,6 +70,18 @@ class ParseFunctionGenerator {
   // Emits out-of-class data member definitions to `printer`:
   void GenerateDataDefinitions(io::Printer* printer);
 
+  // Returns the size in bytes of the generated `_table_`, or 0 if the message
+  // has none.
+  size_t TailCallTableSize() const;
+
+  // Returns the number of fields that the table hands to MpFallback, and so
+  // to the (generic or generated) fallback parser.
+  int NumMpFallbackFields() const;
+
+  // Returns the number of functions GenerateMethodImpls() defines when the
+  // table parser is enabled, which is the default.
+  int NumOutOfLineFunctions() const;
+
  private:
   class GeneratedOptionProvider;
 
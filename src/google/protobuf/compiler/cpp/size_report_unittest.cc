@@ -0,0 +1,159 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Golden tests of the report written by the size_report generator option
+// (see FileGenerator::GenerateSizeReport()).
+
+#include <string>
+#include <vector>
+
+#include "google/protobuf/testing/file.h"
+#include "google/protobuf/compiler/cpp/generator.h"
+#include "google/protobuf/compiler/command_line_interface.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/testing/googletest.h"
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "google/protobuf/compiler/annotation_test_util.h"
+#include "google/protobuf/compiler/cpp/helpers.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+namespace atu = annotation_test_util;
+
+namespace {
+
+// Runs the C++ generator with the size_report option and `options` on
+// `filename` and returns the report, with the source_bytes column, which
+// changes with any edit to the generated code, replaced by "*".
+std::string GenerateSizeReport(const std::string& filename,
+                               const std::string& options = "") {
+  CommandLineInterface cli;
+  CppGenerator cpp_generator;
+  cli.RegisterGenerator("--cpp_out", &cpp_generator, "");
+  FileDescriptorProto file;
+  EXPECT_TRUE(atu::RunProtoCompiler(
+      filename, absl::StrCat("--cpp_out=size_report", options, ":",
+                             TestTempDir()),
+      &cli, &file));
+
+  std::string report;
+  GOOGLE_CHECK_OK(File::GetContents(
+      absl::StrCat(TestTempDir(), "/", StripProto(filename),
+                   ".pb.size_report.tsv"),
+      &report, true));
+  std::vector<std::string> lines = absl::StrSplit(report, '\n');
+  for (std::string& line : lines) {
+    std::vector<std::string> columns = absl::StrSplit(line, '\t');
+    if (line.empty() || line[0] == '#') continue;
+    EXPECT_EQ(7, columns.size()) << line;
+    EXPECT_GT(std::stoi(columns[2]), 0) << line;
+    columns[2] = "*";
+    line = absl::StrJoin(columns, "\t");
+  }
+  return absl::StrJoin(lines, "\n");
+}
+
+const char kSizeReportTestFile[] =
+    "syntax = \"proto2\";\n"
+    "package foo;\n"
+    "message Empty {}\n"
+    "message Scalars {\n"
+    "  optional int32 i = 1;\n"
+    "  optional string s = 2 [default = \"s\"];\n"
+    "  repeated int64 r = 3;\n"
+    "}\n"
+    "message Composite {\n"
+    "  optional Scalars child = 1;\n"
+    "  oneof choice {\n"
+    "    int32 number = 2;\n"
+    "    Scalars other = 3;\n"
+    "  }\n"
+    "  map<int32, string> entries = 4;\n"
+    "  required int32 id = 5;\n"
+    "  extensions 100 to 199;\n"
+    "}\n";
+
+TEST(CppSizeReportTest, Golden) {
+  // Instance and table sizes are those of 64-bit targets.
+  if (sizeof(void*) != 8) GTEST_SKIP();
+  atu::AddFile("size_report.proto", kSizeReportTestFile);
+  EXPECT_EQ(
+      "# message\tfunctions\tsource_bytes\ttctable_bytes\tinstance_bytes\t"
+      "descriptor_bytes\tfallback_fields\n"
+      "foo.Empty\t4\t*\t0\t20\t7\t0\n"
+      "foo.Scalars\t16\t*\t0\t52\t45\t0\n"
+      "foo.Composite.EntriesEntry\t4\t*\t0\t36\t46\t0\n"
+      "foo.Composite\t21\t*\t0\t128\t164\t0\n",
+      GenerateSizeReport("size_report.proto"));
+}
+
+TEST(CppSizeReportTest, TailCallTableGolden) {
+  // The map field is parsed by the generated fallback, an extra function.
+  if (sizeof(void*) != 8) GTEST_SKIP();
+  atu::AddFile("size_report.proto", kSizeReportTestFile);
+  EXPECT_EQ(
+      "# message\tfunctions\tsource_bytes\ttctable_bytes\tinstance_bytes\t"
+      "descriptor_bytes\tfallback_fields\n"
+      "foo.Empty\t4\t*\t0\t20\t7\t0\n"
+      "foo.Scalars\t16\t*\t180\t52\t45\t0\n"
+      "foo.Composite.EntriesEntry\t4\t*\t155\t36\t46\t0\n"
+      "foo.Composite\t22\t*\t264\t128\t164\t1\n",
+      GenerateSizeReport("size_report.proto",
+                         ",experimental_tail_call_table_mode=always"));
+}
+
+TEST(CppSizeReportTest, LiteGolden) {
+  // Without reflection no descriptor is embedded, and even Empty has its own
+  // Clear(), serializer and parser.
+  if (sizeof(void*) != 8) GTEST_SKIP();
+  atu::AddFile("size_report_lite.proto",
+               absl::StrCat(kSizeReportTestFile,
+                            "option optimize_for = LITE_RUNTIME;\n"));
+  EXPECT_EQ(
+      "# message\tfunctions\tsource_bytes\ttctable_bytes\tinstance_bytes\t"
+      "descriptor_bytes\tfallback_fields\n"
+      "foo.Empty\t16\t*\t0\t20\t0\t0\n"
+      "foo.Scalars\t16\t*\t0\t52\t0\t0\n"
+      "foo.Composite.EntriesEntry\t3\t*\t0\t36\t0\t0\n"
+      "foo.Composite\t20\t*\t0\t128\t0\t0\n",
+      GenerateSizeReport("size_report_lite.proto"));
+}
+
+}  // namespace
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
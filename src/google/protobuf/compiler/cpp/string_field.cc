@@ -576,6 +576,134 @@ void StringFieldGenerator::GenerateCopyAggregateInitializer(
 
 // ===================================================================
 
+StringPieceFieldGenerator::StringPieceFieldGenerator(
+    const FieldDescriptor* descriptor, const Options& options)
+    : FieldGenerator(descriptor, options) {
+  SetStringVariables(descriptor, &variables_, options);
+}
+
+StringPieceFieldGenerator::~StringPieceFieldGenerator() {}
+
+void StringPieceFieldGenerator::GeneratePrivateMembers(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("::$proto_ns$::internal::StringPieceField $name$_;\n");
+}
+
+void StringPieceFieldGenerator::GenerateAccessorDeclarations(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "$deprecated_attr$::absl::string_view ${1$$name$$}$() const;\n"
+      "$deprecated_attr$void ${1$set_$name$$}$(::absl::string_view value);\n"
+      "private:\n"
+      "::absl::string_view _internal_$name$() const;\n"
+      "void _internal_set_$name$(::absl::string_view value);\n"
+      "public:\n",
+      descriptor_);
+}
+
+void StringPieceFieldGenerator::GenerateInlineAccessorDefinitions(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "inline ::absl::string_view $classname$::$name$() const {\n"
+      "$annotate_get$"
+      "  // @@protoc_insertion_point(field_get:$full_name$)\n"
+      "  return _internal_$name$();\n"
+      "}\n"
+      "inline void $classname$::set_$name$(::absl::string_view value) {\n"
+      "  _internal_set_$name$(value);\n"
+      "$annotate_set$"
+      "  // @@protoc_insertion_point(field_set:$full_name$)\n"
+      "}\n"
+      "inline ::absl::string_view $classname$::_internal_$name$() const {\n"
+      "  return $field$.Get();\n"
+      "}\n"
+      "inline void $classname$::_internal_set_$name$(::absl::string_view "
+      "value) {\n"
+      "  $set_hasbit$\n"
+      "  $field$.Set(value, GetArenaForAllocation());\n"
+      "}\n");
+}
+
+void StringPieceFieldGenerator::GenerateClearingCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("$field$.Clear();\n");
+}
+
+void StringPieceFieldGenerator::GenerateMergingCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("_this->_internal_set_$name$(from._internal_$name$());\n");
+}
+
+void StringPieceFieldGenerator::GenerateSwappingCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("$field$.InternalSwap(&other->$field$);\n");
+}
+
+void StringPieceFieldGenerator::GenerateCopyConstructorCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "_this->$field$.Set(from._internal_$name$(),\n"
+      "                   _this->GetArenaForAllocation());\n");
+}
+
+void StringPieceFieldGenerator::GenerateDestructorCode(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("$field$.Destroy();\n");
+}
+
+void StringPieceFieldGenerator::GenerateSerializeWithCachedSizesToArray(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  if (descriptor_->type() == FieldDescriptor::TYPE_STRING) {
+    GenerateUtf8CheckCodeForString(
+        descriptor_, options_, false,
+        "this->_internal_$name$().data(), "
+        "static_cast<int>(this->_internal_$name$().length()),\n",
+        format);
+  }
+  format(
+      "target = stream->WriteString($number$, this->_internal_$name$(), "
+      "target);\n");
+}
+
+void StringPieceFieldGenerator::GenerateByteSize(io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format(
+      "total_size += $tag_size$ +\n"
+      "  ::$proto_ns$::internal::WireFormatLite::LengthDelimitedSize(\n"
+      "    this->_internal_$name$().size());\n");
+}
+
+// StringPieceField is neither copyable nor movable, so it is always
+// initialized in place from an empty braced list.
+void StringPieceFieldGenerator::GenerateConstexprAggregateInitializer(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("/*decltype($field$)*/{}");
+}
+
+void StringPieceFieldGenerator::GenerateAggregateInitializer(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("/*decltype($field$)*/{}");
+}
+
+void StringPieceFieldGenerator::GenerateCopyAggregateInitializer(
+    io::Printer* printer) const {
+  Formatter format(printer, variables_);
+  format("/*decltype($field$)*/{}");
+}
+
+// ===================================================================
+
 StringOneofFieldGenerator::StringOneofFieldGenerator(
     const FieldDescriptor* descriptor, const Options& options)
     : StringFieldGenerator(descriptor, options) {
@@ -81,6 +81,36 @@ class StringFieldGenerator : public FieldGenerator {
   bool inlined_;
 };
 
+// Generates a singular [ctype = STRING_PIECE] field backed by
+// internal::StringPieceField, which is read and written as absl::string_view.
+class StringPieceFieldGenerator : public FieldGenerator {
+ public:
+  StringPieceFieldGenerator(const FieldDescriptor* descriptor,
+                            const Options& options);
+  StringPieceFieldGenerator(const StringPieceFieldGenerator&) = delete;
+  StringPieceFieldGenerator& operator=(const StringPieceFieldGenerator&) =
+      delete;
+  ~StringPieceFieldGenerator() override;
+
+  // implements FieldGenerator ---------------------------------------
+  void GeneratePrivateMembers(io::Printer* printer) const override;
+  void GenerateAccessorDeclarations(io::Printer* printer) const override;
+  void GenerateInlineAccessorDefinitions(io::Printer* printer) const override;
+  void GenerateClearingCode(io::Printer* printer) const override;
+  void GenerateMergingCode(io::Printer* printer) const override;
+  void GenerateSwappingCode(io::Printer* printer) const override;
+  void GenerateConstructorCode(io::Printer* printer) const override {}
+  void GenerateCopyConstructorCode(io::Printer* printer) const override;
+  void GenerateDestructorCode(io::Printer* printer) const override;
+  void GenerateSerializeWithCachedSizesToArray(
+      io::Printer* printer) const override;
+  void GenerateByteSize(io::Printer* printer) const override;
+  void GenerateConstexprAggregateInitializer(
+      io::Printer* printer) const override;
+  void GenerateAggregateInitializer(io::Printer* printer) const override;
+  void GenerateCopyAggregateInitializer(io::Printer* printer) const override;
+};
+
 class StringOneofFieldGenerator : public StringFieldGenerator {
  public:
   StringOneofFieldGenerator(const FieldDescriptor* descriptor,
@@ -39,21 +39,32 @@
 #else
 #include <unistd.h>
 #endif
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <dirent.h>
+#endif
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/compiler/parser.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/tokenizer.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -62,6 +73,9 @@
 #include <ctype.h>
 #endif
 
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
 namespace google {
 namespace protobuf {
 namespace compiler {
@@ -73,6 +87,14 @@ using google::protobuf::io::win32::access;
 using google::protobuf::io::win32::open;
 #endif
 
+#ifndef O_BINARY
+#ifdef _O_BINARY
+#define O_BINARY _O_BINARY
+#else
+#define O_BINARY 0  // If this isn't defined, the platform doesn't need it.
+#endif
+#endif
+
 // Returns true if the text looks like a Windows-style absolute path, starting
 // with a drive letter.  Example:  "C:\foo".  TODO(kenton):  Share this with
 // copy in command_line_interface.cc?
@@ -85,6 +107,15 @@ static bool IsWindowsAbsolutePath(absl::string_view text) {
 #endif
 }
 
+// Appends everything remaining in the stream to *output.
+static void ReadAll(io::ZeroCopyInputStream* input, std::string* output) {
+  const void* data;
+  int size;
+  while (input->Next(&data, &size)) {
+    output->append(static_cast<const char*>(data), size);
+  }
+}
+
 MultiFileErrorCollector::~MultiFileErrorCollector() {}
 
 // This class serves two purposes:
@@ -124,6 +155,7 @@ SourceTreeDescriptorDatabase::SourceTreeDescriptorDatabase(
     : source_tree_(source_tree),
       fallback_database_(nullptr),
       error_collector_(nullptr),
+      parse_cache_(nullptr),
       using_validation_error_collector_(false),
       validation_error_collector_(this) {}
 
@@ -132,6 +164,7 @@ SourceTreeDescriptorDatabase::SourceTreeDescriptorDatabase(
     : source_tree_(source_tree),
       fallback_database_(fallback_database),
       error_collector_(nullptr),
+      parse_cache_(nullptr),
       using_validation_error_collector_(false),
       validation_error_collector_(this) {}
 
@@ -152,9 +185,18 @@ bool SourceTreeDescriptorDatabase::FindFileByName(const std::string& filename,
     return false;
   }
 
+  if (parse_cache_ != nullptr) {
+    return ParseWithCache(filename, input.get(), output);
+  }
+  return ParseFile(filename, input.get(), output);
+}
+
+bool SourceTreeDescriptorDatabase::ParseFile(const std::string& filename,
+                                             io::ZeroCopyInputStream* input,
+                                             FileDescriptorProto* output) {
   // Set up the tokenizer and parser.
   SingleFileErrorCollector file_error_collector(filename, error_collector_);
-  io::Tokenizer tokenizer(input.get(), &file_error_collector);
+  io::Tokenizer tokenizer(input, &file_error_collector);
 
   Parser parser;
   if (error_collector_ != nullptr) {
@@ -169,6 +211,27 @@ bool SourceTreeDescriptorDatabase::FindFileByName(const std::string& filename,
   return parser.Parse(&tokenizer, output) && !file_error_collector.had_errors();
 }
 
+bool SourceTreeDescriptorDatabase::ParseWithCache(
+    const std::string& filename, io::ZeroCopyInputStream* input,
+    FileDescriptorProto* output) {
+  std::string contents;
+  ReadAll(input, &contents);
+
+  // Locations are only needed if a DescriptorPool may ask for them.
+  SourceLocationTable* source_locations =
+      using_validation_error_collector_ ? &source_locations_ : nullptr;
+  if (parse_cache_->Lookup(filename, contents, output, source_locations)) {
+    return true;
+  }
+
+  io::ArrayInputStream contents_input(contents.data(), contents.size());
+  if (!ParseFile(filename, &contents_input, output)) {
+    return false;
+  }
+  parse_cache_->Store(filename, contents, *output, source_locations);
+  return true;
+}
+
 bool SourceTreeDescriptorDatabase::FindFileContainingSymbol(
     const std::string& symbol_name, FileDescriptorProto* output) {
   return false;
@@ -247,6 +310,354 @@ void Importer::ClearUnusedImportTrackFiles() {
 }
 
 
+// ===================================================================
+
+namespace {
+
+// Identifies the entry format, and the parser that produced the entry.
+// Changing either must invalidate existing entries.
+const char kParseCacheMagic[] = "protoc-parse-cache";
+const uint32_t kParseCacheFormatVersion = 1;
+
+const DescriptorPool::ErrorCollector::ErrorLocation kAllErrorLocations[] = {
+    DescriptorPool::ErrorCollector::NAME,
+    DescriptorPool::ErrorCollector::NUMBER,
+    DescriptorPool::ErrorCollector::TYPE,
+    DescriptorPool::ErrorCollector::EXTENDEE,
+    DescriptorPool::ErrorCollector::DEFAULT_VALUE,
+    DescriptorPool::ErrorCollector::INPUT_TYPE,
+    DescriptorPool::ErrorCollector::OUTPUT_TYPE,
+    DescriptorPool::ErrorCollector::OPTION_NAME,
+    DescriptorPool::ErrorCollector::OPTION_VALUE,
+    DescriptorPool::ErrorCollector::IMPORT,
+    DescriptorPool::ErrorCollector::OTHER,
+};
+
+// A SourceLocationTable is keyed by pointers into a particular
+// FileDescriptorProto, so in an entry each message is identified instead by
+// its index in a pre-order walk of the proto, which is the same for the proto
+// that was stored and the one parsed back from the entry.
+void CollectMessages(const Message& message,
+                     std::vector<const Message*>* output) {
+  output->push_back(&message);
+  const Reflection* reflection = message.GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  reflection->ListFields(message, &fields);
+  for (const FieldDescriptor* field : fields) {
+    if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) continue;
+    if (field->is_repeated()) {
+      for (int i = 0; i < reflection->FieldSize(message, field); i++) {
+        CollectMessages(reflection->GetRepeatedMessage(message, field, i),
+                        output);
+      }
+    } else {
+      CollectMessages(reflection->GetMessage(message, field), output);
+    }
+  }
+}
+
+// FNV-1a.  Only used to name entries, which are verified on lookup, so it
+// needn't be strong; it must however be stable across processes.
+uint64_t HashForCache(absl::string_view data, uint64_t hash) {
+  for (char c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool ReadString(io::CodedInputStream* input, std::string* value) {
+  uint32_t size;
+  return input->ReadVarint32(&size) && input->ReadString(value, size);
+}
+
+void WriteString(io::CodedOutputStream* output, absl::string_view value) {
+  output->WriteVarint32(value.size());
+  output->WriteRaw(value.data(), value.size());
+}
+
+int CurrentProcessId() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+struct CacheEntry {
+  std::string path;
+  int64_t size;
+  int64_t modification_time;
+};
+
+// Appends the entries in directory, which ends with a '/', to *entries.
+void ListCacheEntries(const std::string& directory,
+                      std::vector<CacheEntry>* entries) {
+  auto add_entry = [entries](const std::string& path) {
+#ifdef _WIN32
+    struct _stat info;
+    if (io::win32::stat(path.c_str(), &info) != 0) return;
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return;
+#endif
+    entries->push_back({path, static_cast<int64_t>(info.st_size),
+                        static_cast<int64_t>(info.st_mtime)});
+  };
+#ifdef _WIN32
+  io::win32::ExpandWildcards(absl::StrCat(directory, "*.pbcache"), add_entry);
+#else
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) return;
+  while (struct dirent* dir_entry = readdir(dir)) {
+    if (absl::EndsWith(dir_entry->d_name, ".pbcache")) {
+      add_entry(absl::StrCat(directory, dir_entry->d_name));
+    }
+  }
+  closedir(dir);
+#endif
+}
+
+}  // namespace
+
+DiskParseCache::DiskParseCache(const std::string& directory,
+                               int64_t max_bytes)
+    : directory_(directory), max_bytes_(max_bytes), stored_(false) {
+  if (!directory_.empty() && directory_.back() != '/') {
+    directory_.push_back('/');
+  }
+}
+
+DiskParseCache::~DiskParseCache() {
+  // Reading entries never makes the directory grow, so only a cache that
+  // wrote some needs to look at it again.
+  if (stored_) Trim();
+}
+
+void DiskParseCache::Trim() {
+  std::vector<CacheEntry> entries;
+  ListCacheEntries(directory_, &entries);
+  int64_t total_size = 0;
+  for (const CacheEntry& entry : entries) total_size += entry.size;
+  if (total_size <= max_bytes_) return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const CacheEntry& a, const CacheEntry& b) {
+              return a.modification_time < b.modification_time;
+            });
+  for (const CacheEntry& entry : entries) {
+    if (total_size <= max_bytes_) break;
+    // Another process may have removed it already, or still be reading it
+    // on a platform that forbids removing open files; neither matters.
+    if (remove(entry.path.c_str()) == 0) total_size -= entry.size;
+  }
+}
+
+std::string DiskParseCache::EntryPath(const std::string& filename,
+                                      absl::string_view contents) const {
+  uint64_t hash = HashForCache(filename, 0xcbf29ce484222325ULL);
+  hash = HashForCache(absl::string_view("\0", 1), hash);
+  hash = HashForCache(contents, hash);
+  return absl::StrCat(directory_, absl::Hex(hash, absl::kZeroPad16),
+                      ".pbcache");
+}
+
+bool DiskParseCache::Lookup(const std::string& filename,
+                            absl::string_view contents,
+                            FileDescriptorProto* output,
+                            SourceLocationTable* source_locations) {
+  int file_descriptor;
+  do {
+    file_descriptor = open(EntryPath(filename, contents).c_str(),
+                           O_RDONLY | O_BINARY);
+  } while (file_descriptor < 0 && errno == EINTR);
+  if (file_descriptor < 0) return false;
+
+  std::string entry;
+  {
+    io::FileInputStream file_input(file_descriptor);
+    file_input.SetCloseOnDelete(true);
+    ReadAll(&file_input, &entry);
+  }
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(entry.data()),
+                             entry.size());
+
+  // The header, name and contents must match exactly.
+  std::string magic;
+  uint32_t version, format_version, contents_size;
+  std::string entry_filename;
+  if (!input.ReadString(&magic, sizeof(kParseCacheMagic) - 1) ||
+      magic != kParseCacheMagic || !input.ReadVarint32(&version) ||
+      version != PROTOBUF_VERSION || !input.ReadVarint32(&format_version) ||
+      format_version != kParseCacheFormatVersion ||
+      !ReadString(&input, &entry_filename) || entry_filename != filename ||
+      !input.ReadVarint32(&contents_size) ||
+      contents_size != contents.size() ||
+      absl::string_view(entry).substr(input.CurrentPosition(),
+                                      contents_size) != contents ||
+      !input.Skip(contents_size)) {
+    return false;
+  }
+
+  std::string parsed;
+  uint32_t has_locations;
+  if (!ReadString(&input, &parsed) || !input.ReadVarint32(&has_locations)) {
+    return false;
+  }
+  if (source_locations != nullptr && !has_locations) return false;
+
+  FileDescriptorProto result;
+  if (!result.ParseFromString(parsed)) return false;
+
+  // Decode all locations before touching *source_locations, so that a
+  // damaged entry can't leave it half-updated.
+  struct Location {
+    const Message* message;
+    int location;
+    int line;
+    int column;
+  };
+  struct ImportLocation {
+    std::string name;
+    int line;
+    int column;
+  };
+  std::vector<Location> locations;
+  std::vector<ImportLocation> import_locations;
+  if (source_locations != nullptr) {
+    std::vector<const Message*> messages;
+    CollectMessages(result, &messages);
+    uint32_t count;
+    if (!input.ReadVarint32(&count)) return false;
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t index, location, line, column;
+      if (!input.ReadVarint32(&index) || index >= messages.size() ||
+          !input.ReadVarint32(&location) ||
+          location > DescriptorPool::ErrorCollector::OTHER ||
+          !input.ReadVarint32(&line) || !input.ReadVarint32(&column)) {
+        return false;
+      }
+      locations.push_back({messages[index], static_cast<int>(location),
+                           static_cast<int>(line), static_cast<int>(column)});
+    }
+
+    if (!input.ReadVarint32(&count)) return false;
+    for (uint32_t i = 0; i < count; i++) {
+      ImportLocation import_location;
+      uint32_t line, column;
+      if (!ReadString(&input, &import_location.name) ||
+          !input.ReadVarint32(&line) || !input.ReadVarint32(&column)) {
+        return false;
+      }
+      import_location.line = static_cast<int>(line);
+      import_location.column = static_cast<int>(column);
+      import_locations.push_back(std::move(import_location));
+    }
+  }
+
+  // The locations refer to messages in result, so it has to be swapped into
+  // *output rather than copied.
+  output->Swap(&result);
+  for (const Location& location : locations) {
+    source_locations->Add(
+        location.message,
+        static_cast<DescriptorPool::ErrorCollector::ErrorLocation>(
+            location.location),
+        location.line, location.column);
+  }
+  for (const ImportLocation& import_location : import_locations) {
+    source_locations->AddImport(output, import_location.name,
+                                import_location.line, import_location.column);
+  }
+  return true;
+}
+
+void DiskParseCache::Store(const std::string& filename,
+                           absl::string_view contents,
+                           const FileDescriptorProto& parsed,
+                           const SourceLocationTable* source_locations) {
+  // Write to a file of our own and rename it into place, so that concurrent
+  // readers never see a partial entry.
+  std::string path = EntryPath(filename, contents);
+  std::string temp_path =
+      absl::StrCat(path, ".", CurrentProcessId(), ".tmp");
+  int file_descriptor;
+  do {
+    file_descriptor = open(temp_path.c_str(),
+                           O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+  } while (file_descriptor < 0 && errno == EINTR);
+  if (file_descriptor < 0) return;
+
+  bool success;
+  {
+    io::FileOutputStream file_output(file_descriptor);
+    {
+      io::CodedOutputStream output(&file_output);
+      output.WriteRaw(kParseCacheMagic, sizeof(kParseCacheMagic) - 1);
+      output.WriteVarint32(PROTOBUF_VERSION);
+      output.WriteVarint32(kParseCacheFormatVersion);
+      WriteString(&output, filename);
+      WriteString(&output, contents);
+      WriteString(&output, parsed.SerializeAsString());
+      output.WriteVarint32(source_locations != nullptr);
+
+      if (source_locations != nullptr) {
+        std::vector<const Message*> messages;
+        CollectMessages(parsed, &messages);
+
+        struct Location {
+          uint32_t index;
+          int location;
+          int line;
+          int column;
+        };
+        std::vector<Location> locations;
+        for (uint32_t i = 0; i < messages.size(); i++) {
+          for (auto location : kAllErrorLocations) {
+            int line, column;
+            if (source_locations->Find(messages[i], location, &line,
+                                       &column)) {
+              locations.push_back({i, location, line, column});
+            }
+          }
+        }
+        output.WriteVarint32(locations.size());
+        for (const Location& location : locations) {
+          output.WriteVarint32(location.index);
+          output.WriteVarint32(location.location);
+          output.WriteVarint32(location.line);
+          output.WriteVarint32(location.column);
+        }
+
+        std::vector<std::pair<const std::string*, std::pair<int, int>>>
+            import_locations;
+        for (const std::string& dependency : parsed.dependency()) {
+          int line, column;
+          if (source_locations->FindImport(&parsed, dependency, &line,
+                                           &column)) {
+            import_locations.push_back({&dependency, {line, column}});
+          }
+        }
+        output.WriteVarint32(import_locations.size());
+        for (const auto& import_location : import_locations) {
+          WriteString(&output, *import_location.first);
+          output.WriteVarint32(import_location.second.first);
+          output.WriteVarint32(import_location.second.second);
+        }
+      }
+      success = !output.HadError();
+    }
+    success = file_output.Close() && success;
+  }
+
+  if (!success || rename(temp_path.c_str(), path.c_str()) != 0) {
+    // Most likely another process got there first, which is fine.
+    remove(temp_path.c_str());
+    return;
+  }
+  stored_ = true;
+}
+
 // ===================================================================
 
 SourceTree::~SourceTree() {}
@@ -518,3 +929,5 @@ io::ZeroCopyInputStream* DiskSourceTree::OpenDiskFile(
 }  // namespace compiler
 }  // namespace protobuf
 }  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -37,10 +37,12 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_IMPORTER_H__
 #define GOOGLE_PROTOBUF_COMPILER_IMPORTER_H__
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "google/protobuf/compiler/parser.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor_database.h"
@@ -62,6 +64,7 @@ class Importer;
 class MultiFileErrorCollector;
 class SourceTree;
 class DiskSourceTree;
+class DiskParseCache;
 
 // TODO(kenton):  Move all SourceTree stuff to a separate file?
 
@@ -105,6 +108,11 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
     return &validation_error_collector_;
   }
 
+  // Makes FindFileByName() look each file up in the given cache before
+  // parsing it, and store the result there afterwards.  The cache must
+  // outlive this object.  Pass nullptr to stop using a cache.
+  void UseParseCache(DiskParseCache* cache) { parse_cache_ = cache; }
+
   // implements DescriptorDatabase -----------------------------------
   bool FindFileByName(const std::string& filename,
                       FileDescriptorProto* output) override;
@@ -117,9 +125,18 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
  private:
   class SingleFileErrorCollector;
 
+  // Parses the given file, reporting errors to error_collector_.
+  bool ParseFile(const std::string& filename, io::ZeroCopyInputStream* input,
+                 FileDescriptorProto* output);
+  // Like ParseFile(), but consults parse_cache_ first.
+  bool ParseWithCache(const std::string& filename,
+                      io::ZeroCopyInputStream* input,
+                      FileDescriptorProto* output);
+
   SourceTree* source_tree_;
   DescriptorDatabase* fallback_database_;
   MultiFileErrorCollector* error_collector_;
+  DiskParseCache* parse_cache_;
 
   class PROTOBUF_EXPORT ValidationErrorCollector
       : public DescriptorPool::ErrorCollector {
@@ -185,12 +202,65 @@ class PROTOBUF_EXPORT Importer {
                                 bool is_error = false);
   void ClearUnusedImportTrackFiles();
 
+  // See SourceTreeDescriptorDatabase::UseParseCache().
+  void UseParseCache(DiskParseCache* cache) { database_.UseParseCache(cache); }
+
 
  private:
   SourceTreeDescriptorDatabase database_;
   DescriptorPool pool_;
 };
 
+// A persistent cache of parsed .proto files, kept as one file per entry in a
+// directory on disk.  Entries are keyed by a file's name and contents, so a
+// file is only parsed again after it changes.  Each entry also holds the
+// contents it was parsed from, which are compared on lookup, so a hash
+// collision costs a reparse rather than a wrong result.
+//
+// Entries are written to a temporary file and then renamed into place, so
+// several processes may share one directory.  Failing to read or write an
+// entry is not an error; the file is simply parsed as if it were not cached.
+//
+// The directory is kept to at most max_bytes of entries: when a cache that
+// stored any entries is destroyed, the least recently written entries are
+// removed until the rest fit.
+class PROTOBUF_EXPORT DiskParseCache {
+ public:
+  static constexpr int64_t kDefaultMaxBytes = int64_t{64} << 20;
+
+  // The directory must already exist.
+  explicit DiskParseCache(const std::string& directory,
+                          int64_t max_bytes = kDefaultMaxBytes);
+  DiskParseCache(const DiskParseCache&) = delete;
+  DiskParseCache& operator=(const DiskParseCache&) = delete;
+  ~DiskParseCache();
+
+  // Looks up the result of parsing the given file.  If source_locations is
+  // non-null, the entry must also have the locations the parser recorded,
+  // which are added to it (keyed by elements of *output).  Returns false if
+  // there is no usable entry.
+  bool Lookup(const std::string& filename, absl::string_view contents,
+              FileDescriptorProto* output,
+              SourceLocationTable* source_locations);
+
+  // Records that parsing the given file produced the given proto.  If
+  // source_locations is non-null, the locations it holds for elements of
+  // parsed are saved along with it.
+  void Store(const std::string& filename, absl::string_view contents,
+             const FileDescriptorProto& parsed,
+             const SourceLocationTable* source_locations);
+
+ private:
+  std::string EntryPath(const std::string& filename,
+                        absl::string_view contents) const;
+  // Removes the oldest entries until the rest take at most max_bytes_.
+  void Trim();
+
+  std::string directory_;
+  int64_t max_bytes_;
+  bool stored_;
+};
+
 // If the importer encounters problems while trying to import the proto files,
 // it reports them to a MultiFileErrorCollector.
 class PROTOBUF_EXPORT MultiFileErrorCollector {
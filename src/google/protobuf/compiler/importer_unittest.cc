@@ -41,6 +41,7 @@
 #include "google/protobuf/testing/file.h"
 #include "google/protobuf/testing/file.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
 #include "absl/container/flat_hash_map.h"
@@ -253,6 +254,134 @@ TEST_F(ImporterTest, LiteRuntimeImport) {
       error_collector_.text_);
 }
 
+// ===================================================================
+
+class DiskParseCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    dirname_ = TestTempDir() + "/test_parse_cache";
+    if (FileExists(dirname_)) {
+      File::DeleteRecursively(dirname_, NULL, NULL);
+    }
+    GOOGLE_CHECK_OK(File::CreateDir(dirname_, 0777));
+  }
+
+  void TearDown() override {
+    if (FileExists(dirname_)) {
+      File::DeleteRecursively(dirname_, NULL, NULL);
+    }
+  }
+
+  // Imports the file with a fresh Importer using a cache in dirname_, and
+  // returns its FileDescriptorProto, or the errors reported.
+  std::string Import(
+      const std::string& filename,
+      int64_t max_bytes = DiskParseCache::kDefaultMaxBytes) {
+    MockErrorCollector error_collector;
+    DiskParseCache cache(dirname_, max_bytes);
+    Importer importer(&source_tree_, &error_collector);
+    importer.UseParseCache(&cache);
+    const FileDescriptor* file = importer.Import(filename);
+    if (file == nullptr) return error_collector.text_;
+    FileDescriptorProto proto;
+    file->CopyTo(&proto);
+    return proto.DebugString();
+  }
+
+  MockSourceTree source_tree_;
+  std::string dirname_;
+};
+
+TEST_F(DiskParseCacheTest, ReusesEntries) {
+  const char* foo_contents =
+      "syntax = \"proto2\";\n"
+      "import \"bar.proto\";\n"
+      "message Foo { optional Bar bar = 1; }\n";
+  source_tree_.AddFile("foo.proto", foo_contents);
+  source_tree_.AddFile("bar.proto",
+                       "syntax = \"proto2\";\n"
+                       "message Bar {}\n");
+
+  std::string expected = Import("foo.proto");
+  EXPECT_NE(std::string::npos, expected.find("type_name: \".Bar\""));
+
+  // Both files are in the cache now, with or without source locations.
+  DiskParseCache cache(dirname_);
+  FileDescriptorProto proto;
+  SourceLocationTable source_locations;
+  EXPECT_TRUE(cache.Lookup("foo.proto", foo_contents, &proto, nullptr));
+  EXPECT_EQ("foo.proto", proto.name());
+  EXPECT_TRUE(
+      cache.Lookup("foo.proto", foo_contents, &proto, &source_locations));
+  int line, column;
+  EXPECT_TRUE(source_locations.FindImport(&proto, "bar.proto", &line, &column));
+  EXPECT_EQ(1, line);
+
+  // The cached result is the same as the parsed one.
+  EXPECT_EQ(expected, Import("foo.proto"));
+
+  // Entries are only used for identical contents.
+  EXPECT_FALSE(cache.Lookup("foo.proto", "syntax = \"proto2\";\n", &proto,
+                            nullptr));
+  EXPECT_FALSE(cache.Lookup("baz.proto", foo_contents, &proto, nullptr));
+}
+
+TEST_F(DiskParseCacheTest, ErrorLocations) {
+  // A file that parses but fails to build is cached along with the locations
+  // needed to report its errors.
+  source_tree_.AddFile("foo.proto",
+                       "syntax = \"proto2\";\n"
+                       "message Foo { optional Bar bar = 1; }\n");
+
+  std::string expected = "foo.proto:1:23: \"Bar\" is not defined.\n";
+  EXPECT_EQ(expected, Import("foo.proto"));
+  EXPECT_EQ(expected, Import("foo.proto"));
+}
+
+TEST_F(DiskParseCacheTest, WarningsOnCacheHit) {
+  const char* foo_contents =
+      "syntax = \"proto2\";\n"
+      "import \"bar.proto\";\n"
+      "message Foo {}\n";
+  source_tree_.AddFile("foo.proto", foo_contents);
+  source_tree_.AddFile("bar.proto",
+                       "syntax = \"proto2\";\n"
+                       "message Bar {}\n");
+
+  // Validation warnings are reported again, at the same location, when the
+  // file comes from the cache.
+  std::string expected = "foo.proto:1:0: Import bar.proto is unused.\n";
+  for (int i = 0; i < 2; i++) {
+    MockErrorCollector error_collector;
+    DiskParseCache cache(dirname_);
+    Importer importer(&source_tree_, &error_collector);
+    importer.UseParseCache(&cache);
+    importer.AddUnusedImportTrackFile("foo.proto");
+    EXPECT_TRUE(importer.Import("foo.proto") != nullptr);
+    EXPECT_EQ("", error_collector.text_);
+    EXPECT_EQ(expected, error_collector.warning_text_);
+  }
+  DiskParseCache cache(dirname_);
+  FileDescriptorProto proto;
+  EXPECT_TRUE(cache.Lookup("foo.proto", foo_contents, &proto, nullptr));
+}
+
+TEST_F(DiskParseCacheTest, MaxBytes) {
+  const char* foo_contents =
+      "syntax = \"proto2\";\n"
+      "message Foo {}\n";
+  source_tree_.AddFile("foo.proto", foo_contents);
+  DiskParseCache cache(dirname_);
+  FileDescriptorProto proto;
+
+  // A cache too small to keep any entry removes the ones it wrote.
+  Import("foo.proto", 1);
+  EXPECT_FALSE(cache.Lookup("foo.proto", foo_contents, &proto, nullptr));
+
+  Import("foo.proto");
+  EXPECT_TRUE(cache.Lookup("foo.proto", foo_contents, &proto, nullptr));
+}
+
 
 // ===================================================================
 
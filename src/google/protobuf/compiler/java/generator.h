@@ -66,6 +66,8 @@ class PROTOC_EXPORT JavaGenerator : public CodeGenerator {
 
   uint64_t GetSupportedFeatures() const override;
 
+  bool SupportsConcurrentGeneration() const override { return true; }
+
   void set_opensource_runtime(bool opensource) {
     opensource_runtime_ = opensource;
   }
@@ -113,6 +113,7 @@ class MockCodeGenerator : public CodeGenerator {
                 GeneratorContext* context, std::string* error) const override;
 
   uint64_t GetSupportedFeatures() const override;
+  bool SupportsConcurrentGeneration() const override { return true; }
   void SuppressFeatures(uint64_t features);
 
  private:
@@ -38,14 +38,17 @@
 
 #ifndef _WIN32
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/select.h>
 #include <sys/wait.h>
 #endif
 
 #include "google/protobuf/stubs/logging.h"
+#include "absl/base/attributes.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/message.h"
 
@@ -53,6 +56,15 @@ namespace google {
 namespace protobuf {
 namespace compiler {
 
+namespace {
+// Subprocesses may be started from several threads at once (see --jobs in
+// CommandLineInterface).  Starting one briefly leaves the child's ends of its
+// pipes inheritable, so Start() holds this lock to keep them from leaking
+// into a concurrently started sibling, which would then hold the pipe open
+// and prevent the plugin from ever seeing EOF.
+ABSL_CONST_INIT absl::Mutex start_mutex(absl::kConstInit);
+}  // namespace
+
 #ifdef _WIN32
 
 static void CloseHandleOrDie(HANDLE handle) {
@@ -78,6 +90,8 @@ Subprocess::~Subprocess() {
 }
 
 void Subprocess::Start(const std::string& program, SearchMode search_mode) {
+  absl::MutexLock lock(&start_mutex);
+
   // Create the pipes.
   HANDLE stdin_pipe_read;
   HANDLE stdin_pipe_write;
@@ -315,11 +329,45 @@ char* portable_strdup(const char* s) {
   }
   return ns;
 }
+
+// The "sighandler_t" typedef is GNU-specific, so define our own.
+typedef void SignalHandler(int);
+
+ABSL_CONST_INIT absl::Mutex sigpipe_mutex(absl::kConstInit);
+int sigpipe_ignore_count ABSL_GUARDED_BY(sigpipe_mutex) = 0;
+SignalHandler* old_pipe_handler ABSL_GUARDED_BY(sigpipe_mutex) = nullptr;
+
+// Makes sure SIGPIPE is disabled so that if the child dies it doesn't kill us.
+// Several Communicate() calls may overlap, so the original handler is only
+// restored when the last of them finishes.
+class ScopedIgnoreSigpipe {
+ public:
+  ScopedIgnoreSigpipe() {
+    absl::MutexLock lock(&sigpipe_mutex);
+    if (sigpipe_ignore_count++ == 0) {
+      old_pipe_handler = signal(SIGPIPE, SIG_IGN);
+    }
+  }
+  ~ScopedIgnoreSigpipe() {
+    absl::MutexLock lock(&sigpipe_mutex);
+    if (--sigpipe_ignore_count == 0) {
+      signal(SIGPIPE, old_pipe_handler);
+    }
+  }
+};
+
+void SetCloseOnExec(int fd) {
+  int flags = fcntl(fd, F_GETFD);
+  GOOGLE_CHECK(flags != -1 && fcntl(fd, F_SETFD, flags | FD_CLOEXEC) != -1);
+}
 }  // namespace
 
 void Subprocess::Start(const std::string& program, SearchMode search_mode) {
-  // Note that we assume that there are no other threads, thus we don't have to
-  // do crazy stuff like using socket pairs or avoiding libc locks.
+  // Other threads may be starting subprocesses too, but start_mutex keeps
+  // them from forking while we set up.  The child only calls async-signal-safe
+  // functions before exec, so we still don't have to do crazy stuff like
+  // using socket pairs.
+  absl::MutexLock lock(&start_mutex);
 
   // [0] is read end, [1] is write end.
   int stdin_pipe[2];
@@ -328,6 +376,13 @@ void Subprocess::Start(const std::string& program, SearchMode search_mode) {
   GOOGLE_CHECK(pipe(stdin_pipe) != -1);
   GOOGLE_CHECK(pipe(stdout_pipe) != -1);
 
+  // None of these should survive into any child but our own, where dup2()
+  // installs clean (inheritable) copies as stdin and stdout.
+  for (int fd : {stdin_pipe[0], stdin_pipe[1], stdout_pipe[0],
+                 stdout_pipe[1]}) {
+    SetCloseOnExec(fd);
+  }
+
   char* argv[2] = {portable_strdup(program.c_str()), nullptr};
 
   child_pid_ = fork();
@@ -381,11 +436,7 @@ bool Subprocess::Communicate(const Message& input, Message* output,
                              std::string* error) {
   GOOGLE_CHECK_NE(child_stdin_, -1) << "Must call Start() first.";
 
-  // The "sighandler_t" typedef is GNU-specific, so define our own.
-  typedef void SignalHandler(int);
-
-  // Make sure SIGPIPE is disabled so that if the child dies it doesn't kill us.
-  SignalHandler* old_pipe_handler = signal(SIGPIPE, SIG_IGN);
+  ScopedIgnoreSigpipe ignore_sigpipe;
 
   std::string input_data;
   if (!input.SerializeToString(&input_data)) {
@@ -464,9 +515,6 @@ bool Subprocess::Communicate(const Message& input, Message* output,
     }
   }
 
-  // Restore SIGPIPE handling.
-  signal(SIGPIPE, old_pipe_handler);
-
   if (WIFEXITED(status)) {
     if (WEXITSTATUS(status) != 0) {
       int error_code = WEXITSTATUS(status);
@@ -34,13 +34,15 @@
 
 #include "google/protobuf/extension_set.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "google/protobuf/stubs/common.h"
 #include "google/protobuf/arena.h"
-#include "absl/container/flat_hash_set.h"
-#include "absl/hash/hash.h"
+#include "absl/container/node_hash_map.h"
 #include "google/protobuf/extension_set_inl.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
@@ -69,49 +71,119 @@ inline WireFormatLite::CppType cpp_type(FieldType type) {
 
 // Registry stuff.
 
-struct ExtensionEq {
-  bool operator()(const ExtensionInfo& lhs, const ExtensionInfo& rhs) const {
-    return lhs.message == rhs.message && lhs.number == rhs.number;
+// The extensions registered for one extendee.  Extension numbers are usually
+// allocated in a few contiguous blocks, so as long as the numbers are dense
+// enough, lookups go through an array indexed by extension number instead of
+// the hash map.
+class ExtendeeExtensions {
+ public:
+  // Returns false if an extension with the same number is already registered.
+  bool Insert(const ExtensionInfo& info) {
+    auto inserted = by_number_.try_emplace(info.number, info);
+    if (!inserted.second) return false;
+    if (by_number_.size() == 1) {
+      min_number_ = max_number_ = info.number;
+    } else {
+      min_number_ = std::min(min_number_, info.number);
+      max_number_ = std::max(max_number_, info.number);
+    }
+    UpdateDenseIndex(&inserted.first->second);
+    return true;
   }
-};
 
-struct ExtensionHasher {
-  std::size_t operator()(const ExtensionInfo& info) const {
-    return absl::HashOf(info.message, info.number);
+  const ExtensionInfo* Find(int number) const {
+    if (!dense_.empty()) {
+      // Numbers below dense_base_ wrap around to large indices.
+      size_t index = static_cast<uint32_t>(number - dense_base_);
+      return index < dense_.size() ? dense_[index] : nullptr;
+    }
+    auto it = by_number_.find(number);
+    return it == by_number_.end() ? nullptr : &it->second;
   }
+
+ private:
+  // The array may have at most about one empty slot per extension.
+  bool IsDense() const {
+    return static_cast<size_t>(max_number_ - min_number_) <
+           2 * by_number_.size() + 16;
+  }
+
+  void UpdateDenseIndex(const ExtensionInfo* info) {
+    if (!IsDense()) {
+      std::vector<const ExtensionInfo*>().swap(dense_);
+      return;
+    }
+    if (dense_.empty()) {
+      // Either the first extension, or the numbers just became dense.
+      dense_base_ = min_number_;
+      dense_.assign(max_number_ - min_number_ + 1, nullptr);
+      for (const auto& entry : by_number_) {
+        dense_[entry.first - dense_base_] = &entry.second;
+      }
+      return;
+    }
+    if (min_number_ < dense_base_) {
+      dense_.insert(dense_.begin(), dense_base_ - min_number_, nullptr);
+      dense_base_ = min_number_;
+    }
+    dense_.resize(max_number_ - dense_base_ + 1, nullptr);
+    dense_[info->number - dense_base_] = info;
+  }
+
+  // Owns the ExtensionInfos; node-based so that dense_ can point into it.
+  absl::node_hash_map<int, ExtensionInfo> by_number_;
+  int min_number_ = 0;
+  int max_number_ = 0;
+  // If non-empty, dense_[i] is the extension numbered dense_base_ + i, or
+  // null, for every registered extension.
+  int dense_base_ = 0;
+  std::vector<const ExtensionInfo*> dense_;
 };
 
+// Node-based so that the per-thread cache in FindExtendeeExtensions() stays
+// valid when more extendees are registered.
 using ExtensionRegistry =
-    absl::flat_hash_set<ExtensionInfo, ExtensionHasher, ExtensionEq>;
+    absl::node_hash_map<const MessageLite*, ExtendeeExtensions>;
 
-static const ExtensionRegistry* global_registry = nullptr;
+static ExtensionRegistry* global_registry = nullptr;
 
 // This function is only called at startup, so there is no need for thread-
 // safety.
 void Register(const ExtensionInfo& info) {
   static auto local_static_registry = OnShutdownDelete(new ExtensionRegistry);
   global_registry = local_static_registry;
-  if (!local_static_registry->insert(info).second) {
+  if (!(*local_static_registry)[info.message].Insert(info)) {
     GOOGLE_LOG(FATAL) << "Multiple extension registrations for type \""
                << info.message->GetTypeName() << "\", field number "
                << info.number << ".";
   }
 }
 
-const ExtensionInfo* FindRegisteredExtension(const MessageLite* extendee,
-                                             int number) {
+const ExtendeeExtensions* FindExtendeeExtensions(const MessageLite* extendee) {
+#ifndef GOOGLE_PROTOBUF_NO_THREADLOCAL
+  // The extensions of a message are usually parsed back to back, so each
+  // thread remembers the last extendee it has looked up.
+  static PROTOBUF_THREAD_LOCAL const MessageLite* last_extendee = nullptr;
+  static PROTOBUF_THREAD_LOCAL const ExtendeeExtensions* last_extensions =
+      nullptr;
+  if (extendee == last_extendee) return last_extensions;
+#endif  // !GOOGLE_PROTOBUF_NO_THREADLOCAL
+
   if (!global_registry) return nullptr;
+  auto it = global_registry->find(extendee);
+  if (it == global_registry->end()) return nullptr;
 
-  ExtensionInfo info;
-  info.message = extendee;
-  info.number = number;
+#ifndef GOOGLE_PROTOBUF_NO_THREADLOCAL
+  last_extendee = extendee;
+  last_extensions = &it->second;
+#endif  // !GOOGLE_PROTOBUF_NO_THREADLOCAL
+  return &it->second;
+}
 
-  auto it = global_registry->find(info);
-  if (it == global_registry->end()) {
-    return nullptr;
-  } else {
-    return &*it;
-  }
+const ExtensionInfo* FindRegisteredExtension(const MessageLite* extendee,
+                                             int number) {
+  const ExtendeeExtensions* extensions = FindExtendeeExtensions(extendee);
+  return extensions == nullptr ? nullptr : extensions->Find(number);
 }
 
 }  // namespace
@@ -1585,7 +1657,14 @@ const ExtensionSet::Extension* ExtensionSet::FindOrNull(int key) const {
   if (flat_size_ == 0) {
     return nullptr;
   } else if (PROTOBUF_PREDICT_TRUE(!is_large())) {
-    auto it = std::lower_bound(flat_begin(), flat_end() - 1, key,
+    // Extensions are often numbered contiguously, in which case the key sits
+    // at its offset from the smallest key; try that before searching.
+    const KeyValue* begin = flat_begin();
+    size_t guess = static_cast<uint32_t>(key - begin->first);
+    if (guess < flat_size_ && begin[guess].first == key) {
+      return &begin[guess].second;
+    }
+    auto it = std::lower_bound(begin, flat_end() - 1, key,
                                KeyValue::FirstComparator());
     return it->first == key ? &it->second : nullptr;
   } else {
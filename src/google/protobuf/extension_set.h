@@ -41,7 +41,6 @@
 
 #include <algorithm>
 #include <cassert>
-#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -50,6 +49,7 @@
 #include "google/protobuf/stubs/logging.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/port.h"
+#include "absl/container/btree_map.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/repeated_field.h"
@@ -680,7 +680,9 @@ class PROTOBUF_EXPORT ExtensionSet {
     };
   };
 
-  typedef std::map<int, Extension> LargeMap;
+  // A B-tree keeps the extensions sorted like the flat array does, but is far
+  // denser and faster to search than a node-based map.
+  typedef absl::btree_map<int, Extension> LargeMap;
 
   // Wrapper API that switches between flat-map and LargeMap.
 
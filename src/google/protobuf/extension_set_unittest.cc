@@ -1384,6 +1384,96 @@ TEST(ExtensionSetTest, ExtensionSetSpaceUsed) {
   EXPECT_TRUE((l2 - l) > (l3 - l));
 }
 
+TEST(ExtensionSetTest, ManyExtensions) {
+  // Enough extensions to switch from the flat array to the large map, added
+  // out of order and with gaps.
+  for (Arena* arena : {static_cast<Arena*>(nullptr), new Arena}) {
+    ExtensionSet set(arena);
+    for (int i = 600; i > 0; --i) {
+      set.SetInt32(i * 3, WireFormatLite::TYPE_INT32, i, nullptr);
+    }
+    EXPECT_EQ(600, set.NumExtensions());
+    for (int i = 1; i <= 600; ++i) {
+      EXPECT_TRUE(set.Has(i * 3));
+      EXPECT_FALSE(set.Has(i * 3 + 1));
+      EXPECT_EQ(i, set.GetInt32(i * 3, -1));
+    }
+    set.ClearExtension(300);
+    EXPECT_FALSE(set.Has(300));
+    EXPECT_EQ(-1, set.GetInt32(300, -1));
+    EXPECT_EQ(101, set.GetInt32(303, -1));
+    delete arena;
+  }
+}
+
+TEST(ExtensionSetTest, FindsExtensionsWithGaps) {
+  ExtensionSet set;
+  for (int number : {2, 3, 4, 10, 11, 50}) {
+    set.SetInt32(number, WireFormatLite::TYPE_INT32, number * 10, nullptr);
+  }
+  for (int number = 0; number < 60; ++number) {
+    bool present = number == 2 || number == 3 || number == 4 ||
+                   number == 10 || number == 11 || number == 50;
+    EXPECT_EQ(present, set.Has(number)) << number;
+    EXPECT_EQ(present ? number * 10 : -1, set.GetInt32(number, -1)) << number;
+  }
+}
+
+// The registry is global and refuses to register a number twice, so the
+// extensions used by RegistryLookup are registered once per process, on
+// extendees of its own rather than on default instances other tests use.
+struct RegistryLookupExtendees {
+  unittest::TestPackedTypes dense;
+  unittest::TestUnpackedTypes sparse;
+};
+
+const RegistryLookupExtendees& GetRegistryLookupExtendees() {
+  static const RegistryLookupExtendees* extendees = [] {
+    auto* result = new RegistryLookupExtendees;
+    for (int number = 1000; number < 1300; number += 2) {
+      ExtensionSet::RegisterExtension(&result->dense, number,
+                                      WireFormatLite::TYPE_INT32, false, false,
+                                      nullptr);
+    }
+    for (int number : {5000, 1 << 20, 3, 1 << 28}) {
+      ExtensionSet::RegisterExtension(&result->sparse, number,
+                                      WireFormatLite::TYPE_INT64, false, false,
+                                      nullptr);
+    }
+    return result;
+  }();
+  return *extendees;
+}
+
+TEST(ExtensionSetTest, RegistryLookup) {
+  const MessageLite* dense = &GetRegistryLookupExtendees().dense;
+  const MessageLite* sparse = &GetRegistryLookupExtendees().sparse;
+
+  ExtensionInfo info;
+  // Alternate between the extendees to exercise the per-thread cache.
+  for (int number = 990; number < 1310; ++number) {
+    bool registered = number >= 1000 && number < 1300 && number % 2 == 0;
+    GeneratedExtensionFinder dense_finder(dense);
+    EXPECT_EQ(registered, dense_finder.Find(number, &info)) << number;
+    if (registered) {
+      EXPECT_EQ(WireFormatLite::TYPE_INT32, info.type);
+      EXPECT_EQ(number, info.number);
+    }
+    GeneratedExtensionFinder sparse_finder(sparse);
+    EXPECT_FALSE(sparse_finder.Find(number, &info)) << number;
+  }
+  GeneratedExtensionFinder sparse_finder(sparse);
+  for (int number : {5000, 1 << 20, 3, 1 << 28}) {
+    ASSERT_TRUE(sparse_finder.Find(number, &info)) << number;
+    EXPECT_EQ(WireFormatLite::TYPE_INT64, info.type);
+    EXPECT_EQ(number, info.number);
+  }
+  EXPECT_FALSE(sparse_finder.Find(4, &info));
+  GeneratedExtensionFinder empty_finder(
+      &unittest::TestEmptyMessage::default_instance());
+  EXPECT_FALSE(empty_finder.Find(3, &info));
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace protobuf
@@ -0,0 +1,130 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/field_access_listener.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/descriptor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+struct FieldAccessCounters {
+  absl::string_view (*name_extractor)();
+  std::atomic<uint64_t>* counts;
+  int num_fields;
+};
+
+// Listeners register themselves during static initialization, so the registry
+// must not depend on the order in which globals are constructed.
+class FieldAccessRegistry {
+ public:
+  static FieldAccessRegistry* singleton() {
+    static auto instance = internal::OnShutdownDelete(new FieldAccessRegistry);
+    return instance;
+  }
+
+  void Register(const FieldAccessCounters& counters) {
+    absl::MutexLock lock(&mutex_);
+    counters_.push_back(counters);
+  }
+
+  std::vector<FieldAccessCounters> Snapshot() {
+    absl::MutexLock lock(&mutex_);
+    return counters_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<FieldAccessCounters> counters_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace
+
+namespace internal {
+
+void RegisterFieldAccessCounters(absl::string_view (*name_extractor)(),
+                                 std::atomic<uint64_t>* counts,
+                                 int num_fields) {
+  FieldAccessRegistry::singleton()->Register(
+      {name_extractor, counts, num_fields});
+}
+
+}  // namespace internal
+
+std::string GetFieldAccessProfile() {
+  std::string profile;
+  for (const FieldAccessCounters& counters :
+       FieldAccessRegistry::singleton()->Snapshot()) {
+    // Message names are only resolved here, as the descriptors are not
+    // available while the listeners are registered.
+    const Descriptor* descriptor =
+        DescriptorPool::generated_pool()->FindMessageTypeByName(
+            std::string(counters.name_extractor()));
+    if (descriptor == nullptr) {
+      GOOGLE_LOG(DFATAL) << "Unknown message type "
+                         << counters.name_extractor();
+      continue;
+    }
+    GOOGLE_DCHECK_EQ(descriptor->field_count(), counters.num_fields);
+    for (int i = 0; i < counters.num_fields; ++i) {
+      uint64_t count = counters.counts[i].load(std::memory_order_relaxed);
+      if (count == 0) continue;
+      absl::StrAppend(&profile, descriptor->field(i)->full_name(), " ", count,
+                      "\n");
+    }
+  }
+  return profile;
+}
+
+void ResetFieldAccessProfile() {
+  for (const FieldAccessCounters& counters :
+       FieldAccessRegistry::singleton()->Snapshot()) {
+    for (int i = 0; i < counters.num_fields; ++i) {
+      counters.counts[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -31,11 +31,17 @@
 #ifndef GOOGLE_PROTOBUF_FIELD_ACCESS_LISTENER_H__
 #define GOOGLE_PROTOBUF_FIELD_ACCESS_LISTENER_H__
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <string>
 
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/port.h"
+#include "absl/strings/string_view.h"
 
+// Must be included last.
+#include "google/protobuf/port_def.inc"
 
 namespace google {
 namespace protobuf {
@@ -153,14 +159,143 @@ struct NoOpAccessListener {
                                      const void* field) {}
 };
 
+namespace internal {
+// Registers the per-field access counters of the message type whose full name
+// is returned by `name_extractor`.  `counts` has one entry per field, indexed
+// by FieldDescriptor::index().
+PROTOBUF_EXPORT void RegisterFieldAccessCounters(
+    absl::string_view (*name_extractor)(), std::atomic<uint64_t>* counts,
+    int num_fields);
+}  // namespace internal
+
+// A listener that counts the accesses to each field of a message type, for
+// profile-guided code generation.  It is selected by building both the
+// library and the generated code with PROTOBUF_FIELD_ACCESS_PROFILING defined,
+// and generating the code with the C++ generator option
+// inject_field_listener_events.  GetFieldAccessProfile() returns the counts in
+// the format expected by the generator's access_profile option (see
+// compiler/access_info_map.h).
+//
+// Counting is a relaxed atomic increment per accessor call, so it is cheap
+// enough to leave on for a representative run but not free.
+template <typename Proto>
+struct CountingAccessListener {
+  static constexpr int kFields = Proto::_kInternalFieldNumber;
+
+  explicit CountingAccessListener(absl::string_view (*name_extractor)()) {
+    internal::RegisterFieldAccessCounters(name_extractor, counts_, kFields);
+  }
+
+  static void OnSerialize(const MessageLite* msg) {}
+  static void OnDeserialize(const MessageLite* msg) {}
+  static void OnByteSize(const MessageLite* msg) {}
+  static void OnMergeFrom(const MessageLite* to, const MessageLite* from) {}
+  static void OnGetMetadata() {}
+
+  template <int kFieldNum>
+  static void OnAdd(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnAddMutable(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnGet(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnClear(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnHas(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnList(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnMutable(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnMutableList(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnRelease(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnSet(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+  template <int kFieldNum>
+  static void OnSize(const MessageLite* msg, const void* field) {
+    Count<kFieldNum>();
+  }
+
+  // Extensions are not part of the layout of the message, so they are not
+  // counted.
+  static void OnHasExtension(const MessageLite* msg, int extension_tag,
+                             const void* field) {}
+  static void OnClearExtension(const MessageLite* msg, int extension_tag,
+                               const void* field) {}
+  static void OnExtensionSize(const MessageLite* msg, int extension_tag,
+                              const void* field) {}
+  static void OnGetExtension(const MessageLite* msg, int extension_tag,
+                             const void* field) {}
+  static void OnMutableExtension(const MessageLite* msg, int extension_tag,
+                                 const void* field) {}
+  static void OnSetExtension(const MessageLite* msg, int extension_tag,
+                             const void* field) {}
+  static void OnReleaseExtension(const MessageLite* msg, int extension_tag,
+                                 const void* field) {}
+  static void OnAddExtension(const MessageLite* msg, int extension_tag,
+                             const void* field) {}
+  static void OnAddMutableExtension(const MessageLite* msg, int extension_tag,
+                                    const void* field) {}
+  static void OnListExtension(const MessageLite* msg, int extension_tag,
+                              const void* field) {}
+  static void OnMutableListExtension(const MessageLite* msg, int extension_tag,
+                                     const void* field) {}
+
+ private:
+  template <int kFieldNum>
+  static void Count() {
+    static_assert(kFieldNum >= 0 && kFieldNum < kFields,
+                  "field index out of range");
+    counts_[kFieldNum].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static std::atomic<uint64_t> counts_[kFields > 0 ? kFields : 1];
+};
+
+template <typename Proto>
+std::atomic<uint64_t>
+    CountingAccessListener<Proto>::counts_[kFields > 0 ? kFields : 1];
+
+// Returns the field access counts recorded by CountingAccessListener, one
+// "<fully-qualified field name> <count>" line per accessed field.
+PROTOBUF_EXPORT std::string GetFieldAccessProfile();
+// Resets all counts recorded by CountingAccessListener to zero.
+PROTOBUF_EXPORT void ResetFieldAccessProfile();
+
 }  // namespace protobuf
 }  // namespace google
 
 #ifndef REPLACE_PROTO_LISTENER_IMPL
 namespace google {
 namespace protobuf {
+#ifdef PROTOBUF_FIELD_ACCESS_PROFILING
+template <class T>
+using AccessListener = CountingAccessListener<T>;
+#else   // PROTOBUF_FIELD_ACCESS_PROFILING
 template <class T>
 using AccessListener = NoOpAccessListener<T>;
+#endif  // !PROTOBUF_FIELD_ACCESS_PROFILING
 }  // namespace protobuf
 }  // namespace google
 #else
@@ -169,4 +304,6 @@ using AccessListener = NoOpAccessListener<T>;
 
 #endif  // !REPLACE_PROTO_LISTENER_IMPL
 
+#include "google/protobuf/port_undef.inc"
+
 #endif  // GOOGLE_PROTOBUF_FIELD_ACCESS_LISTENER_H__
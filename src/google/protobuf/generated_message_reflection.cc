@@ -54,9 +54,11 @@
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/generated_message_util.h"
 #include "google/protobuf/inlined_string_field.h"
+#include "google/protobuf/lazy_field.h"
 #include "google/protobuf/map_field.h"
 #include "google/protobuf/map_field_inl.h"
 #include "google/protobuf/repeated_field.h"
+#include "google/protobuf/string_piece_field.h"
 #include "google/protobuf/unknown_field_set.h"
 
 
@@ -317,17 +319,23 @@ bool Reflection::IsLazyExtension(const Message& message,
 }
 
 bool Reflection::IsLazilyVerifiedLazyField(const FieldDescriptor* field) const {
-  if (field->options().unverified_lazy()) return true;
-
-  // Message fields with [lazy=true] will be eagerly verified
-  // (go/verified-lazy).
-  return field->options().lazy() && !IsEagerlyVerifiedLazyField(field);
+  // Generated code tags the offsets of LazyField-backed fields; dynamic
+  // messages never use LazyField.
+  return IsLazyFieldStorage(field) && field->options().unverified_lazy();
 }
 
 bool Reflection::IsEagerlyVerifiedLazyField(
     const FieldDescriptor* field) const {
+  // Message fields with [lazy=true] will be eagerly verified.
   return (field->type() == FieldDescriptor::TYPE_MESSAGE &&
-          schema_.IsEagerlyVerifiedLazyField(field));
+          schema_.IsEagerlyVerifiedLazyField(field)) ||
+         (IsLazyFieldStorage(field) && !field->options().unverified_lazy());
+}
+
+bool Reflection::IsLazyFieldStorage(const FieldDescriptor* field) const {
+  return !field->is_extension() &&
+         field->type() == FieldDescriptor::TYPE_MESSAGE &&
+         schema_.IsLazyField(field);
 }
 
 bool Reflection::IsInlined(const FieldDescriptor* field) const {
@@ -414,6 +422,11 @@ size_t Reflection::SpaceUsedLong(const Message& message) const {
           break;
 
         case FieldDescriptor::CPPTYPE_STRING: {
+          if (schema_.IsStringPieceField(field)) {
+            total_size += GetField<internal::StringPieceField>(message, field)
+                              .SpaceUsedExcludingSelfLong();
+            break;
+          }
           switch (field->options().ctype()) {
             default:  // TODO(kenton):  Support other string reps.
             case FieldOptions::STRING:
@@ -444,6 +457,9 @@ size_t Reflection::SpaceUsedLong(const Message& message) const {
           if (schema_.IsDefaultInstance(message)) {
             // For singular fields, the prototype just stores a pointer to the
             // external type's prototype, so there is no extra memory usage.
+          } else if (IsLazyField(field)) {
+            total_size += GetRaw<LazyField>(message, field)
+                              .SpaceUsedExcludingSelfLong();
           } else {
             const Message* sub_message = GetRaw<const Message*>(message, field);
             if (sub_message != nullptr) {
@@ -551,6 +567,10 @@ class SwapFieldHelper {
   static void SwapNonInlinedStrings(const Reflection* r, Message* lhs,
                                     Message* rhs, const FieldDescriptor* field);
 
+  template <bool unsafe_shallow_swap>
+  static void SwapStringPieces(const Reflection* r, Message* lhs, Message* rhs,
+                               const FieldDescriptor* field);
+
   template <bool unsafe_shallow_swap>
   static void SwapStringField(const Reflection* r, Message* lhs, Message* rhs,
                               const FieldDescriptor* field);
@@ -642,10 +662,28 @@ void SwapFieldHelper::SwapNonInlinedStrings(const Reflection* r, Message* lhs,
   }
 }
 
+template <bool unsafe_shallow_swap>
+void SwapFieldHelper::SwapStringPieces(const Reflection* r, Message* lhs,
+                                       Message* rhs,
+                                       const FieldDescriptor* field) {
+  auto* lhs_string = r->MutableRaw<StringPieceField>(lhs, field);
+  auto* rhs_string = r->MutableRaw<StringPieceField>(rhs, field);
+  if (unsafe_shallow_swap) {
+    lhs_string->InternalSwap(rhs_string);
+  } else {
+    StringPieceField::Swap(lhs_string, lhs->GetArenaForAllocation(),
+                           rhs_string, rhs->GetArenaForAllocation());
+  }
+}
+
 template <bool unsafe_shallow_swap>
 void SwapFieldHelper::SwapStringField(const Reflection* r, Message* lhs,
                                       Message* rhs,
                                       const FieldDescriptor* field) {
+  if (r->schema_.IsStringPieceField(field)) {
+    SwapFieldHelper::SwapStringPieces<unsafe_shallow_swap>(r, lhs, rhs, field);
+    return;
+  }
   switch (field->options().ctype()) {
     default:
     case FieldOptions::STRING: {
@@ -712,7 +750,16 @@ template <bool unsafe_shallow_swap>
 void SwapFieldHelper::SwapMessageField(const Reflection* r, Message* lhs,
                                        Message* rhs,
                                        const FieldDescriptor* field) {
-  if (unsafe_shallow_swap) {
+  if (r->IsLazyField(field)) {
+    auto* lhs_lazy = r->MutableRaw<LazyField>(lhs, field);
+    auto* rhs_lazy = r->MutableRaw<LazyField>(rhs, field);
+    if (unsafe_shallow_swap) {
+      lhs_lazy->InternalSwap(rhs_lazy);
+    } else {
+      LazyField::Swap(lhs_lazy, lhs->GetArenaForAllocation(), rhs_lazy,
+                      rhs->GetArenaForAllocation());
+    }
+  } else if (unsafe_shallow_swap) {
     std::swap(*r->MutableRaw<Message*>(lhs, field),
               *r->MutableRaw<Message*>(rhs, field));
   } else {
@@ -1338,6 +1385,10 @@ void Reflection::ClearField(Message* message,
           break;
 
         case FieldDescriptor::CPPTYPE_STRING: {
+          if (schema_.IsStringPieceField(field)) {
+            MutableRaw<internal::StringPieceField>(message, field)->Clear();
+            break;
+          }
           switch (field->options().ctype()) {
             default:  // TODO(kenton):  Support other string reps.
             case FieldOptions::STRING:
@@ -1356,7 +1407,10 @@ void Reflection::ClearField(Message* message,
         }
 
         case FieldDescriptor::CPPTYPE_MESSAGE:
-          if (schema_.HasBitIndex(field) == static_cast<uint32_t>(-1)) {
+          if (IsLazyField(field)) {
+            MutableRaw<LazyField>(message, field)->Clear();
+          } else if (schema_.HasBitIndex(field) ==
+                     static_cast<uint32_t>(-1)) {
             // Proto3 does not have has-bits and we need to set a message field
             // to nullptr in order to indicate its un-presence.
             if (message->GetArenaForAllocation() == nullptr) {
@@ -1727,6 +1781,10 @@ std::string Reflection::GetString(const Message& message,
     if (schema_.InRealOneof(field) && !HasOneofField(message, field)) {
       return field->default_value_string();
     }
+    if (schema_.IsStringPieceField(field)) {
+      return std::string(
+          GetField<internal::StringPieceField>(message, field).Get());
+    }
     switch (field->options().ctype()) {
       default:  // TODO(kenton):  Support other string reps.
       case FieldOptions::STRING:
@@ -1743,7 +1801,6 @@ std::string Reflection::GetString(const Message& message,
 const std::string& Reflection::GetStringReference(const Message& message,
                                                   const FieldDescriptor* field,
                                                   std::string* scratch) const {
-  (void)scratch;  // Parameter is used by Google-internal code.
   USAGE_CHECK_ALL(GetStringReference, SINGULAR, STRING);
   if (field->is_extension()) {
     return GetExtensionSet(message).GetString(field->number(),
@@ -1752,6 +1809,13 @@ const std::string& Reflection::GetStringReference(const Message& message,
     if (schema_.InRealOneof(field) && !HasOneofField(message, field)) {
       return field->default_value_string();
     }
+    if (schema_.IsStringPieceField(field)) {
+      // StringPieceField does not hold a std::string to refer to.
+      absl::string_view value =
+          GetField<internal::StringPieceField>(message, field).Get();
+      scratch->assign(value.data(), value.size());
+      return *scratch;
+    }
     switch (field->options().ctype()) {
       default:  // TODO(kenton):  Support other string reps.
       case FieldOptions::STRING:
@@ -1773,6 +1837,11 @@ void Reflection::SetString(Message* message, const FieldDescriptor* field,
     return MutableExtensionSet(message)->SetString(
         field->number(), field->type(), std::move(value), field);
   } else {
+    if (schema_.IsStringPieceField(field)) {
+      MutableField<internal::StringPieceField>(message, field)
+          ->Set(value, message->GetArenaForAllocation());
+      return;
+    }
     switch (field->options().ctype()) {
       default:  // TODO(kenton):  Support other string reps.
       case FieldOptions::STRING: {
@@ -2076,6 +2145,12 @@ const Message& Reflection::GetMessage(const Message& message,
     if (schema_.InRealOneof(field) && !HasOneofField(message, field)) {
       return *GetDefaultMessageInstance(field);
     }
+    if (IsLazyField(field)) {
+      return static_cast<const Message&>(
+          GetRaw<LazyField>(message, field)
+              .GetByPrototype(*GetDefaultMessageInstance(field),
+                              message.GetArenaForAllocation()));
+    }
     const Message* result = GetRaw<const Message*>(message, field);
     if (result == nullptr) {
       result = GetDefaultMessageInstance(field);
@@ -2096,6 +2171,14 @@ Message* Reflection::MutableMessage(Message* message,
     return static_cast<Message*>(
         MutableExtensionSet(message)->MutableMessage(field, factory));
   } else {
+    if (IsLazyField(field)) {
+      SetBit(message, field);
+      return static_cast<Message*>(
+          MutableRaw<LazyField>(message, field)
+              ->MutableByPrototype(*GetDefaultMessageInstance(field),
+                                   message->GetArenaForAllocation()));
+    }
+
     Message* result;
 
     Message** result_holder = MutableRaw<Message*>(message, field);
@@ -2147,6 +2230,12 @@ void Reflection::UnsafeArenaSetAllocatedMessage(
     } else {
       SetBit(message, field);
     }
+    if (IsLazyField(field)) {
+      MutableRaw<LazyField>(message, field)
+          ->UnsafeArenaSetAllocated(sub_message,
+                                    message->GetArenaForAllocation());
+      return;
+    }
     Message** sub_message_holder = MutableRaw<Message*>(message, field);
     if (message->GetArenaForAllocation() == nullptr) {
       delete *sub_message_holder;
@@ -2209,6 +2298,13 @@ Message* Reflection::UnsafeArenaReleaseMessage(Message* message,
         return nullptr;
       }
     }
+    if (IsLazyField(field)) {
+      return static_cast<Message*>(
+          MutableRaw<LazyField>(message, field)
+              ->UnsafeArenaReleaseByPrototype(
+                  *GetDefaultMessageInstance(field),
+                  message->GetArenaForAllocation()));
+    }
     Message** result = MutableRaw<Message*>(message, field);
     Message* ret = *result;
     *result = nullptr;
@@ -2671,6 +2767,9 @@ bool Reflection::HasBit(const Message& message,
   // proto3: no has-bits. All fields present except messages, which are
   // present only if their message-field pointer is non-null.
   if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    if (IsLazyField(field)) {
+      return !GetRaw<LazyField>(message, field).IsCleared();
+    }
     return !schema_.IsDefaultInstance(message) &&
            GetRaw<const Message*>(message, field) != nullptr;
   } else {
@@ -2686,6 +2785,11 @@ bool Reflection::HasBit(const Message& message,
     // (which uses HasField()) needs to be consistent with this.
     switch (field->cpp_type()) {
       case FieldDescriptor::CPPTYPE_STRING:
+        if (schema_.IsStringPieceField(field)) {
+          return !GetField<internal::StringPieceField>(message, field)
+                      .Get()
+                      .empty();
+        }
         switch (field->options().ctype()) {
           default: {
             if (IsInlined(field)) {
@@ -3302,7 +3406,8 @@ const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
               /* use_direct_tcparser_table */ false,
 
               /* is_lite */ false,  //
-              ref_.schema_.IsSplit(field)};
+              ref_.schema_.IsSplit(field),
+              ref_.schema_.IsStringPieceField(field)};
     }
 
    private:
@@ -83,6 +83,7 @@ constexpr uint32_t kInvalidFieldOffsetTag = 0x40000000u;
 constexpr uint32_t kSplitFieldOffsetMask = 0x80000000u;
 constexpr uint32_t kLazyMask = 0x1u;
 constexpr uint32_t kInlinedMask = 0x1u;
+constexpr uint32_t kStringPieceMask = 0x2u;
 
 // This struct describes the internal layout of the message, hence this is
 // used to act on the message reflectively.
@@ -229,6 +230,22 @@ struct ReflectionSchema {
            OffsetValue(offsets_[field->index()], field->type());
   }
 
+  // Returns true if the field is backed by LazyField.  Generated code tags the
+  // offsets of such fields with kLazyMask.
+  bool IsLazyField(const FieldDescriptor* field) const {
+    GOOGLE_DCHECK_EQ(field->type(), FieldDescriptor::TYPE_MESSAGE);
+    return (offsets_[field->index()] & kLazyMask) != 0u;
+  }
+
+  // Returns true if the field is backed by StringPieceField.  Generated code
+  // tags the offsets of such fields with kStringPieceMask.
+  bool IsStringPieceField(const FieldDescriptor* field) const {
+    return (field->type() == FieldDescriptor::TYPE_STRING ||
+            field->type() == FieldDescriptor::TYPE_BYTES) &&
+           !InRealOneof(field) &&
+           (offsets_[field->index()] & kStringPieceMask) != 0u;
+  }
+
   // Returns true if the field is implicitly backed by LazyField.
   bool IsEagerlyVerifiedLazyField(const FieldDescriptor* field) const {
     GOOGLE_DCHECK_EQ(field->type(), FieldDescriptor::TYPE_MESSAGE);
@@ -293,7 +310,8 @@ struct ReflectionSchema {
     if (type == FieldDescriptor::TYPE_MESSAGE ||
         type == FieldDescriptor::TYPE_STRING ||
         type == FieldDescriptor::TYPE_BYTES) {
-      return v & (~kSplitFieldOffsetMask) & (~kInlinedMask) & (~kLazyMask);
+      return v & (~kSplitFieldOffsetMask) & (~kInlinedMask) & (~kLazyMask) &
+             (~kStringPieceMask);
     }
     return v & (~kSplitFieldOffsetMask);
   }
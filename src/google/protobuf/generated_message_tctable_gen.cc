@@ -184,7 +184,7 @@ bool IsFieldEligibleForFastParsing(
   // Map, oneof, weak, and lazy fields are not handled on the fast path.
   if (field->is_map() || field->real_containing_oneof() ||
       field->options().weak() || options.is_implicitly_weak ||
-      options.should_split) {
+      options.lazy_opt != 0 || options.should_split) {
     return false;
   }
 
@@ -674,6 +674,8 @@ uint16_t MakeTypeCardForField(
       field->type() == FieldDescriptor::TYPE_STRING) {
     if (field->is_repeated()) {
       type_card |= fl::kRepSString;
+    } else if (options.is_string_piece) {
+      type_card |= fl::kRepSPiece;
     } else {
       type_card |= fl::kRepAString;
     }
@@ -64,6 +64,7 @@ struct PROTOBUF_EXPORT TailCallTableInfo {
     bool use_direct_tcparser_table;
     bool is_lite;
     bool should_split;
+    bool is_string_piece;
   };
   class OptionProvider {
    public:
@@ -38,6 +38,7 @@
 #include <utility>
 
 #include "google/protobuf/port.h"
+#include "absl/functional/function_ref.h"
 #include "google/protobuf/extension_set.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/metadata_lite.h"
@@ -530,6 +531,34 @@ class PROTOBUF_EXPORT TcParser final {
   static const char* FastEndG1(PROTOBUF_TC_PARAM_DECL);
   static const char* FastEndG2(PROTOBUF_TC_PARAM_DECL);
 
+  // Table-driven serialization:
+  //
+  // Serializes the fields and extensions of `msg` described by `table` in
+  // field number order, or computes their serialized size.  Unknown fields are
+  // left to the caller.  ByteSizeFields() must be called first, as it updates
+  // the cached sizes of submessages.  Files generated with the
+  // experimental_table_driven_serialization option use these in place of the
+  // unrolled per-field code; the generator only does so for messages whose
+  // fields are all described by `table` (no maps, weak, lazy or inlined string
+  // fields, and at most one extension range).
+  static uint8_t* SerializeFields(const MessageLite* msg,
+                                  const TcParseTableBase* table,
+                                  uint8_t* target,
+                                  io::EpsCopyOutputStream* stream);
+  static size_t ByteSizeFields(const MessageLite* msg,
+                               const TcParseTableBase* table);
+
+  // Calls `f(field_num, entry, base)` for the fields of `msg` described by
+  // `table`, in field number order, skipping those with explicit presence
+  // that are not set.  Fields without explicit presence are visited whatever
+  // their value.  `base` is the object holding the field: `msg` itself, or
+  // its split struct.  Extensions and unknown fields are not visited.
+  static void ForEachPresentField(
+      const MessageLite* msg, const TcParseTableBase* table,
+      absl::FunctionRef<void(uint32_t, const TcParseTableBase::FieldEntry&,
+                             const void*)>
+          f);
+
  private:
   friend class GeneratedTcTableLiteTest;
   static void* MaybeGetSplitBase(MessageLite* msg, const bool is_split,
@@ -679,6 +708,20 @@ class PROTOBUF_EXPORT TcParser final {
                            const TcParseTableBase* table,
                            const TcParseTableBase::FieldEntry& entry,
                            uint16_t xform_val);
+  static void VerifyUtf8ForSerialize(absl::string_view value,
+                                     const TcParseTableBase* table,
+                                     const TcParseTableBase::FieldEntry& entry);
+
+  // Table-driven serialization of a single present field:
+  static uint8_t* SerializeField(const MessageLite* msg,
+                                 const TcParseTableBase* table,
+                                 const TcParseTableBase::FieldEntry& entry,
+                                 uint32_t field_num, uint8_t* target,
+                                 io::EpsCopyOutputStream* stream);
+  static size_t FieldByteSize(const MessageLite* msg,
+                              const TcParseTableBase* table,
+                              const TcParseTableBase::FieldEntry& entry,
+                              uint32_t field_num);
 
   // For FindFieldEntry tests:
   friend class FindFieldEntryTest;
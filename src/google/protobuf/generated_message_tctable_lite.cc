@@ -36,6 +36,7 @@
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/inlined_string_field.h"
+#include "google/protobuf/lazy_field.h"
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/wire_format_lite.h"
@@ -2214,6 +2215,15 @@ PROTOBUF_NOINLINE const char* TcParser::MpString(PROTOBUF_TC_PARAM_DECL) {
       break;
     }
 
+    case field_layout::kRepSPiece: {
+      auto& field = RefAt<StringPieceField>(base, entry.offset);
+      ptr = ctx->ReadStringPieceField(ptr, &field,
+                                      msg->GetArenaForAllocation());
+      if (!ptr) break;
+      is_valid = MpVerifyUtf8(field.Get(), table, entry, xform_val);
+      break;
+    }
+
     case field_layout::kRepIString: {
       break;
     }
@@ -2303,8 +2313,27 @@ PROTOBUF_NOINLINE const char* TcParser::MpRepeatedString(
 }
 
 const char* TcParser::MpLazyMessage(PROTOBUF_TC_PARAM_DECL) {
-  GOOGLE_LOG(FATAL) << "Unimplemented";
-  return nullptr;
+  const auto& entry = RefAt<FieldEntry>(table, data.entry_offset());
+  const uint16_t type_card = entry.type_card;
+  const uint16_t card = type_card & field_layout::kFcMask;
+
+  // Only singular, non-oneof lazy fields are stored as LazyField; the rest are
+  // left to generated code.
+  if (card != field_layout::kFcOptional && card != field_layout::kFcSingular) {
+    PROTOBUF_MUSTTAIL return table->fallback(PROTOBUF_TC_PARAM_PASS);
+  }
+
+  if (card == field_layout::kFcOptional) {
+    SetHas(entry, msg);
+  }
+  SyncHasbits(msg, hasbits, table);
+  const LazyVerifyOption option =
+      (type_card & field_layout::kTvMask) == field_layout::kTvEager
+          ? LazyVerifyOption::kEager
+          : LazyVerifyOption::kLazy;
+  return RefAt<LazyField>(msg, entry.offset)
+      ._InternalParse(*table->field_aux(&entry)->message_default(),
+                      msg->GetArenaForAllocation(), option, ptr, ctx);
 }
 
 template <bool is_split>
@@ -2440,6 +2469,537 @@ const char* TcParser::MpRepeatedMessage(PROTOBUF_TC_PARAM_DECL) {
   }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Table-driven serialization
+//////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Calls `f(field_num, entry)` for every field entry of `table`, in field
+// number order.  Walks the same lookup structures as FindFieldEntry(): the
+// 32-bit skipmap for fields 1-32, then the skipmap blocks that follow it.
+template <typename F>
+void ForEachFieldEntry(const TcParseTableBase* table, F f) {
+  const FieldEntry* entry = table->field_entries_begin();
+  const FieldEntry* const end = entry + table->num_field_entries;
+  uint32_t skipmap = table->skipmap32;
+  for (uint32_t num = 1; num <= 32 && entry != end; ++num, skipmap >>= 1) {
+    if ((skipmap & 1) == 0) f(num, *entry++);
+  }
+  const uint16_t* lookup_table = table->field_lookup_begin();
+  while (entry != end) {
+    uint32_t fstart = lookup_table[0] | (uint32_t{lookup_table[1]} << 16);
+    uint32_t num_skip_entries = lookup_table[2];
+    lookup_table += 3;
+    for (uint32_t i = 0; i < num_skip_entries; ++i, lookup_table += 2) {
+      uint16_t skipmap16 = lookup_table[0];
+      for (uint32_t j = 0; j < 16; ++j) {
+        if ((skipmap16 & (1u << j)) == 0) f(fstart + 16 * i + j, *entry++);
+      }
+    }
+  }
+}
+
+// Returns the object holding `entry`'s field: either the message itself, or
+// its split struct for fields moved out of line.
+const void* FieldBase(const MessageLite* msg, const TcParseTableBase* table,
+                      const FieldEntry& entry) {
+  if (entry.type_card & field_layout::kSplitMask) {
+    return TcParser::RefAt<const void*>(msg, GetSplitOffset(table));
+  }
+  return msg;
+}
+
+// Returns false if `entry` has explicit presence and is not set.  Fields
+// without explicit presence are always "present" here; the callers skip
+// their default values.
+bool HasFieldPresence(const MessageLite* msg, const FieldEntry& entry,
+                      uint32_t field_num) {
+  switch (entry.type_card & field_layout::kFcMask) {
+    case field_layout::kFcOptional: {
+      // `has_idx` is relative to the message object, as in SetHas().
+      uint32_t has_idx = static_cast<uint32_t>(entry.has_idx);
+      uint32_t hasblock = TcParser::RefAt<uint32_t>(msg, has_idx / 32 * 4);
+      return (hasblock >> (has_idx % 32)) & 1;
+    }
+    case field_layout::kFcOneof:
+      return TcParser::RefAt<uint32_t>(msg, entry.has_idx) == field_num;
+    default:
+      return true;
+  }
+}
+
+bool IsSingularDefault(uint16_t card, bool is_default) {
+  return card == field_layout::kFcSingular && is_default;
+}
+
+template <typename T>
+uint8_t* WriteVarintValue(uint32_t field_num, uint16_t type_card, T value,
+                          uint8_t* target) {
+  using WFL = WireFormatLite;
+  const uint16_t rep = type_card & field_layout::kRepMask;
+  const bool zigzag = (type_card & field_layout::kTvMask) ==
+                      +field_layout::kTvZigZag;
+  if (rep == field_layout::kRep8Bits) {
+    return WFL::WriteBoolToArray(field_num, value != 0, target);
+  } else if (rep == field_layout::kRep32Bits) {
+    if (zigzag) {
+      return WFL::WriteSInt32ToArray(field_num, static_cast<int32_t>(value),
+                                     target);
+    }
+    if ((type_card & field_layout::kFmtMask) == field_layout::kFmtUnsigned) {
+      return WFL::WriteUInt32ToArray(field_num, static_cast<uint32_t>(value),
+                                     target);
+    }
+    return WFL::WriteInt32ToArray(field_num, static_cast<int32_t>(value),
+                                  target);
+  }
+  if (zigzag) {
+    return WFL::WriteSInt64ToArray(field_num, static_cast<int64_t>(value),
+                                   target);
+  }
+  return WFL::WriteUInt64ToArray(field_num, static_cast<uint64_t>(value),
+                                 target);
+}
+
+template <typename T>
+size_t VarintValueSize(uint16_t type_card, T value) {
+  using WFL = WireFormatLite;
+  const uint16_t rep = type_card & field_layout::kRepMask;
+  const bool zigzag = (type_card & field_layout::kTvMask) ==
+                      +field_layout::kTvZigZag;
+  if (rep == field_layout::kRep8Bits) return 1;
+  if (rep == field_layout::kRep32Bits) {
+    if (zigzag) return WFL::SInt32Size(static_cast<int32_t>(value));
+    if ((type_card & field_layout::kFmtMask) == field_layout::kFmtUnsigned) {
+      return WFL::UInt32Size(static_cast<uint32_t>(value));
+    }
+    return WFL::Int32Size(static_cast<int32_t>(value));
+  }
+  if (zigzag) return WFL::SInt64Size(static_cast<int64_t>(value));
+  return WFL::UInt64Size(static_cast<uint64_t>(value));
+}
+
+// Returns the payload size of a packed varint field, without tag and length.
+size_t PackedVarintDataSize(uint16_t type_card, const void* field) {
+  using WFL = WireFormatLite;
+  const uint16_t rep = type_card & field_layout::kRepMask;
+  const bool zigzag = (type_card & field_layout::kTvMask) ==
+                      +field_layout::kTvZigZag;
+  if (rep == field_layout::kRep8Bits) {
+    return static_cast<const RepeatedField<bool>*>(field)->size();
+  } else if (rep == field_layout::kRep32Bits) {
+    const auto& r = *static_cast<const RepeatedField<int32_t>*>(field);
+    if (zigzag) return WFL::SInt32Size(r);
+    if ((type_card & field_layout::kFmtMask) == field_layout::kFmtUnsigned) {
+      return WFL::UInt32Size(
+          *static_cast<const RepeatedField<uint32_t>*>(field));
+    }
+    return WFL::Int32Size(r);
+  }
+  const auto& r = *static_cast<const RepeatedField<int64_t>*>(field);
+  if (zigzag) return WFL::SInt64Size(r);
+  return WFL::Int64Size(r);
+}
+
+// Element size of repeated and packed fixed fields, and of the storage of
+// packed bools.
+size_t FixedElementSize(uint16_t type_card) {
+  switch (type_card & field_layout::kRepMask) {
+    case field_layout::kRep8Bits:
+      return 1;
+    case field_layout::kRep32Bits:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+}  // namespace
+
+void TcParser::VerifyUtf8ForSerialize(absl::string_view value,
+                                      const TcParseTableBase* table,
+                                      const FieldEntry& entry) {
+  const uint16_t xform_val = entry.type_card & field_layout::kTvMask;
+  if (xform_val == field_layout::kTvUtf8
+#ifndef NDEBUG
+      || xform_val == field_layout::kTvUtf8Debug
+#endif  // NDEBUG
+  ) {
+    if (!utf8_range::IsStructurallyValid(value)) {
+      PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry),
+                        "serializing", false);
+    }
+  }
+}
+
+uint8_t* TcParser::SerializeField(const MessageLite* msg,
+                                  const TcParseTableBase* table,
+                                  const FieldEntry& entry, uint32_t field_num,
+                                  uint8_t* target,
+                                  io::EpsCopyOutputStream* stream) {
+  using WFL = WireFormatLite;
+  const uint16_t type_card = entry.type_card;
+  const uint16_t card = type_card & field_layout::kFcMask;
+  const uint16_t rep = type_card & field_layout::kRepMask;
+  const void* const base = FieldBase(msg, table, entry);
+
+  switch (type_card & field_layout::kFkMask) {
+    case field_layout::kFkVarint:
+      if (card == field_layout::kFcRepeated) {
+        if (rep == field_layout::kRep8Bits) {
+          for (bool v : RefAt<RepeatedField<bool>>(base, entry.offset)) {
+            target = stream->EnsureSpace(target);
+            target = WFL::WriteBoolToArray(field_num, v, target);
+          }
+        } else if (rep == field_layout::kRep32Bits) {
+          for (int32_t v : RefAt<RepeatedField<int32_t>>(base, entry.offset)) {
+            target = stream->EnsureSpace(target);
+            target = WriteVarintValue(field_num, type_card, v, target);
+          }
+        } else {
+          for (int64_t v : RefAt<RepeatedField<int64_t>>(base, entry.offset)) {
+            target = stream->EnsureSpace(target);
+            target = WriteVarintValue(field_num, type_card, v, target);
+          }
+        }
+        return target;
+      }
+      if (rep == field_layout::kRep8Bits) {
+        bool v = RefAt<bool>(base, entry.offset);
+        if (IsSingularDefault(card, !v)) return target;
+        target = stream->EnsureSpace(target);
+        return WFL::WriteBoolToArray(field_num, v, target);
+      } else if (rep == field_layout::kRep32Bits) {
+        int32_t v = RefAt<int32_t>(base, entry.offset);
+        if (IsSingularDefault(card, v == 0)) return target;
+        target = stream->EnsureSpace(target);
+        return WriteVarintValue(field_num, type_card, v, target);
+      } else {
+        int64_t v = RefAt<int64_t>(base, entry.offset);
+        if (IsSingularDefault(card, v == 0)) return target;
+        target = stream->EnsureSpace(target);
+        return WriteVarintValue(field_num, type_card, v, target);
+      }
+
+    case field_layout::kFkPackedVarint: {
+      const void* field = &RefAt<char>(base, entry.offset);
+      if (rep == field_layout::kRep8Bits) {
+        const auto& r = *static_cast<const RepeatedField<bool>*>(field);
+        if (r.empty()) return target;
+        return stream->WriteFixedPacked(field_num, r, target);
+      }
+      int size = static_cast<int>(PackedVarintDataSize(type_card, field));
+      if (size == 0) return target;
+      const bool zigzag =
+          (type_card & field_layout::kTvMask) == +field_layout::kTvZigZag;
+      if (rep == field_layout::kRep32Bits) {
+        if (zigzag) {
+          return stream->WriteSInt32Packed(
+              field_num, *static_cast<const RepeatedField<int32_t>*>(field),
+              size, target);
+        }
+        if ((type_card & field_layout::kFmtMask) ==
+            field_layout::kFmtUnsigned) {
+          return stream->WriteUInt32Packed(
+              field_num, *static_cast<const RepeatedField<uint32_t>*>(field),
+              size, target);
+        }
+        return stream->WriteInt32Packed(
+            field_num, *static_cast<const RepeatedField<int32_t>*>(field),
+            size, target);
+      }
+      if (zigzag) {
+        return stream->WriteSInt64Packed(
+            field_num, *static_cast<const RepeatedField<int64_t>*>(field),
+            size, target);
+      }
+      return stream->WriteUInt64Packed(
+          field_num, *static_cast<const RepeatedField<uint64_t>*>(field), size,
+          target);
+    }
+
+    case field_layout::kFkFixed:
+      if (rep == field_layout::kRep32Bits) {
+        if (card == field_layout::kFcRepeated) {
+          for (uint32_t v :
+               RefAt<RepeatedField<uint32_t>>(base, entry.offset)) {
+            target = stream->EnsureSpace(target);
+            target = WFL::WriteFixed32ToArray(field_num, v, target);
+          }
+          return target;
+        }
+        uint32_t v = RefAt<uint32_t>(base, entry.offset);
+        if (IsSingularDefault(card, v == 0)) return target;
+        target = stream->EnsureSpace(target);
+        return WFL::WriteFixed32ToArray(field_num, v, target);
+      } else {
+        if (card == field_layout::kFcRepeated) {
+          for (uint64_t v :
+               RefAt<RepeatedField<uint64_t>>(base, entry.offset)) {
+            target = stream->EnsureSpace(target);
+            target = WFL::WriteFixed64ToArray(field_num, v, target);
+          }
+          return target;
+        }
+        uint64_t v = RefAt<uint64_t>(base, entry.offset);
+        if (IsSingularDefault(card, v == 0)) return target;
+        target = stream->EnsureSpace(target);
+        return WFL::WriteFixed64ToArray(field_num, v, target);
+      }
+
+    case field_layout::kFkPackedFixed:
+      if (rep == field_layout::kRep32Bits) {
+        const auto& r = RefAt<RepeatedField<uint32_t>>(base, entry.offset);
+        if (r.empty()) return target;
+        return stream->WriteFixedPacked(field_num, r, target);
+      } else {
+        const auto& r = RefAt<RepeatedField<uint64_t>>(base, entry.offset);
+        if (r.empty()) return target;
+        return stream->WriteFixedPacked(field_num, r, target);
+      }
+
+    case field_layout::kFkString:
+      switch (rep) {
+        case field_layout::kRepAString: {
+          const std::string& v =
+              RefAt<ArenaStringPtr>(base, entry.offset).Get();
+          if (IsSingularDefault(card, v.empty())) return target;
+          VerifyUtf8ForSerialize(v, table, entry);
+          return stream->WriteString(field_num, v, target);
+        }
+        case field_layout::kRepSPiece: {
+          absl::string_view v =
+              RefAt<StringPieceField>(base, entry.offset).Get();
+          if (IsSingularDefault(card, v.empty())) return target;
+          VerifyUtf8ForSerialize(v, table, entry);
+          return stream->WriteString(field_num, v, target);
+        }
+        case field_layout::kRepSString:
+          for (const std::string& v :
+               RefAt<RepeatedPtrField<std::string>>(base, entry.offset)) {
+            VerifyUtf8ForSerialize(v, table, entry);
+            target = stream->WriteString(field_num, v, target);
+          }
+          return target;
+        default:
+          GOOGLE_LOG(DFATAL) << "string rep not supported by table-driven "
+                         "serialization: "
+                      << (rep >> field_layout::kRepShift);
+          return target;
+      }
+
+    case field_layout::kFkMessage: {
+      const bool is_group = rep == field_layout::kRepGroup;
+      GOOGLE_DCHECK(is_group || rep == field_layout::kRepMessage)
+          << "message rep not supported by table-driven serialization: "
+          << (rep >> field_layout::kRepShift);
+      if (card == field_layout::kFcRepeated) {
+        const auto& field = RefAt<RepeatedPtrFieldBase>(base, entry.offset);
+        for (int i = 0, n = field.size(); i < n; ++i) {
+          const MessageLite& v = field.Get<GenericTypeHandler<MessageLite>>(i);
+          target = is_group ? WFL::InternalWriteGroup(field_num, v, target,
+                                                      stream)
+                            : WFL::InternalWriteMessage(
+                                  field_num, v, v.GetCachedSize(), target,
+                                  stream);
+        }
+        return target;
+      }
+      const MessageLite* v = RefAt<const MessageLite*>(base, entry.offset);
+      if (v == nullptr) return target;
+      return is_group ? WFL::InternalWriteGroup(field_num, *v, target, stream)
+                      : WFL::InternalWriteMessage(
+                            field_num, *v, v->GetCachedSize(), target, stream);
+    }
+
+    default:
+      GOOGLE_LOG(DFATAL)
+          << "field kind not supported by table-driven serialization: "
+          << (type_card & field_layout::kFkMask);
+      return target;
+  }
+}
+
+size_t TcParser::FieldByteSize(const MessageLite* msg,
+                               const TcParseTableBase* table,
+                               const FieldEntry& entry, uint32_t field_num) {
+  using WFL = WireFormatLite;
+  const uint16_t type_card = entry.type_card;
+  const uint16_t card = type_card & field_layout::kFcMask;
+  const uint16_t rep = type_card & field_layout::kRepMask;
+  const void* const base = FieldBase(msg, table, entry);
+  const size_t tag_size = io::CodedOutputStream::VarintSize32(field_num << 3);
+
+  switch (type_card & field_layout::kFkMask) {
+    case field_layout::kFkVarint:
+      if (card == field_layout::kFcRepeated) {
+        size_t total = 0;
+        if (rep == field_layout::kRep8Bits) {
+          const auto& r = RefAt<RepeatedField<bool>>(base, entry.offset);
+          return r.size() * (tag_size + 1);
+        } else if (rep == field_layout::kRep32Bits) {
+          const auto& r = RefAt<RepeatedField<int32_t>>(base, entry.offset);
+          for (int32_t v : r) total += VarintValueSize(type_card, v);
+          return total + r.size() * tag_size;
+        } else {
+          const auto& r = RefAt<RepeatedField<int64_t>>(base, entry.offset);
+          for (int64_t v : r) total += VarintValueSize(type_card, v);
+          return total + r.size() * tag_size;
+        }
+      }
+      if (rep == field_layout::kRep8Bits) {
+        bool v = RefAt<bool>(base, entry.offset);
+        if (IsSingularDefault(card, !v)) return 0;
+        return tag_size + 1;
+      } else if (rep == field_layout::kRep32Bits) {
+        int32_t v = RefAt<int32_t>(base, entry.offset);
+        if (IsSingularDefault(card, v == 0)) return 0;
+        return tag_size + VarintValueSize(type_card, v);
+      } else {
+        int64_t v = RefAt<int64_t>(base, entry.offset);
+        if (IsSingularDefault(card, v == 0)) return 0;
+        return tag_size + VarintValueSize(type_card, v);
+      }
+
+    case field_layout::kFkPackedVarint: {
+      size_t data_size =
+          PackedVarintDataSize(type_card, &RefAt<char>(base, entry.offset));
+      if (data_size == 0) return 0;
+      return tag_size + WFL::LengthDelimitedSize(data_size);
+    }
+
+    case field_layout::kFkFixed: {
+      const size_t element_size = FixedElementSize(type_card);
+      if (card == field_layout::kFcRepeated) {
+        // RepeatedField<uint32_t> and <uint64_t> share their size() layout.
+        int n = element_size == 4
+                    ? RefAt<RepeatedField<uint32_t>>(base, entry.offset).size()
+                    : RefAt<RepeatedField<uint64_t>>(base, entry.offset).size();
+        return n * (tag_size + element_size);
+      }
+      bool is_default = element_size == 4
+                            ? RefAt<uint32_t>(base, entry.offset) == 0
+                            : RefAt<uint64_t>(base, entry.offset) == 0;
+      if (IsSingularDefault(card, is_default)) return 0;
+      return tag_size + element_size;
+    }
+
+    case field_layout::kFkPackedFixed: {
+      const size_t element_size = FixedElementSize(type_card);
+      int n = element_size == 4
+                  ? RefAt<RepeatedField<uint32_t>>(base, entry.offset).size()
+                  : RefAt<RepeatedField<uint64_t>>(base, entry.offset).size();
+      if (n == 0) return 0;
+      return tag_size + WFL::LengthDelimitedSize(n * element_size);
+    }
+
+    case field_layout::kFkString:
+      switch (rep) {
+        case field_layout::kRepAString: {
+          const std::string& v =
+              RefAt<ArenaStringPtr>(base, entry.offset).Get();
+          if (IsSingularDefault(card, v.empty())) return 0;
+          return tag_size + WFL::LengthDelimitedSize(v.size());
+        }
+        case field_layout::kRepSPiece: {
+          absl::string_view v =
+              RefAt<StringPieceField>(base, entry.offset).Get();
+          if (IsSingularDefault(card, v.empty())) return 0;
+          return tag_size + WFL::LengthDelimitedSize(v.size());
+        }
+        case field_layout::kRepSString: {
+          const auto& r =
+              RefAt<RepeatedPtrField<std::string>>(base, entry.offset);
+          size_t total = r.size() * tag_size;
+          for (const std::string& v : r) {
+            total += WFL::LengthDelimitedSize(v.size());
+          }
+          return total;
+        }
+        default:
+          GOOGLE_LOG(DFATAL) << "string rep not supported by table-driven "
+                         "serialization: "
+                      << (rep >> field_layout::kRepShift);
+          return 0;
+      }
+
+    case field_layout::kFkMessage: {
+      const bool is_group = rep == field_layout::kRepGroup;
+      // Groups are delimited by a start and an end tag.
+      const size_t message_tag_size = is_group ? 2 * tag_size : tag_size;
+      if (card == field_layout::kFcRepeated) {
+        const auto& field = RefAt<RepeatedPtrFieldBase>(base, entry.offset);
+        size_t total = field.size() * message_tag_size;
+        for (int i = 0, n = field.size(); i < n; ++i) {
+          const MessageLite& v = field.Get<GenericTypeHandler<MessageLite>>(i);
+          total += is_group ? WFL::GroupSize(v) : WFL::MessageSize(v);
+        }
+        return total;
+      }
+      const MessageLite* v = RefAt<const MessageLite*>(base, entry.offset);
+      if (v == nullptr) return 0;
+      return message_tag_size +
+             (is_group ? WFL::GroupSize(*v) : WFL::MessageSize(*v));
+    }
+
+    default:
+      GOOGLE_LOG(DFATAL)
+          << "field kind not supported by table-driven serialization: "
+          << (type_card & field_layout::kFkMask);
+      return 0;
+  }
+}
+
+uint8_t* TcParser::SerializeFields(const MessageLite* msg,
+                                   const TcParseTableBase* table,
+                                   uint8_t* target,
+                                   io::EpsCopyOutputStream* stream) {
+  // Extensions are written in field number order with the fields, which is
+  // possible because tables only describe a single extension range.
+  const bool has_extensions = table->extension_offset != 0;
+  bool extensions_done = !has_extensions;
+  auto serialize_extensions = [&] {
+    extensions_done = true;
+    target = RefAt<ExtensionSet>(msg, table->extension_offset)
+                 ._InternalSerialize(table->default_instance,
+                                     table->extension_range_low,
+                                     table->extension_range_high, target,
+                                     stream);
+  };
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    if (!extensions_done && field_num > table->extension_range_low) {
+      serialize_extensions();
+    }
+    if (!HasFieldPresence(msg, entry, field_num)) return;
+    target = SerializeField(msg, table, entry, field_num, target, stream);
+  });
+  if (!extensions_done) serialize_extensions();
+  return target;
+}
+
+size_t TcParser::ByteSizeFields(const MessageLite* msg,
+                                const TcParseTableBase* table) {
+  size_t total_size = 0;
+  if (table->extension_offset != 0) {
+    total_size += RefAt<ExtensionSet>(msg, table->extension_offset).ByteSize();
+  }
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    if (!HasFieldPresence(msg, entry, field_num)) return;
+    total_size += FieldByteSize(msg, table, entry, field_num);
+  });
+  return total_size;
+}
+
+void TcParser::ForEachPresentField(
+    const MessageLite* msg, const TcParseTableBase* table,
+    absl::FunctionRef<void(uint32_t, const FieldEntry&, const void*)> f) {
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    if (!HasFieldPresence(msg, entry, field_num)) return;
+    f(field_num, entry, FieldBase(msg, table, entry));
+  });
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
@@ -0,0 +1,269 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// End-to-end tests of TcParser::SerializeFields() and
+// TcParser::ByteSizeFields().  This file is built against unittest.proto and
+// unittest_proto3.proto compiled with experimental_table_driven_serialization
+// (and, in a second target, with force_split as well), so that every message
+// below except TestAllTypes itself serializes through its parse table.  The
+// output must match the per-field generated code byte for byte: the golden
+// files were written by that code, and DynamicMessage produces the same bytes
+// through reflection.
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/testing/file.h"
+#include "google/protobuf/testing/googletest.h"
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/test_util2.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+std::string ReadGolden(const std::string& name) {
+  std::string golden;
+  GOOGLE_CHECK_OK(File::GetContents(
+      TestUtil::GetTestDataPath("third_party/protobuf/testdata/" + name),
+      &golden, true));
+  return golden;
+}
+
+// Serializes a copy of `message` made with DynamicMessage, which writes every
+// field, extensions included, through reflection instead of a parse table.
+std::string SerializeDynamically(const Message& message) {
+  DynamicMessageFactory factory;
+  std::unique_ptr<Message> dynamic(
+      factory.GetPrototype(message.GetDescriptor())->New());
+  dynamic->MergeFrom(message);
+  return dynamic->SerializePartialAsString();
+}
+
+// Checks that `message` serializes to `expected`, that ByteSizeLong() agrees,
+// and that the bytes parse back into an equal message.
+template <typename T>
+void ExpectSerializesTo(const T& message, absl::string_view expected) {
+  EXPECT_EQ(expected.size(), message.ByteSizeLong());
+  EXPECT_EQ(expected, message.SerializePartialAsString());
+  T parsed;
+  ASSERT_TRUE(parsed.ParsePartialFromString(expected));
+  EXPECT_EQ(expected, parsed.SerializePartialAsString());
+}
+
+template <typename T>
+void ExpectSerializesLikeDynamic(const T& message) {
+  ExpectSerializesTo(message, SerializeDynamically(message));
+}
+
+// The accessors of [ctype = STRING_PIECE] and [ctype = CORD] fields are not
+// public, so those are set through reflection.
+void SetString(Message* message, const std::string& name,
+               const std::string& value) {
+  message->GetReflection()->SetString(
+      message, message->GetDescriptor()->FindFieldByName(name), value);
+}
+
+void AddString(Message* message, const std::string& name,
+               const std::string& value) {
+  message->GetReflection()->AddString(
+      message, message->GetDescriptor()->FindFieldByName(name), value);
+}
+
+TEST(TableDrivenSerializationTest, Golden) {
+  // TestAllTypes keeps its generated serializer because of its [lazy] field,
+  // but its nested, foreign and imported submessages and groups use tables.
+  // golden_message holds every member of its oneof, so only parse it.
+  unittest::TestAllTypes all_types;
+  ASSERT_TRUE(all_types.ParseFromString(ReadGolden("golden_message")));
+  TestUtil::ExpectAllFieldsSet(all_types);
+  ExpectSerializesLikeDynamic(all_types);
+
+  unittest::TestPackedTypes packed;
+  TestUtil::SetPackedFields(&packed);
+  ExpectSerializesTo(packed, ReadGolden("golden_packed_fields_message"));
+
+  unittest::TestPackedExtensions packed_extensions;
+  TestUtil::SetPackedExtensions(&packed_extensions);
+  ExpectSerializesTo(packed_extensions,
+                     ReadGolden("golden_packed_fields_message"));
+}
+
+TEST(TableDrivenSerializationTest, AllFieldKinds) {
+  unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  ExpectSerializesLikeDynamic(extensions);
+
+  unittest::TestUnpackedTypes unpacked;
+  TestUtil::SetUnpackedFields(&unpacked);
+  ExpectSerializesLikeDynamic(unpacked);
+
+  unittest::TestRequired required;
+  required.set_a(1);
+  required.set_dummy17(17);
+  required.set_c(-1);
+  ExpectSerializesLikeDynamic(required);
+}
+
+TEST(TableDrivenSerializationTest, Strings) {
+  // Plain, [ctype = STRING_PIECE] and [ctype = CORD] strings, singular and
+  // repeated, including empty values.
+  unittest::TestCamelCaseFieldNames message;
+  message.set_primitivefield(1);
+  message.set_stringfield("string");
+  message.set_enumfield(unittest::FOREIGN_BAR);
+  message.mutable_messagefield()->set_c(2);
+  SetString(&message, "StringPieceField", "string piece");
+  SetString(&message, "CordField", "cord");
+  for (const char* value : {"", "a", "bc"}) {
+    message.add_repeatedprimitivefield(static_cast<int>(strlen(value)));
+    message.add_repeatedstringfield(value);
+    message.add_repeatedenumfield(unittest::FOREIGN_FOO);
+    message.add_repeatedmessagefield()->set_c(static_cast<int>(strlen(value)));
+    AddString(&message, "RepeatedStringPieceField", value);
+    AddString(&message, "RepeatedCordField", value);
+  }
+  ExpectSerializesLikeDynamic(message);
+
+  // Explicitly set empty strings are written.
+  message.Clear();
+  message.set_stringfield("");
+  SetString(&message, "StringPieceField", "");
+  SetString(&message, "CordField", "");
+  EXPECT_EQ(std::string("\x12\x00\x2a\x00\x32\x00", 6),
+            message.SerializePartialAsString());
+  ExpectSerializesLikeDynamic(message);
+}
+
+TEST(TableDrivenSerializationTest, Oneofs) {
+  unittest::TestOneof2 message;
+  TestUtil::SetOneof1(&message);
+  ExpectSerializesLikeDynamic(message);
+  TestUtil::SetOneof2(&message);
+  ExpectSerializesLikeDynamic(message);
+
+  // Each kind of member, including empty strings and zeros.
+  message.Clear();
+  message.set_foo_string("");
+  message.set_bar_int(0);
+  ExpectSerializesLikeDynamic(message);
+  SetString(&message, "foo_cord", "cord");
+  SetString(&message, "bar_string_piece", "");
+  ExpectSerializesLikeDynamic(message);
+  SetString(&message, "foo_string_piece", "piece");
+  message.set_bar_enum(unittest::TestOneof2::BAZ);
+  ExpectSerializesLikeDynamic(message);
+  message.mutable_foogroup()->set_b("group");
+  message.set_bar_bytes("bytes");
+  ExpectSerializesLikeDynamic(message);
+  message.mutable_foo_message()->add_corge_int(1);
+  SetString(&message, "bar_cord", "");
+  ExpectSerializesLikeDynamic(message);
+}
+
+TEST(TableDrivenSerializationTest, ExtensionsInterleavedWithFields) {
+  unittest::TestExtensionInsideTable message;
+  message.set_field1(1);
+  message.set_field4(4);
+  message.set_field6(6);
+  message.set_field10(10);
+  message.SetExtension(unittest::test_extension_inside_table_extension, 5);
+  ExpectSerializesTo(message, "\x08\x01\x20\x04\x28\x05\x30\x06\x50\x0a");
+
+  // Fields, groups and extensions of message type, with the extension range
+  // at the end.
+  unittest::TestParsingMerge merge;
+  TestUtil::SetAllFields(merge.mutable_required_all_types());
+  merge.add_repeated_all_types()->set_optional_int32(1);
+  merge.mutable_optionalgroup()->mutable_optional_group_all_types()
+      ->set_optional_string("group");
+  merge.add_repeatedgroup()->mutable_repeated_group_all_types();
+  merge.MutableExtension(unittest::TestParsingMerge::optional_ext)
+      ->set_optional_int64(2);
+  merge.AddExtension(unittest::TestParsingMerge::repeated_ext)
+      ->add_repeated_string("ext");
+  ExpectSerializesLikeDynamic(merge);
+}
+
+TEST(TableDrivenSerializationTest, UnknownFields) {
+  unittest::TestRequired message;
+  message.set_a(1);
+  const std::string unknown("\xa8\x1f\x07", 3);  // Field 501, varint 7.
+  message.mutable_unknown_fields()->AddVarint(501, 7);
+  ExpectSerializesTo(message, absl::StrCat("\x08\x01", unknown));
+}
+
+TEST(TableDrivenSerializationTest, ImplicitPresence) {
+  // Zero scalars and empty strings are skipped, even when they were set.
+  proto3_unittest::TestPackedTypes packed;
+  packed.add_packed_int32(0);
+  packed.add_packed_sint64(-1);
+  packed.add_packed_double(-0.0);
+  packed.add_packed_bool(false);
+  packed.add_packed_enum(proto3_unittest::FOREIGN_ZERO);
+  ExpectSerializesLikeDynamic(packed);
+
+  proto3_unittest::TestUnpackedTypes unpacked;
+  unpacked.add_repeated_int32(0);
+  unpacked.add_repeated_float(-0.0f);
+  ExpectSerializesLikeDynamic(unpacked);
+
+  proto3_unittest::NestedTestAllTypes nested;
+  nested.mutable_child();
+  ExpectSerializesTo(nested, std::string("\x0a\x00", 2));
+}
+
+#ifndef NDEBUG
+TEST(TableDrivenSerializationTest, VerifiesUtf8InDebugBuilds) {
+  unittest::TestCamelCaseFieldNames message;
+  message.set_stringfield("\xff");
+  ScopedMemoryLog log;
+  EXPECT_EQ(std::string("\x12\x01\xff", 3),
+            message.SerializePartialAsString());
+  const std::vector<std::string>& errors = log.GetMessages(ERROR);
+  ASSERT_EQ(1, errors.size());
+  EXPECT_NE(std::string::npos,
+            errors[0].find(
+                "protobuf_unittest.TestCamelCaseFieldNames.StringField"))
+      << errors[0];
+}
+#endif  // !NDEBUG
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -36,6 +36,10 @@
 
 #if HAVE_ZLIB
 #include "google/protobuf/io/gzip_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "google/protobuf/port.h"
 
 #include "google/protobuf/stubs/common.h"
@@ -327,6 +331,348 @@ bool GzipOutputStream::Close() {
   return ok;
 }
 
+// =========================================================================
+
+namespace {
+
+// Size of the deflate window, and so of the dictionary handed to each block.
+constexpr size_t kWindowSize = 32 * 1024;
+constexpr int kDefaultParallelBlockSize = 128 * 1024;
+
+}  // namespace
+
+struct ParallelGzipOutputStream::Block {
+  std::unique_ptr<char[]> input;
+  size_t input_size = 0;
+  // Up to kWindowSize bytes of input preceding this block.
+  std::string dictionary;
+  bool last = false;
+
+  // Filled in by the worker.
+  std::string output;
+  uLong check = 0;
+  int error = Z_OK;
+  // Set under mutex_ once the fields above are final.
+  bool done = false;
+};
+
+namespace {
+
+// Deflates one block as a raw deflate stream continuing the previous block.
+// Returns a zlib error code.
+int CompressBlock(const char* input, size_t input_size,
+                  const std::string& dictionary, bool last,
+                  const ParallelGzipOutputStream::Options& options,
+                  std::string* output) {
+  z_stream zcontext;
+  memset(&zcontext, 0, sizeof(zcontext));
+  int error = deflateInit2(&zcontext, options.compression_level, Z_DEFLATED,
+                           /* windowBits (raw deflate) */ -15,
+                           /* memLevel (default) */ 8,
+                           options.compression_strategy);
+  if (error != Z_OK) return error;
+  if (!dictionary.empty()) {
+    error = deflateSetDictionary(
+        &zcontext, reinterpret_cast<const Bytef*>(dictionary.data()),
+        dictionary.size());
+  }
+
+  // deflateBound() does not account for the sync flush marker.
+  output->resize(deflateBound(&zcontext, input_size) + 16);
+  zcontext.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+  zcontext.avail_in = input_size;
+  zcontext.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  zcontext.avail_out = output->size();
+
+  // Every block but the last ends on a byte boundary with an empty stored
+  // block, so that the next block's output can simply be appended.
+  int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+  while (error == Z_OK) {
+    if (zcontext.avail_out == 0) {
+      size_t used = output->size();
+      output->resize(used * 2);
+      zcontext.next_out = reinterpret_cast<Bytef*>(&(*output)[used]);
+      zcontext.avail_out = used;
+    }
+    error = deflate(&zcontext, flush);
+    if (error == Z_STREAM_END) {
+      error = Z_OK;
+      break;
+    }
+    if (flush == Z_SYNC_FLUSH && error == Z_OK && zcontext.avail_out != 0) {
+      break;
+    }
+  }
+  output->resize(zcontext.total_out);
+  int end_error = deflateEnd(&zcontext);
+  // Z_DATA_ERROR from deflateEnd() only means that not everything was
+  // finished, which is expected after a sync flush.
+  if (error == Z_OK && end_error != Z_DATA_ERROR) error = end_error;
+  return error;
+}
+
+}  // namespace
+
+ParallelGzipOutputStream::Options::Options()
+    : format(GzipOutputStream::GZIP),
+      block_size(kDefaultParallelBlockSize),
+      compression_level(Z_DEFAULT_COMPRESSION),
+      compression_strategy(Z_DEFAULT_STRATEGY),
+      num_threads(0),
+      max_pending_blocks(0) {}
+
+ParallelGzipOutputStream::ParallelGzipOutputStream(
+    ZeroCopyOutputStream* sub_stream)
+    : ParallelGzipOutputStream(sub_stream, Options()) {}
+
+ParallelGzipOutputStream::ParallelGzipOutputStream(
+    ZeroCopyOutputStream* sub_stream, const Options& options)
+    : sub_stream_(sub_stream),
+      options_(options),
+      zerror_(Z_OK),
+      header_written_(false),
+      closed_(false),
+      current_size_(0),
+      check_(options.format == GzipOutputStream::ZLIB ? adler32(0, Z_NULL, 0)
+                                                      : crc32(0, Z_NULL, 0)),
+      byte_count_(0),
+      shutdown_(false) {
+  if (options_.block_size <= 0) {
+    options_.block_size = kDefaultParallelBlockSize;
+  }
+  int num_threads = options_.num_threads;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  max_pending_blocks_ = options_.max_pending_blocks > 0
+                            ? options_.max_pending_blocks
+                            : 2 * num_threads;
+  workers_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ParallelGzipOutputStream::~ParallelGzipOutputStream() {
+  Close();
+  StopWorkers();
+}
+
+bool ParallelGzipOutputStream::HasWork() const {
+  return shutdown_ || !queue_.empty();
+}
+
+void ParallelGzipOutputStream::WorkerLoop() {
+  while (true) {
+    Block* block;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &ParallelGzipOutputStream::HasWork));
+      if (queue_.empty()) return;
+      block = queue_.front();
+      queue_.pop_front();
+    }
+    int error = CompressBlock(block->input.get(), block->input_size,
+                              block->dictionary, block->last, options_,
+                              &block->output);
+    const Bytef* data = reinterpret_cast<const Bytef*>(block->input.get());
+    uLong check = options_.format == GzipOutputStream::ZLIB
+                      ? adler32(adler32(0, Z_NULL, 0), data, block->input_size)
+                      : crc32(crc32(0, Z_NULL, 0), data, block->input_size);
+    absl::MutexLock lock(&mutex_);
+    block->check = check;
+    block->error = error;
+    block->done = true;
+  }
+}
+
+void ParallelGzipOutputStream::StopWorkers() {
+  {
+    absl::MutexLock lock(&mutex_);
+    // Blocks nobody picked up yet are no longer needed.
+    queue_.clear();
+    shutdown_ = true;
+  }
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+}
+
+void ParallelGzipOutputStream::Submit(bool last) {
+  if (current_ == nullptr) {
+    current_.reset(new Block);
+  }
+  Block* block = current_.get();
+  block->input_size = current_size_;
+  block->last = last;
+  block->dictionary = window_;
+
+  const char* input = block->input.get();
+  if (current_size_ >= kWindowSize) {
+    window_.assign(input + current_size_ - kWindowSize, kWindowSize);
+  } else if (current_size_ > 0) {
+    window_.append(input, current_size_);
+    if (window_.size() > kWindowSize) {
+      window_.erase(0, window_.size() - kWindowSize);
+    }
+  }
+
+  byte_count_ += current_size_;
+  current_size_ = 0;
+  pending_.push_back(std::move(current_));
+  absl::MutexLock lock(&mutex_);
+  queue_.push_back(block);
+}
+
+bool ParallelGzipOutputStream::WriteToSubStream(const void* data,
+                                                size_t size) {
+  const char* in = static_cast<const char*>(data);
+  while (size > 0) {
+    void* out;
+    int out_size;
+    if (!sub_stream_->Next(&out, &out_size)) {
+      zerror_ = Z_BUF_ERROR;
+      return false;
+    }
+    size_t n = std::min(size, static_cast<size_t>(out_size));
+    memcpy(out, in, n);
+    sub_stream_->BackUp(out_size - static_cast<int>(n));
+    in += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ParallelGzipOutputStream::WritePending(size_t max_pending) {
+  if (!header_written_) {
+    header_written_ = true;
+    if (options_.format == GzipOutputStream::ZLIB) {
+      // CMF selects deflate with a 32kB window; FLG carries the level hint
+      // and makes the header a multiple of 31, as in zlib's deflate.c.
+      int level = options_.compression_level == Z_DEFAULT_COMPRESSION
+                      ? 6
+                      : options_.compression_level;
+      int level_flags;
+      if (options_.compression_strategy >= Z_HUFFMAN_ONLY || level < 2) {
+        level_flags = 0;
+      } else if (level < 6) {
+        level_flags = 1;
+      } else if (level == 6) {
+        level_flags = 2;
+      } else {
+        level_flags = 3;
+      }
+      int header = (0x78 << 8) | (level_flags << 6);
+      header += 31 - (header % 31);
+      uint8_t bytes[2] = {static_cast<uint8_t>(header >> 8),
+                          static_cast<uint8_t>(header)};
+      if (!WriteToSubStream(bytes, sizeof(bytes))) return false;
+    } else {
+      // Magic, deflate, no flags, no mtime, no extra flags, unknown OS.
+      static const uint8_t kGzipHeader[10] = {0x1f, 0x8b, 8, 0, 0,
+                                              0,    0,    0, 0, 0xff};
+      if (!WriteToSubStream(kGzipHeader, sizeof(kGzipHeader))) return false;
+    }
+  }
+
+  while (!pending_.empty()) {
+    Block* block = pending_.front().get();
+    {
+      absl::MutexLock lock(&mutex_);
+      if (pending_.size() > max_pending) {
+        mutex_.Await(absl::Condition(&block->done));
+      } else if (!block->done) {
+        break;
+      }
+    }
+    if (block->error != Z_OK) {
+      zerror_ = block->error;
+      return false;
+    }
+    if (!WriteToSubStream(block->output.data(), block->output.size())) {
+      return false;
+    }
+    z_off_t length = static_cast<z_off_t>(block->input_size);
+    check_ = options_.format == GzipOutputStream::ZLIB
+                 ? adler32_combine(check_, block->check, length)
+                 : crc32_combine(check_, block->check, length);
+    pending_.pop_front();
+  }
+  return true;
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool ParallelGzipOutputStream::Next(void** data, int* size) {
+  if (closed_ || zerror_ != Z_OK) {
+    return false;
+  }
+  if (current_size_ == static_cast<size_t>(options_.block_size)) {
+    Submit(false);
+    if (!WritePending(max_pending_blocks_)) return false;
+  }
+  if (current_ == nullptr) {
+    current_.reset(new Block);
+    current_->input.reset(new char[options_.block_size]);
+  }
+  *data = current_->input.get() + current_size_;
+  *size = options_.block_size - static_cast<int>(current_size_);
+  current_size_ = options_.block_size;
+  return true;
+}
+
+void ParallelGzipOutputStream::BackUp(int count) {
+  GOOGLE_CHECK_GE(current_size_, static_cast<size_t>(count));
+  current_size_ -= count;
+}
+
+int64_t ParallelGzipOutputStream::ByteCount() const {
+  return byte_count_ + current_size_;
+}
+
+bool ParallelGzipOutputStream::Flush() {
+  if (closed_ || zerror_ != Z_OK) {
+    return false;
+  }
+  if (current_size_ > 0) {
+    Submit(false);
+  }
+  return WritePending(0);
+}
+
+bool ParallelGzipOutputStream::Close() {
+  if (closed_) {
+    return false;
+  }
+  closed_ = true;
+  if (zerror_ == Z_OK) {
+    Submit(true);
+  }
+  bool ok = zerror_ == Z_OK && WritePending(0);
+  if (ok) {
+    uint8_t trailer[8];
+    size_t trailer_size;
+    if (options_.format == GzipOutputStream::ZLIB) {
+      // Big-endian Adler-32.
+      for (int i = 0; i < 4; ++i) {
+        trailer[i] = static_cast<uint8_t>(check_ >> (24 - 8 * i));
+      }
+      trailer_size = 4;
+    } else {
+      // Little-endian CRC-32 and input size modulo 2^32.
+      uint32_t length = static_cast<uint32_t>(byte_count_);
+      for (int i = 0; i < 4; ++i) {
+        trailer[i] = static_cast<uint8_t>(check_ >> (8 * i));
+        trailer[4 + i] = static_cast<uint8_t>(length >> (8 * i));
+      }
+      trailer_size = 8;
+    }
+    ok = WriteToSubStream(trailer, trailer_size);
+  }
+  StopWorkers();
+  return ok;
+}
+
 }  // namespace io
 }  // namespace protobuf
 }  // namespace google
@@ -39,11 +39,22 @@
 //
 // GzipOutputStream is an ZeroCopyOutputStream that compresses data to
 // an underlying ZeroCopyOutputStream.
+//
+// ParallelGzipOutputStream is a GzipOutputStream alternative which compresses
+// independent blocks on worker threads while the caller keeps writing.
 
 #ifndef GOOGLE_PROTOBUF_IO_GZIP_STREAM_H__
 #define GOOGLE_PROTOBUF_IO_GZIP_STREAM_H__
 
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "google/protobuf/stubs/common.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/port.h"
 #include "zlib.h"
@@ -195,6 +206,127 @@ class PROTOBUF_EXPORT GzipOutputStream PROTOBUF_FUTURE_FINAL
   int Deflate(int flush);
 };
 
+// A ZeroCopyOutputStream that compresses data through zlib on a pool of worker
+// threads, in the style of pigz.
+//
+// Input is cut into blocks of Options::block_size bytes.  Each block is
+// deflated independently, primed with the preceding 32kB of input as a
+// dictionary so that the compression ratio stays close to that of
+// GzipOutputStream, and ends on a byte boundary with a sync flush.  The blocks
+// are written to the underlying stream in order on the calling thread, so the
+// result is a single standard gzip (or zlib) stream which any inflater can
+// read.  The underlying stream is only ever accessed from the thread calling
+// into this object.
+class PROTOBUF_EXPORT ParallelGzipOutputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // Defaults to GZIP.
+    GzipOutputStream::Format format;
+
+    // Amount of input compressed as one unit by a worker.  Smaller blocks
+    // expose more parallelism but cost some compression ratio.  Defaults to
+    // 128kB.
+    int block_size;
+
+    // A number between 0 and 9, where 0 is no compression and 9 is best
+    // compression.  Defaults to Z_DEFAULT_COMPRESSION (see zlib.h).
+    int compression_level;
+
+    // Defaults to Z_DEFAULT_STRATEGY.  See GzipOutputStream::Options.
+    int compression_strategy;
+
+    // Number of worker threads.  0 means one per hardware thread.  Defaults
+    // to 0.
+    int num_threads;
+
+    // Maximum number of blocks which are compressing or waiting to be
+    // written before Next() blocks.  0 means twice the number of threads.
+    // Defaults to 0.
+    int max_pending_blocks;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a ParallelGzipOutputStream with default options.
+  explicit ParallelGzipOutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create a ParallelGzipOutputStream with the given options.
+  ParallelGzipOutputStream(ZeroCopyOutputStream* sub_stream,
+                           const Options& options);
+  ParallelGzipOutputStream(const ParallelGzipOutputStream&) = delete;
+  ParallelGzipOutputStream& operator=(const ParallelGzipOutputStream&) =
+      delete;
+
+  ~ParallelGzipOutputStream() override;
+
+  // Return the first zlib error code hit by this stream, or Z_OK.
+  int ZlibErrorCode() const { return zerror_; }
+
+  // Compresses the data written so far and writes it, and every block still
+  // in progress, to the underlying stream.  Blocks until the workers have
+  // caught up.
+  // It is the caller's responsibility to flush the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Flush();
+
+  // Writes out all data and closes the gzip stream.  Stops the worker
+  // threads.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Block;
+
+  ZeroCopyOutputStream* sub_stream_;
+  Options options_;
+  int zerror_;
+  bool header_written_;
+  bool closed_;
+  int max_pending_blocks_;
+
+  // The block currently handed out to the caller, and how much of it holds
+  // data.
+  std::unique_ptr<Block> current_;
+  size_t current_size_;
+  // The last 32kB of input submitted so far; the dictionary for the next
+  // block.
+  std::string window_;
+
+  // Submitted blocks in stream order.  Owned by the calling thread; the
+  // workers only touch blocks through queue_.
+  std::deque<std::unique_ptr<Block>> pending_;
+  // Running checksum and length of the blocks written so far.
+  uint32_t check_;
+  int64_t byte_count_;
+
+  absl::Mutex mutex_;
+  // Blocks waiting for a worker, guarded by mutex_.
+  std::deque<Block*> queue_;
+  bool shutdown_;
+  std::vector<std::thread> workers_;
+
+  void WorkerLoop();
+  bool HasWork() const;
+
+  // Hands the current block to the workers.  `last` marks the final block of
+  // the stream.
+  void Submit(bool last);
+  // Writes finished blocks at the front of pending_ to sub_stream_, waiting
+  // for blocks as needed until at most `max_pending` remain.
+  bool WritePending(size_t max_pending);
+  bool WriteToSubStream(const void* data, size_t size);
+  void StopWorkers();
+};
+
 }  // namespace io
 }  // namespace protobuf
 }  // namespace google
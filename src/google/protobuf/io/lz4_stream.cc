@@ -0,0 +1,367 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// This file contains the implementation of classes Lz4InputStream and
+// Lz4OutputStream.
+
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/port.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+static const int kDefaultBufferSize = 256 * 1024;
+
+Lz4InputStream::Options::Options() : buffer_size(kDefaultBufferSize) {}
+
+Lz4InputStream::Lz4InputStream(ZeroCopyInputStream* sub_stream)
+    : Lz4InputStream(sub_stream, Options()) {}
+
+Lz4InputStream::Lz4InputStream(ZeroCopyInputStream* sub_stream,
+                               const Options& options)
+    : sub_stream_(sub_stream),
+      dcontext_(nullptr),
+      lz4_error_(0),
+      truncated_(false),
+      frame_remaining_(0),
+      output_buffer_was_full_(false),
+      dictionary_(options.dictionary),
+      input_position_(nullptr),
+      input_end_(nullptr),
+      byte_count_(0) {
+  size_t result = LZ4F_createDecompressionContext(&dcontext_, LZ4F_VERSION);
+  if (LZ4F_isError(result)) lz4_error_ = result;
+  output_buffer_length_ =
+      options.buffer_size > 0 ? options.buffer_size : kDefaultBufferSize;
+  output_buffer_ = static_cast<char*>(operator new(output_buffer_length_));
+  output_position_ = output_buffer_;
+  output_end_ = output_buffer_;
+}
+
+Lz4InputStream::~Lz4InputStream() {
+  internal::SizedDelete(output_buffer_, output_buffer_length_);
+  LZ4F_freeDecompressionContext(dcontext_);
+}
+
+const char* Lz4InputStream::Lz4ErrorMessage() const {
+  if (lz4_error_ != 0) return LZ4F_getErrorName(lz4_error_);
+  if (truncated_) return "truncated LZ4 frame";
+  return nullptr;
+}
+
+bool Lz4InputStream::Decompress() {
+  size_t produced = 0;
+  while (produced == 0) {
+    // When the last call filled the output buffer LZ4 may still hold
+    // decompressed data, which has to be drained before reading more input.
+    if (input_position_ == input_end_ && !output_buffer_was_full_) {
+      const void* in;
+      int in_size;
+      if (!sub_stream_->Next(&in, &in_size)) {
+        // A clean end of input has to fall between frames.
+        truncated_ = frame_remaining_ != 0;
+        return false;
+      }
+      input_position_ = static_cast<const char*>(in);
+      input_end_ = input_position_ + in_size;
+    }
+    size_t dst_size = output_buffer_length_;
+    size_t src_size = input_end_ - input_position_;
+    if (dictionary_.empty()) {
+      frame_remaining_ =
+          LZ4F_decompress(dcontext_, output_buffer_, &dst_size,
+                          input_position_, &src_size, nullptr);
+    } else {
+      frame_remaining_ = LZ4F_decompress_usingDict(
+          dcontext_, output_buffer_, &dst_size, input_position_, &src_size,
+          dictionary_.data(), dictionary_.size(), nullptr);
+    }
+    if (LZ4F_isError(frame_remaining_)) {
+      lz4_error_ = frame_remaining_;
+      return false;
+    }
+    input_position_ += src_size;
+    produced = dst_size;
+    output_buffer_was_full_ = produced == output_buffer_length_;
+  }
+  output_position_ = output_buffer_;
+  output_end_ = output_buffer_ + produced;
+  return true;
+}
+
+// implements ZeroCopyInputStream ----------------------------------
+bool Lz4InputStream::Next(const void** data, int* size) {
+  if (lz4_error_ != 0 || truncated_) {
+    return false;
+  }
+  if (output_position_ == output_end_ && !Decompress()) {
+    return false;
+  }
+  *data = output_position_;
+  *size = static_cast<int>(output_end_ - output_position_);
+  byte_count_ += *size;
+  output_position_ = output_end_;
+  return true;
+}
+
+void Lz4InputStream::BackUp(int count) {
+  GOOGLE_CHECK_LE(count, output_position_ - output_buffer_);
+  output_position_ -= count;
+  byte_count_ -= count;
+}
+
+bool Lz4InputStream::Skip(int count) {
+  const void* data;
+  int size = 0;
+  bool ok = Next(&data, &size);
+  while (ok && (size < count)) {
+    count -= size;
+    ok = Next(&data, &size);
+  }
+  if (size > count) {
+    BackUp(size - count);
+  }
+  return ok;
+}
+
+int64_t Lz4InputStream::ByteCount() const { return byte_count_; }
+
+// =========================================================================
+
+Lz4OutputStream::Options::Options()
+    : buffer_size(kDefaultBufferSize),
+      compression_level(0),
+      block_size(LZ4F_max64KB),
+      checksum(false) {}
+
+Lz4OutputStream::Lz4OutputStream(ZeroCopyOutputStream* sub_stream) {
+  Init(sub_stream, Options());
+}
+
+Lz4OutputStream::Lz4OutputStream(ZeroCopyOutputStream* sub_stream,
+                                 const Options& options) {
+  Init(sub_stream, options);
+}
+
+void Lz4OutputStream::Init(ZeroCopyOutputStream* sub_stream,
+                           const Options& options) {
+  sub_stream_ = sub_stream;
+  sub_data_ = nullptr;
+  sub_data_size_ = 0;
+  sub_data_position_ = 0;
+  ccontext_ = nullptr;
+  cdict_ = nullptr;
+  lz4_error_ = 0;
+  started_ = false;
+  closed_ = false;
+  input_pending_ = 0;
+  byte_count_ = 0;
+
+  memset(&preferences_, 0, sizeof(preferences_));
+  preferences_.compressionLevel = options.compression_level;
+  preferences_.frameInfo.blockSizeID = options.block_size;
+  preferences_.frameInfo.contentChecksumFlag =
+      options.checksum ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+
+  input_buffer_length_ =
+      options.buffer_size > 0 ? options.buffer_size : kDefaultBufferSize;
+  input_buffer_ = static_cast<char*>(operator new(input_buffer_length_));
+  // LZ4F_compressBound() covers a full input buffer plus the frame footer,
+  // but not the frame header.
+  output_buffer_length_ =
+      std::max<size_t>(LZ4F_compressBound(input_buffer_length_, &preferences_),
+                       LZ4F_HEADER_SIZE_MAX);
+  output_buffer_ = static_cast<char*>(operator new(output_buffer_length_));
+
+  size_t result = LZ4F_createCompressionContext(&ccontext_, LZ4F_VERSION);
+  if (LZ4F_isError(result)) {
+    lz4_error_ = result;
+    return;
+  }
+  if (!options.dictionary.empty()) {
+    cdict_ =
+        LZ4F_createCDict(options.dictionary.data(), options.dictionary.size());
+    GOOGLE_CHECK(cdict_ != nullptr);
+  }
+}
+
+Lz4OutputStream::~Lz4OutputStream() {
+  Close();
+  LZ4F_freeCompressionContext(ccontext_);
+  LZ4F_freeCDict(cdict_);
+  internal::SizedDelete(output_buffer_, output_buffer_length_);
+  internal::SizedDelete(input_buffer_, input_buffer_length_);
+}
+
+const char* Lz4OutputStream::Lz4ErrorMessage() const {
+  return lz4_error_ != 0 ? LZ4F_getErrorName(lz4_error_) : nullptr;
+}
+
+// private
+size_t Lz4OutputStream::RunOperation(Operation op, void* dst,
+                                     size_t capacity) {
+  switch (op) {
+    case kBegin:
+      if (cdict_ != nullptr) {
+        return LZ4F_compressBegin_usingCDict(ccontext_, dst, capacity, cdict_,
+                                             &preferences_);
+      }
+      return LZ4F_compressBegin(ccontext_, dst, capacity, &preferences_);
+    case kUpdate:
+      return LZ4F_compressUpdate(ccontext_, dst, capacity, input_buffer_,
+                                 input_pending_, nullptr);
+    case kFlush:
+      return LZ4F_flush(ccontext_, dst, capacity, nullptr);
+    case kEnd:
+      return LZ4F_compressEnd(ccontext_, dst, capacity, nullptr);
+  }
+  return 0;
+}
+
+bool Lz4OutputStream::Compress(Operation op) {
+  if (sub_data_ == nullptr || sub_data_position_ == sub_data_size_) {
+    void* data;
+    int size;
+    if (!sub_stream_->Next(&data, &size)) {
+      sub_data_ = nullptr;
+      return false;
+    }
+    GOOGLE_CHECK_GT(size, 0);
+    sub_data_ = static_cast<char*>(data);
+    sub_data_size_ = size;
+    sub_data_position_ = 0;
+  }
+
+  size_t available = sub_data_size_ - sub_data_position_;
+  if (available >= output_buffer_length_) {
+    // Compress straight into the underlying stream's buffer.
+    size_t result =
+        RunOperation(op, sub_data_ + sub_data_position_, available);
+    if (LZ4F_isError(result)) {
+      lz4_error_ = result;
+      return false;
+    }
+    sub_data_position_ += result;
+  } else {
+    size_t result = RunOperation(op, output_buffer_, output_buffer_length_);
+    if (LZ4F_isError(result)) {
+      lz4_error_ = result;
+      return false;
+    }
+    const char* staged = output_buffer_;
+    while (result > 0) {
+      if (sub_data_position_ == sub_data_size_) {
+        void* data;
+        int size;
+        if (!sub_stream_->Next(&data, &size)) {
+          sub_data_ = nullptr;
+          return false;
+        }
+        GOOGLE_CHECK_GT(size, 0);
+        sub_data_ = static_cast<char*>(data);
+        sub_data_size_ = size;
+        sub_data_position_ = 0;
+      }
+      size_t n = std::min(result, sub_data_size_ - sub_data_position_);
+      memcpy(sub_data_ + sub_data_position_, staged, n);
+      sub_data_position_ += n;
+      staged += n;
+      result -= n;
+    }
+  }
+
+  if (op == kUpdate) {
+    byte_count_ += input_pending_;
+    input_pending_ = 0;
+  } else if (op != kBegin) {
+    // Notify lower layer of data.
+    sub_stream_->BackUp(static_cast<int>(sub_data_size_ - sub_data_position_));
+    // We don't own the buffer anymore.
+    sub_data_ = nullptr;
+  }
+  return true;
+}
+
+bool Lz4OutputStream::CompressPending() {
+  if (!started_) {
+    if (!Compress(kBegin)) return false;
+    started_ = true;
+  }
+  return input_pending_ == 0 || Compress(kUpdate);
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool Lz4OutputStream::Next(void** data, int* size) {
+  if (lz4_error_ != 0 || closed_ || !CompressPending()) {
+    return false;
+  }
+  input_pending_ = input_buffer_length_;
+  *data = input_buffer_;
+  *size = static_cast<int>(input_buffer_length_);
+  return true;
+}
+
+void Lz4OutputStream::BackUp(int count) {
+  GOOGLE_CHECK_GE(input_pending_, static_cast<size_t>(count));
+  input_pending_ -= count;
+}
+
+int64_t Lz4OutputStream::ByteCount() const {
+  return byte_count_ + input_pending_;
+}
+
+bool Lz4OutputStream::Flush() {
+  if (lz4_error_ != 0 || closed_) {
+    return false;
+  }
+  return CompressPending() && Compress(kFlush);
+}
+
+bool Lz4OutputStream::Close() {
+  if (closed_) {
+    return false;
+  }
+  closed_ = true;
+  return lz4_error_ == 0 && CompressPending() && Compress(kEnd);
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // HAVE_LZ4
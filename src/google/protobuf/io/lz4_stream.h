@@ -0,0 +1,238 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// This file contains the definition for classes Lz4InputStream and
+// Lz4OutputStream.
+//
+// Lz4InputStream decompresses a sequence of LZ4 frames read from an
+// underlying ZeroCopyInputStream and provides the decompressed data as a
+// ZeroCopyInputStream.
+//
+// Lz4OutputStream is a ZeroCopyOutputStream that compresses data to an
+// underlying ZeroCopyOutputStream as a single LZ4 frame.
+//
+// Both classes are only available when protobuf is built with LZ4 support
+// (HAVE_LZ4, see the protobuf_WITH_LZ4 CMake option).
+
+#ifndef GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
+
+#include <string>
+
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/port.h"
+
+// Dictionary support is only declared in the static section of lz4frame.h
+// before LZ4 1.10.
+#ifndef LZ4F_STATIC_LINKING_ONLY
+#define LZ4F_STATIC_LINKING_ONLY
+#endif
+#include "lz4frame.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A ZeroCopyInputStream that reads compressed data through LZ4.
+class PROTOBUF_EXPORT Lz4InputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // Size of the buffer handed out by Next().  Defaults to 256kB.  LZ4
+    // decompresses straight into this buffer when it can hold a whole block,
+    // so it should be at least the block size used by the writer.
+    int buffer_size;
+
+    // Dictionary the data was compressed with.  Empty means no dictionary.
+    // The contents are copied by the stream.
+    std::string dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create an Lz4InputStream with default options.
+  explicit Lz4InputStream(ZeroCopyInputStream* sub_stream);
+
+  // Create an Lz4InputStream with the given options.
+  Lz4InputStream(ZeroCopyInputStream* sub_stream, const Options& options);
+  Lz4InputStream(const Lz4InputStream&) = delete;
+  Lz4InputStream& operator=(const Lz4InputStream&) = delete;
+  ~Lz4InputStream() override;
+
+  // Return last error message or nullptr if no error.
+  const char* Lz4ErrorMessage() const;
+  // Return the last LZ4F error code, or 0 if no error.  See LZ4F_isError().
+  size_t Lz4ErrorCode() const { return lz4_error_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyInputStream* sub_stream_;
+
+  LZ4F_dctx* dcontext_;
+  size_t lz4_error_;
+  // Set when the underlying stream ended in the middle of a frame.
+  bool truncated_;
+  // Result of the last LZ4F_decompress() call; 0 between frames.
+  size_t frame_remaining_;
+  // Whether the last LZ4F_decompress() call filled output_buffer_.
+  bool output_buffer_was_full_;
+  std::string dictionary_;
+
+  const char* input_position_;
+  const char* input_end_;
+
+  char* output_buffer_;
+  size_t output_buffer_length_;
+  // [output_position_, output_end_) holds decompressed bytes which have not
+  // been returned by Next() yet.
+  char* output_position_;
+  char* output_end_;
+  int64_t byte_count_;
+
+  // Decompress more data into output_buffer_.  Returns false at the end of
+  // the input or on error.
+  bool Decompress();
+};
+
+// A ZeroCopyOutputStream that writes compressed data through LZ4.
+class PROTOBUF_EXPORT Lz4OutputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 256kB.
+    int buffer_size;
+
+    // Compression level.  0 selects the default fast compressor, negative
+    // values trade ratio for speed, and values from 3 (LZ4HC_CLEVEL_MIN) up
+    // to 12 select the high compression mode.  Defaults to 0.
+    int compression_level;
+
+    // Maximum size of an LZ4 block.  Defaults to LZ4F_max64KB.
+    LZ4F_blockSizeID_t block_size;
+
+    // Whether to append a checksum of the uncompressed data to the frame.
+    // Defaults to false.
+    bool checksum;
+
+    // Dictionary to compress with.  Readers must be given the same
+    // dictionary.  Empty means no dictionary.
+    std::string dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create an Lz4OutputStream with default options.
+  explicit Lz4OutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create an Lz4OutputStream with the given options.
+  Lz4OutputStream(ZeroCopyOutputStream* sub_stream, const Options& options);
+  Lz4OutputStream(const Lz4OutputStream&) = delete;
+  Lz4OutputStream& operator=(const Lz4OutputStream&) = delete;
+
+  ~Lz4OutputStream() override;
+
+  // Return last error message or nullptr if no error.
+  const char* Lz4ErrorMessage() const;
+  // Return the last LZ4F error code, or 0 if no error.  See LZ4F_isError().
+  size_t Lz4ErrorCode() const { return lz4_error_; }
+
+  // Flushes data written so far to compressed data in the underlying stream.
+  // It is the caller's responsibility to flush the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Flush();
+
+  // Writes out all data and ends the LZ4 frame.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  enum Operation { kBegin, kUpdate, kFlush, kEnd };
+
+  ZeroCopyOutputStream* sub_stream_;
+  // Result from calling Next() on sub_stream_, and how much of it has been
+  // filled with compressed data.
+  char* sub_data_;
+  size_t sub_data_size_;
+  size_t sub_data_position_;
+
+  LZ4F_cctx* ccontext_;
+  LZ4F_CDict* cdict_;
+  LZ4F_preferences_t preferences_;
+  size_t lz4_error_;
+  bool started_;
+  bool closed_;
+
+  char* input_buffer_;
+  size_t input_buffer_length_;
+  // Number of bytes at the front of input_buffer_ which have been written by
+  // the caller but not compressed yet.
+  size_t input_pending_;
+  int64_t byte_count_;
+
+  // LZ4F only writes to destinations large enough for the worst case, so
+  // output which does not fit the sub_stream_ buffer is staged here.
+  char* output_buffer_;
+  size_t output_buffer_length_;
+
+  // Shared constructor code.
+  void Init(ZeroCopyOutputStream* sub_stream, const Options& options);
+
+  // Runs one LZ4F operation on the pending input and writes its output to
+  // sub_stream_.  Returns false on error.
+  bool Compress(Operation op);
+  size_t RunOperation(Operation op, void* dst, size_t capacity);
+  // Writes the frame header if needed and compresses the pending input.
+  bool CompressPending();
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
@@ -115,11 +115,31 @@ namespace {
 
 // Note:  No class is allowed to contain '\0', since this is used to mark end-
 //   of-input and is handled specially.
+//
+// Membership is looked up in a 256-entry table computed at compile time from
+// each class's expression, so that the bulk scanning loops in
+// Tokenizer::ConsumeZeroOrMore() cost one load and one test per character.
 
-#define CHARACTER_CLASS(NAME, EXPRESSION)                     \
-  class NAME {                                                \
-   public:                                                    \
-    static inline bool InClass(char c) { return EXPRESSION; } \
+template <typename CharacterClass>
+struct CharacterClassTable {
+  constexpr CharacterClassTable() : in_class() {
+    for (int i = 0; i < 256; ++i) {
+      in_class[i] = CharacterClass::Matches(static_cast<char>(i));
+    }
+  }
+  bool in_class[256];
+};
+
+template <typename CharacterClass>
+constexpr CharacterClassTable<CharacterClass> kCharacterClassTable{};
+
+#define CHARACTER_CLASS(NAME, EXPRESSION)                          \
+  class NAME {                                                     \
+   public:                                                         \
+    static constexpr bool Matches(char c) { return EXPRESSION; }   \
+    static inline bool InClass(char c) {                           \
+      return kCharacterClassTable<NAME>.in_class[c & 0xFF];        \
+    }                                                              \
   }
 
 CHARACTER_CLASS(Whitespace, c == ' ' || c == '\n' || c == '\t' || c == '\r' ||
@@ -145,6 +165,14 @@ CHARACTER_CLASS(Escape, c == 'a' || c == 'b' || c == 'f' || c == 'n' ||
                             c == 'r' || c == 't' || c == 'v' || c == '\\' ||
                             c == '?' || c == '\'' || c == '\"');
 
+// Runs of characters that need no special handling inside comments and
+// string literals.
+CHARACTER_CLASS(LineCommentText, c != '\0' && c != '\n');
+CHARACTER_CLASS(BlockCommentText,
+                c != '\0' && c != '*' && c != '/' && c != '\n');
+CHARACTER_CLASS(StringText, c != '\0' && c != '\n' && c != '\\' && c != '\"' &&
+                                c != '\'');
+
 #undef CHARACTER_CLASS
 
 // Given a char, interpret it as a numeric digit and return its value.
@@ -376,8 +404,40 @@ inline bool Tokenizer::TryConsume(char c) {
 
 template <typename CharacterClass>
 inline void Tokenizer::ConsumeZeroOrMore() {
+  // Rather than going through NextChar() for every character, scan to the
+  // end of the run (or of the current buffer) directly and update the
+  // position once.  Refresh() takes care of anything being recorded when
+  // the run continues into the next buffer.
   while (CharacterClass::InClass(current_char_)) {
-    NextChar();
+    const char* start = buffer_ + buffer_pos_;
+    const char* end = buffer_ + buffer_size_;
+    const char* ptr = start;
+    if (!CharacterClass::Matches('\n') && !CharacterClass::Matches('\t')) {
+      // Every character is one column wide.
+      do {
+        ++ptr;
+      } while (ptr < end && CharacterClass::InClass(*ptr));
+      column_ += static_cast<int>(ptr - start);
+    } else {
+      do {
+        if (*ptr == '\n') {
+          ++line_;
+          column_ = 0;
+        } else if (*ptr == '\t') {
+          column_ += kTabWidth - column_ % kTabWidth;
+        } else {
+          ++column_;
+        }
+        ++ptr;
+      } while (ptr < end && CharacterClass::InClass(*ptr));
+    }
+
+    buffer_pos_ = static_cast<int>(ptr - buffer_);
+    if (buffer_pos_ < buffer_size_) {
+      current_char_ = *ptr;
+      return;
+    }
+    Refresh();
   }
 }
 
@@ -386,9 +446,7 @@ inline void Tokenizer::ConsumeOneOrMore(const char* error) {
   if (!CharacterClass::InClass(current_char_)) {
     AddError(error);
   } else {
-    do {
-      NextChar();
-    } while (CharacterClass::InClass(current_char_));
+    ConsumeZeroOrMore<CharacterClass>();
   }
 }
 
@@ -398,6 +456,7 @@ inline void Tokenizer::ConsumeOneOrMore(const char* error) {
 
 void Tokenizer::ConsumeString(char delimiter) {
   while (true) {
+    ConsumeZeroOrMore<StringText>();
     switch (current_char_) {
       case '\0':
         AddError("Unexpected end of string.");
@@ -519,9 +578,7 @@ Tokenizer::TokenType Tokenizer::ConsumeNumber(bool started_with_zero,
 void Tokenizer::ConsumeLineComment(std::string* content) {
   if (content != NULL) RecordTo(content);
 
-  while (current_char_ != '\0' && current_char_ != '\n') {
-    NextChar();
-  }
+  ConsumeZeroOrMore<LineCommentText>();
   TryConsume('\n');
 
   if (content != NULL) StopRecording();
@@ -534,10 +591,7 @@ void Tokenizer::ConsumeBlockComment(std::string* content) {
   if (content != NULL) RecordTo(content);
 
   while (true) {
-    while (current_char_ != '\0' && current_char_ != '*' &&
-           current_char_ != '/' && current_char_ != '\n') {
-      NextChar();
-    }
+    ConsumeZeroOrMore<BlockCommentText>();
 
     if (TryConsume('\n')) {
       if (content != NULL) StopRecording();
@@ -395,10 +395,11 @@ class PROTOBUF_EXPORT Tokenizer {
   // -----------------------------------------------------------------
   // These helper methods make the parsing code more readable.  The
   // "character classes" referred to are defined at the top of the .cc file.
-  // Basically it is a C++ class with one method:
+  // Basically it is a C++ class with two methods:
+  //   static constexpr bool Matches(char c);
   //   static bool InClass(char c);
-  // The method returns true if c is a member of this "class", like "Letter"
-  // or "Digit".
+  // Both return true if c is a member of this "class", like "Letter" or
+  // "Digit"; InClass() is a table lookup precomputed from Matches().
 
   // Returns true if the current character is of the given character
   // class, but does not consume anything.
@@ -414,7 +415,8 @@ class PROTOBUF_EXPORT Tokenizer {
   // Like above, but try to consume the specific character indicated.
   inline bool TryConsume(char c);
 
-  // Consume zero or more of the given character class.
+  // Consume zero or more of the given character class.  Runs are scanned a
+  // buffer at a time rather than through NextChar().
   template <typename CharacterClass>
   inline void ConsumeZeroOrMore();
 
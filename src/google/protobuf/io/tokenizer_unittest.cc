@@ -456,6 +456,20 @@ MultiTokenCase kMultiTokenCases[] = {
          {Tokenizer::TYPE_END, "", 1, 3, 3},
      }},
 
+    // Test that positions stay correct across long runs of identifier,
+    // number, comment, and string characters, including tabs and newlines
+    // inside block comments.
+    {"abcdefghijklmnopqrstuvwxyz_0123456789 1234567890123\n"
+     "/* a\tlong\n  block comment\t*/ 'single \"quoted\" string'\tx",
+     {
+         {Tokenizer::TYPE_IDENTIFIER,
+          "abcdefghijklmnopqrstuvwxyz_0123456789", 0, 0, 37},
+         {Tokenizer::TYPE_INTEGER, "1234567890123", 0, 38, 51},
+         {Tokenizer::TYPE_STRING, "'single \"quoted\" string'", 2, 19, 43},
+         {Tokenizer::TYPE_IDENTIFIER, "x", 2, 48, 49},
+         {Tokenizer::TYPE_END, "", 2, 49, 49},
+     }},
+
     // Test all whitespace chars
     {"foo\n\t\r\v\fbar",
      {
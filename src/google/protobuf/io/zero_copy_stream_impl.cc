@@ -38,10 +38,19 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
 #include <errno.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 #include "google/protobuf/stubs/common.h"
 #include "google/protobuf/stubs/logging.h"
@@ -77,6 +86,48 @@ int close_no_eintr(int fd) {
   return result;
 }
 
+#ifdef _WIN32
+struct iovec {
+  void* iov_base;
+  size_t iov_len;
+};
+#endif
+
+#ifdef IOV_MAX
+constexpr int kMaxIovecs = IOV_MAX;
+#else
+constexpr int kMaxIovecs = 1024;
+#endif
+
+// Writes all of `iov`, retrying on EINTR and short writes.  On failure,
+// returns false with errno set.
+bool WritevFully(int fd, iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    int64_t bytes;
+    do {
+#ifdef _WIN32
+      bytes = write(fd, iov->iov_base, static_cast<int>(iov->iov_len));
+#else
+      bytes = writev(fd, iov, std::min(iovcnt, kMaxIovecs));
+#endif
+    } while (bytes < 0 && errno == EINTR);
+    if (bytes == 0) errno = EIO;
+    if (bytes <= 0) return false;
+
+    // Skip over what was written.
+    while (iovcnt > 0 && static_cast<size_t>(bytes) >= iov->iov_len) {
+      bytes -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (bytes > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + bytes;
+      iov->iov_len -= bytes;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 // ===================================================================
@@ -169,6 +220,137 @@ int FileInputStream::CopyingFileInputStream::Skip(int count) {
 
 // ===================================================================
 
+MappedFileInputStream::MappedFileInputStream(int file_descriptor,
+                                             int window_size)
+    : file_(file_descriptor),
+      window_size_(window_size > 0 ? window_size
+                                   : std::numeric_limits<int>::max()) {
+  if (!Map()) {
+    fallback_ = std::make_unique<FileInputStream>(file_descriptor, window_size);
+  }
+}
+
+MappedFileInputStream::~MappedFileInputStream() {
+  if (fallback_ == nullptr && close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      GOOGLE_LOG(ERROR) << "close() failed: " << strerror(errno_);
+    }
+  }
+  Unmap();
+}
+
+bool MappedFileInputStream::Map() {
+#ifdef _WIN32
+  return false;
+#else
+  struct stat st;
+  if (fstat(file_, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+  off_t offset = lseek(file_, 0, SEEK_CUR);
+  if (offset == static_cast<off_t>(-1)) return false;
+  if (static_cast<uint64_t>(st.st_size) >
+      std::numeric_limits<size_t>::max()) {
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  if (size > 0) {
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_, 0);
+    if (mapping == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+    madvise(mapping, size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+    madvise(mapping, size, MADV_WILLNEED);
+#endif
+    mapping_ = static_cast<const char*>(mapping);
+  }
+  mapping_size_ = size;
+  start_ = position_ = std::min(static_cast<size_t>(offset), size);
+  return true;
+#endif
+}
+
+void MappedFileInputStream::Unmap() {
+#ifndef _WIN32
+  if (mapping_ != nullptr) {
+    munmap(const_cast<char*>(mapping_), mapping_size_);
+    mapping_ = nullptr;
+  }
+#endif
+}
+
+bool MappedFileInputStream::Close() {
+  if (fallback_ != nullptr) return fallback_->Close();
+  GOOGLE_CHECK(!is_closed_);
+
+  is_closed_ = true;
+  Unmap();
+  if (close_no_eintr(file_) != 0) {
+    errno_ = errno;
+    return false;
+  }
+  return true;
+}
+
+void MappedFileInputStream::SetCloseOnDelete(bool value) {
+  if (fallback_ != nullptr) {
+    fallback_->SetCloseOnDelete(value);
+  } else {
+    close_on_delete_ = value;
+  }
+}
+
+int MappedFileInputStream::GetErrno() const {
+  return fallback_ != nullptr ? fallback_->GetErrno() : errno_;
+}
+
+bool MappedFileInputStream::Next(const void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  if (is_closed_ || position_ >= mapping_size_) {
+    last_returned_size_ = 0;  // Don't let caller back up.
+    return false;
+  }
+  last_returned_size_ = static_cast<int>(std::min(
+      static_cast<size_t>(window_size_), mapping_size_ - position_));
+  *data = mapping_ + position_;
+  *size = last_returned_size_;
+  position_ += last_returned_size_;
+  return true;
+}
+
+void MappedFileInputStream::BackUp(int count) {
+  if (fallback_ != nullptr) {
+    fallback_->BackUp(count);
+    return;
+  }
+  GOOGLE_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  GOOGLE_CHECK_LE(count, last_returned_size_);
+  GOOGLE_CHECK_GE(count, 0);
+  position_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool MappedFileInputStream::Skip(int count) {
+  if (fallback_ != nullptr) return fallback_->Skip(count);
+  GOOGLE_CHECK_GE(count, 0);
+  last_returned_size_ = 0;  // Don't let caller back up.
+  if (is_closed_) return false;
+  if (static_cast<size_t>(count) > mapping_size_ - position_) {
+    position_ = mapping_size_;
+    return false;
+  }
+  position_ += count;
+  return true;
+}
+
+int64_t MappedFileInputStream::ByteCount() const {
+  if (fallback_ != nullptr) return fallback_->ByteCount();
+  return static_cast<int64_t>(position_ - start_);
+}
+
+// ===================================================================
+
 FileOutputStream::FileOutputStream(int file_descriptor, int block_size)
     : CopyingOutputStreamAdaptor(&copying_output_, block_size),
       copying_output_(file_descriptor) {}
@@ -247,6 +429,146 @@ bool FileOutputStream::CopyingFileOutputStream::Write(const void* buffer,
 
 // ===================================================================
 
+VectoredFileOutputStream::VectoredFileOutputStream(int file_descriptor)
+    : VectoredFileOutputStream(file_descriptor, Options()) {}
+
+VectoredFileOutputStream::VectoredFileOutputStream(int file_descriptor,
+                                                   const Options& options)
+    : file_(file_descriptor), options_(options) {
+  GOOGLE_CHECK_GT(options_.buffer_size, 0);
+  const int alignment = options_.direct_io_alignment;
+  if (alignment != 0) {
+    GOOGLE_CHECK(alignment > 0 && (alignment & (alignment - 1)) == 0)
+        << "direct_io_alignment must be a power of two: " << alignment;
+    GOOGLE_CHECK_EQ(options_.buffer_size % alignment, 0)
+        << "buffer_size must be a multiple of direct_io_alignment.";
+  }
+}
+
+VectoredFileOutputStream::~VectoredFileOutputStream() {
+  if (is_closed_) return;
+  if (close_on_delete_) {
+    if (!Close()) {
+      GOOGLE_LOG(ERROR) << "close() failed: " << strerror(errno_);
+    }
+  } else if (!WriteBuffers(true)) {
+    GOOGLE_LOG(ERROR) << "write() failed: " << strerror(errno_);
+  }
+}
+
+bool VectoredFileOutputStream::Flush() {
+  GOOGLE_CHECK(!is_closed_);
+  return WriteBuffers(false);
+}
+
+bool VectoredFileOutputStream::Close() {
+  GOOGLE_CHECK(!is_closed_);
+  const bool flushed = WriteBuffers(true);
+  is_closed_ = true;
+  if (close_no_eintr(file_) != 0) {
+    if (flushed) errno_ = errno;
+    return false;
+  }
+  return flushed;
+}
+
+bool VectoredFileOutputStream::Next(void** data, int* size) {
+  if (is_closed_ || errno_ != 0) return false;
+  if (num_pending_ == 0 || tail_size_ == options_.buffer_size) {
+    if (PendingBytes() >= static_cast<size_t>(options_.flush_size) &&
+        !WriteBuffers(false)) {
+      return false;
+    }
+  }
+  // After a BackUp(), the rest of the last buffer is returned again, so that
+  // only the last pending buffer is ever partially filled.
+  if (num_pending_ == 0 || tail_size_ == options_.buffer_size) {
+    if (num_pending_ == buffers_.size()) buffers_.push_back(NewBuffer());
+    ++num_pending_;
+    tail_size_ = 0;
+  }
+  *data = buffers_[num_pending_ - 1] + tail_size_;
+  *size = options_.buffer_size - tail_size_;
+  last_returned_size_ = *size;
+  tail_size_ = options_.buffer_size;
+  byte_count_ += *size;
+  return true;
+}
+
+void VectoredFileOutputStream::BackUp(int count) {
+  GOOGLE_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  GOOGLE_CHECK_LE(count, last_returned_size_);
+  GOOGLE_CHECK_GE(count, 0);
+  tail_size_ -= count;
+  byte_count_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+int64_t VectoredFileOutputStream::ByteCount() const { return byte_count_; }
+
+size_t VectoredFileOutputStream::PendingBytes() const {
+  if (num_pending_ == 0) return 0;
+  return (num_pending_ - 1) * options_.buffer_size + tail_size_;
+}
+
+char* VectoredFileOutputStream::NewBuffer() {
+  const size_t alignment = std::max(options_.direct_io_alignment, 1);
+  storage_.emplace_back(new char[options_.buffer_size + alignment - 1]);
+  uintptr_t address = reinterpret_cast<uintptr_t>(storage_.back().get());
+  address = (address + alignment - 1) & ~(uintptr_t{alignment} - 1);
+  return reinterpret_cast<char*>(address);
+}
+
+bool VectoredFileOutputStream::WriteBuffers(bool final) {
+  if (errno_ != 0) return false;
+  last_returned_size_ = 0;  // The buffers may be moved around below.
+  const int alignment = options_.direct_io_alignment;
+  size_t size = PendingBytes();
+  if (alignment != 0 && size % alignment != 0) {
+    size -= size % alignment;
+    if (final) {
+      // O_DIRECT only allows writing whole blocks: write those first, then
+      // the partial one without it.
+      if (!WriteBuffers(false)) return false;
+#if defined(O_DIRECT) && !defined(_WIN32)
+      int flags = fcntl(file_, F_GETFL);
+      if (flags != -1) fcntl(file_, F_SETFL, flags & ~O_DIRECT);
+#endif
+      size = PendingBytes();
+    }
+  }
+  if (size == 0) return true;
+
+  std::vector<iovec> iov;
+  iov.reserve(num_pending_);
+  size_t remaining = size;
+  for (size_t i = 0; remaining > 0; ++i) {
+    size_t len = std::min(remaining, static_cast<size_t>(options_.buffer_size));
+    iov.push_back({buffers_[i], len});
+    remaining -= len;
+  }
+  if (!WritevFully(file_, iov.data(), static_cast<int>(iov.size()))) {
+    errno_ = errno;
+    return false;
+  }
+
+  // In direct I/O mode, a partial block may be left over at the end of the
+  // last buffer.  Move it to the start of the first one.
+  const size_t leftover = PendingBytes() - size;
+  if (leftover == 0) {
+    num_pending_ = 0;
+    return true;
+  }
+  std::swap(buffers_[0], buffers_[num_pending_ - 1]);
+  memmove(buffers_[0], buffers_[0] + tail_size_ - leftover, leftover);
+  num_pending_ = 1;
+  tail_size_ = static_cast<int>(leftover);
+  return true;
+}
+
+// ===================================================================
+
 IstreamInputStream::IstreamInputStream(std::istream* input, int block_size)
     : copying_input_(input), impl_(&copying_input_, block_size) {}
 
@@ -363,6 +685,155 @@ int64_t ConcatenatingInputStream::ByteCount() const {
   }
 }
 
+// ===================================================================
+
+// Reads a ZeroCopyInputStream through the CopyingInputStream interface.
+class ReadAheadInputStream::ZeroCopySource final : public CopyingInputStream {
+ public:
+  explicit ZeroCopySource(ZeroCopyInputStream* input) : input_(input) {}
+
+  int Read(void* buffer, int size) override {
+    const void* data;
+    int available;
+    do {
+      if (!input_->Next(&data, &available)) return 0;
+    } while (available == 0);
+    if (available > size) {
+      input_->BackUp(available - size);
+      available = size;
+    }
+    memcpy(buffer, data, available);
+    return available;
+  }
+
+ private:
+  ZeroCopyInputStream* input_;
+};
+
+ReadAheadInputStream::ReadAheadInputStream(CopyingInputStream* source)
+    : ReadAheadInputStream(source, Options()) {}
+
+ReadAheadInputStream::ReadAheadInputStream(CopyingInputStream* source,
+                                           const Options& options)
+    : options_(options), source_(source) {
+  Start();
+}
+
+ReadAheadInputStream::ReadAheadInputStream(ZeroCopyInputStream* source)
+    : ReadAheadInputStream(source, Options()) {}
+
+ReadAheadInputStream::ReadAheadInputStream(ZeroCopyInputStream* source,
+                                           const Options& options)
+    : options_(options),
+      zero_copy_source_(new ZeroCopySource(source)),
+      source_(zero_copy_source_.get()) {
+  Start();
+}
+
+ReadAheadInputStream::~ReadAheadInputStream() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+  }
+  reader_.join();
+}
+
+void ReadAheadInputStream::Start() {
+  GOOGLE_CHECK_GT(options_.buffer_size, 0);
+  GOOGLE_CHECK_GE(options_.depth, 2);
+  for (int i = 0; i < options_.depth; ++i) {
+    buffers_.emplace_back(new uint8_t[options_.buffer_size]);
+  }
+  sizes_.resize(options_.depth);
+  reader_ = std::thread([this] { ReaderLoop(); });
+}
+
+bool ReadAheadInputStream::CanFill() const {
+  return shutdown_ || num_filled_ < options_.depth;
+}
+
+bool ReadAheadInputStream::CanTake() const {
+  return num_filled_ > 0 || source_done_;
+}
+
+void ReadAheadInputStream::ReaderLoop() {
+  while (true) {
+    int slot;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &ReadAheadInputStream::CanFill));
+      if (shutdown_) return;
+      slot = (head_ + num_filled_) % options_.depth;
+    }
+    // The caller does not touch buffers past num_filled_, so this one can be
+    // filled without holding the lock.
+    int size = source_->Read(buffers_[slot].get(), options_.buffer_size);
+    absl::MutexLock lock(&mutex_);
+    if (size <= 0) {
+      source_done_ = true;
+      return;
+    }
+    sizes_[slot] = size;
+    ++num_filled_;
+  }
+}
+
+bool ReadAheadInputStream::Next(const void** data, int* size) {
+  if (backed_up_ > 0) {
+    *data = current_ + current_size_ - backed_up_;
+    *size = backed_up_;
+  } else {
+    absl::MutexLock lock(&mutex_);
+    if (holding_) {
+      // Hand the caller's buffer back to the reader thread.
+      head_ = (head_ + 1) % options_.depth;
+      --num_filled_;
+      holding_ = false;
+    }
+    mutex_.Await(absl::Condition(this, &ReadAheadInputStream::CanTake));
+    if (num_filled_ == 0) {
+      last_returned_size_ = 0;  // Don't let caller back up.
+      return false;
+    }
+    holding_ = true;
+    current_ = buffers_[head_].get();
+    current_size_ = sizes_[head_];
+    *data = current_;
+    *size = current_size_;
+  }
+  backed_up_ = 0;
+  last_returned_size_ = *size;
+  position_ += *size;
+  return true;
+}
+
+void ReadAheadInputStream::BackUp(int count) {
+  GOOGLE_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  GOOGLE_CHECK_LE(count, last_returned_size_);
+  GOOGLE_CHECK_GE(count, 0);
+  backed_up_ = count;
+  position_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool ReadAheadInputStream::Skip(int count) {
+  GOOGLE_CHECK_GE(count, 0);
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  last_returned_size_ = 0;  // Don't let caller back up.
+  return true;
+}
+
+int64_t ReadAheadInputStream::ByteCount() const { return position_; }
 
 // ===================================================================
 
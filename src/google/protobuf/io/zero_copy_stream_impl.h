@@ -40,10 +40,15 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 
+#include <cstddef>
 #include <iosfwd>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "google/protobuf/stubs/common.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
@@ -134,6 +139,80 @@ class PROTOBUF_EXPORT FileInputStream PROTOBUF_FUTURE_FINAL
 
 // ===================================================================
 
+// A ZeroCopyInputStream which reads a file by mapping it into memory.
+//
+// Next() returns windows of the mapping itself, so the data is parsed
+// straight out of the page cache instead of being copied into a buffer by
+// read() first.  The kernel is told that the mapping will be read
+// sequentially and soon.  When the descriptor does not refer to a regular
+// file, or the file cannot be mapped (or on Windows), the stream reads
+// through a FileInputStream instead; IsMapped() tells which happened.
+//
+// The data returned by Next() remains valid until the stream is closed or
+// destroyed, not just until the next call, so strings parsed with aliasing
+// enabled may point into it for as long as the stream is kept alive.  The
+// file must not be truncated or modified while it is mapped.
+class PROTOBUF_EXPORT MappedFileInputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyInputStream {
+ public:
+  // Creates a stream that reads the file open on the given Unix file
+  // descriptor, from the descriptor's current offset to the end of the file.
+  // The offset of the descriptor itself is left unchanged.  If a
+  // window_size is given, Next() returns at most that many bytes at a time;
+  // by default it returns as much of the file as fits in an int.  When the
+  // file cannot be mapped, window_size is used as the block size of the
+  // FileInputStream.
+  explicit MappedFileInputStream(int file_descriptor, int window_size = -1);
+  MappedFileInputStream(const MappedFileInputStream&) = delete;
+  MappedFileInputStream& operator=(const MappedFileInputStream&) = delete;
+  ~MappedFileInputStream() override;
+
+  // Unmaps and closes the underlying file.  Returns false if an error occurs
+  // during the process; use GetErrno() to examine the error.  Even if an
+  // error occurs, the file descriptor is closed when this returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.  The mapping is
+  // always released on destruction.
+  void SetCloseOnDelete(bool value);
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.
+  int GetErrno() const;
+
+  // Returns true if the file is read through a memory mapping.
+  bool IsMapped() const { return fallback_ == nullptr; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  bool Map();
+  void Unmap();
+
+  const int file_;
+  const int window_size_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  int errno_ = 0;
+
+  // The mapping covers the whole file; reading starts at start_.
+  const char* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  size_t start_ = 0;
+  size_t position_ = 0;
+  int last_returned_size_ = 0;
+
+  // Set if the file could not be mapped.
+  std::unique_ptr<FileInputStream> fallback_;
+};
+
+// ===================================================================
+
 // A ZeroCopyOutputStream which writes to a file descriptor.
 //
 // FileOutputStream is preferred over using an ofstream with
@@ -203,6 +282,91 @@ class PROTOBUF_EXPORT FileOutputStream PROTOBUF_FUTURE_FINAL
 
 // ===================================================================
 
+// A ZeroCopyOutputStream which writes to a file descriptor with vectored
+// writes.
+//
+// FileOutputStream writes its single buffer every time it fills up.  This
+// stream instead hands out a series of buffers and writes all of them with a
+// single writev() once flush_size bytes are pending, which takes far fewer
+// system calls for large outputs.  The buffers are reused after each write.
+//
+// For files opened with O_DIRECT, set direct_io_alignment to the alignment
+// the file system requires (typically 512 or 4096).  Buffers are then
+// aligned and sized to it, and only whole blocks are written until the
+// stream is closed or destroyed; the partial block at the end is written
+// after clearing O_DIRECT on the descriptor.
+class PROTOBUF_EXPORT VectoredFileOutputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyOutputStream {
+ public:
+  struct Options {
+    // Size of the buffers returned by Next().
+    int buffer_size = 64 << 10;
+    // Pending data is written once it reaches this many bytes.
+    int flush_size = 1 << 20;
+    // If nonzero, a power of two that buffer_size must be a multiple of;
+    // see the class comment.
+    int direct_io_alignment = 0;
+  };
+
+  // Creates a stream that writes to the given Unix file descriptor.
+  explicit VectoredFileOutputStream(int file_descriptor);
+  VectoredFileOutputStream(int file_descriptor, const Options& options);
+  VectoredFileOutputStream(const VectoredFileOutputStream&) = delete;
+  VectoredFileOutputStream& operator=(const VectoredFileOutputStream&) =
+      delete;
+  ~VectoredFileOutputStream() override;
+
+  // Writes all pending data, except a partial block in direct I/O mode.
+  // Returns false if an error occurs; use GetErrno() to examine the error.
+  bool Flush();
+
+  // Writes all pending data and closes the underlying file.  Returns false if
+  // an error occurs during the process; use GetErrno() to examine the error.
+  // Even if an error occurs, the file descriptor is closed when this returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.  WARNING:
+  // This leaves no way for the caller to detect if close() fails.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.  Once an error
+  // occurs, the stream is broken and all subsequent operations will
+  // fail.
+  int GetErrno() const { return errno_; }
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  size_t PendingBytes() const;
+  char* NewBuffer();
+  // Writes the pending data, or only its whole blocks in direct I/O mode
+  // unless `final` is true.
+  bool WriteBuffers(bool final);
+
+  const int file_;
+  const Options options_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  int errno_ = 0;
+  int64_t byte_count_ = 0;
+
+  // buffers_[0, num_pending_) hold pending data.  All of them are full
+  // except the last one, of which tail_size_ bytes are used.
+  std::vector<char*> buffers_;
+  size_t num_pending_ = 0;
+  int tail_size_ = 0;
+  int last_returned_size_ = 0;
+  // Owns the memory of buffers_, which may be offset for alignment.
+  std::vector<std::unique_ptr<char[]>> storage_;
+};
+
+// ===================================================================
+
 // A ZeroCopyInputStream which reads from a C++ istream.
 //
 // Note that for reading files (or anything represented by a file descriptor),
@@ -328,6 +492,82 @@ class PROTOBUF_EXPORT ConcatenatingInputStream PROTOBUF_FUTURE_FINAL
 
 // ===================================================================
 
+// A ZeroCopyInputStream which reads ahead from another stream on a
+// background thread.
+//
+// CopyingInputStreamAdaptor (and so FileInputStream) reads synchronously in
+// Next(), so parsing stalls on every refill, which hurts with slow sources
+// such as network file systems.  ReadAheadInputStream has a reader thread
+// fill several buffers in advance while the caller parses the buffer
+// returned by the last Next(), overlapping I/O with parsing.
+//
+// The source must outlive this stream, and must not be used by anything else
+// while this stream exists, since it is read from the reader thread.  As with
+// CopyingInputStreamAdaptor, a read error ends the stream.
+class PROTOBUF_EXPORT ReadAheadInputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyInputStream {
+ public:
+  struct Options {
+    // Size of each buffer.
+    int buffer_size = 64 << 10;
+    // Number of buffers, at least 2.  The caller holds one of them, so up to
+    // depth - 1 buffers are read ahead.
+    int depth = 3;
+  };
+
+  explicit ReadAheadInputStream(CopyingInputStream* source);
+  ReadAheadInputStream(CopyingInputStream* source, const Options& options);
+  // The reader thread copies the data of a ZeroCopyInputStream source into
+  // the buffers.
+  explicit ReadAheadInputStream(ZeroCopyInputStream* source);
+  ReadAheadInputStream(ZeroCopyInputStream* source, const Options& options);
+  ReadAheadInputStream(const ReadAheadInputStream&) = delete;
+  ReadAheadInputStream& operator=(const ReadAheadInputStream&) = delete;
+  // Stops the reader thread, after waiting for a read in progress.
+  ~ReadAheadInputStream() override;
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  class ZeroCopySource;
+
+  void Start();
+  void ReaderLoop();
+  bool CanFill() const;
+  bool CanTake() const;
+
+  const Options options_;
+  std::unique_ptr<ZeroCopySource> zero_copy_source_;
+  CopyingInputStream* const source_;
+  std::vector<std::unique_ptr<uint8_t[]>> buffers_;
+
+  absl::Mutex mutex_;
+  // Guarded by mutex_: buffers [head_, head_ + num_filled_) (modulo depth)
+  // hold data, the first one being the caller's while holding_ is set.
+  // The sizes of the others are only written by the reader thread.
+  std::vector<int> sizes_;
+  int head_ = 0;
+  int num_filled_ = 0;
+  bool source_done_ = false;
+  bool shutdown_ = false;
+
+  // Only used by the caller's thread.
+  bool holding_ = false;
+  const uint8_t* current_ = nullptr;
+  int current_size_ = 0;
+  int backed_up_ = 0;
+  int last_returned_size_ = 0;
+  int64_t position_ = 0;
+
+  std::thread reader_;
+};
+
+// ===================================================================
+
 }  // namespace io
 }  // namespace protobuf
 }  // namespace google
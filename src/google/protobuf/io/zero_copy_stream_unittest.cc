@@ -78,6 +78,12 @@
 #if HAVE_ZLIB
 #include "google/protobuf/io/gzip_stream.h"
 #endif
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+#endif
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+#endif
 
 #include "google/protobuf/stubs/common.h"
 #include "google/protobuf/stubs/logging.h"
@@ -556,6 +562,66 @@ TEST_F(IoTest, ZlibIoInputAutodetect) {
   delete[] buffer;
 }
 
+TEST_F(IoTest, ParallelGzipIo) {
+  const int kBufferSize = 2 * 1024;
+  uint8* buffer = new uint8[kBufferSize];
+  for (GzipOutputStream::Format format :
+       {GzipOutputStream::GZIP, GzipOutputStream::ZLIB}) {
+    for (int i = 0; i < kBlockSizeCount; i++) {
+      for (int j = 0; j < kBlockSizeCount; j++) {
+        for (int z = 0; z < kBlockSizeCount; z++) {
+          int gzip_block_size = kBlockSizes[z];
+          int size;
+          {
+            ArrayOutputStream output(buffer, kBufferSize, kBlockSizes[i]);
+            ParallelGzipOutputStream::Options options;
+            options.format = format;
+            options.num_threads = 2;
+            if (gzip_block_size != -1) {
+              options.block_size = gzip_block_size;
+            }
+            ParallelGzipOutputStream gzout(&output, options);
+            WriteStuff(&gzout);
+            EXPECT_TRUE(gzout.Close());
+            size = output.ByteCount();
+          }
+          {
+            ArrayInputStream input(buffer, size, kBlockSizes[j]);
+            GzipInputStream gzin(&input,
+                                 format == GzipOutputStream::GZIP
+                                     ? GzipInputStream::GZIP
+                                     : GzipInputStream::ZLIB);
+            ReadStuff(&gzin);
+          }
+        }
+      }
+    }
+  }
+  delete[] buffer;
+}
+
+TEST_F(IoTest, ParallelGzipIoLarge) {
+  // Blocks smaller than the deflate window check that each block is primed
+  // with the input before it, and the flush checks that a partial block is
+  // handled.
+  for (int block_size : {1000, 40000, 1 << 20}) {
+    std::string compressed;
+    {
+      StringOutputStream output(&compressed);
+      ParallelGzipOutputStream::Options options;
+      options.block_size = block_size;
+      options.num_threads = 4;
+      ParallelGzipOutputStream gzout(&output, options);
+      WriteStuffLarge(&gzout);
+      EXPECT_TRUE(gzout.Flush());
+      EXPECT_TRUE(gzout.Close());
+    }
+    ArrayInputStream input(compressed.data(), compressed.size());
+    GzipInputStream gzin(&input);
+    ReadStuffLarge(&gzin);
+  }
+}
+
 std::string IoTest::Compress(const std::string& data,
                              const GzipOutputStream::Options& options) {
   std::string result;
@@ -1475,7 +1541,163 @@ TEST_F(IoTest, FileIo) {
   }
 }
 
+TEST_F(IoTest, MappedFileIo) {
+  std::string filename = TestTempDir() + "/zero_copy_stream_test_file";
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      int file =
+          open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+      ASSERT_GE(file, 0);
+
+      {
+        FileOutputStream output(file, kBlockSizes[i]);
+        WriteStuff(&output);
+        EXPECT_EQ(0, output.GetErrno());
+      }
+
+      // Rewind.
+      ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+      {
+        MappedFileInputStream input(file, kBlockSizes[j]);
 #ifndef _WIN32
+        EXPECT_TRUE(input.IsMapped());
+#endif
+        ReadStuff(&input);
+        EXPECT_EQ(0, input.GetErrno());
+      }
+
+      close(file);
+    }
+  }
+}
+
+TEST_F(IoTest, VectoredFileIo) {
+  std::string filename = TestTempDir() + "/zero_copy_stream_test_file";
+  const int kBufferSizes[] = {1, 7, 64, 4096};
+  const int kFlushSizes[] = {1, 100, 1 << 20};
+
+  for (int buffer_size : kBufferSizes) {
+    for (int flush_size : kFlushSizes) {
+      int file =
+          open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+      ASSERT_GE(file, 0);
+
+      {
+        VectoredFileOutputStream::Options options;
+        options.buffer_size = buffer_size;
+        options.flush_size = flush_size;
+        VectoredFileOutputStream output(file, options);
+        WriteStuffLarge(&output);
+        EXPECT_TRUE(output.Flush());
+        EXPECT_EQ(0, output.GetErrno());
+      }
+
+      // Rewind.
+      ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+      {
+        FileInputStream input(file);
+        ReadStuffLarge(&input);
+        EXPECT_EQ(0, input.GetErrno());
+      }
+
+      close(file);
+    }
+  }
+}
+
+TEST_F(IoTest, VectoredFileDirectIo) {
+  std::string filename = TestTempDir() + "/zero_copy_stream_test_file";
+  int flags = O_RDWR | O_CREAT | O_TRUNC | O_BINARY;
+#if defined(O_DIRECT) && !defined(_WIN32)
+  // Not every file system supports O_DIRECT; the stream works the same way
+  // without it.
+  int file = open(filename.c_str(), flags | O_DIRECT, 0777);
+  if (file < 0) file = open(filename.c_str(), flags, 0777);
+#else
+  int file = open(filename.c_str(), flags, 0777);
+#endif
+  ASSERT_GE(file, 0);
+
+  VectoredFileOutputStream::Options options;
+  options.buffer_size = 8192;
+  options.flush_size = 16384;
+  options.direct_io_alignment = 4096;
+  VectoredFileOutputStream output(file, options);
+  WriteString(&output, std::string(5000, 'a'));
+  // Only the first whole block can be written.
+  EXPECT_TRUE(output.Flush());
+  EXPECT_EQ(4096, lseek(file, 0, SEEK_CUR));
+  WriteString(&output, std::string(30000, 'b'));
+  EXPECT_EQ(35000, output.ByteCount());
+  EXPECT_TRUE(output.Close());
+  EXPECT_EQ(0, output.GetErrno());
+
+  file = open(filename.c_str(), O_RDONLY | O_BINARY);
+  ASSERT_GE(file, 0);
+  FileInputStream input(file);
+  input.SetCloseOnDelete(true);
+  ReadString(&input, std::string(5000, 'a') + std::string(30000, 'b'));
+  uint8 byte;
+  EXPECT_EQ(ReadFromInput(&input, &byte, 1), 0);
+}
+
+TEST_F(IoTest, MappedFileStartsAtCurrentOffset) {
+  std::string filename = TestTempDir() + "/zero_copy_stream_test_file";
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  ASSERT_EQ(write(file, "hello world", 11), 11);
+  ASSERT_EQ(lseek(file, 6, SEEK_SET), 6);
+
+  MappedFileInputStream input(file);
+  input.SetCloseOnDelete(true);
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ("world", std::string(static_cast<const char*>(data), size));
+  EXPECT_EQ(5, input.ByteCount());
+  input.BackUp(2);
+  EXPECT_EQ(3, input.ByteCount());
+  EXPECT_FALSE(input.Skip(3));
+  EXPECT_EQ(5, input.ByteCount());
+  EXPECT_FALSE(input.Next(&data, &size));
+}
+
+TEST_F(IoTest, MappedFileEmpty) {
+  std::string filename = TestTempDir() + "/zero_copy_stream_test_file";
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+
+  MappedFileInputStream input(file);
+  const void* data;
+  int size;
+  EXPECT_FALSE(input.Next(&data, &size));
+  EXPECT_EQ(0, input.ByteCount());
+  EXPECT_TRUE(input.Close());
+  EXPECT_EQ(0, input.GetErrno());
+}
+
+#ifndef _WIN32
+TEST_F(IoTest, MappedFileFallsBackForPipes) {
+  int fd[2];
+  ASSERT_EQ(pipe(fd), 0);
+  ASSERT_EQ(write(fd[1], "hello", 5), 5);
+  close(fd[1]);
+
+  MappedFileInputStream input(fd[0]);
+  input.SetCloseOnDelete(true);
+  EXPECT_FALSE(input.IsMapped());
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ("hello", std::string(static_cast<const char*>(data), size));
+  EXPECT_FALSE(input.Next(&data, &size));
+}
+
 // This tests the FileInputStream with a non blocking file. It opens a pipe in
 // non blocking mode, then starts reading it. The writing thread starts writing
 // 100ms after that.
@@ -1576,6 +1798,152 @@ TEST_F(IoTest, GzipFileIo) {
 }
 #endif
 
+#if HAVE_ZSTD
+TEST_F(IoTest, ZstdIo) {
+  const int kBufferSize = 2 * 1024;
+  uint8* buffer = new uint8[kBufferSize];
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int z = 0; z < kBlockSizeCount; z++) {
+        int zstd_buffer_size = kBlockSizes[z];
+        int size;
+        {
+          ArrayOutputStream output(buffer, kBufferSize, kBlockSizes[i]);
+          ZstdOutputStream::Options options;
+          if (zstd_buffer_size != -1) {
+            options.buffer_size = zstd_buffer_size;
+          }
+          ZstdOutputStream zout(&output, options);
+          WriteStuff(&zout);
+          EXPECT_TRUE(zout.Close());
+          size = output.ByteCount();
+        }
+        {
+          ArrayInputStream input(buffer, size, kBlockSizes[j]);
+          ZstdInputStream::Options options;
+          if (zstd_buffer_size != -1) {
+            options.buffer_size = zstd_buffer_size;
+          }
+          ZstdInputStream zin(&input, options);
+          ReadStuff(&zin);
+          EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+        }
+      }
+    }
+  }
+  delete[] buffer;
+}
+
+TEST_F(IoTest, ZstdIoWithFlushAndDictionary) {
+  std::string compressed;
+  ZstdOutputStream::Options options;
+  options.compression_level = 19;
+  options.checksum = true;
+  options.dictionary = "Hello world!\nSome text.  Blah blah.";
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output, options);
+    WriteStuff(&zout);
+    EXPECT_TRUE(zout.Flush());
+    EXPECT_TRUE(zout.Close());
+  }
+  ArrayInputStream input(compressed.data(), compressed.size());
+  ZstdInputStream::Options input_options;
+  input_options.dictionary = options.dictionary;
+  ZstdInputStream zin(&input, input_options);
+  ReadStuff(&zin);
+}
+
+TEST_F(IoTest, ZstdIoTruncated) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output);
+    WriteStuffLarge(&zout);
+  }
+  ArrayInputStream input(compressed.data(), compressed.size() - 1);
+  ZstdInputStream zin(&input);
+  const void* data;
+  int size;
+  while (zin.Next(&data, &size)) {
+  }
+  EXPECT_NE(zin.ZstdErrorMessage(), nullptr);
+}
+#endif  // HAVE_ZSTD
+
+#if HAVE_LZ4
+TEST_F(IoTest, Lz4Io) {
+  const int kBufferSize = 2 * 1024;
+  uint8* buffer = new uint8[kBufferSize];
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int z = 0; z < kBlockSizeCount; z++) {
+        int lz4_buffer_size = kBlockSizes[z];
+        int size;
+        {
+          ArrayOutputStream output(buffer, kBufferSize, kBlockSizes[i]);
+          Lz4OutputStream::Options options;
+          if (lz4_buffer_size != -1) {
+            options.buffer_size = lz4_buffer_size;
+          }
+          Lz4OutputStream lzout(&output, options);
+          WriteStuff(&lzout);
+          EXPECT_TRUE(lzout.Close());
+          size = output.ByteCount();
+        }
+        {
+          ArrayInputStream input(buffer, size, kBlockSizes[j]);
+          Lz4InputStream::Options options;
+          if (lz4_buffer_size != -1) {
+            options.buffer_size = lz4_buffer_size;
+          }
+          Lz4InputStream lzin(&input, options);
+          ReadStuff(&lzin);
+          EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+        }
+      }
+    }
+  }
+  delete[] buffer;
+}
+
+TEST_F(IoTest, Lz4IoWithFlushAndDictionary) {
+  std::string compressed;
+  Lz4OutputStream::Options options;
+  options.compression_level = 9;
+  options.checksum = true;
+  options.dictionary = "Hello world!\nSome text.  Blah blah.";
+  {
+    StringOutputStream output(&compressed);
+    Lz4OutputStream lzout(&output, options);
+    WriteStuff(&lzout);
+    EXPECT_TRUE(lzout.Flush());
+    EXPECT_TRUE(lzout.Close());
+  }
+  ArrayInputStream input(compressed.data(), compressed.size());
+  Lz4InputStream::Options input_options;
+  input_options.dictionary = options.dictionary;
+  Lz4InputStream lzin(&input, input_options);
+  ReadStuff(&lzin);
+}
+
+TEST_F(IoTest, Lz4IoTruncated) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    Lz4OutputStream lzout(&output);
+    WriteStuffLarge(&lzout);
+  }
+  ArrayInputStream input(compressed.data(), compressed.size() - 1);
+  Lz4InputStream lzin(&input);
+  const void* data;
+  int size;
+  while (lzin.Next(&data, &size)) {
+  }
+  EXPECT_NE(lzin.Lz4ErrorMessage(), nullptr);
+}
+#endif  // HAVE_LZ4
+
 // MSVC raises various debugging exceptions if we try to use a file
 // descriptor of -1, defeating our tests below.  This class will disable
 // these debug assertions while in scope.
@@ -1620,6 +1988,33 @@ TEST_F(IoTest, FileReadError) {
   EXPECT_EQ(EBADF, input.GetErrno());
 }
 
+TEST_F(IoTest, MappedFileReadError) {
+  MsvcDebugDisabler debug_disabler;
+
+  // -1 = invalid file descriptor.
+  MappedFileInputStream input(-1);
+  EXPECT_FALSE(input.IsMapped());
+
+  const void* buffer;
+  int size;
+  EXPECT_FALSE(input.Next(&buffer, &size));
+  EXPECT_EQ(EBADF, input.GetErrno());
+}
+
+TEST_F(IoTest, VectoredFileWriteError) {
+  MsvcDebugDisabler debug_disabler;
+
+  // -1 = invalid file descriptor.
+  VectoredFileOutputStream output(-1);
+
+  void* buffer;
+  int size;
+  EXPECT_TRUE(output.Next(&buffer, &size));
+  EXPECT_FALSE(output.Flush());
+  EXPECT_EQ(EBADF, output.GetErrno());
+  EXPECT_FALSE(output.Next(&buffer, &size));
+}
+
 // Test that FileOutputStreams report errors correctly.
 TEST_F(IoTest, FileWriteError) {
   MsvcDebugDisabler debug_disabler;
@@ -1739,6 +2134,71 @@ TEST_F(IoTest, ConcatenatingInputStream) {
   ReadStuff(&input);
 }
 
+TEST_F(IoTest, ReadAheadInputStream) {
+  std::string str;
+  {
+    StringOutputStream output(&str);
+    WriteStuffLarge(&output);
+  }
+
+  const int kBufferSizes[] = {7, 1000, 1 << 16};
+  const int kDepths[] = {2, 3, 8};
+  for (int buffer_size : kBufferSizes) {
+    for (int depth : kDepths) {
+      for (int block_size : {-1, 3, 4096}) {
+        ArrayInputStream array_input(str.data(), str.size(), block_size);
+        ReadAheadInputStream::Options options;
+        options.buffer_size = buffer_size;
+        options.depth = depth;
+        ReadAheadInputStream input(&array_input, options);
+        ReadStuffLarge(&input);
+      }
+    }
+  }
+}
+
+// A CopyingInputStream that returns a few bytes at a time, slowly.
+class SlowCopyingInputStream : public CopyingInputStream {
+ public:
+  explicit SlowCopyingInputStream(absl::string_view data) : data_(data) {}
+
+  int Read(void* buffer, int size) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    int n = std::min<int>({size, 5, static_cast<int>(data_.size())});
+    memcpy(buffer, data_.data(), n);
+    data_.remove_prefix(n);
+    return n;
+  }
+
+ private:
+  absl::string_view data_;
+};
+
+TEST_F(IoTest, ReadAheadInputStreamFromCopyingStream) {
+  std::string str;
+  {
+    StringOutputStream output(&str);
+    WriteStuff(&output);
+  }
+  SlowCopyingInputStream source(str);
+  ReadAheadInputStream input(&source);
+  ReadStuff(&input);
+}
+
+TEST_F(IoTest, ReadAheadInputStreamDestroyedEarly) {
+  std::string str(1 << 20, 'x');
+  ArrayInputStream array_input(str.data(), str.size(), 100);
+  ReadAheadInputStream::Options options;
+  options.buffer_size = 100;
+  ReadAheadInputStream input(&array_input, options);
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(100, size);
+  // The destructor stops the reader thread, which is blocked on a full set of
+  // buffers by now.
+}
+
 // To test LimitingInputStream, we write our golden text to a buffer, then
 // create an ArrayInputStream that contains the whole buffer (not just the
 // bytes written), then use a LimitingInputStream to limit it just to the
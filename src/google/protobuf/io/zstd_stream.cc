@@ -0,0 +1,285 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// This file contains the implementation of classes ZstdInputStream and
+// ZstdOutputStream.
+
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/port.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+ZstdInputStream::Options::Options()
+    : buffer_size(static_cast<int>(ZSTD_DStreamOutSize())) {}
+
+ZstdInputStream::ZstdInputStream(ZeroCopyInputStream* sub_stream)
+    : ZstdInputStream(sub_stream, Options()) {}
+
+ZstdInputStream::ZstdInputStream(ZeroCopyInputStream* sub_stream,
+                                 const Options& options)
+    : sub_stream_(sub_stream),
+      dcontext_(ZSTD_createDCtx()),
+      zerror_(0),
+      truncated_(false),
+      frame_remaining_(0),
+      output_buffer_was_full_(false),
+      input_{nullptr, 0, 0},
+      byte_count_(0) {
+  GOOGLE_CHECK(dcontext_ != nullptr);
+  if (!options.dictionary.empty()) {
+    size_t result = ZSTD_DCtx_loadDictionary(
+        dcontext_, options.dictionary.data(), options.dictionary.size());
+    if (ZSTD_isError(result)) zerror_ = result;
+  }
+  output_buffer_length_ =
+      options.buffer_size > 0 ? options.buffer_size : ZSTD_DStreamOutSize();
+  output_buffer_ = static_cast<char*>(operator new(output_buffer_length_));
+  output_position_ = output_buffer_;
+  output_end_ = output_buffer_;
+}
+
+ZstdInputStream::~ZstdInputStream() {
+  internal::SizedDelete(output_buffer_, output_buffer_length_);
+  ZSTD_freeDCtx(dcontext_);
+}
+
+const char* ZstdInputStream::ZstdErrorMessage() const {
+  if (zerror_ != 0) return ZSTD_getErrorName(zerror_);
+  if (truncated_) return "truncated zstd frame";
+  return nullptr;
+}
+
+bool ZstdInputStream::Decompress() {
+  ZSTD_outBuffer output = {output_buffer_, output_buffer_length_, 0};
+  while (output.pos == 0) {
+    // When the last call filled the output buffer zstd may still hold
+    // decompressed data, which has to be drained before reading more input.
+    if (input_.pos == input_.size && !output_buffer_was_full_) {
+      const void* in;
+      int in_size;
+      if (!sub_stream_->Next(&in, &in_size)) {
+        // A clean end of input has to fall between frames.
+        truncated_ = frame_remaining_ != 0;
+        return false;
+      }
+      input_.src = in;
+      input_.size = in_size;
+      input_.pos = 0;
+    }
+    frame_remaining_ = ZSTD_decompressStream(dcontext_, &output, &input_);
+    if (ZSTD_isError(frame_remaining_)) {
+      zerror_ = frame_remaining_;
+      return false;
+    }
+    output_buffer_was_full_ = output.pos == output.size;
+  }
+  output_position_ = output_buffer_;
+  output_end_ = output_buffer_ + output.pos;
+  return true;
+}
+
+// implements ZeroCopyInputStream ----------------------------------
+bool ZstdInputStream::Next(const void** data, int* size) {
+  if (zerror_ != 0 || truncated_) {
+    return false;
+  }
+  if (output_position_ == output_end_ && !Decompress()) {
+    return false;
+  }
+  *data = output_position_;
+  *size = static_cast<int>(output_end_ - output_position_);
+  byte_count_ += *size;
+  output_position_ = output_end_;
+  return true;
+}
+
+void ZstdInputStream::BackUp(int count) {
+  GOOGLE_CHECK_LE(count, output_position_ - output_buffer_);
+  output_position_ -= count;
+  byte_count_ -= count;
+}
+
+bool ZstdInputStream::Skip(int count) {
+  const void* data;
+  int size = 0;
+  bool ok = Next(&data, &size);
+  while (ok && (size < count)) {
+    count -= size;
+    ok = Next(&data, &size);
+  }
+  if (size > count) {
+    BackUp(size - count);
+  }
+  return ok;
+}
+
+int64_t ZstdInputStream::ByteCount() const { return byte_count_; }
+
+// =========================================================================
+
+ZstdOutputStream::Options::Options()
+    : buffer_size(static_cast<int>(ZSTD_CStreamInSize())),
+      compression_level(ZSTD_CLEVEL_DEFAULT),
+      checksum(false) {}
+
+ZstdOutputStream::ZstdOutputStream(ZeroCopyOutputStream* sub_stream) {
+  Init(sub_stream, Options());
+}
+
+ZstdOutputStream::ZstdOutputStream(ZeroCopyOutputStream* sub_stream,
+                                   const Options& options) {
+  Init(sub_stream, options);
+}
+
+void ZstdOutputStream::Init(ZeroCopyOutputStream* sub_stream,
+                            const Options& options) {
+  sub_stream_ = sub_stream;
+  output_ = {nullptr, 0, 0};
+  zerror_ = 0;
+  closed_ = false;
+  input_pending_ = 0;
+  byte_count_ = 0;
+
+  input_buffer_length_ =
+      options.buffer_size > 0 ? options.buffer_size : ZSTD_CStreamInSize();
+  input_buffer_ = static_cast<char*>(operator new(input_buffer_length_));
+
+  ccontext_ = ZSTD_createCCtx();
+  GOOGLE_CHECK(ccontext_ != nullptr);
+  size_t result = ZSTD_CCtx_setParameter(ccontext_, ZSTD_c_compressionLevel,
+                                         options.compression_level);
+  if (!ZSTD_isError(result)) {
+    result = ZSTD_CCtx_setParameter(ccontext_, ZSTD_c_checksumFlag,
+                                    options.checksum ? 1 : 0);
+  }
+  if (!ZSTD_isError(result) && !options.dictionary.empty()) {
+    result = ZSTD_CCtx_loadDictionary(ccontext_, options.dictionary.data(),
+                                      options.dictionary.size());
+  }
+  if (ZSTD_isError(result)) zerror_ = result;
+}
+
+ZstdOutputStream::~ZstdOutputStream() {
+  Close();
+  ZSTD_freeCCtx(ccontext_);
+  internal::SizedDelete(input_buffer_, input_buffer_length_);
+}
+
+const char* ZstdOutputStream::ZstdErrorMessage() const {
+  return zerror_ != 0 ? ZSTD_getErrorName(zerror_) : nullptr;
+}
+
+// private
+bool ZstdOutputStream::Compress(ZSTD_EndDirective mode) {
+  ZSTD_inBuffer input = {input_buffer_, input_pending_, 0};
+  bool done;
+  do {
+    if (output_.dst == nullptr || output_.pos == output_.size) {
+      void* data;
+      int size;
+      if (!sub_stream_->Next(&data, &size)) {
+        output_ = {nullptr, 0, 0};
+        return false;
+      }
+      GOOGLE_CHECK_GT(size, 0);
+      output_ = {data, static_cast<size_t>(size), 0};
+    }
+    size_t remaining = ZSTD_compressStream2(ccontext_, &output_, &input, mode);
+    if (ZSTD_isError(remaining)) {
+      zerror_ = remaining;
+      return false;
+    }
+    // ZSTD_e_continue is done once all input has been consumed; flushing
+    // and ending are done once zstd has nothing left in its internal buffers.
+    done = mode == ZSTD_e_continue ? input.pos == input.size : remaining == 0;
+  } while (!done);
+  byte_count_ += input_pending_;
+  input_pending_ = 0;
+  if (mode != ZSTD_e_continue) {
+    // Notify lower layer of data.
+    sub_stream_->BackUp(static_cast<int>(output_.size - output_.pos));
+    // We don't own the buffer anymore.
+    output_ = {nullptr, 0, 0};
+  }
+  return true;
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool ZstdOutputStream::Next(void** data, int* size) {
+  if (zerror_ != 0 || closed_) {
+    return false;
+  }
+  if (input_pending_ != 0 && !Compress(ZSTD_e_continue)) {
+    return false;
+  }
+  input_pending_ = input_buffer_length_;
+  *data = input_buffer_;
+  *size = static_cast<int>(input_buffer_length_);
+  return true;
+}
+
+void ZstdOutputStream::BackUp(int count) {
+  GOOGLE_CHECK_GE(input_pending_, static_cast<size_t>(count));
+  input_pending_ -= count;
+}
+
+int64_t ZstdOutputStream::ByteCount() const {
+  return byte_count_ + input_pending_;
+}
+
+bool ZstdOutputStream::Flush() {
+  if (zerror_ != 0 || closed_) {
+    return false;
+  }
+  return Compress(ZSTD_e_flush);
+}
+
+bool ZstdOutputStream::Close() {
+  if (closed_) {
+    return false;
+  }
+  closed_ = true;
+  return zerror_ == 0 && Compress(ZSTD_e_end);
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // HAVE_ZSTD
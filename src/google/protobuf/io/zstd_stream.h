@@ -0,0 +1,216 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// This file contains the definition for classes ZstdInputStream and
+// ZstdOutputStream.
+//
+// ZstdInputStream decompresses a sequence of zstd frames read from an
+// underlying ZeroCopyInputStream and provides the decompressed data as a
+// ZeroCopyInputStream.
+//
+// ZstdOutputStream is a ZeroCopyOutputStream that compresses data to an
+// underlying ZeroCopyOutputStream as a single zstd frame.
+//
+// Both classes are only available when protobuf is built with zstd support
+// (HAVE_ZSTD, see the protobuf_WITH_ZSTD CMake option).
+
+#ifndef GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
+
+#include <string>
+
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/port.h"
+#include "zstd.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A ZeroCopyInputStream that reads compressed data through zstd.
+class PROTOBUF_EXPORT ZstdInputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // Size of the buffer handed out by Next().  Defaults to
+    // ZSTD_DStreamOutSize() (128kB), which lets zstd decompress a full block
+    // at a time.  Larger buffers mean fewer, larger chunks for consumers such
+    // as CodedInputStream.
+    int buffer_size;
+
+    // Raw content or zstd-format dictionary the data was compressed with.
+    // Empty means no dictionary.  The contents are copied by the stream.
+    std::string dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a ZstdInputStream with default options.
+  explicit ZstdInputStream(ZeroCopyInputStream* sub_stream);
+
+  // Create a ZstdInputStream with the given options.
+  ZstdInputStream(ZeroCopyInputStream* sub_stream, const Options& options);
+  ZstdInputStream(const ZstdInputStream&) = delete;
+  ZstdInputStream& operator=(const ZstdInputStream&) = delete;
+  ~ZstdInputStream() override;
+
+  // Return last error message or nullptr if no error.
+  const char* ZstdErrorMessage() const;
+  // Return the last zstd error code, or 0 if no error.  See ZSTD_isError().
+  size_t ZstdErrorCode() const { return zerror_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyInputStream* sub_stream_;
+
+  ZSTD_DCtx* dcontext_;
+  size_t zerror_;
+  // Set when the underlying stream ended in the middle of a frame.
+  bool truncated_;
+  // Result of the last ZSTD_decompressStream() call; 0 between frames.
+  size_t frame_remaining_;
+  // Whether the last ZSTD_decompressStream() call filled output_buffer_.
+  bool output_buffer_was_full_;
+  ZSTD_inBuffer input_;
+
+  char* output_buffer_;
+  size_t output_buffer_length_;
+  // [output_position_, output_end_) holds decompressed bytes which have not
+  // been returned by Next() yet.
+  char* output_position_;
+  char* output_end_;
+  int64_t byte_count_;
+
+  // Decompress more data into output_buffer_.  Returns false at the end of
+  // the input or on error.
+  bool Decompress();
+};
+
+// A ZeroCopyOutputStream that writes compressed data through zstd.
+class PROTOBUF_EXPORT ZstdOutputStream PROTOBUF_FUTURE_FINAL
+    : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to ZSTD_CStreamInSize()
+    // (128kB).
+    int buffer_size;
+
+    // Compression level, between ZSTD_minCLevel() (negative levels trade
+    // ratio for speed) and ZSTD_maxCLevel().  Defaults to
+    // ZSTD_CLEVEL_DEFAULT (see zstd.h).
+    int compression_level;
+
+    // Whether to append a checksum of the uncompressed data to the frame.
+    // Defaults to false.
+    bool checksum;
+
+    // Raw content or zstd-format dictionary to compress with.  Readers must
+    // be given the same dictionary.  Empty means no dictionary.  The
+    // contents are copied by the stream.
+    std::string dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a ZstdOutputStream with default options.
+  explicit ZstdOutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create a ZstdOutputStream with the given options.
+  ZstdOutputStream(ZeroCopyOutputStream* sub_stream, const Options& options);
+  ZstdOutputStream(const ZstdOutputStream&) = delete;
+  ZstdOutputStream& operator=(const ZstdOutputStream&) = delete;
+
+  ~ZstdOutputStream() override;
+
+  // Return last error message or nullptr if no error.
+  const char* ZstdErrorMessage() const;
+  // Return the last zstd error code, or 0 if no error.  See ZSTD_isError().
+  size_t ZstdErrorCode() const { return zerror_; }
+
+  // Flushes data written so far to compressed data in the underlying stream.
+  // The flushed data forms complete zstd blocks which a reader can decompress
+  // without waiting for the end of the frame.
+  // It is the caller's responsibility to flush the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Flush();
+
+  // Writes out all data and ends the zstd frame.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyOutputStream* sub_stream_;
+  // Result from calling Next() on sub_stream_, and how much of it has been
+  // filled with compressed data.
+  ZSTD_outBuffer output_;
+
+  ZSTD_CCtx* ccontext_;
+  size_t zerror_;
+  bool closed_;
+
+  char* input_buffer_;
+  size_t input_buffer_length_;
+  // Number of bytes at the front of input_buffer_ which have been written by
+  // the caller but not compressed yet.
+  size_t input_pending_;
+  int64_t byte_count_;
+
+  // Shared constructor code.
+  void Init(ZeroCopyOutputStream* sub_stream, const Options& options);
+
+  // Feeds the pending input to zstd with the given end directive and writes
+  // the output to sub_stream_.  Returns false on error.
+  bool Compress(ZSTD_EndDirective mode);
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
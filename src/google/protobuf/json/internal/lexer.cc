@@ -53,6 +53,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/stubs/status_macros.h"
+#include "utf8_validity.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -397,6 +398,15 @@ static char ParseSimpleEscape(char c, bool allow_legacy_syntax) {
   }
 }
 
+namespace {
+// Returns true for bytes that stand for themselves inside of a string in any
+// mode: everything but quotes, backslashes and control characters.
+bool IsOrdinaryStringByte(char c) {
+  uint8_t uc = static_cast<uint8_t>(c);
+  return uc >= 0x20 && uc != 0xff && c != '"' && c != '\'' && c != '\\';
+}
+}  // namespace
+
 absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
   RETURN_IF_ERROR(SkipToToken());
   // This is a non-standard extension accepted by the ESF parser that we will
@@ -415,6 +425,23 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
 
+    // Fast path: take the run of ordinary characters that is already
+    // buffered, and validate it with utf8_range in a single call.  Whatever
+    // stops the run (quotes, escapes, control characters, and UTF-8 sequences
+    // that are split across chunks or that utf8_range rejects) is handled one
+    // character at a time below.
+    absl::string_view unread = stream_.Unread();
+    size_t run = 0;
+    while (run < unread.size() && IsOrdinaryStringByte(unread[run])) ++run;
+    run = utf8_range::SpanStructurallyValid(unread.substr(0, run));
+    if (run > 0) {
+      if (!on_heap.empty()) {
+        on_heap.append(unread.data(), run);
+      }
+      RETURN_IF_ERROR(Advance(run));
+      continue;
+    }
+
     char c = stream_.PeekChar();
     RETURN_IF_ERROR(Advance(1));
     switch (c) {
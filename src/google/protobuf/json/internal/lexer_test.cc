@@ -614,6 +614,28 @@ TEST(LexerTest, RejectNonUtf8String) {
 
 TEST(LexerTest, RejectNonUtf8Prefix) { Bad("\xff{}"); }
 
+TEST(LexerTest, MultiByteStringAcrossChunks) {
+  // Multi-byte characters end up split at every position by Do(), and the
+  // escapes force the string onto the heap part of the way through.
+  absl::string_view json = R"json(
+    ["施氏食獅史 🐈‍⬛ naïve", "施氏\t食獅史 🐈‍⬛ na\u00efve"]
+  )json";
+  Do(json, [](io::ZeroCopyInputStream* stream) {
+    EXPECT_THAT(Value::Parse(stream),
+                IsOkAndHolds(ValueIs<Value::Array>(ElementsAre(
+                    ValueIs<std::string>("施氏食獅史 🐈‍⬛ naïve"),
+                    ValueIs<std::string>("施氏\t食獅史 🐈‍⬛ naïve")))));
+  });
+}
+
+TEST(LexerTest, RejectTruncatedUtf8) {
+  absl::string_view json = R"json(
+    ["施氏食獅史x"]
+  )json";
+  // A lead byte followed by a character that is not a continuation byte.
+  Bad(absl::StrReplaceAll(json, {{"x", "\xe6\x96"}}));
+}
+
 TEST(LexerTest, SurrogateEscape) {
   absl::string_view json = R"json(
     [ "\ud83d\udc08\u200D\u2b1B\ud83d\uDdA4" ]
@@ -1308,8 +1308,7 @@ absl::Status JsonStringToMessage(absl::string_view input, Message* message,
   return s;
 }
 
-absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
-                                const std::string& type_url,
+absl::Status JsonToBinaryStream(ResolverPool* pool, const std::string& type_url,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 json_internal::ParseOptions options) {
@@ -1349,8 +1348,7 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
     Msg<ParseProto3Type> msg(tee_output.has_value() ? &*tee_output
                                                     : binary_output);
 
-    ResolverPool pool(resolver);
-    auto desc = pool.FindMessage(type_url);
+    auto desc = pool->FindMessage(type_url);
     RETURN_IF_ERROR(desc.status());
 
     s = ParseMessage<ParseProto3Type>(lex, **desc, msg, /*any_reparse=*/false);
@@ -1370,6 +1368,16 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
   PROTOBUF_DLOG(INFO) << "json2/output: " << absl::BytesToHexString(out);
   return s;
 }
+
+absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* json_input,
+                                io::ZeroCopyOutputStream* binary_output,
+                                json_internal::ParseOptions options) {
+  ResolverPool pool(resolver);
+  return JsonToBinaryStream(&pool, type_url, json_input, binary_output,
+                            options);
+}
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
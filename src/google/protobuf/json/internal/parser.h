@@ -41,6 +41,8 @@
 namespace google {
 namespace protobuf {
 namespace json_internal {
+class ResolverPool;
+
 // Internal version of google::protobuf::util::JsonStringToMessage; see json_util.h for
 // details.
 absl::Status JsonStringToMessage(absl::string_view input, Message* message,
@@ -52,6 +54,12 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 json_internal::ParseOptions options);
+// Like the above, but looks types up in `pool`, which may be shared with other
+// conversions.
+absl::Status JsonToBinaryStream(ResolverPool* pool, const std::string& type_url,
+                                io::ZeroCopyInputStream* json_input,
+                                io::ZeroCopyOutputStream* binary_output,
+                                json_internal::ParseOptions options);
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -815,8 +815,7 @@ absl::Status MessageToJsonString(const Message& message, std::string* output,
   return absl::OkStatus();
 }
 
-absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
-                                const std::string& type_url,
+absl::Status BinaryToJsonStream(ResolverPool* pool, const std::string& type_url,
                                 io::ZeroCopyInputStream* binary_input,
                                 io::ZeroCopyOutputStream* json_output,
                                 json_internal::WriterOptions options) {
@@ -846,8 +845,7 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
 
   PROTOBUF_DLOG(INFO) << "json2/input: " << absl::BytesToHexString(copy);
 
-  ResolverPool pool(resolver);
-  auto desc = pool.FindMessage(type_url);
+  auto desc = pool->FindMessage(type_url);
   RETURN_IF_ERROR(desc.status());
 
   io::CodedInputStream stream(tee_input.has_value() ? &*tee_input
@@ -874,6 +872,16 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
   writer.NewLine();
   return absl::OkStatus();
 }
+
+absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                json_internal::WriterOptions options) {
+  ResolverPool pool(resolver);
+  return BinaryToJsonStream(&pool, type_url, binary_input, json_output,
+                            options);
+}
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -41,6 +41,8 @@
 namespace google {
 namespace protobuf {
 namespace json_internal {
+class ResolverPool;
+
 // Internal version of google::protobuf::util::MessageToJsonString; see json_util.h for
 // details.
 absl::Status MessageToJsonString(const Message& message, std::string* output,
@@ -52,6 +54,12 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* binary_input,
                                 io::ZeroCopyOutputStream* json_output,
                                 json_internal::WriterOptions options);
+// Like the above, but looks types up in `pool`, which may be shared with other
+// conversions.
+absl::Status BinaryToJsonStream(ResolverPool* pool, const std::string& type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                json_internal::WriterOptions options);
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -31,6 +31,7 @@
 #include "google/protobuf/json/internal/untyped_message.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
 #include <cstdint>
 #include <memory>
@@ -44,11 +45,13 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/message.h"
+#include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
@@ -73,35 +76,42 @@ absl::StatusOr<const ResolverPool::Message*> ResolverPool::Field::MessageType()
   GOOGLE_CHECK(proto().kind() == google::protobuf::Field::TYPE_MESSAGE ||
         proto().kind() == google::protobuf::Field::TYPE_GROUP)
       << proto().kind();
-  if (type_ == nullptr) {
-    auto type = pool_->FindMessage(proto().type_url());
-    RETURN_IF_ERROR(type.status());
-    type_ = *type;
+  const void* type = type_.load(std::memory_order_acquire);
+  if (type == nullptr) {
+    auto found = pool_->FindMessage(proto().type_url());
+    RETURN_IF_ERROR(found.status());
+    type = *found;
+    type_.store(type, std::memory_order_release);
   }
-  return reinterpret_cast<const Message*>(type_);
+  return reinterpret_cast<const Message*>(type);
 }
 
 absl::StatusOr<const ResolverPool::Enum*> ResolverPool::Field::EnumType()
     const {
   GOOGLE_CHECK(proto().kind() == google::protobuf::Field::TYPE_ENUM) << proto().kind();
-  if (type_ == nullptr) {
-    auto type = pool_->FindEnum(proto().type_url());
-    RETURN_IF_ERROR(type.status());
-    type_ = *type;
+  const void* type = type_.load(std::memory_order_acquire);
+  if (type == nullptr) {
+    auto found = pool_->FindEnum(proto().type_url());
+    RETURN_IF_ERROR(found.status());
+    type = *found;
+    type_.store(type, std::memory_order_release);
   }
-  return reinterpret_cast<const Enum*>(type_);
+  return reinterpret_cast<const Enum*>(type);
 }
 
 absl::Span<const ResolverPool::Field> ResolverPool::Message::FieldsByIndex()
     const {
-  if (raw_.fields_size() > 0 && fields_ == nullptr) {
+  absl::call_once(fields_once_, [this] {
+    if (raw_.fields_size() == 0) {
+      return;
+    }
     fields_ = std::unique_ptr<Field[]>(new Field[raw_.fields_size()]);
     for (size_t i = 0; i < raw_.fields_size(); ++i) {
       fields_[i].pool_ = pool_;
       fields_[i].raw_ = &raw_.fields(i);
       fields_[i].parent_ = this;
     }
-  }
+  });
 
   return absl::MakeSpan(fields_.get(), proto().fields_size());
 }
@@ -112,17 +122,12 @@ const ResolverPool::Field* ResolverPool::Message::FindField(
     return nullptr;
   }
 
-  if (fields_by_name_.empty()) {
-    const Field* found = nullptr;
+  absl::call_once(fields_by_name_once_, [this] {
     for (auto& field : FieldsByIndex()) {
-      if (field.proto().name() == name || field.proto().json_name() == name) {
-        found = &field;
-      }
       fields_by_name_.try_emplace(field.proto().name(), &field);
       fields_by_name_.try_emplace(field.proto().json_name(), &field);
     }
-    return found;
-  }
+  });
 
   auto it = fields_by_name_.find(name);
   return it == fields_by_name_.end() ? nullptr : it->second;
@@ -134,50 +139,62 @@ const ResolverPool::Field* ResolverPool::Message::FindField(
     return nullptr;
   }
 
-  bool is_small = raw_.fields_size() < 8;
-  if (is_small || fields_by_number_.empty()) {
-    const Field* found = nullptr;
+  if (raw_.fields_size() < 8) {
     for (auto& field : FieldsByIndex()) {
       if (field.proto().number() == number) {
-        found = &field;
-      }
-      if (!is_small) {
-        fields_by_number_.try_emplace(field.proto().number(), &field);
+        return &field;
       }
     }
-    return found;
+    return nullptr;
   }
 
+  absl::call_once(fields_by_number_once_, [this] {
+    for (auto& field : FieldsByIndex()) {
+      fields_by_number_.try_emplace(field.proto().number(), &field);
+    }
+  });
+
   auto it = fields_by_number_.find(number);
   return it == fields_by_number_.end() ? nullptr : it->second;
 }
 
 absl::StatusOr<const ResolverPool::Message*> ResolverPool::FindMessage(
     absl::string_view url) {
-  auto it = messages_.find(url);
-  if (it != messages_.end()) {
-    return it->second.get();
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = messages_.find(url);
+    if (it != messages_.end()) {
+      return it->second.get();
+    }
   }
 
+  // The resolver is called without the lock held, so that a slow lookup does
+  // not block lookups of types that are already cached.  If another thread
+  // resolves the same type meanwhile, its entry wins and ours is dropped.
   auto msg = absl::WrapUnique(new Message(this));
   std::string url_buf(url);
   RETURN_IF_ERROR(resolver_->ResolveMessageType(url_buf, &msg->raw_));
 
+  absl::MutexLock lock(&mu_);
   return messages_.try_emplace(std::move(url_buf), std::move(msg))
       .first->second.get();
 }
 
 absl::StatusOr<const ResolverPool::Enum*> ResolverPool::FindEnum(
     absl::string_view url) {
-  auto it = enums_.find(url);
-  if (it != enums_.end()) {
-    return it->second.get();
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = enums_.find(url);
+    if (it != enums_.end()) {
+      return it->second.get();
+    }
   }
 
   auto enoom = absl::WrapUnique(new Enum(this));
   std::string url_buf(url);
   RETURN_IF_ERROR(resolver_->ResolveEnumType(url_buf, &enoom->raw_));
 
+  absl::MutexLock lock(&mu_);
   return enums_.try_emplace(std::move(url_buf), std::move(enoom))
       .first->second.get();
 }
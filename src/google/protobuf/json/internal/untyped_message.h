@@ -31,6 +31,7 @@
 #ifndef GOOGLE_PROTOBUF_UITL_UNTYPED_MESSAGE_H__
 #define GOOGLE_PROTOBUF_UITL_UNTYPED_MESSAGE_H__
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -42,10 +43,13 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/message.h"
+#include "absl/base/call_once.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
@@ -75,7 +79,10 @@ struct SizeVisitor {
 
 // A DescriptorPool-like type for caching lookups from a TypeResolver.
 //
-// This type and all of its nested types are thread-hostile.
+// This type and all of its nested types are thread-safe: a single pool may be
+// shared by concurrent conversions, in which case each type is resolved and
+// indexed only once.  The returned Message, Enum and Field objects live as
+// long as the pool.
 class ResolverPool {
  public:
   class Message;
@@ -99,7 +106,7 @@ class ResolverPool {
     ResolverPool* pool_ = nullptr;
     const google::protobuf::Field* raw_ = nullptr;
     const Message* parent_ = nullptr;
-    mutable const void* type_ = nullptr;
+    mutable std::atomic<const void*> type_{nullptr};
   };
 
   class Message {
@@ -121,9 +128,13 @@ class ResolverPool {
 
     ResolverPool* pool_;
     google::protobuf::Type raw_;
+    // Each index is built on first use.
+    mutable absl::once_flag fields_once_;
     mutable std::unique_ptr<Field[]> fields_;
+    mutable absl::once_flag fields_by_name_once_;
     mutable absl::flat_hash_map<absl::string_view, const Field*>
         fields_by_name_;
+    mutable absl::once_flag fields_by_number_once_;
     mutable absl::flat_hash_map<int32_t, const Field*> fields_by_number_;
   };
 
@@ -155,9 +166,14 @@ class ResolverPool {
   absl::StatusOr<const Message*> FindMessage(absl::string_view url);
   absl::StatusOr<const Enum*> FindEnum(absl::string_view url);
 
+  google::protobuf::util::TypeResolver* resolver() const { return resolver_; }
+
  private:
-  absl::flat_hash_map<std::string, std::unique_ptr<Message>> messages_;
-  absl::flat_hash_map<std::string, std::unique_ptr<Enum>> enums_;
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, std::unique_ptr<Message>> messages_
+      ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, std::unique_ptr<Enum>> enums_
+      ABSL_GUARDED_BY(mu_);
   google::protobuf::util::TypeResolver* resolver_;
 };
 
@@ -37,6 +37,7 @@
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/parser.h"
 #include "google/protobuf/json/internal/unparser.h"
+#include "google/protobuf/json/internal/untyped_message.h"
 #include "google/protobuf/util/type_resolver.h"
 #include "google/protobuf/stubs/status_macros.h"
 
@@ -46,12 +47,9 @@
 namespace google {
 namespace protobuf {
 namespace json {
-
-absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
-                                const std::string& type_url,
-                                io::ZeroCopyInputStream* binary_input,
-                                io::ZeroCopyOutputStream* json_output,
-                                const PrintOptions& options) {
+namespace {
+google::protobuf::json_internal::WriterOptions ToWriterOptions(
+    const PrintOptions& options) {
   google::protobuf::json_internal::WriterOptions opts;
   opts.add_whitespace = options.add_whitespace;
   opts.preserve_proto_field_names = options.preserve_proto_field_names;
@@ -60,9 +58,37 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
 
   // TODO(b/234868512): Drop this setting.
   opts.allow_legacy_syntax = true;
+  return opts;
+}
+
+google::protobuf::json_internal::ParseOptions ToParseOptions(
+    const ParseOptions& options) {
+  google::protobuf::json_internal::ParseOptions opts;
+  opts.ignore_unknown_fields = options.ignore_unknown_fields;
+  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+
+  // TODO(b/234868512): Drop this setting.
+  opts.allow_legacy_syntax = true;
+  return opts;
+}
+}  // namespace
 
+ResolverCache::ResolverCache(google::protobuf::util::TypeResolver* resolver)
+    : pool_(new google::protobuf::json_internal::ResolverPool(resolver)) {}
+
+ResolverCache::~ResolverCache() = default;
+
+google::protobuf::util::TypeResolver* ResolverCache::resolver() const {
+  return pool_->resolver();
+}
+
+absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                const PrintOptions& options) {
   return google::protobuf::json_internal::BinaryToJsonStream(
-      resolver, type_url, binary_input, json_output, opts);
+      resolver, type_url, binary_input, json_output, ToWriterOptions(options));
 }
 
 absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* resolver,
@@ -81,15 +107,8 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 const ParseOptions& options) {
-  google::protobuf::json_internal::ParseOptions opts;
-  opts.ignore_unknown_fields = options.ignore_unknown_fields;
-  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
-
-  // TODO(b/234868512): Drop this setting.
-  opts.allow_legacy_syntax = true;
-
   return google::protobuf::json_internal::JsonToBinaryStream(
-      resolver, type_url, json_input, binary_output, opts);
+      resolver, type_url, json_input, binary_output, ToParseOptions(options));
 }
 
 absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* resolver,
@@ -103,30 +122,58 @@ absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* resolver,
                             options);
 }
 
-absl::Status MessageToJsonString(const Message& message, std::string* output,
-                                 const PrintOptions& options) {
-  google::protobuf::json_internal::WriterOptions opts;
-  opts.add_whitespace = options.add_whitespace;
-  opts.preserve_proto_field_names = options.preserve_proto_field_names;
-  opts.always_print_enums_as_ints = options.always_print_enums_as_ints;
-  opts.always_print_primitive_fields = options.always_print_primitive_fields;
+absl::Status BinaryToJsonStream(ResolverCache* cache,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                const PrintOptions& options) {
+  return google::protobuf::json_internal::BinaryToJsonStream(
+      cache->pool(), type_url, binary_input, json_output,
+      ToWriterOptions(options));
+}
 
-  // TODO(b/234868512): Drop this setting.
-  opts.allow_legacy_syntax = true;
+absl::Status BinaryToJsonString(ResolverCache* cache,
+                                const std::string& type_url,
+                                const std::string& binary_input,
+                                std::string* json_output,
+                                const PrintOptions& options) {
+  io::ArrayInputStream input_stream(binary_input.data(), binary_input.size());
+  io::StringOutputStream output_stream(json_output);
+  return BinaryToJsonStream(cache, type_url, &input_stream, &output_stream,
+                            options);
+}
 
-  return google::protobuf::json_internal::MessageToJsonString(message, output, opts);
+absl::Status JsonToBinaryStream(ResolverCache* cache,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* json_input,
+                                io::ZeroCopyOutputStream* binary_output,
+                                const ParseOptions& options) {
+  return google::protobuf::json_internal::JsonToBinaryStream(
+      cache->pool(), type_url, json_input, binary_output,
+      ToParseOptions(options));
 }
 
-absl::Status JsonStringToMessage(absl::string_view input, Message* message,
-                                 const ParseOptions& options) {
-  google::protobuf::json_internal::ParseOptions opts;
-  opts.ignore_unknown_fields = options.ignore_unknown_fields;
-  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+absl::Status JsonToBinaryString(ResolverCache* cache,
+                                const std::string& type_url,
+                                absl::string_view json_input,
+                                std::string* binary_output,
+                                const ParseOptions& options) {
+  io::ArrayInputStream input_stream(json_input.data(), json_input.size());
+  io::StringOutputStream output_stream(binary_output);
+  return JsonToBinaryStream(cache, type_url, &input_stream, &output_stream,
+                            options);
+}
 
-  // TODO(b/234868512): Drop this setting.
-  opts.allow_legacy_syntax = true;
+absl::Status MessageToJsonString(const Message& message, std::string* output,
+                                 const PrintOptions& options) {
+  return google::protobuf::json_internal::MessageToJsonString(message, output,
+                                                    ToWriterOptions(options));
+}
 
-  return google::protobuf::json_internal::JsonStringToMessage(input, message, opts);
+absl::Status JsonStringToMessage(absl::string_view input, Message* message,
+                                 const ParseOptions& options) {
+  return google::protobuf::json_internal::JsonStringToMessage(input, message,
+                                                    ToParseOptions(options));
 }
 }  // namespace json
 }  // namespace protobuf
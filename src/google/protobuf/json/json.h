@@ -33,6 +33,7 @@
 #ifndef GOOGLE_PROTOBUF_JSON_JSON_H__
 #define GOOGLE_PROTOBUF_JSON_JSON_H__
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
@@ -45,6 +46,9 @@
 
 namespace google {
 namespace protobuf {
+namespace json_internal {
+class ResolverPool;
+}  // namespace json_internal
 namespace json {
 struct ParseOptions {
   // Whether to ignore unknown JSON fields during parsing
@@ -113,6 +117,35 @@ inline absl::Status JsonStringToMessage(absl::string_view input,
   return JsonStringToMessage(input, message, ParseOptions());
 }
 
+// A long-lived cache of the types looked up through a TypeResolver, for
+// converting many messages between binary and JSON.
+//
+// The conversion functions that take a TypeResolver resolve every type they
+// meet afresh on each call.  Those that take a ResolverCache instead resolve
+// each type URL only once over the lifetime of the cache, and keep the field
+// indexes built for it, which pays off when the same types are converted over
+// and over.  The cache never forgets a type, so it should only be used with a
+// resolver whose answers do not change.
+//
+// ResolverCache is thread-safe: one instance may be shared by conversions
+// running concurrently on several threads.
+class PROTOBUF_EXPORT ResolverCache final {
+ public:
+  // Does not take ownership of `resolver`, which must outlive the cache.
+  explicit ResolverCache(google::protobuf::util::TypeResolver* resolver);
+  ResolverCache(const ResolverCache&) = delete;
+  ResolverCache& operator=(const ResolverCache&) = delete;
+  ~ResolverCache();
+
+  google::protobuf::util::TypeResolver* resolver() const;
+
+  // For use by the conversion functions below.
+  json_internal::ResolverPool* pool() const { return pool_.get(); }
+
+ private:
+  std::unique_ptr<json_internal::ResolverPool> pool_;
+};
+
 // Converts protobuf binary data to JSON.
 // The conversion will fail if:
 //   1. TypeResolver fails to resolve a type.
@@ -148,6 +181,34 @@ inline absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* res
                             PrintOptions());
 }
 
+// Like the above, but looks types up in `cache`.
+PROTOBUF_EXPORT absl::Status BinaryToJsonStream(
+    ResolverCache* cache, const std::string& type_url,
+    io::ZeroCopyInputStream* binary_input,
+    io::ZeroCopyOutputStream* json_output, const PrintOptions& options);
+
+inline absl::Status BinaryToJsonStream(ResolverCache* cache,
+                                       const std::string& type_url,
+                                       io::ZeroCopyInputStream* binary_input,
+                                       io::ZeroCopyOutputStream* json_output) {
+  return BinaryToJsonStream(cache, type_url, binary_input, json_output,
+                            PrintOptions());
+}
+
+PROTOBUF_EXPORT absl::Status BinaryToJsonString(ResolverCache* cache,
+                                                const std::string& type_url,
+                                                const std::string& binary_input,
+                                                std::string* json_output,
+                                                const PrintOptions& options);
+
+inline absl::Status BinaryToJsonString(ResolverCache* cache,
+                                       const std::string& type_url,
+                                       const std::string& binary_input,
+                                       std::string* json_output) {
+  return BinaryToJsonString(cache, type_url, binary_input, json_output,
+                            PrintOptions());
+}
+
 // Converts JSON data to protobuf binary format.
 // The conversion will fail if:
 //   1. TypeResolver fails to resolve a type.
@@ -181,6 +242,34 @@ inline absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* res
   return JsonToBinaryString(resolver, type_url, json_input, binary_output,
                             ParseOptions());
 }
+
+// Like the above, but looks types up in `cache`.
+PROTOBUF_EXPORT absl::Status JsonToBinaryStream(
+    ResolverCache* cache, const std::string& type_url,
+    io::ZeroCopyInputStream* json_input,
+    io::ZeroCopyOutputStream* binary_output, const ParseOptions& options);
+
+inline absl::Status JsonToBinaryStream(
+    ResolverCache* cache, const std::string& type_url,
+    io::ZeroCopyInputStream* json_input,
+    io::ZeroCopyOutputStream* binary_output) {
+  return JsonToBinaryStream(cache, type_url, json_input, binary_output,
+                            ParseOptions());
+}
+
+PROTOBUF_EXPORT absl::Status JsonToBinaryString(ResolverCache* cache,
+                                                const std::string& type_url,
+                                                absl::string_view json_input,
+                                                std::string* binary_output,
+                                                const ParseOptions& options);
+
+inline absl::Status JsonToBinaryString(ResolverCache* cache,
+                                       const std::string& type_url,
+                                       absl::string_view json_input,
+                                       std::string* binary_output) {
+  return JsonToBinaryString(cache, type_url, json_input, binary_output,
+                            ParseOptions());
+}
 }  // namespace json
 }  // namespace protobuf
 }  // namespace google
@@ -31,10 +31,12 @@
 #include "google/protobuf/json/json.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "google/protobuf/duration.pb.h"
@@ -105,6 +107,7 @@ MATCHER_P(StatusIs, status,
 enum class Codec {
   kReflective,
   kResolver,
+  kResolverCache,
 };
 
 class JsonTest : public testing::TestWithParam<Codec> {
@@ -122,10 +125,15 @@ class JsonTest : public testing::TestWithParam<Codec> {
     std::string result;
     io::StringOutputStream out(&result);
 
-    RETURN_IF_ERROR(BinaryToJsonStream(
-        resolver_.get(),
-        absl::StrCat("type.googleapis.com/", proto.GetTypeName()), &in, &out,
-        options));
+    std::string type_url =
+        absl::StrCat("type.googleapis.com/", proto.GetTypeName());
+    if (GetParam() == Codec::kResolverCache) {
+      RETURN_IF_ERROR(
+          BinaryToJsonStream(&cache_, type_url, &in, &out, options));
+    } else {
+      RETURN_IF_ERROR(
+          BinaryToJsonStream(resolver_.get(), type_url, &in, &out, options));
+    }
     return result;
   }
 
@@ -141,10 +149,15 @@ class JsonTest : public testing::TestWithParam<Codec> {
     std::string result;
     io::StringOutputStream out(&result);
 
-    RETURN_IF_ERROR(JsonToBinaryStream(
-        resolver_.get(),
-        absl::StrCat("type.googleapis.com/", proto.GetTypeName()), &in, &out,
-        options));
+    std::string type_url =
+        absl::StrCat("type.googleapis.com/", proto.GetTypeName());
+    if (GetParam() == Codec::kResolverCache) {
+      RETURN_IF_ERROR(
+          JsonToBinaryStream(&cache_, type_url, &in, &out, options));
+    } else {
+      RETURN_IF_ERROR(
+          JsonToBinaryStream(resolver_.get(), type_url, &in, &out, options));
+    }
 
     if (!proto.ParseFromString(result)) {
       return absl::InternalError("wire format parse failed");
@@ -163,10 +176,12 @@ class JsonTest : public testing::TestWithParam<Codec> {
   std::unique_ptr<TypeResolver> resolver_{
       google::protobuf::util::NewTypeResolverForDescriptorPool(
           "type.googleapis.com", DescriptorPool::generated_pool())};
+  ResolverCache cache_{resolver_.get()};
 };
 
 INSTANTIATE_TEST_SUITE_P(JsonTestSuite, JsonTest,
-                         testing::Values(Codec::kReflective, Codec::kResolver));
+                         testing::Values(Codec::kReflective, Codec::kResolver,
+                                         Codec::kResolverCache));
 
 TEST_P(JsonTest, TestWhitespaces) {
   TestMessage m;
@@ -1016,7 +1031,7 @@ TEST_P(JsonTest, TestParsingEnumIgnoreCase) {
 }
 
 TEST_P(JsonTest, Extensions) {
-  if (GetParam() == Codec::kResolver) {
+  if (GetParam() != Codec::kReflective) {
     GTEST_SKIP();
   }
 
@@ -1311,6 +1326,138 @@ TEST_P(JsonTest, ClearPreExistingRepeatedInJsonValues) {
   EXPECT_THAT(s.fields(), IsEmpty());
 }
 
+// Counts the types resolved through the underlying resolver.
+class CountingResolver : public TypeResolver {
+ public:
+  explicit CountingResolver(TypeResolver* resolver) : resolver_(resolver) {}
+
+  absl::Status ResolveMessageType(const std::string& type_url,
+                                  google::protobuf::Type* type) override {
+    ++message_lookups_;
+    return resolver_->ResolveMessageType(type_url, type);
+  }
+  absl::Status ResolveEnumType(const std::string& type_url,
+                               google::protobuf::Enum* enum_type) override {
+    ++enum_lookups_;
+    return resolver_->ResolveEnumType(type_url, enum_type);
+  }
+
+  int message_lookups() const { return message_lookups_; }
+  int enum_lookups() const { return enum_lookups_; }
+
+ private:
+  TypeResolver* resolver_;
+  std::atomic<int> message_lookups_{0};
+  std::atomic<int> enum_lookups_{0};
+};
+
+TEST(ResolverCacheTest, ResolvesEachTypeOnce) {
+  std::unique_ptr<TypeResolver> resolver(
+      google::protobuf::util::NewTypeResolverForDescriptorPool(
+          "type.googleapis.com", DescriptorPool::generated_pool()));
+  CountingResolver counting(resolver.get());
+  ResolverCache cache(&counting);
+  EXPECT_EQ(cache.resolver(), &counting);
+
+  TestMessage m;
+  m.set_int32_value(5);
+  m.set_enum_value(proto3::BAR);
+  m.mutable_message_value()->set_value(7);
+  const std::string binary = m.SerializeAsString();
+  const std::string type_url = "type.googleapis.com/proto3.TestMessage";
+
+  std::string first;
+  ASSERT_OK(BinaryToJsonString(&cache, type_url, binary, &first, {}));
+  int message_lookups = counting.message_lookups();
+  int enum_lookups = counting.enum_lookups();
+  EXPECT_EQ(message_lookups, 2);
+  EXPECT_EQ(enum_lookups, 1);
+
+  for (int i = 0; i < 3; ++i) {
+    std::string json;
+    ASSERT_OK(BinaryToJsonString(&cache, type_url, binary, &json));
+    EXPECT_EQ(json, first);
+
+    std::string round_trip;
+    ASSERT_OK(JsonToBinaryString(&cache, type_url, json, &round_trip));
+    TestMessage parsed;
+    ASSERT_TRUE(parsed.ParseFromString(round_trip));
+    EXPECT_EQ(parsed.int32_value(), 5);
+    EXPECT_EQ(parsed.enum_value(), proto3::BAR);
+    EXPECT_EQ(parsed.message_value().value(), 7);
+  }
+  EXPECT_EQ(counting.message_lookups(), message_lookups);
+  EXPECT_EQ(counting.enum_lookups(), enum_lookups);
+
+  // A failed lookup is not cached.
+  std::string json;
+  EXPECT_THAT(
+      BinaryToJsonString(&cache, "type.googleapis.com/proto3.NoSuchType",
+                         binary, &json, {}),
+      Not(StatusIs(absl::StatusCode::kOk)));
+  EXPECT_THAT(
+      BinaryToJsonString(&cache, "type.googleapis.com/proto3.NoSuchType",
+                         binary, &json, {}),
+      Not(StatusIs(absl::StatusCode::kOk)));
+  EXPECT_EQ(counting.message_lookups(), message_lookups + 2);
+}
+
+TEST(ResolverCacheTest, SharedAcrossThreads) {
+  std::unique_ptr<TypeResolver> resolver(
+      google::protobuf::util::NewTypeResolverForDescriptorPool(
+          "type.googleapis.com", DescriptorPool::generated_pool()));
+  CountingResolver counting(resolver.get());
+  ResolverCache cache(&counting);
+
+  TestMessage m;
+  m.set_string_value("hello");
+  m.add_repeated_int32_value(1);
+  m.add_repeated_int32_value(2);
+  m.mutable_message_value()->set_value(3);
+  m.add_repeated_enum_value(proto3::FOO);
+  const std::string binary = m.SerializeAsString();
+  const std::string type_url = "type.googleapis.com/proto3.TestMessage";
+  const std::string expected =
+      R"({"stringValue":"hello","messageValue":{"value":3},)"
+      R"("repeatedInt32Value":[1,2],"repeatedEnumValue":["FOO"]})";
+
+  std::vector<std::thread> threads;
+  std::atomic<int> failures{0};
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 50; ++i) {
+        std::string json;
+        std::string round_trip;
+        TestMessage parsed;
+        if (!BinaryToJsonString(&cache, type_url, binary, &json, {}).ok() ||
+            json != expected ||
+            !JsonToBinaryString(&cache, type_url, json, &round_trip, {})
+                 .ok() ||
+            !parsed.ParseFromString(round_trip) ||
+            parsed.SerializeAsString() != binary) {
+          ++failures;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(failures, 0);
+
+  // Threads that miss the cache at the same time may each call the resolver,
+  // but once the types are cached the resolver is not called again.
+  int message_lookups = counting.message_lookups();
+  int enum_lookups = counting.enum_lookups();
+  EXPECT_GE(message_lookups, 2);
+  EXPECT_GE(enum_lookups, 1);
+  std::string json;
+  ASSERT_OK(BinaryToJsonString(&cache, type_url, binary, &json));
+  EXPECT_EQ(json, expected);
+  EXPECT_EQ(counting.message_lookups(), message_lookups);
+  EXPECT_EQ(counting.enum_lookups(), enum_lookups);
+}
+
 }  // namespace
 }  // namespace json
 }  // namespace protobuf
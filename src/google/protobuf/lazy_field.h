@@ -0,0 +1,178 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// This file is internal to the protocol buffer library; it is included by
+// generated code for messages with [lazy = true] or [unverified_lazy = true]
+// submessage fields and should not be used directly.
+
+#ifndef GOOGLE_PROTOBUF_LAZY_FIELD_H__
+#define GOOGLE_PROTOBUF_LAZY_FIELD_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "google/protobuf/arena.h"
+#include "google/protobuf/message_lite.h"
+#include "absl/strings/cord.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/parse_context.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+#ifdef SWIG
+#error "You cannot SWIG proto headers"
+#endif
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Whether the bytes of a lazy field are checked when the enclosing message is
+// parsed.  [lazy = true] fields are verified eagerly: malformed bytes or a
+// recursion limit violation fail the enclosing parse.  [unverified_lazy = true]
+// fields are not, and such errors only surface on first access.
+enum class LazyVerifyOption {
+  kLazy,
+  kEager,
+};
+
+// LazyField is the storage for a singular submessage field that is parsed on
+// demand.  When the enclosing message is parsed, the wire bytes of the
+// submessage are kept unparsed; the first access through GetByPrototype() or
+// MutableByPrototype() parses them into a message object.  As long as the
+// field is only read, the original bytes stay authoritative and serializing
+// the enclosing message copies them verbatim.  Eagerly verified fields parse
+// the bytes up front into the message object, which the first access then
+// returns, but still serialize the bytes verbatim.
+//
+// LazyField does not know the type of the message it holds, so every call
+// that may need to create one takes the default instance of that type as a
+// prototype.  Like the other field representations, it does not release the
+// memory it owns on destruction: Destroy() must be called when the enclosing
+// message is not on an arena.
+//
+// A LazyField is in one of three states:
+//   - cleared: the field is not set.  message_ may hold a cleared object that
+//     is reused by the next MutableByPrototype().
+//   - bytes: unparsed_ holds the serialized submessage.  message_ is either
+//     null or a faithful parse of unparsed_.
+//   - message: message_ holds the value and unparsed_ is empty.
+//
+// Const accessors may be called concurrently; the parse on first access is
+// published with a compare-and-swap, so racing readers agree on one object.
+class PROTOBUF_EXPORT LazyField {
+ public:
+  constexpr LazyField() {}
+  LazyField(const LazyField&) = delete;
+  LazyField& operator=(const LazyField&) = delete;
+
+  // Frees the message object, if any.  Must only be called when the enclosing
+  // message is not on an arena.
+  void Destroy();
+
+  bool IsCleared() const { return state_ == kCleared; }
+  void Clear();
+
+  // Returns the submessage, parsing the unparsed bytes on first access.  New
+  // objects are allocated on `arena`.  Returns `prototype` if the field is not
+  // set.
+  const MessageLite& GetByPrototype(const MessageLite& prototype,
+                                    Arena* arena) const;
+  // Returns a mutable submessage.  The unparsed bytes, if any, are dropped
+  // after they have been parsed.
+  MessageLite* MutableByPrototype(const MessageLite& prototype, Arena* arena);
+  // Clears the field and returns the heap-allocated submessage it held, or
+  // nullptr if there is none.
+  MessageLite* ReleaseByPrototype(const MessageLite& prototype, Arena* arena);
+  // Like ReleaseByPrototype(), but does not copy a submessage that lives on
+  // `arena`.
+  MessageLite* UnsafeArenaReleaseByPrototype(const MessageLite& prototype,
+                                             Arena* arena);
+  // Takes ownership of `message`, which must live on `arena` (or on the heap
+  // if `arena` is null).  A null `message` clears the field.
+  void UnsafeArenaSetAllocated(MessageLite* message, Arena* arena);
+
+  void MergeFrom(const MessageLite& prototype, const LazyField& other,
+                 Arena* arena);
+
+  // Swaps two fields that live on the same arena.
+  void InternalSwap(LazyField* other);
+  // Swaps two fields that may live on different arenas.  Any message objects
+  // are serialized first so that no object changes arenas.
+  static void Swap(LazyField* lhs, Arena* lhs_arena, LazyField* rhs,
+                   Arena* rhs_arena);
+
+  // Size of the submessage payload, without tag and length prefix.  For a
+  // field holding a message object this also updates its cached size.
+  size_t ByteSizeLong() const;
+  // Writes the field, including tag and length prefix.  Requires a preceding
+  // call to ByteSizeLong().
+  uint8_t* InternalWrite(int number, uint8_t* target,
+                         io::EpsCopyOutputStream* stream) const;
+  // Parses a length-delimited submessage at `ptr`, which points just past the
+  // tag.  Repeated occurrences are merged, as for any other message field.
+  // With LazyVerifyOption::kEager the bytes are also parsed into a message
+  // object on `arena` right away, honoring the recursion limit of `ctx`, and
+  // the parse fails if they are malformed.  The object is kept, so the first
+  // access does not parse the bytes again.
+  const char* _InternalParse(const MessageLite& prototype, Arena* arena,
+                             LazyVerifyOption option, const char* ptr,
+                             ParseContext* ctx);
+
+  size_t SpaceUsedExcludingSelfLong() const;
+
+ private:
+  enum State : uint8_t { kCleared, kBytes, kMessage };
+
+  MessageLite* message() const {
+    return message_.load(std::memory_order_acquire);
+  }
+  // Forgets the current message object, freeing it if it is on the heap.
+  void DropMessage(Arena* arena);
+  // Moves the field to the message state, parsing the bytes if needed.
+  MessageLite* EnsureMessage(const MessageLite& prototype, Arena* arena);
+  // Moves the field to the bytes (or cleared) state, serializing the message
+  // object if needed, and drops the message object.
+  void EnsureBytes(Arena* arena);
+
+  absl::Cord unparsed_;
+  mutable std::atomic<MessageLite*> message_{nullptr};
+  State state_ = kCleared;
+};
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_LAZY_FIELD_H__
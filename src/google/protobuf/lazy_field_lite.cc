@@ -28,18 +28,19 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include <limits>
-#include <memory>
+#include "google/protobuf/lazy_field.h"
+
+#include <string>
 #include <utility>
 
-#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/generated_message_util.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
-#include "google/protobuf/lazy_field.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "absl/strings/string_view.h"
 
 // Must be included last.
-// clang-format off
 #include "google/protobuf/port_def.inc"
-// clang-format on
 
 namespace google {
 namespace protobuf {
@@ -47,99 +48,255 @@ namespace internal {
 
 namespace {
 
-// Returns the initial depth for a local context.
-// --The default depth for lazily verified LazyField.
-// --Eagerly verified LazyField has no limit (max int).
-inline int GetInitDepth(LazyVerifyOption option) {
-  return option == LazyVerifyOption::kLazy
-             ? io::CodedInputStream::GetDefaultRecursionLimit()
-             : std::numeric_limits<int>::max();
-}  // namespace
+bool MergePartialFromCord(const absl::Cord& cord, MessageLite* message) {
+  io::CordInputStream input(&cord);
+  return message->MergePartialFromBoundedZeroCopyStream(
+      &input, static_cast<int>(cord.size()));
+}
 
-template <typename T>
-inline bool ParseWithOuterContextImpl(const T& input, LazyVerifyOption option,
-                                      ParseContext* ctx, MessageLite* message) {
-  GOOGLE_DCHECK(ctx == nullptr || !ctx->AliasingEnabled());
+// [unverified_lazy] fields are not checked when the enclosing message is
+// parsed, so a malformed submessage is only noticed on first access.  Like a
+// failed eager parse, the fields decoded so far are kept.
+void LogParseError(const MessageLite& message) {
+  GOOGLE_LOG(WARNING) << "Lazy parsing failed for " << message.GetTypeName();
+}
 
-  // Create local context with depth.
+// Merges `bytes` into `message` as if they had been parsed as a submessage
+// at the current position of `ctx`, i.e. one level deeper.
+bool MergeVerified(absl::string_view bytes, MessageLite* message,
+                   const ParseContext& ctx) {
+  if (ctx.depth() <= 0) return false;
   const char* ptr;
-  ParseContext local_ctx =
-      ctx != nullptr ? ctx->Spawn(&ptr, input)
-                     : ParseContext(GetInitDepth(option), false, &ptr, input);
-
-  if (ctx == nullptr ||
-      ctx->lazy_parse_mode() == ParseContext::LazyParseMode::kEagerVerify) {
-    // Unparsed data is already verified at parsing. Disable eager-verification.
-    (void)local_ctx.set_lazy_parse_mode(ParseContext::LazyParseMode::kLazy);
-  }
+  ParseContext nested(ctx.depth() - 1, false, &ptr, bytes);
+  nested.data() = ctx.data();
+  ptr = message->_InternalParse(ptr, &nested);
+  return ptr != nullptr && nested.EndedAtLimit();
+}
 
-  ptr = message->_InternalParse(ptr, &local_ctx);
+}  // namespace
 
-  if (ctx != nullptr && local_ctx.missing_required_fields()) {
-    ctx->SetMissingRequiredFields();
-  }
+void LazyField::Destroy() { delete message(); }
 
-  return ptr != nullptr &&
-         (local_ctx.EndedAtEndOfStream() || local_ctx.EndedAtLimit());
+void LazyField::Clear() {
+  unparsed_.Clear();
+  if (MessageLite* m = message()) m->Clear();
+  state_ = kCleared;
 }
 
-}  // namespace
-
-namespace {
-class ByPrototype {
- public:
-  explicit ByPrototype(const MessageLite* prototype) : prototype_(prototype) {}
+void LazyField::DropMessage(Arena* arena) {
+  MessageLite* m = message();
+  if (m == nullptr) return;
+  if (arena == nullptr) delete m;
+  message_.store(nullptr, std::memory_order_relaxed);
+}
 
-  MessageLite* New(Arena* arena) const { return prototype_->New(arena); }
+const MessageLite& LazyField::GetByPrototype(const MessageLite& prototype,
+                                             Arena* arena) const {
+  if (state_ == kCleared) return prototype;
+  MessageLite* m = message();
+  if (m != nullptr) return *m;
 
-  const MessageLite& Default() const { return *prototype_; }
+  GOOGLE_DCHECK_EQ(state_, kBytes);
+  MessageLite* parsed = prototype.New(arena);
+  if (!MergePartialFromCord(unparsed_, parsed)) LogParseError(*parsed);
+  if (!message_.compare_exchange_strong(m, parsed, std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+    // Another reader published its parse first.
+    if (arena == nullptr) delete parsed;
+    return *m;
+  }
+  return *parsed;
+}
 
- private:
-  const MessageLite* prototype_;
-};
-}  // namespace
+MessageLite* LazyField::EnsureMessage(const MessageLite& prototype,
+                                      Arena* arena) {
+  MessageLite* m = message();
+  switch (state_) {
+    case kCleared:
+      if (m == nullptr) {
+        m = prototype.New(arena);
+        message_.store(m, std::memory_order_relaxed);
+      }
+      break;
+    case kBytes:
+      if (m == nullptr) {
+        m = prototype.New(arena);
+        if (!MergePartialFromCord(unparsed_, m)) LogParseError(*m);
+        message_.store(m, std::memory_order_relaxed);
+      }
+      unparsed_.Clear();
+      break;
+    case kMessage:
+      break;
+  }
+  state_ = kMessage;
+  return m;
+}
 
-const MessageLite& LazyField::GetByPrototype(const MessageLite& prototype,
-                                             Arena* arena,
-                                             LazyVerifyOption option,
-                                             ParseContext* ctx) const {
-  return GetGeneric(ByPrototype(&prototype), arena, option, ctx);
+void LazyField::EnsureBytes(Arena* arena) {
+  if (state_ == kMessage) {
+    io::CordOutputStream output;
+    message()->SerializePartialToZeroCopyStream(&output);
+    unparsed_ = output.Consume();
+    state_ = kBytes;
+  }
+  DropMessage(arena);
 }
 
 MessageLite* LazyField::MutableByPrototype(const MessageLite& prototype,
-                                           Arena* arena,
-                                           LazyVerifyOption option,
-                                           ParseContext* ctx) {
-  return MutableGeneric(ByPrototype(&prototype), arena, option, ctx);
+                                           Arena* arena) {
+  return EnsureMessage(prototype, arena);
 }
 
 MessageLite* LazyField::ReleaseByPrototype(const MessageLite& prototype,
-                                           Arena* arena,
-                                           LazyVerifyOption option) {
-  return ReleaseGeneric(ByPrototype(&prototype), arena, option);
+                                           Arena* arena) {
+  MessageLite* released = UnsafeArenaReleaseByPrototype(prototype, arena);
+#ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
+  MessageLite* old = released;
+  released = DuplicateIfNonNull(released);
+  if (arena == nullptr) delete old;
+#else   // PROTOBUF_FORCE_COPY_IN_RELEASE
+  if (arena != nullptr) released = DuplicateIfNonNull(released);
+#endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
+  return released;
 }
 
 MessageLite* LazyField::UnsafeArenaReleaseByPrototype(
-    const MessageLite& prototype, Arena* arena, LazyVerifyOption option) {
-  return UnsafeArenaReleaseGeneric(ByPrototype(&prototype), arena, option);
+    const MessageLite& prototype, Arena* arena) {
+  MessageLite* released =
+      state_ == kCleared ? message() : EnsureMessage(prototype, arena);
+  message_.store(nullptr, std::memory_order_relaxed);
+  state_ = kCleared;
+  return released;
+}
+
+void LazyField::UnsafeArenaSetAllocated(MessageLite* message, Arena* arena) {
+  DropMessage(arena);
+  unparsed_.Clear();
+  message_.store(message, std::memory_order_relaxed);
+  state_ = message != nullptr ? kMessage : kCleared;
+}
+
+void LazyField::MergeFrom(const MessageLite& prototype, const LazyField& other,
+                          Arena* arena) {
+  GOOGLE_DCHECK_NE(this, &other);
+  if (other.state_ == kCleared) return;
+  switch (state_) {
+    case kCleared:
+      if (other.state_ == kBytes) {
+        // A retained cleared object is not a parse of the new bytes.
+        DropMessage(arena);
+        unparsed_ = other.unparsed_;
+        state_ = kBytes;
+        return;
+      }
+      break;
+    case kBytes:
+      // Concatenating two encodings merges them, so stay unparsed.
+      DropMessage(arena);
+      if (other.state_ == kBytes) {
+        unparsed_.Append(other.unparsed_);
+      } else {
+        io::CordOutputStream output(std::move(unparsed_));
+        other.message()->SerializePartialToZeroCopyStream(&output);
+        unparsed_ = output.Consume();
+      }
+      return;
+    case kMessage:
+      break;
+  }
+
+  MessageLite* m = EnsureMessage(prototype, arena);
+  if (other.state_ == kBytes) {
+    if (!MergePartialFromCord(other.unparsed_, m)) LogParseError(*m);
+  } else {
+    m->CheckTypeAndMergeFrom(*other.message());
+  }
+}
+
+void LazyField::InternalSwap(LazyField* other) {
+  unparsed_.swap(other->unparsed_);
+  MessageLite* m = message();
+  message_.store(other->message(), std::memory_order_relaxed);
+  other->message_.store(m, std::memory_order_relaxed);
+  std::swap(state_, other->state_);
 }
 
-bool LazyField::ParseWithOuterContext(MessageLite* message,
-                                      LazyVerifyOption option,
-                                      ParseContext* ctx) const {
-  absl::optional<absl::string_view> flat = unparsed_.TryFlat();
-  if (flat.has_value()) {
-    return ParseWithOuterContextImpl(*flat, option, ctx, message);
+void LazyField::Swap(LazyField* lhs, Arena* lhs_arena, LazyField* rhs,
+                     Arena* rhs_arena) {
+  if (lhs_arena != rhs_arena) {
+    lhs->EnsureBytes(lhs_arena);
+    rhs->EnsureBytes(rhs_arena);
   }
+  lhs->InternalSwap(rhs);
+}
+
+size_t LazyField::ByteSizeLong() const {
+  switch (state_) {
+    case kCleared:
+      return 0;
+    case kBytes:
+      return unparsed_.size();
+    case kMessage:
+      return message()->ByteSizeLong();
+  }
+  return 0;
+}
 
-  io::CordInputStream input(unparsed_);
-  return ParseWithOuterContextImpl(&input, option, ctx, message);
+uint8_t* LazyField::InternalWrite(int number, uint8_t* target,
+                                  io::EpsCopyOutputStream* stream) const {
+  if (state_ == kMessage) {
+    const MessageLite* m = message();
+    return WireFormatLite::InternalWriteMessage(number, *m, m->GetCachedSize(),
+                                                target, stream);
+  }
+  // Untouched submessages are written back byte for byte.
+  target = stream->EnsureSpace(target);
+  target = WireFormatLite::WriteTagToArray(
+      number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, target);
+  target = io::CodedOutputStream::WriteVarint32ToArray(
+      static_cast<uint32_t>(unparsed_.size()), target);
+  for (absl::string_view chunk : unparsed_.Chunks()) {
+    target =
+        stream->WriteRaw(chunk.data(), static_cast<int>(chunk.size()), target);
+  }
+  return target;
 }
 
-void LazyField::LogParseError(const MessageLite* message) {
-  GOOGLE_LOG_EVERY_N(INFO, 100) << "Lazy parsing failed for " << message->GetTypeName()
-                         << " error=" << message->InitializationErrorString()
-                         << " (N = " << COUNTER << ")";
+const char* LazyField::_InternalParse(const MessageLite& prototype,
+                                      Arena* arena, LazyVerifyOption option,
+                                      const char* ptr, ParseContext* ctx) {
+  if (state_ == kMessage) return ctx->ParseMessage(message(), ptr);
+
+  int size = ReadSize(&ptr);
+  if (ptr == nullptr) return nullptr;
+  std::string bytes;
+  ptr = ctx->ReadString(ptr, size, &bytes);
+  if (ptr == nullptr) return nullptr;
+
+  if (option == LazyVerifyOption::kEager) {
+    // Verifying the bytes takes a full parse, so parse them into the field's
+    // message object on `arena`, which then serves the first access.  The
+    // object stays a faithful parse of all the bytes: ones merged in from
+    // another field have no object yet, so they are parsed into it first.
+    MessageLite* m = message();
+    if (m == nullptr) {
+      m = prototype.New(arena);
+      if (state_ == kBytes && !MergePartialFromCord(unparsed_, m)) {
+        LogParseError(*m);
+      }
+      message_.store(m, std::memory_order_relaxed);
+    }
+    bool verified = MergeVerified(bytes, m, *ctx);
+    unparsed_.Append(std::move(bytes));
+    state_ = kBytes;
+    return verified ? ptr : nullptr;
+  }
+  // Any message object no longer reflects the accumulated bytes.
+  DropMessage(arena);
+  unparsed_.Append(std::move(bytes));
+  state_ = kBytes;
+  return ptr;
 }
 
 }  // namespace internal
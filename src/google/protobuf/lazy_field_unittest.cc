@@ -0,0 +1,238 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/lazy_field.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllTypes;
+
+// optional_lazy_message (field 27, tag 0xDA 0x01) holding a NestedMessage
+// whose bb field is encoded twice: first 1, then 2.  The canonical encoding
+// of the same value is "\x08\x02".
+constexpr absl::string_view kNonCanonical("\xDA\x01\x04\x08\x01\x08\x02", 7);
+constexpr absl::string_view kCanonical("\xDA\x01\x02\x08\x02", 5);
+
+TEST(LazyFieldTest, UntouchedFieldIsSerializedVerbatim) {
+  TestAllTypes message;
+  ASSERT_TRUE(message.ParseFromString(kNonCanonical));
+  EXPECT_EQ(message.SerializeAsString(), kNonCanonical);
+  EXPECT_EQ(message.ByteSizeLong(), kNonCanonical.size());
+
+  // Reading the field parses it but leaves the original bytes in charge.
+  EXPECT_TRUE(message.has_optional_lazy_message());
+  EXPECT_EQ(message.optional_lazy_message().bb(), 2);
+  EXPECT_EQ(message.SerializeAsString(), kNonCanonical);
+
+  // Mutable access makes the parsed message authoritative.
+  message.mutable_optional_lazy_message();
+  EXPECT_EQ(message.SerializeAsString(), kCanonical);
+}
+
+TEST(LazyFieldTest, RepeatedOccurrencesAreMerged) {
+  TestAllTypes payload1;
+  payload1.set_optional_int32(1);
+  TestAllTypes payload2;
+  payload2.set_optional_int64(2);
+  NestedTestAllTypes part1;
+  *part1.mutable_lazy_child()->mutable_payload() = payload1;
+  NestedTestAllTypes part2;
+  *part2.mutable_lazy_child()->mutable_payload() = payload2;
+
+  NestedTestAllTypes message;
+  ASSERT_TRUE(message.ParseFromString(part1.SerializeAsString() +
+                                      part2.SerializeAsString()));
+  EXPECT_EQ(message.lazy_child().payload().optional_int32(), 1);
+  EXPECT_EQ(message.lazy_child().payload().optional_int64(), 2);
+
+  // A further occurrence after mutable access merges into the message.
+  message.mutable_lazy_child()->mutable_payload()->set_optional_int32(3);
+  TestAllTypes payload3;
+  payload3.set_optional_string("x");
+  NestedTestAllTypes part3;
+  *part3.mutable_lazy_child()->mutable_payload() = payload3;
+  ASSERT_TRUE(message.MergeFromString(part3.SerializeAsString()));
+  EXPECT_EQ(message.lazy_child().payload().optional_int32(), 3);
+  EXPECT_EQ(message.lazy_child().payload().optional_int64(), 2);
+  EXPECT_EQ(message.lazy_child().payload().optional_string(), "x");
+}
+
+TEST(LazyFieldTest, MalformedBytesFailEagerParse) {
+  // optional_lazy_message holding a truncated varint.  [lazy] fields are
+  // verified while the enclosing message is parsed.
+  constexpr absl::string_view kMalformed("\xDA\x01\x02\x08\xFF", 5);
+  TestAllTypes message;
+  EXPECT_FALSE(message.ParseFromString(kMalformed));
+}
+
+TEST(LazyFieldTest, EagerParseKeepsVerifiedMessage) {
+  // Verifying a [lazy] field parses it into a message on the arena, which the
+  // first access returns as is; the bytes are still written back verbatim.
+  Arena arena;
+  TestAllTypes* message = Arena::CreateMessage<TestAllTypes>(&arena);
+  ASSERT_TRUE(message->ParseFromString(kNonCanonical));
+  size_t space_used = message->SpaceUsedLong();
+  const TestAllTypes::NestedMessage& lazy = message->optional_lazy_message();
+  EXPECT_EQ(lazy.GetArena(), &arena);
+  EXPECT_EQ(lazy.bb(), 2);
+  EXPECT_EQ(message->SpaceUsedLong(), space_used);
+  EXPECT_EQ(&message->optional_lazy_message(), &lazy);
+  EXPECT_EQ(message->SerializeAsString(), kNonCanonical);
+}
+
+TEST(LazyFieldTest, MalformedBytesFailOnAccess) {
+  // Same as above for optional_unverified_lazy_message (field 28).  Such
+  // fields are not verified during parsing, so the error only surfaces when
+  // the field is read, and the bytes are still passed through unchanged.
+  constexpr absl::string_view kMalformed("\xE2\x01\x02\x08\xFF", 5);
+  TestAllTypes message;
+  ASSERT_TRUE(message.ParseFromString(kMalformed));
+  EXPECT_TRUE(message.has_optional_unverified_lazy_message());
+  message.optional_unverified_lazy_message();
+  EXPECT_EQ(message.SerializeAsString(), kMalformed);
+}
+
+TEST(LazyFieldTest, CopyMergeAndClear) {
+  TestAllTypes source;
+  ASSERT_TRUE(source.ParseFromString(kNonCanonical));
+
+  TestAllTypes copy(source);
+  EXPECT_EQ(copy.SerializeAsString(), kNonCanonical);
+  EXPECT_EQ(copy.optional_lazy_message().bb(), 2);
+
+  TestAllTypes merged;
+  merged.mutable_optional_lazy_message()->set_bb(5);
+  merged.MergeFrom(source);
+  EXPECT_EQ(merged.optional_lazy_message().bb(), 2);
+
+  TestAllTypes unparsed;
+  ASSERT_TRUE(unparsed.ParseFromString(kNonCanonical));
+  unparsed.MergeFrom(source);
+  EXPECT_EQ(unparsed.optional_lazy_message().bb(), 2);
+  EXPECT_EQ(unparsed.SerializeAsString().size(),
+            3 + 2 * (kNonCanonical.size() - 3));
+
+  copy.clear_optional_lazy_message();
+  EXPECT_FALSE(copy.has_optional_lazy_message());
+  EXPECT_FALSE(copy.optional_lazy_message().has_bb());
+  EXPECT_EQ(copy.SerializeAsString(), "");
+}
+
+TEST(LazyFieldTest, ReleaseAndSetAllocated) {
+  TestAllTypes message;
+  ASSERT_TRUE(message.ParseFromString(kNonCanonical));
+  std::unique_ptr<TestAllTypes::NestedMessage> released(
+      message.release_optional_lazy_message());
+  ASSERT_NE(released, nullptr);
+  EXPECT_EQ(released->bb(), 2);
+  EXPECT_FALSE(message.has_optional_lazy_message());
+
+  message.set_allocated_optional_lazy_message(released.release());
+  EXPECT_TRUE(message.has_optional_lazy_message());
+  EXPECT_EQ(message.SerializeAsString(), kCanonical);
+
+  message.set_allocated_optional_lazy_message(nullptr);
+  EXPECT_FALSE(message.has_optional_lazy_message());
+}
+
+TEST(LazyFieldTest, ArenaSwapAndRelease) {
+  Arena arena;
+  auto* on_arena = Arena::CreateMessage<TestAllTypes>(&arena);
+  ASSERT_TRUE(on_arena->ParseFromString(kNonCanonical));
+  EXPECT_EQ(on_arena->optional_lazy_message().bb(), 2);
+
+  TestAllTypes on_heap;
+  on_heap.mutable_optional_lazy_message()->set_bb(7);
+  on_arena->Swap(&on_heap);
+  EXPECT_EQ(on_arena->optional_lazy_message().bb(), 7);
+  EXPECT_EQ(on_heap.optional_lazy_message().bb(), 2);
+
+  std::unique_ptr<TestAllTypes::NestedMessage> released(
+      on_arena->release_optional_lazy_message());
+  ASSERT_NE(released, nullptr);
+  EXPECT_EQ(released->bb(), 7);
+}
+
+TEST(LazyFieldTest, Reflection) {
+  TestAllTypes message;
+  ASSERT_TRUE(message.ParseFromString(kNonCanonical));
+  const Reflection* reflection = message.GetReflection();
+  const FieldDescriptor* field =
+      TestAllTypes::descriptor()->FindFieldByName("optional_lazy_message");
+
+  EXPECT_TRUE(reflection->HasField(message, field));
+  const Message& sub = reflection->GetMessage(message, field);
+  EXPECT_EQ(&sub, &message.optional_lazy_message());
+  EXPECT_EQ(message.SerializeAsString(), kNonCanonical);
+
+  reflection->MutableMessage(&message, field);
+  EXPECT_EQ(message.SerializeAsString(), kCanonical);
+
+  std::unique_ptr<Message> released(
+      reflection->ReleaseMessage(&message, field));
+  EXPECT_FALSE(reflection->HasField(message, field));
+  reflection->SetAllocatedMessage(&message, released.release(), field);
+  EXPECT_EQ(message.optional_lazy_message().bb(), 2);
+
+  reflection->ClearField(&message, field);
+  EXPECT_FALSE(reflection->HasField(message, field));
+  EXPECT_GT(message.SpaceUsedLong(), 0);
+}
+
+TEST(LazyFieldTest, ImplicitPresence) {
+  proto3_unittest::TestAllTypes message;
+  EXPECT_FALSE(message.has_optional_lazy_message());
+  ASSERT_TRUE(message.ParseFromString(kCanonical));
+  EXPECT_TRUE(message.has_optional_lazy_message());
+  EXPECT_EQ(message.optional_lazy_message().bb(), 2);
+  EXPECT_EQ(message.SerializeAsString(), kCanonical);
+
+  message.clear_optional_lazy_message();
+  EXPECT_FALSE(message.has_optional_lazy_message());
+  EXPECT_EQ(message.SerializeAsString(), "");
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -39,6 +39,7 @@
 
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
@@ -99,6 +100,9 @@ class DynamicMapField;
 
 class GeneratedMessageReflection;
 
+template <typename MapT>
+class MapSorterBase;
+
 // re-implement std::allocator to use arena allocator for memory allocation.
 // Used for Map implementation. Users should not use this class
 // directly.
@@ -275,6 +279,13 @@ struct NodeBase {
   alignas(int64_t) alignas(double) alignas(void*) NodeBase* next;
 };
 
+// An element of the cached key order of a map (see KeyMapBase): the first slot
+// holds the capacity of the array, and the others point to the elements.
+union SortedMapSlot {
+  size_t capacity;
+  const void* element;
+};
+
 inline NodeBase* EraseFromLinkedList(NodeBase* item, NodeBase* head) {
   if (head == item) {
     return head->next;
@@ -435,7 +446,8 @@ class KeyMapBase {
         seed_(0),
         index_of_first_non_null_(internal::kGlobalEmptyTableSize),
         table_(const_cast<TableEntryPtr*>(internal::kGlobalEmptyTable)),
-        alloc_(arena) {}
+        alloc_(arena),
+        sorted_(0) {}
 
   KeyMapBase(const KeyMapBase&) = delete;
   KeyMapBase& operator=(const KeyMapBase&) = delete;
@@ -532,6 +544,10 @@ class KeyMapBase {
     std::swap(index_of_first_non_null_, other->index_of_first_non_null_);
     std::swap(table_, other->table_);
     std::swap(alloc_, other->alloc_);
+    uintptr_t sorted = sorted_.load(std::memory_order_relaxed);
+    sorted_.store(other->sorted_.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+    other->sorted_.store(sorted, std::memory_order_relaxed);
   }
 
   hasher hash_function() const { return {}; }
@@ -542,8 +558,91 @@ class KeyMapBase {
   size_type size() const { return num_elements_; }
   bool empty() const { return size() == 0; }
 
+  // Deterministic serialization visits the elements in key order (see
+  // MapSorterBase).  The map caches that order until the next insertion or
+  // erasure, so that serializing an unchanged map again needs neither an
+  // allocation nor a sort.  The cache is shared by concurrent readers: one of
+  // them claims it and fills it in while the others sort on their own.
+
+  // Returns the elements in key order, or nullptr if the cache is stale.
+  const SortedMapSlot* CachedSortedElements() const {
+    uintptr_t sorted = sorted_.load(std::memory_order_acquire);
+    if ((sorted & kSortedStateMask) != kSortedValid) return nullptr;
+    return reinterpret_cast<const SortedMapSlot*>(sorted & ~kSortedStateMask) +
+           1;
+  }
+
+  // Claims the stale cache and returns room for size() elements, which the
+  // caller fills in key order before calling PublishSortedElements().
+  // Returns nullptr if another reader holds the claim or the cache is valid.
+  SortedMapSlot* ClaimSortedElements() const {
+    uintptr_t sorted = sorted_.load(std::memory_order_relaxed);
+    if ((sorted & kSortedStateMask) != kSortedStale ||
+        !sorted_.compare_exchange_strong(sorted, sorted | kSortedBuilding,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    auto* slots = reinterpret_cast<SortedMapSlot*>(sorted);
+    if (slots == nullptr || slots[0].capacity < num_elements_) {
+      // Grow geometrically: on an arena the old array cannot be freed.
+      size_type capacity = num_elements_;
+      if (slots != nullptr) {
+        capacity = (std::max)(capacity, 2 * slots[0].capacity);
+        // alloc_ itself is not modified.
+        const_cast<KeyMapBase*>(this)->template Dealloc<SortedMapSlot>(
+            slots, slots[0].capacity + 1);
+      }
+      slots = const_cast<KeyMapBase*>(this)->template Alloc<SortedMapSlot>(
+          capacity + 1);
+      slots[0].capacity = capacity;
+      sorted_.store(reinterpret_cast<uintptr_t>(slots) | kSortedBuilding,
+                    std::memory_order_relaxed);
+    }
+    return slots + 1;
+  }
+
+  void PublishSortedElements() const {
+    uintptr_t sorted = sorted_.load(std::memory_order_relaxed);
+    GOOGLE_DCHECK_EQ(sorted & kSortedStateMask, kSortedBuilding);
+    sorted_.store((sorted & ~kSortedStateMask) | kSortedValid,
+                  std::memory_order_release);
+  }
+
  protected:
+  enum : uintptr_t {
+    kSortedStale = 0,
+    kSortedBuilding = 1,
+    kSortedValid = 2,
+    kSortedStateMask = 3,
+  };
+
+  // Called on every insertion and erasure.  Mutation is never concurrent with
+  // readers, so there is no claim to respect here.
+  void InvalidateSortedElements() {
+    uintptr_t sorted = sorted_.load(std::memory_order_relaxed);
+    if (sorted & kSortedStateMask) {
+      sorted_.store(sorted & ~kSortedStateMask, std::memory_order_relaxed);
+    }
+  }
+
+  void DestroySortedElements() {
+    auto* slots = reinterpret_cast<SortedMapSlot*>(
+        sorted_.load(std::memory_order_relaxed) & ~kSortedStateMask);
+    if (slots != nullptr) {
+      Dealloc<SortedMapSlot>(slots, slots[0].capacity + 1);
+      sorted_.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  size_t SortedElementsSpaceUsed() const {
+    auto* slots = reinterpret_cast<const SortedMapSlot*>(
+        sorted_.load(std::memory_order_relaxed) & ~kSortedStateMask);
+    return slots == nullptr ? 0 : (slots[0].capacity + 1) * sizeof(*slots);
+  }
+
   PROTOBUF_NOINLINE void erase_no_destroy(size_type b, KeyNode* node) {
+    InvalidateSortedElements();
     TreeIterator tree_it;
     const bool is_list = revalidate_if_necessary(b, node, &tree_it);
     if (is_list) {
@@ -616,6 +715,7 @@ class KeyMapBase {
     // or whatever.  But it's probably cheap enough to recompute that here;
     // it's likely that we're inserting into an empty or short list.
     GOOGLE_DCHECK(FindHelper(node->key()).node == nullptr);
+    InvalidateSortedElements();
     if (TableEntryIsEmpty(b)) {
       InsertUniqueInList(b, node);
       index_of_first_non_null_ = (std::min)(index_of_first_non_null_, b);
@@ -921,6 +1021,9 @@ class KeyMapBase {
   size_type index_of_first_non_null_;
   TableEntryPtr* table_;  // an array with num_buckets_ entries
   Allocator alloc_;
+  // The cached key order: a SortedMapSlot array, tagged with its state in the
+  // low bits.
+  mutable std::atomic<uintptr_t> sorted_;
 };
 
 }  // namespace internal
@@ -1078,10 +1181,13 @@ class Map {
     InnerMap& operator=(const InnerMap&) = delete;
 
     ~InnerMap() {
-      if (this->alloc_.arena() == nullptr &&
-          this->num_buckets_ != internal::kGlobalEmptyTableSize) {
-        clear();
-        this->template Dealloc<TableEntryPtr>(this->table_, this->num_buckets_);
+      if (this->alloc_.arena() == nullptr) {
+        if (this->num_buckets_ != internal::kGlobalEmptyTableSize) {
+          clear();
+          this->template Dealloc<TableEntryPtr>(this->table_,
+                                                this->num_buckets_);
+        }
+        this->DestroySortedElements();
       }
     }
 
@@ -1135,6 +1241,7 @@ class Map {
     const_iterator end() const { return const_iterator(); }
 
     void clear() {
+      this->InvalidateSortedElements();
       for (size_type b = 0; b < this->num_buckets_; b++) {
         internal::NodeBase* node;
         if (this->TableEntryIsNonEmptyList(b)) {
@@ -1205,7 +1312,9 @@ class Map {
 
     size_t SpaceUsedInternal() const {
       return internal::SpaceUsedInTable<Key>(this->table_, this->num_buckets_,
-                                             this->num_elements_, sizeof(Node));
+                                             this->num_elements_,
+                                             sizeof(Node)) +
+             this->SortedElementsSpaceUsed();
     }
 
    private:
@@ -1576,6 +1685,8 @@ class Map {
   friend class Arena;
   using InternalArenaConstructable_ = void;
   using DestructorSkippable_ = void;
+  template <typename MapT>
+  friend class internal::MapSorterBase;
   template <typename Derived, typename K, typename V,
             internal::WireFormatLite::FieldType key_wire_type,
             internal::WireFormatLite::FieldType value_wire_type>
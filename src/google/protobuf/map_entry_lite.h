@@ -34,6 +34,7 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -472,17 +473,19 @@ struct MapSorterIt {
   MapSorterIt operator+(int v) { return MapSorterIt{ptr + v}; }
 };
 
-// MapSorterFlat stores keys inline with pointers to map entries, so that
-// keys can be compared without indirection. This type is used for maps with
-// keys that are not strings.
+// Common part of MapSorterFlat and MapSorterPtr: iterates over the entries of
+// a map in key order.  The order is taken from the cache kept by the map when
+// that is up to date; otherwise the derived class sorts the entries into the
+// array returned by Begin(), which is the map's cache if no other thread is
+// refreshing it concurrently.
 template <typename MapT>
-class MapSorterFlat {
+class MapSorterBase {
  public:
   using value_type = typename MapT::value_type;
-  using storage_type = std::pair<typename MapT::key_type, const value_type*>;
+  using storage_type = const SortedMapSlot;
 
-  // This const_iterator dereferenes to the map entry stored in the sorting
-  // array pairs. This is the same interface as the Map::const_iterator type,
+  // This const_iterator dereferences the map entry pointers stored in the
+  // sorted array. This is the same interface as the Map::const_iterator type,
   // and allows generated code to use the same loop body with either form:
   //   for (const auto& entry : map) { ... }
   //   for (const auto& entry : MapSorterFlat(map)) { ... }
@@ -491,72 +494,97 @@ class MapSorterFlat {
     using reference = const typename MapT::value_type&;
     using MapSorterIt<storage_type>::MapSorterIt;
 
-    pointer operator->() const { return this->ptr->second; }
+    pointer operator->() const {
+      return static_cast<pointer>(this->ptr->element);
+    }
     reference operator*() const { return *this->operator->(); }
   };
 
-  explicit MapSorterFlat(const MapT& m)
-      : size_(m.size()), items_(size_ ? new storage_type[size_] : nullptr) {
-    if (!size_) return;
-    storage_type* it = &items_[0];
-    for (const auto& entry : m) {
-      *it++ = {entry.first, &entry};
+  MapSorterBase(const MapSorterBase&) = delete;
+  MapSorterBase& operator=(const MapSorterBase&) = delete;
+
+  size_t size() const { return size_; }
+  const_iterator begin() const { return {items_}; }
+  const_iterator end() const { return {items_ + size_}; }
+
+ protected:
+  explicit MapSorterBase(const MapT& m)
+      : map_(m), size_(m.size()), items_(m.elements_.CachedSortedElements()) {}
+
+  // Returns the array to sort the entries into, or nullptr if they are
+  // already sorted.
+  SortedMapSlot* Begin() {
+    if (items_ != nullptr || size_ == 0) return nullptr;
+    SortedMapSlot* slots = map_.elements_.ClaimSortedElements();
+    if (slots == nullptr) {
+      owned_.reset(new SortedMapSlot[size_]);
+      slots = owned_.get();
     }
-    std::sort(&items_[0], &items_[size_],
-              [](const storage_type& a, const storage_type& b) {
-                return a.first < b.first;
-              });
+    items_ = slots;
+    return slots;
+  }
+
+  // Must be called after filling in the array returned by Begin().
+  void Finish() {
+    if (owned_ == nullptr) map_.elements_.PublishSortedElements();
   }
-  size_t size() const { return size_; }
-  const_iterator begin() const { return {items_.get()}; }
-  const_iterator end() const { return {items_.get() + size_}; }
 
  private:
+  const MapT& map_;
   size_t size_;
-  std::unique_ptr<storage_type[]> items_;
+  const SortedMapSlot* items_;
+  std::unique_ptr<SortedMapSlot[]> owned_;
 };
 
-// MapSorterPtr stores and sorts pointers to map entries. This type is used for
-// maps with keys that are strings.
+// MapSorterFlat sorts copies of the keys stored inline with pointers to map
+// entries, so that keys can be compared without indirection. This type is
+// used for maps with keys that are not strings.
 template <typename MapT>
-class MapSorterPtr {
+class MapSorterFlat : public MapSorterBase<MapT> {
  public:
   using value_type = typename MapT::value_type;
-  using storage_type = const typename MapT::value_type*;
 
-  // This const_iterator dereferenes the map entry pointer stored in the sorting
-  // array. This is the same interface as the Map::const_iterator type, and
-  // allows generated code to use the same loop body with either form:
-  //   for (const auto& entry : map) { ... }
-  //   for (const auto& entry : MapSorterPtr(map)) { ... }
-  struct const_iterator : public MapSorterIt<storage_type> {
-    using pointer = const typename MapT::value_type*;
-    using reference = const typename MapT::value_type&;
-    using MapSorterIt<storage_type>::MapSorterIt;
+  explicit MapSorterFlat(const MapT& m) : MapSorterBase<MapT>(m) {
+    SortedMapSlot* slots = this->Begin();
+    if (slots == nullptr) return;
+    using pair_type = std::pair<typename MapT::key_type, const value_type*>;
+    std::unique_ptr<pair_type[]> items(new pair_type[this->size()]);
+    pair_type* it = &items[0];
+    for (const auto& entry : m) {
+      *it++ = {entry.first, &entry};
+    }
+    std::sort(&items[0], &items[this->size()],
+              [](const pair_type& a, const pair_type& b) {
+                return a.first < b.first;
+              });
+    for (size_t i = 0; i < this->size(); ++i) {
+      slots[i].element = items[i].second;
+    }
+    this->Finish();
+  }
+};
 
-    pointer operator->() const { return *this->ptr; }
-    reference operator*() const { return *this->operator->(); }
-  };
+// MapSorterPtr sorts pointers to map entries. This type is used for maps with
+// keys that are strings.
+template <typename MapT>
+class MapSorterPtr : public MapSorterBase<MapT> {
+ public:
+  using value_type = typename MapT::value_type;
 
-  explicit MapSorterPtr(const MapT& m)
-      : size_(m.size()), items_(size_ ? new storage_type[size_] : nullptr) {
-    if (!size_) return;
-    storage_type* it = &items_[0];
+  explicit MapSorterPtr(const MapT& m) : MapSorterBase<MapT>(m) {
+    SortedMapSlot* slots = this->Begin();
+    if (slots == nullptr) return;
+    SortedMapSlot* it = slots;
     for (const auto& entry : m) {
-      *it++ = &entry;
+      (it++)->element = &entry;
     }
-    std::sort(&items_[0], &items_[size_],
-              [](const storage_type& a, const storage_type& b) {
-                return a->first < b->first;
+    std::sort(slots, slots + this->size(),
+              [](const SortedMapSlot& a, const SortedMapSlot& b) {
+                return static_cast<const value_type*>(a.element)->first <
+                       static_cast<const value_type*>(b.element)->first;
               });
+    this->Finish();
   }
-  size_t size() const { return size_; }
-  const_iterator begin() const { return {items_.get()}; }
-  const_iterator end() const { return {items_.get() + size_}; }
-
- private:
-  size_t size_;
-  std::unique_ptr<storage_type[]> items_;
 };
 
 }  // namespace internal
@@ -149,6 +149,7 @@ class MessageFactory;
 
 // Defined in other files.
 class AssignDescriptorsHelper;
+class CompiledFieldAccessor;
 class DynamicMessageFactory;
 class GeneratedMessageReflectionTestHelper;
 class MapKey;
@@ -188,6 +189,7 @@ void PerformAbslStringify(
 }  // namespace internal
 namespace util {
 class MessageDifferencer;
+class MessageFingerprint;
 }
 
 
@@ -1065,6 +1067,8 @@ class PROTOBUF_EXPORT Reflection final {
 
   bool IsLazilyVerifiedLazyField(const FieldDescriptor* field) const;
   bool IsEagerlyVerifiedLazyField(const FieldDescriptor* field) const;
+  // Returns true if generated code stores the field as a LazyField.
+  bool IsLazyFieldStorage(const FieldDescriptor* field) const;
 
   bool IsSplit(const FieldDescriptor* field) const {
     return schema_.IsSplit(field);
@@ -1114,11 +1118,13 @@ class PROTOBUF_EXPORT Reflection final {
   friend class Message;
   friend class ::PROTOBUF_NAMESPACE_ID::MessageLayoutInspector;
   friend class ::PROTOBUF_NAMESPACE_ID::AssignDescriptorsHelper;
+  friend class CompiledFieldAccessor;
   friend class DynamicMessageFactory;
   friend class GeneratedMessageReflectionTestHelper;
   friend class python::MapReflectionFriend;
   friend class python::MessageReflectionFriend;
   friend class util::MessageDifferencer;
+  friend class util::MessageFingerprint;
 #define GOOGLE_PROTOBUF_HAS_CEL_MAP_REFLECTION_FRIEND
   friend class expr::CelMapReflectionFriend;
   friend class internal::MapFieldReflectionTest;
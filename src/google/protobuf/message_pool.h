@@ -0,0 +1,220 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Defines MessagePool, which recycles message objects that are not allocated
+// on an arena.
+
+#ifndef GOOGLE_PROTOBUF_MESSAGE_POOL_H__
+#define GOOGLE_PROTOBUF_MESSAGE_POOL_H__
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/port.h"
+
+#ifdef SWIG
+#error "You cannot SWIG proto headers"
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// Limits on what a MessagePool keeps around.
+struct MessagePoolOptions {
+  // Maximum number of idle messages held by the pool.  Messages returned to a
+  // full pool are deleted.
+  size_t max_idle_messages = 16;
+  // A returned message is only kept if its SpaceUsedLong() after Clear() is at
+  // most this many bytes, so that one unusually large message does not pin
+  // its memory for the lifetime of the pool.  See also measure_interval.
+  size_t max_message_bytes = 64 << 10;
+  // Maximum sum of SpaceUsedLong() over all idle messages.
+  size_t max_idle_bytes = 1 << 20;
+  // SpaceUsedLong() walks the whole message, so a message is only measured
+  // the first time it is returned and then every measure_interval-th time;
+  // in between, its last measurement is used.  Since Clear() keeps memory, a
+  // message only grows, and growth past the limits above is noticed within
+  // measure_interval returns.  0 or 1 measures every time.
+  size_t measure_interval = 16;
+};
+
+// MessagePool hands out heap-allocated messages of type T and takes them back
+// when they are no longer needed, instead of deleting them.  Clear() keeps the
+// memory a message owns -- string buffers, repeated field storage and
+// elements, singular submessages -- so a recycled message can usually be
+// filled again without allocating.  In the steady state, parsing messages of
+// similar shape through a pool allocates nothing:
+//
+//   MessagePool<MyRequest> pool;
+//   ...
+//   MessagePool<MyRequest>::Handle request = pool.Parse(bytes);
+//   if (request == nullptr) return ParseError();
+//   Process(*request);
+//   // The message goes back to the pool when `request` is destroyed.
+//
+// Pools are an alternative to arenas for code where the lifetime of messages
+// does not follow a request scope.  The memory retained by the pool is bounded
+// by MessagePoolOptions.  For messages that do not derive from Message (lite
+// messages), which cannot measure their memory, only max_idle_messages
+// applies.
+//
+// MessagePool is thread-safe.  Handles may be destroyed on any thread, but
+// all of them must be destroyed before the pool.
+template <typename T>
+class MessagePool {
+  static_assert(std::is_base_of<MessageLite, T>::value,
+                "MessagePool only holds protocol buffer messages");
+
+ public:
+  // Returns a message to the pool it came from.
+  class Recycler {
+   public:
+    Recycler() = default;
+    void operator()(T* message) const {
+      pool_->Recycle(message, bytes_, returns_);
+    }
+
+   private:
+    friend class MessagePool;
+    Recycler(MessagePool* pool, size_t bytes, size_t returns)
+        : pool_(pool), bytes_(bytes), returns_(returns) {}
+
+    MessagePool* pool_ = nullptr;
+    // The message's last measured size, and how often it has been returned.
+    size_t bytes_ = 0;
+    size_t returns_ = 0;
+  };
+  using Handle = std::unique_ptr<T, Recycler>;
+
+  MessagePool() : MessagePool(MessagePoolOptions()) {}
+  explicit MessagePool(const MessagePoolOptions& options) : options_(options) {}
+  MessagePool(const MessagePool&) = delete;
+  MessagePool& operator=(const MessagePool&) = delete;
+  ~MessagePool() {
+    for (const Idle& idle : idle_) delete idle.message;
+  }
+
+  // Returns an empty message, recycled if possible.
+  Handle Get() {
+    Idle idle = {nullptr, 0, 0};
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!idle_.empty()) {
+        idle = idle_.back();
+        idle_bytes_ -= idle.bytes;
+        idle_.pop_back();
+      }
+    }
+    if (idle.message == nullptr) idle.message = new T();
+    return Handle(idle.message, Recycler(this, idle.bytes, idle.returns));
+  }
+
+  // Returns a message parsed from `data`, or a null handle if `data` is not a
+  // valid serialization of T.
+  Handle Parse(absl::string_view data) {
+    Handle message = Get();
+    if (!message->ParseFromString(data)) message.reset();
+    return message;
+  }
+
+  // Number of idle messages in the pool, and the memory they retain.
+  size_t idle_messages() const {
+    absl::MutexLock lock(&mutex_);
+    return idle_.size();
+  }
+  size_t idle_bytes() const {
+    absl::MutexLock lock(&mutex_);
+    return idle_bytes_;
+  }
+
+  // Deletes all idle messages.
+  void Trim() {
+    std::vector<Idle> idle;
+    {
+      absl::MutexLock lock(&mutex_);
+      idle.swap(idle_);
+      idle_bytes_ = 0;
+    }
+    for (const Idle& i : idle) delete i.message;
+  }
+
+ private:
+  struct Idle {
+    T* message;
+    size_t bytes;
+    size_t returns;
+  };
+
+  static size_t SpaceUsed(const T& message, std::true_type) {
+    return message.SpaceUsedLong();
+  }
+  static size_t SpaceUsed(const T&, std::false_type) { return 0; }
+
+  void Recycle(T* message, size_t bytes, size_t returns) {
+    message->Clear();
+    if (options_.measure_interval <= 1 ||
+        returns % options_.measure_interval == 0) {
+      bytes = SpaceUsed(*message, typename std::is_base_of<Message, T>::type());
+    }
+    ++returns;
+    if (bytes <= options_.max_message_bytes) {
+      absl::MutexLock lock(&mutex_);
+      if (idle_.size() < options_.max_idle_messages &&
+          idle_bytes_ + bytes <= options_.max_idle_bytes) {
+        idle_.push_back({message, bytes, returns});
+        idle_bytes_ += bytes;
+        return;
+      }
+    }
+    delete message;
+  }
+
+  const MessagePoolOptions options_;
+  mutable absl::Mutex mutex_;
+  std::vector<Idle> idle_;
+  size_t idle_bytes_ = 0;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_MESSAGE_POOL_H__
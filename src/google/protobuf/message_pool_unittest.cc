@@ -0,0 +1,208 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "google/protobuf/message_pool.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_lite.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestAllTypesLite;
+
+std::string MakeRequest(int repeated_count) {
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  message.set_optional_string(std::string(100, 'x'));
+  message.mutable_optional_nested_message()->set_bb(2);
+  for (int i = 0; i < repeated_count; ++i) {
+    message.add_repeated_string(std::string(50, 'y'));
+    message.add_repeated_nested_message()->set_bb(i);
+  }
+  return message.SerializeAsString();
+}
+
+TEST(MessagePoolTest, RecyclesClearedMessages) {
+  MessagePool<TestAllTypes> pool;
+  TestAllTypes* first;
+  {
+    MessagePool<TestAllTypes>::Handle message = pool.Get();
+    first = message.get();
+    message->set_optional_int32(5);
+    message->add_repeated_int32(6);
+  }
+  EXPECT_EQ(1, pool.idle_messages());
+  EXPECT_GT(pool.idle_bytes(), 0);
+
+  MessagePool<TestAllTypes>::Handle message = pool.Get();
+  EXPECT_EQ(first, message.get());
+  EXPECT_EQ(0, pool.idle_messages());
+  EXPECT_EQ(0, pool.idle_bytes());
+  EXPECT_EQ(0, message->ByteSizeLong());
+}
+
+TEST(MessagePoolTest, ParseReusesRetainedMemory) {
+  MessagePool<TestAllTypes> pool;
+  const std::string data = MakeRequest(3);
+
+  const char* string_buffer;
+  const TestAllTypes::NestedMessage* nested;
+  const TestAllTypes::NestedMessage* repeated_nested;
+  const std::string* repeated_string;
+  {
+    auto message = pool.Parse(data);
+    ASSERT_NE(message, nullptr);
+    string_buffer = message->optional_string().data();
+    nested = &message->optional_nested_message();
+    repeated_nested = &message->repeated_nested_message(2);
+    repeated_string = &message->repeated_string(2);
+  }
+
+  auto message = pool.Parse(data);
+  ASSERT_NE(message, nullptr);
+  EXPECT_EQ(data, message->SerializeAsString());
+  EXPECT_EQ(string_buffer, message->optional_string().data());
+  EXPECT_EQ(nested, &message->optional_nested_message());
+  EXPECT_EQ(repeated_nested, &message->repeated_nested_message(2));
+  EXPECT_EQ(repeated_string, &message->repeated_string(2));
+}
+
+TEST(MessagePoolTest, ParseFailureReturnsNull) {
+  MessagePool<TestAllTypes> pool;
+  EXPECT_EQ(nullptr, pool.Parse("\xff"));
+  // The message used for the attempt went back to the pool.
+  EXPECT_EQ(1, pool.idle_messages());
+}
+
+TEST(MessagePoolTest, MaxIdleMessages) {
+  MessagePoolOptions options;
+  options.max_idle_messages = 2;
+  MessagePool<TestAllTypes> pool(options);
+  {
+    std::vector<MessagePool<TestAllTypes>::Handle> messages;
+    for (int i = 0; i < 5; ++i) messages.push_back(pool.Get());
+  }
+  EXPECT_EQ(2, pool.idle_messages());
+}
+
+TEST(MessagePoolTest, MaxMessageBytes) {
+  MessagePoolOptions options;
+  options.max_message_bytes = 4096;
+  options.measure_interval = 1;
+  MessagePool<TestAllTypes> pool(options);
+
+  pool.Parse(MakeRequest(1));
+  EXPECT_EQ(1, pool.idle_messages());
+  // This message retains more memory than allowed and is deleted.
+  pool.Get()->mutable_optional_string()->resize(8192);
+  EXPECT_EQ(0, pool.idle_messages());
+}
+
+TEST(MessagePoolTest, MeasureInterval) {
+  MessagePoolOptions options;
+  options.max_message_bytes = 4096;
+  options.measure_interval = 4;
+  MessagePool<TestAllTypes> pool(options);
+
+  // Measured on its first return.
+  pool.Get();
+  const size_t small_bytes = pool.idle_bytes();
+  EXPECT_EQ(1, pool.idle_messages());
+
+  // Growth goes unnoticed until the fourth return after that.
+  for (int i = 0; i < 3; ++i) {
+    pool.Get()->mutable_optional_string()->resize(8192);
+    EXPECT_EQ(1, pool.idle_messages()) << i;
+    EXPECT_EQ(small_bytes, pool.idle_bytes()) << i;
+  }
+  pool.Get();
+  EXPECT_EQ(0, pool.idle_messages());
+}
+
+TEST(MessagePoolTest, MaxIdleBytes) {
+  const std::string data = MakeRequest(10);
+  MessagePool<TestAllTypes> unlimited;
+  unlimited.Parse(data);
+  const size_t message_bytes = unlimited.idle_bytes();
+  ASSERT_GT(message_bytes, 0);
+
+  MessagePoolOptions options;
+  options.max_idle_bytes = 2 * message_bytes;
+  MessagePool<TestAllTypes> pool(options);
+  {
+    std::vector<MessagePool<TestAllTypes>::Handle> messages;
+    for (int i = 0; i < 3; ++i) messages.push_back(pool.Parse(data));
+  }
+  EXPECT_EQ(2, pool.idle_messages());
+  EXPECT_EQ(2 * message_bytes, pool.idle_bytes());
+
+  pool.Trim();
+  EXPECT_EQ(0, pool.idle_messages());
+  EXPECT_EQ(0, pool.idle_bytes());
+}
+
+TEST(MessagePoolTest, LiteMessages) {
+  TestAllTypesLite source;
+  source.set_optional_string("foo");
+  source.add_repeated_int32(1);
+  const std::string data = source.SerializeAsString();
+
+  MessagePoolOptions options;
+  options.max_idle_messages = 1;
+  MessagePool<TestAllTypesLite> pool(options);
+  const TestAllTypesLite* kept;
+  {
+    auto message = pool.Parse(data);
+    ASSERT_NE(message, nullptr);
+    auto other = pool.Get();
+    // `other` is returned first and fills the pool.
+    kept = other.get();
+  }
+  // Lite messages cannot measure their memory; only the count is limited.
+  EXPECT_EQ(1, pool.idle_messages());
+  EXPECT_EQ(0, pool.idle_bytes());
+
+  auto message = pool.Parse(data);
+  ASSERT_NE(message, nullptr);
+  EXPECT_EQ("foo", message->optional_string());
+  EXPECT_EQ(kept, message.get());
+  EXPECT_EQ(0, pool.idle_messages());
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
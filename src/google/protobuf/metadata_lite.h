@@ -32,6 +32,7 @@
 #define GOOGLE_PROTOBUF_METADATA_LITE_H__
 
 #include <string>
+#include <type_traits>
 
 #include "google/protobuf/arena.h"
 #include "google/protobuf/port.h"
@@ -219,8 +220,17 @@ class PROTOBUF_EXPORT InternalMetadata {
     Arena* arena;
   };
 
+  // Arena-constructable unknown field containers (UnknownFieldSet) allocate
+  // their contents on the arena of the message.
   template <typename T>
   struct Container : public ContainerBase {
+    explicit Container(Arena* input_arena)
+        : Container(input_arena, Arena::is_arena_constructable<T>()) {}
+    Container(Arena* input_arena, std::true_type)
+        : ContainerBase{input_arena}, unknown_fields(input_arena) {}
+    Container(Arena* input_arena, std::false_type)
+        : ContainerBase{input_arena} {}
+
     T unknown_fields;
   };
 
@@ -243,13 +253,12 @@ class PROTOBUF_EXPORT InternalMetadata {
   template <typename T>
   PROTOBUF_NOINLINE T* mutable_unknown_fields_slow() {
     Arena* my_arena = arena();
-    Container<T>* container = Arena::Create<Container<T>>(my_arena);
+    Container<T>* container = Arena::Create<Container<T>>(my_arena, my_arena);
     intptr_t message_owned_arena_tag = ptr_ & kMessageOwnedArenaTagMask;
     // Two-step assignment works around a bug in clang's static analyzer:
     // https://bugs.llvm.org/show_bug.cgi?id=34198.
     ptr_ = reinterpret_cast<intptr_t>(container);
     ptr_ |= kUnknownFieldsTagMask | message_owned_arena_tag;
-    container->arena = my_arena;
     return &(container->unknown_fields);
   }
 
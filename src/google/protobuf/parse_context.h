@@ -48,6 +48,7 @@
 #include "google/protobuf/metadata_lite.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/repeated_field.h"
+#include "google/protobuf/string_piece_field.h"
 #include "google/protobuf/wire_format_lite.h"
 
 
@@ -182,6 +183,11 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   PROTOBUF_NODISCARD const char* ReadArenaString(const char* ptr,
                                                  ArenaStringPtr* s,
                                                  Arena* arena);
+  // Reads a length-delimited value into `s`.  Implemented in
+  // string_piece_field.cc
+  PROTOBUF_NODISCARD const char* ReadStringPieceField(const char* ptr,
+                                                      StringPieceField* s,
+                                                      Arena* arena);
 
   template <typename Tag, typename T>
   PROTOBUF_NODISCARD const char* ReadRepeatedFixed(const char* ptr,
@@ -0,0 +1,216 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2022 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Tests of code generated from a field access profile.  This file is built
+// against unittest.proto and unittest_lite.proto compiled with
+// inject_field_listener_events, force_inline_string and
+// access_profile=testdata/unittest_access_profile.txt, and with
+// PROTOBUF_FIELD_ACCESS_PROFILING defined, so that the accessors count into
+// CountingAccessListener.
+
+#include <memory>
+#include <string>
+
+#include "google/protobuf/testing/file.h"
+#include "google/protobuf/testing/googletest.h"
+#include <gtest/gtest.h>
+#include "absl/strings/match.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/field_access_listener.h"
+#include "google/protobuf/generated_message_reflection.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/test_util2.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_lite.pb.h"
+
+#ifndef PROTOBUF_FIELD_ACCESS_PROFILING
+#error "This test must be built with PROTOBUF_FIELD_ACCESS_PROFILING."
+#endif
+
+namespace google {
+namespace protobuf {
+
+class MessageLayoutInspector {
+ public:
+  static bool IsSplit(const Message& message, const FieldDescriptor* field) {
+    return message.GetReflection()->schema_.IsSplit(field);
+  }
+  static bool IsInlined(const Message& message, const FieldDescriptor* field) {
+    return message.GetReflection()->schema_.IsFieldInlined(field);
+  }
+};
+
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+const FieldDescriptor* Field(const Message& message, const std::string& name) {
+  const FieldDescriptor* field =
+      message.GetDescriptor()->FindFieldByName(name);
+  GOOGLE_CHECK(field != nullptr) << name;
+  return field;
+}
+
+bool IsSplit(const Message& message, const std::string& name) {
+  return MessageLayoutInspector::IsSplit(message, Field(message, name));
+}
+
+bool IsInlined(const Message& message, const std::string& name) {
+  return MessageLayoutInspector::IsInlined(message, Field(message, name));
+}
+
+std::string SerializeDynamically(const Message& message) {
+  DynamicMessageFactory factory;
+  std::unique_ptr<Message> dynamic(
+      factory.GetPrototype(message.GetDescriptor())->New());
+  dynamic->MergeFrom(message);
+  return dynamic->SerializeAsString();
+}
+
+TEST(ProfileDrivenCodegenTest, Layout) {
+  const TestAllTypes& message = TestAllTypes::default_instance();
+  // Fields the profile shows to be hot stay in the message.
+  EXPECT_FALSE(IsSplit(message, "optional_int32"));
+  EXPECT_FALSE(IsSplit(message, "optional_string"));
+  EXPECT_FALSE(IsSplit(message, "optional_nested_message"));
+  // Cold and unlisted fields are split out of line, except for those that
+  // keep their own storage.
+  EXPECT_TRUE(IsSplit(message, "optional_bytes"));
+  EXPECT_TRUE(IsSplit(message, "optional_int64"));
+  EXPECT_TRUE(IsSplit(message, "optionalgroup"));
+  EXPECT_FALSE(IsSplit(message, "repeated_int32"));
+  EXPECT_FALSE(IsSplit(message, "repeated_string"));
+  EXPECT_FALSE(IsSplit(message, "oneof_string"));
+  EXPECT_FALSE(IsSplit(message, "optional_lazy_message"));
+
+  // force_inline_string inlines every string that can be, but split strings
+  // are not.
+  EXPECT_TRUE(IsInlined(message, "optional_string"));
+  EXPECT_FALSE(IsInlined(message, "optional_bytes"));
+  EXPECT_FALSE(IsInlined(message, "repeated_string"));
+  EXPECT_FALSE(IsInlined(message, "oneof_string"));
+
+  // Messages without a profile are not split, and all their eligible strings
+  // are inlined.
+  const protobuf_unittest::TestCamelCaseFieldNames& camel_case =
+      protobuf_unittest::TestCamelCaseFieldNames::default_instance();
+  EXPECT_FALSE(IsSplit(camel_case, "StringField"));
+  EXPECT_TRUE(IsInlined(camel_case, "StringField"));
+}
+
+TEST(ProfileDrivenCodegenTest, RoundTrip) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  TestUtil::ExpectAllFieldsSet(message);
+  std::string serialized = message.SerializeAsString();
+  EXPECT_EQ(SerializeDynamically(message), serialized);
+
+  TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized));
+  TestUtil::ExpectAllFieldsSet(parsed);
+  EXPECT_EQ(serialized, parsed.SerializeAsString());
+
+  // golden_message was written by code with the default layout.
+  std::string golden;
+  GOOGLE_CHECK_OK(File::GetContents(
+      TestUtil::GetTestDataPath(
+          "third_party/protobuf/testdata/golden_message"),
+      &golden, true));
+  ASSERT_TRUE(parsed.ParseFromString(golden));
+  TestUtil::ExpectAllFieldsSet(parsed);
+
+  TestUtil::ModifyRepeatedFields(&parsed);
+  TestUtil::ExpectRepeatedFieldsModified(parsed);
+  parsed.Clear();
+  TestUtil::ExpectClear(parsed);
+}
+
+TEST(ProfileDrivenCodegenTest, ArenaCopyAndSwap) {
+  Arena arena;
+  TestAllTypes* on_arena = Arena::CreateMessage<TestAllTypes>(&arena);
+  TestUtil::SetAllFields(on_arena);
+  TestUtil::ExpectAllFieldsSet(*on_arena);
+
+  TestAllTypes copy(*on_arena);
+  TestUtil::ExpectAllFieldsSet(copy);
+
+  // Swapping across arenas copies, and inlined strings on the arena must be
+  // given up by the message that held them.
+  TestAllTypes on_heap;
+  on_heap.Swap(on_arena);
+  TestUtil::ExpectAllFieldsSet(on_heap);
+  TestUtil::ExpectClear(*on_arena);
+
+  TestAllTypes* other = Arena::CreateMessage<TestAllTypes>(&arena);
+  on_arena->set_optional_string("swapped");
+  other->Swap(on_arena);
+  EXPECT_EQ("swapped", other->optional_string());
+  EXPECT_FALSE(on_arena->has_optional_string());
+
+  std::unique_ptr<std::string> released(other->release_optional_string());
+  EXPECT_EQ("swapped", *released);
+  EXPECT_FALSE(other->has_optional_string());
+  other->set_allocated_optional_string(new std::string("allocated"));
+  EXPECT_EQ("allocated", other->optional_string());
+}
+
+TEST(ProfileDrivenCodegenTest, AccessProfile) {
+  TestAllTypes message;
+  protobuf_unittest::TestAllTypesLite lite;
+  ResetFieldAccessProfile();
+
+  message.set_optional_int32(1);
+  EXPECT_EQ(1, message.optional_int32());
+  message.set_optional_bytes("cold");
+  // Lite messages have no listener, so they stay out of the profile.
+  lite.set_optional_int32(2);
+  EXPECT_EQ(2, lite.optional_int32());
+
+  std::string profile = GetFieldAccessProfile();
+  EXPECT_TRUE(absl::StrContains(
+      profile, "protobuf_unittest.TestAllTypes.optional_int32 2\n"))
+      << profile;
+  EXPECT_TRUE(absl::StrContains(
+      profile, "protobuf_unittest.TestAllTypes.optional_bytes 1\n"))
+      << profile;
+  EXPECT_FALSE(absl::StrContains(profile, "TestAllTypesLite")) << profile;
+
+  // force_inline_string applies to lite messages as well.
+  std::string serialized = lite.SerializeAsString();
+  protobuf_unittest::TestAllTypesLite parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized));
+  EXPECT_EQ(2, parsed.optional_int32());
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -1237,6 +1237,83 @@ TEST(RepeatedPtrField, SwapLargeLarge) {
   }
 }
 
+TEST(RepeatedPtrField, FirstElementIsStoredInline) {
+  RepeatedPtrField<std::string> field;
+  EXPECT_EQ(1, field.Capacity());
+  EXPECT_EQ(0, field.SpaceUsedExcludingSelf());
+
+  std::string* first = field.Add();
+  first->assign("foo");
+  // No pointer array is allocated for a single element.
+  EXPECT_EQ(1, field.Capacity());
+  EXPECT_EQ(sizeof(std::string), field.SpaceUsedExcludingSelf());
+  EXPECT_EQ(1, field.end() - field.begin());
+  EXPECT_EQ("foo", *field.begin());
+
+  // Growing moves the element out of line.
+  field.Add()->assign("bar");
+  EXPECT_LT(1, field.Capacity());
+  EXPECT_EQ(first, &field.Get(0));
+  EXPECT_EQ("bar", field.Get(1));
+}
+
+TEST(RepeatedPtrField, InlineElementIsReused) {
+  RepeatedPtrField<std::string> field;
+  std::string* first = field.Add();
+  field.RemoveLast();
+  EXPECT_EQ(1, field.ClearedCount());
+  EXPECT_EQ(first, field.Add());
+
+  field.DeleteSubrange(0, 1);
+  EXPECT_TRUE(field.empty());
+  EXPECT_EQ(0, field.ClearedCount());
+
+  std::string* allocated = new std::string("baz");
+  field.AddAllocated(allocated);
+  EXPECT_EQ(allocated, &field.Get(0));
+  std::string* released = field.ReleaseLast();
+  EXPECT_EQ(allocated, released);
+  EXPECT_TRUE(field.empty());
+  delete released;
+}
+
+TEST(RepeatedPtrField, SwapInlineAndOutOfLine) {
+  RepeatedPtrField<std::string> field1;
+  RepeatedPtrField<std::string> field2;
+  field1.Add()->assign("foo");
+  field2.Add()->assign("bar");
+  field2.Add()->assign("baz");
+
+  field1.Swap(&field2);
+  ASSERT_EQ(2, field1.size());
+  EXPECT_EQ("bar", field1.Get(0));
+  EXPECT_EQ("baz", field1.Get(1));
+  ASSERT_EQ(1, field2.size());
+  EXPECT_EQ("foo", field2.Get(0));
+
+  field2.MergeFrom(field1);
+  ASSERT_EQ(3, field2.size());
+  EXPECT_EQ("baz", field2.Get(2));
+}
+
+TEST(RepeatedPtrField, InlineElementOnArena) {
+  Arena arena;
+  auto* field = Arena::CreateMessage<RepeatedPtrField<TestAllTypes>>(&arena);
+  TestAllTypes* message = field->Add();
+  message->set_optional_int32(1);
+  EXPECT_EQ(&arena, message->GetArena());
+
+  RepeatedPtrField<TestAllTypes> heap_field;
+  heap_field.Add()->set_optional_int32(2);
+  field->Swap(&heap_field);
+  ASSERT_EQ(1, field->size());
+  EXPECT_EQ(2, field->Get(0).optional_int32());
+  EXPECT_EQ(&arena, field->Get(0).GetArena());
+  ASSERT_EQ(1, heap_field.size());
+  EXPECT_EQ(1, heap_field.Get(0).optional_int32());
+  EXPECT_EQ(nullptr, heap_field.Get(0).GetArena());
+}
+
 static int ReservedSpace(RepeatedPtrField<std::string>* field) {
   const std::string* const* ptr = field->data();
   do {
@@ -1354,6 +1431,7 @@ TEST(RepeatedPtrField, AddAllocated) {
   EXPECT_EQ(bar, &field.Get(index));
 
   // Third branch:  Field is not at capacity and there are no cleared objects.
+  field.Reserve(field.size() + 1);
   field.RemoveLast();
   std::string* baz = new std::string("baz");
   field.AddAllocated(baz);
@@ -1568,15 +1646,17 @@ TEST(RepeatedPtrField, MoveAssign) {
     *source.Add() = "2";
     RepeatedPtrField<std::string> destination;
     *destination.Add() = "3";
+    *destination.Add() = "4";
     const std::string* const* source_data = source.data();
     const std::string* const* destination_data = destination.data();
     destination = std::move(source);
     EXPECT_EQ(source_data, destination.data());
     EXPECT_THAT(destination, ElementsAre("1", "2"));
     // This property isn't guaranteed but it's useful to have a test that would
-    // catch changes in this area.
+    // catch changes in this area.  (A single element is stored inline and
+    // moves with the field object.)
     EXPECT_EQ(destination_data, source.data());
-    EXPECT_THAT(source, ElementsAre("3"));
+    EXPECT_THAT(source, ElementsAre("3", "4"));
   }
   {
     Arena arena;
@@ -1587,6 +1667,7 @@ TEST(RepeatedPtrField, MoveAssign) {
     RepeatedPtrField<std::string>* destination =
         Arena::CreateMessage<RepeatedPtrField<std::string>>(&arena);
     *destination->Add() = "3";
+    *destination->Add() = "4";
     const std::string* const* source_data = source->data();
     const std::string* const* destination_data = destination->data();
     *destination = std::move(*source);
@@ -1595,7 +1676,7 @@ TEST(RepeatedPtrField, MoveAssign) {
     // This property isn't guaranteed but it's useful to have a test that would
     // catch changes in this area.
     EXPECT_EQ(destination_data, source->data());
-    EXPECT_THAT(*source, ElementsAre("3"));
+    EXPECT_THAT(*source, ElementsAre("3", "4"));
   }
   {
     Arena source_arena;
@@ -53,6 +53,7 @@
 #include <algorithm>
 #endif
 
+#include <cstdint>
 #include <iterator>
 #include <limits>
 #include <string>
@@ -166,9 +167,15 @@ struct IsMovable
 class PROTOBUF_EXPORT RepeatedPtrFieldBase {
  protected:
   constexpr RepeatedPtrFieldBase()
-      : arena_(nullptr), current_size_(0), total_size_(0), rep_(nullptr) {}
+      : arena_(nullptr),
+        current_size_(0),
+        total_size_(kSSOCapacity),
+        tagged_rep_or_elem_(nullptr) {}
   explicit RepeatedPtrFieldBase(Arena* arena)
-      : arena_(arena), current_size_(0), total_size_(0), rep_(nullptr) {}
+      : arena_(arena),
+        current_size_(0),
+        total_size_(kSSOCapacity),
+        tagged_rep_or_elem_(nullptr) {}
 
   RepeatedPtrFieldBase(const RepeatedPtrFieldBase&) = delete;
   RepeatedPtrFieldBase& operator=(const RepeatedPtrFieldBase&) = delete;
@@ -189,29 +196,29 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   const typename TypeHandler::Type& at(int index) const {
     GOOGLE_CHECK_GE(index, 0);
     GOOGLE_CHECK_LT(index, current_size_);
-    return *cast<TypeHandler>(rep_->elements[index]);
+    return *cast<TypeHandler>(element_at(index));
   }
 
   template <typename TypeHandler>
   typename TypeHandler::Type& at(int index) {
     GOOGLE_CHECK_GE(index, 0);
     GOOGLE_CHECK_LT(index, current_size_);
-    return *cast<TypeHandler>(rep_->elements[index]);
+    return *cast<TypeHandler>(element_at(index));
   }
 
   template <typename TypeHandler>
   typename TypeHandler::Type* Mutable(int index) {
     GOOGLE_DCHECK_GE(index, 0);
     GOOGLE_DCHECK_LT(index, current_size_);
-    return cast<TypeHandler>(rep_->elements[index]);
+    return cast<TypeHandler>(element_at(index));
   }
 
   template <typename TypeHandler>
   typename TypeHandler::Type* Add(
       const typename TypeHandler::Type* prototype = nullptr) {
-    if (rep_ != nullptr && current_size_ < rep_->allocated_size) {
+    if (current_size_ < allocated_size()) {
       return cast<TypeHandler>(
-          rep_->elements[ExchangeCurrentSize(current_size_ + 1)]);
+          element_at(ExchangeCurrentSize(current_size_ + 1)));
     }
     typename TypeHandler::Type* result =
         TypeHandler::NewFromPrototype(prototype, arena_);
@@ -223,44 +230,47 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
       typename TypeHandler,
       typename std::enable_if<TypeHandler::Movable::value>::type* = nullptr>
   inline void Add(typename TypeHandler::Type&& value) {
-    if (rep_ != nullptr && current_size_ < rep_->allocated_size) {
-      *cast<TypeHandler>(
-          rep_->elements[ExchangeCurrentSize(current_size_ + 1)]) =
+    if (current_size_ < allocated_size()) {
+      *cast<TypeHandler>(element_at(ExchangeCurrentSize(current_size_ + 1))) =
           std::move(value);
       return;
     }
-    if (!rep_ || rep_->allocated_size == total_size_) {
+    if (allocated_size() == total_size_) {
       Reserve(total_size_ + 1);
     }
-    ++rep_->allocated_size;
+    if (!using_sso()) ++rep()->allocated_size;
     typename TypeHandler::Type* result =
         TypeHandler::New(arena_, std::move(value));
-    rep_->elements[ExchangeCurrentSize(current_size_ + 1)] = result;
+    elements()[ExchangeCurrentSize(current_size_ + 1)] = result;
   }
 
   template <typename TypeHandler>
   void Delete(int index) {
     GOOGLE_DCHECK_GE(index, 0);
     GOOGLE_DCHECK_LT(index, current_size_);
-    TypeHandler::Delete(cast<TypeHandler>(rep_->elements[index]), arena_);
+    TypeHandler::Delete(cast<TypeHandler>(element_at(index)), arena_);
   }
 
   // Must be called from destructor.
   template <typename TypeHandler>
   void Destroy() {
-    if (rep_ != nullptr && arena_ == nullptr) {
-      int n = rep_->allocated_size;
-      void* const* elements = rep_->elements;
+    if (NeedsDestroy()) {
+      int n = allocated_size();
+      void* const* elems = elements();
       for (int i = 0; i < n; i++) {
-        TypeHandler::Delete(cast<TypeHandler>(elements[i]), nullptr);
+        TypeHandler::Delete(cast<TypeHandler>(elems[i]), nullptr);
+      }
+      if (!using_sso()) {
+        const size_t size = total_size_ * sizeof(elems[0]) + kRepHeaderSize;
+        internal::SizedDelete(rep(), size);
       }
-      const size_t size = total_size_ * sizeof(elements[0]) + kRepHeaderSize;
-      internal::SizedDelete(rep_, size);
     }
-    rep_ = nullptr;
+    tagged_rep_or_elem_ = nullptr;
   }
 
-  bool NeedsDestroy() const { return rep_ != nullptr && arena_ == nullptr; }
+  bool NeedsDestroy() const {
+    return tagged_rep_or_elem_ != nullptr && arena_ == nullptr;
+  }
   void DestroyProtos();  // implemented in the cc file
 
  public:
@@ -272,7 +282,7 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   const typename TypeHandler::Type& Get(int index) const {
     GOOGLE_DCHECK_GE(index, 0);
     GOOGLE_DCHECK_LT(index, current_size_);
-    return *cast<TypeHandler>(rep_->elements[index]);
+    return *cast<TypeHandler>(element_at(index));
   }
 
   // Creates and adds an element using the given prototype, without introducing
@@ -309,15 +319,17 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
 
     // Swap all fields at once.
     auto temp = std::make_tuple(rhs->arena_, rhs->current_size_,
-                                rhs->total_size_, rhs->rep_);
-    std::tie(rhs->arena_, rhs->current_size_, rhs->total_size_, rhs->rep_) =
-        std::make_tuple(arena_, current_size_, total_size_, rep_);
-    std::tie(arena_, current_size_, total_size_, rep_) = temp;
+                                rhs->total_size_, rhs->tagged_rep_or_elem_);
+    std::tie(rhs->arena_, rhs->current_size_, rhs->total_size_,
+             rhs->tagged_rep_or_elem_) =
+        std::make_tuple(arena_, current_size_, total_size_,
+                        tagged_rep_or_elem_);
+    std::tie(arena_, current_size_, total_size_, tagged_rep_or_elem_) = temp;
   }
 
   // Prepares the container for adding elements via `AddAllocatedForParse`.
   // It ensures some invariants to avoid checking then in the Add loop:
-  //  - rep_ is not null.
+  //  - there is room for at least one more element.
   //  - there are no preallocated elements.
   //  Returns true if the invariants hold and `AddAllocatedForParse` can be
   //  used.
@@ -325,7 +337,7 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
     if (current_size_ == total_size_) {
       InternalExtend(1);
     }
-    return rep_->allocated_size == current_size_;
+    return allocated_size() == current_size_;
   }
 
   // Similar to `AddAllocated` but faster.
@@ -333,14 +345,13 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   // or other calls to `AddAllocatedForParse`.
   template <typename TypeHandler>
   void AddAllocatedForParse(typename TypeHandler::Type* value) {
-    PROTOBUF_ASSUME(rep_ != nullptr);
-    PROTOBUF_ASSUME(current_size_ == rep_->allocated_size);
+    PROTOBUF_ASSUME(current_size_ == allocated_size());
     if (current_size_ == total_size_) {
       // The array is completely full with no cleared objects, so grow it.
       InternalExtend(1);
     }
-    rep_->elements[current_size_++] = value;
-    ++rep_->allocated_size;
+    elements()[current_size_++] = value;
+    if (!using_sso()) ++rep()->allocated_size;
   }
 
  protected:
@@ -348,7 +359,7 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   void RemoveLast() {
     GOOGLE_DCHECK_GT(current_size_, 0);
     ExchangeCurrentSize(current_size_ - 1);
-    TypeHandler::Clear(cast<TypeHandler>(rep_->elements[current_size_]));
+    TypeHandler::Clear(cast<TypeHandler>(element_at(current_size_)));
   }
 
   template <typename TypeHandler>
@@ -371,10 +382,8 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   }
 
   // Used for constructing iterators.
-  void* const* raw_data() const { return rep_ ? rep_->elements : nullptr; }
-  void** raw_mutable_data() const {
-    return rep_ ? const_cast<void**>(rep_->elements) : nullptr;
-  }
+  void* const* raw_data() const { return elements(); }
+  void** raw_mutable_data() const { return const_cast<void**>(elements()); }
 
   template <typename TypeHandler>
   typename TypeHandler::Type** mutable_data() {
@@ -408,18 +417,21 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
 
   void SwapElements(int index1, int index2) {
     using std::swap;  // enable ADL with fallback
-    swap(rep_->elements[index1], rep_->elements[index2]);
+    swap(elements()[index1], elements()[index2]);
   }
 
   template <typename TypeHandler>
   size_t SpaceUsedExcludingSelfLong() const {
-    size_t allocated_bytes = static_cast<size_t>(total_size_) * sizeof(void*);
-    if (rep_ != nullptr) {
-      for (int i = 0; i < rep_->allocated_size; ++i) {
-        allocated_bytes +=
-            TypeHandler::SpaceUsedLong(*cast<TypeHandler>(rep_->elements[i]));
-      }
-      allocated_bytes += kRepHeaderSize;
+    // The first element is stored inline and takes no extra space.
+    size_t allocated_bytes =
+        using_sso()
+            ? 0
+            : static_cast<size_t>(total_size_) * sizeof(void*) + kRepHeaderSize;
+    const int n = allocated_size();
+    void* const* elems = elements();
+    for (int i = 0; i < n; ++i) {
+      allocated_bytes +=
+          TypeHandler::SpaceUsedLong(*cast<TypeHandler>(elems[i]));
     }
     return allocated_bytes;
   }
@@ -429,9 +441,9 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   // Like Add(), but if there are no cleared objects to use, returns nullptr.
   template <typename TypeHandler>
   typename TypeHandler::Type* AddFromCleared() {
-    if (rep_ != nullptr && current_size_ < rep_->allocated_size) {
+    if (current_size_ < allocated_size()) {
       return cast<TypeHandler>(
-          rep_->elements[ExchangeCurrentSize(current_size_ + 1)]);
+          element_at(ExchangeCurrentSize(current_size_ + 1)));
     } else {
       return nullptr;
     }
@@ -446,28 +458,30 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   template <typename TypeHandler>
   void UnsafeArenaAddAllocated(typename TypeHandler::Type* value) {
     // Make room for the new pointer.
-    if (!rep_ || current_size_ == total_size_) {
+    if (current_size_ == total_size_) {
       // The array is completely full with no cleared objects, so grow it.
       Reserve(total_size_ + 1);
-      ++rep_->allocated_size;
-    } else if (rep_->allocated_size == total_size_) {
+      ++rep()->allocated_size;
+    } else if (allocated_size() == total_size_) {
       // There is no more space in the pointer array because it contains some
       // cleared objects awaiting reuse.  We don't want to grow the array in
       // this case because otherwise a loop calling AddAllocated() followed by
       // Clear() would leak memory.
-      TypeHandler::Delete(cast<TypeHandler>(rep_->elements[current_size_]),
+      TypeHandler::Delete(cast<TypeHandler>(element_at(current_size_)),
                           arena_);
-    } else if (current_size_ < rep_->allocated_size) {
+    } else if (current_size_ < allocated_size()) {
       // We have some cleared objects.  We don't care about their order, so we
-      // can just move the first one to the end to make space.
-      rep_->elements[rep_->allocated_size] = rep_->elements[current_size_];
-      ++rep_->allocated_size;
-    } else {
+      // can just move the first one to the end to make space.  This cannot
+      // happen with inline storage, whose only slot is then taken.
+      Rep* r = rep();
+      r->elements[r->allocated_size] = r->elements[current_size_];
+      ++r->allocated_size;
+    } else if (!using_sso()) {
       // There are no cleared objects.
-      ++rep_->allocated_size;
+      ++rep()->allocated_size;
     }
 
-    rep_->elements[ExchangeCurrentSize(current_size_ + 1)] = value;
+    elements()[ExchangeCurrentSize(current_size_ + 1)] = value;
   }
 
   template <typename TypeHandler>
@@ -483,20 +497,25 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   typename TypeHandler::Type* UnsafeArenaReleaseLast() {
     GOOGLE_DCHECK_GT(current_size_, 0);
     ExchangeCurrentSize(current_size_ - 1);
+    if (using_sso()) {
+      typename TypeHandler::Type* result =
+          cast<TypeHandler>(tagged_rep_or_elem_);
+      tagged_rep_or_elem_ = nullptr;
+      return result;
+    }
+    Rep* r = rep();
     typename TypeHandler::Type* result =
-        cast<TypeHandler>(rep_->elements[current_size_]);
-    --rep_->allocated_size;
-    if (current_size_ < rep_->allocated_size) {
+        cast<TypeHandler>(r->elements[current_size_]);
+    --r->allocated_size;
+    if (current_size_ < r->allocated_size) {
       // There are cleared elements on the end; replace the removed element
       // with the last allocated element.
-      rep_->elements[current_size_] = rep_->elements[rep_->allocated_size];
+      r->elements[current_size_] = r->elements[r->allocated_size];
     }
     return result;
   }
 
-  int ClearedCount() const {
-    return rep_ ? (rep_->allocated_size - current_size_) : 0;
-  }
+  int ClearedCount() const { return allocated_size() - current_size_; }
 
   template <typename TypeHandler>
   void AddCleared(typename TypeHandler::Type* value) {
@@ -504,10 +523,15 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
                                            "RepeatedPtrField not on an arena.";
     GOOGLE_DCHECK(TypeHandler::GetOwningArena(value) == nullptr)
         << "AddCleared() can only accept values not on an arena.";
-    if (!rep_ || rep_->allocated_size == total_size_) {
+    if (allocated_size() == total_size_) {
       Reserve(total_size_ + 1);
     }
-    rep_->elements[rep_->allocated_size++] = value;
+    if (using_sso()) {
+      tagged_rep_or_elem_ = value;
+    } else {
+      Rep* r = rep();
+      r->elements[r->allocated_size++] = value;
+    }
   }
 
   template <typename TypeHandler>
@@ -516,9 +540,14 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
         << "ReleaseCleared() can only be used on a RepeatedPtrField not on "
         << "an arena.";
     GOOGLE_DCHECK(GetOwningArena() == nullptr);
-    GOOGLE_DCHECK(rep_ != nullptr);
-    GOOGLE_DCHECK_GT(rep_->allocated_size, current_size_);
-    return cast<TypeHandler>(rep_->elements[--rep_->allocated_size]);
+    GOOGLE_DCHECK_GT(allocated_size(), current_size_);
+    if (using_sso()) {
+      auto* result = cast<TypeHandler>(tagged_rep_or_elem_);
+      tagged_rep_or_elem_ = nullptr;
+      return result;
+    }
+    Rep* r = rep();
+    return cast<TypeHandler>(r->elements[--r->allocated_size]);
   }
 
   template <typename TypeHandler>
@@ -527,18 +556,11 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
     Arena* element_arena =
         reinterpret_cast<Arena*>(TypeHandler::GetOwningArena(value));
     Arena* arena = GetOwningArena();
-    if (arena == element_arena && rep_ && rep_->allocated_size < total_size_) {
+    if (arena == element_arena && allocated_size() < total_size_) {
       // Fast path: underlying arena representation (tagged pointer) is equal to
       // our arena pointer, and we can add to array without resizing it (at
       // least one slot that is not allocated).
-      void** elems = rep_->elements;
-      if (current_size_ < rep_->allocated_size) {
-        // Make space at [current] by moving first allocated element to end of
-        // allocated list.
-        elems[rep_->allocated_size] = elems[current_size_];
-      }
-      elems[ExchangeCurrentSize(current_size_ + 1)] = value;
-      rep_->allocated_size = rep_->allocated_size + 1;
+      AddToUnallocatedSlot(value);
     } else {
       AddAllocatedSlowWithCopy<TypeHandler>(value, element_arena, arena);
     }
@@ -549,18 +571,10 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
       // AddAllocated version that does not implement arena-safe copying
       // behavior.
       typename TypeHandler::Type* value, std::false_type) {
-    if (rep_ && rep_->allocated_size < total_size_) {
-      // Fast path: underlying arena representation (tagged pointer) is equal to
-      // our arena pointer, and we can add to array without resizing it (at
-      // least one slot that is not allocated).
-      void** elems = rep_->elements;
-      if (current_size_ < rep_->allocated_size) {
-        // Make space at [current] by moving first allocated element to end of
-        // allocated list.
-        elems[rep_->allocated_size] = elems[current_size_];
-      }
-      elems[ExchangeCurrentSize(current_size_ + 1)] = value;
-      ++rep_->allocated_size;
+    if (allocated_size() < total_size_) {
+      // Fast path: we can add to array without resizing it (at least one slot
+      // that is not allocated).
+      AddToUnallocatedSlot(value);
     } else {
       UnsafeArenaAddAllocated<TypeHandler>(value);
     }
@@ -636,7 +650,7 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
     this->Clear<TypeHandler>();
     this->MergeFrom<TypeHandler>(*other);
     other->InternalSwap(&temp);
-    temp.Destroy<TypeHandler>();  // Frees rep_ if `other` had no arena.
+    temp.Destroy<TypeHandler>();  // Frees the rep if `other` had no arena.
   }
 
   // Gets the Arena on which this RepeatedPtrField stores its elements.
@@ -668,6 +682,14 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   // misses due to the indirection, because these fields are checked frequently.
   // Placing all fields directly in the RepeatedPtrFieldBase instance would cost
   // significant performance for memory-sensitive workloads.
+  //
+  // Most repeated fields hold zero or one element, so the first element is
+  // stored inline: until a second element is added, tagged_rep_or_elem_ is the
+  // element itself (or nullptr) instead of a pointer to a Rep, and no Rep is
+  // allocated at all.  A Rep pointer is told apart by its low bit, which is
+  // set; element pointers are at least 2-byte aligned.
+  static constexpr int kSSOCapacity = 1;
+
   Arena* arena_;
   int current_size_;
   int total_size_;
@@ -689,7 +711,61 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
                    sizeof(void*)];
   };
   static constexpr size_t kRepHeaderSize = offsetof(Rep, elements);
-  Rep* rep_;
+  void* tagged_rep_or_elem_;
+
+  // Returns true if the field holds at most one element inline.
+  bool using_sso() const {
+    return (reinterpret_cast<uintptr_t>(tagged_rep_or_elem_) & 1) == 0;
+  }
+  Rep* rep() const {
+    GOOGLE_DCHECK(!using_sso());
+    return reinterpret_cast<Rep*>(
+        reinterpret_cast<uintptr_t>(tagged_rep_or_elem_) - 1);
+  }
+  void set_rep(Rep* r) {
+    tagged_rep_or_elem_ =
+        reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(r) + 1);
+  }
+
+  // The element array: the inline slot or the elements of the Rep.
+  void* const* elements() const {
+    return using_sso() ? &tagged_rep_or_elem_ : +rep()->elements;
+  }
+  void** elements() {
+    return using_sso() ? &tagged_rep_or_elem_ : +rep()->elements;
+  }
+  void* element_at(int index) const {
+    if (using_sso()) {
+      GOOGLE_DCHECK_EQ(index, 0);
+      return tagged_rep_or_elem_;
+    }
+    return rep()->elements[index];
+  }
+
+  // Number of elements, including cleared ones, that have been allocated.
+  int allocated_size() const {
+    return using_sso() ? (tagged_rep_or_elem_ != nullptr ? 1 : 0)
+                       : rep()->allocated_size;
+  }
+
+  // Adds `value` as the next element.  Requires allocated_size() <
+  // total_size_; cleared objects, if any, stay allocated.
+  void AddToUnallocatedSlot(void* value) {
+    if (using_sso()) {
+      GOOGLE_DCHECK_EQ(current_size_, 0);
+      tagged_rep_or_elem_ = value;
+      ExchangeCurrentSize(1);
+      return;
+    }
+    Rep* r = rep();
+    if (current_size_ < r->allocated_size) {
+      // Make space at [current] by moving first allocated element to end of
+      // allocated list.
+      r->elements[r->allocated_size] = r->elements[current_size_];
+    }
+    r->elements[ExchangeCurrentSize(current_size_ + 1)] = value;
+    ++r->allocated_size;
+  }
 
   template <typename TypeHandler>
   static inline typename TypeHandler::Type* cast(void* element) {
@@ -705,12 +781,12 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   template <typename TypeHandler>
   PROTOBUF_NOINLINE void ClearNonEmpty() {
     const int n = current_size_;
-    void* const* elements = rep_->elements;
+    void* const* elems = elements();
     int i = 0;
     GOOGLE_DCHECK_GT(n,
               0);  // do/while loop to avoid initial test because we know n > 0
     do {
-      TypeHandler::Clear(cast<TypeHandler>(elements[i++]));
+      TypeHandler::Clear(cast<TypeHandler>(elems[i++]));
     } while (i < n);
     ExchangeCurrentSize(0);
   }
@@ -720,16 +796,17 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   PROTOBUF_NOINLINE void MergeFromInternal(
       const RepeatedPtrFieldBase& other,
       void (RepeatedPtrFieldBase::*inner_loop)(void**, void**, int, int)) {
-    // Note: wrapper has already guaranteed that other.rep_ != nullptr here.
+    // Note: wrapper has already guaranteed that other is not empty here.
     int other_size = other.current_size_;
-    void** other_elements = other.rep_->elements;
+    void** other_elements = const_cast<void**>(other.elements());
     void** new_elements = InternalExtend(other_size);
-    int allocated_elems = rep_->allocated_size - current_size_;
+    int allocated_elems = allocated_size() - current_size_;
     (this->*inner_loop)(new_elements, other_elements, other_size,
                         allocated_elems);
     ExchangeCurrentSize(current_size_ + other_size);
-    if (rep_->allocated_size < current_size_) {
-      rep_->allocated_size = current_size_;
+    // With inline storage, writing the element made it allocated.
+    if (!using_sso() && rep()->allocated_size < current_size_) {
+      rep()->allocated_size = current_size_;
     }
   }
 
@@ -0,0 +1,100 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "google/protobuf/string_piece_field.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/parse_context.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+void StringPieceField::Destroy() {
+  delete[] reinterpret_cast<char*>(rep_);
+  rep_ = nullptr;
+}
+
+void StringPieceField::Set(absl::string_view value, Arena* arena) {
+  if (rep_ == nullptr || rep_->capacity < value.size()) {
+    if (value.empty()) return;
+    GOOGLE_DCHECK_LE(value.size(), std::numeric_limits<uint32_t>::max());
+    // Arena buffers are sized exactly: the old one cannot be freed, so
+    // leaving room to grow would only waste more of the arena.
+    if (arena == nullptr) delete[] reinterpret_cast<char*>(rep_);
+    rep_ = reinterpret_cast<Rep*>(
+        Arena::CreateArray<char>(arena, sizeof(Rep) + value.size()));
+    rep_->capacity = static_cast<uint32_t>(value.size());
+  }
+  // A value that fits may point into our own buffer, hence memmove.
+  if (!value.empty()) memmove(rep_->data(), value.data(), value.size());
+  rep_->size = static_cast<uint32_t>(value.size());
+}
+
+void StringPieceField::Swap(StringPieceField* lhs, Arena* lhs_arena,
+                            StringPieceField* rhs, Arena* rhs_arena) {
+  if (lhs_arena == rhs_arena) {
+    lhs->InternalSwap(rhs);
+    return;
+  }
+  std::string tmp(lhs->Get());
+  lhs->Set(rhs->Get(), lhs_arena);
+  rhs->Set(tmp, rhs_arena);
+}
+
+const char* EpsCopyInputStream::ReadStringPieceField(const char* ptr,
+                                                     StringPieceField* s,
+                                                     Arena* arena) {
+  int size = ReadSize(&ptr);
+  if (!ptr) return nullptr;
+  if (size <= buffer_end_ + kSlopBytes - ptr) {
+    s->Set(absl::string_view(ptr, size), arena);
+    return ptr + size;
+  }
+  // The value spans several buffers.  Read it into a string first, which only
+  // grows as the bytes actually arrive, rather than trusting the size.
+  std::string value;
+  ptr = ReadStringFallback(ptr, size, &value);
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  s->Set(value, arena);
+  return ptr;
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
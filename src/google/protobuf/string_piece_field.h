@@ -0,0 +1,119 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// This file is internal to the protocol buffer library; it is included by
+// generated code for messages with [ctype = STRING_PIECE] string or bytes
+// fields and should not be used directly.
+
+#ifndef GOOGLE_PROTOBUF_STRING_PIECE_FIELD_H__
+#define GOOGLE_PROTOBUF_STRING_PIECE_FIELD_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "google/protobuf/arena.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+#ifdef SWIG
+#error "You cannot SWIG proto headers"
+#endif
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// StringPieceField is the storage for a singular string or bytes field with
+// [ctype = STRING_PIECE].  Such fields are read and written as
+// absl::string_view, so unlike ArenaStringPtr there is no std::string object
+// behind them: the value is a single buffer holding a small length header
+// followed by the bytes.  On an arena the buffer is allocated from the arena
+// and needs no cleanup, so a string-heavy message costs one allocation per
+// field and nothing at all when the arena is reset.  On the heap the buffer is
+// reused for later values that fit.
+//
+// Like the other field representations, StringPieceField does not release the
+// memory it owns on destruction: Destroy() must be called when the enclosing
+// message is not on an arena.
+class PROTOBUF_EXPORT StringPieceField {
+ public:
+  constexpr StringPieceField() {}
+  StringPieceField(const StringPieceField&) = delete;
+  StringPieceField& operator=(const StringPieceField&) = delete;
+
+  // Frees the buffer.  Must only be called when the enclosing message is not
+  // on an arena.
+  void Destroy();
+
+  absl::string_view Get() const {
+    if (rep_ == nullptr) return absl::string_view();
+    return absl::string_view(rep_->data(), rep_->size);
+  }
+  void Set(absl::string_view value, Arena* arena);
+  // Empties the field, keeping the buffer for later values.
+  void Clear() {
+    if (rep_ != nullptr) rep_->size = 0;
+  }
+
+  // Swaps two fields that live on the same arena.
+  void InternalSwap(StringPieceField* other) {
+    Rep* tmp = rep_;
+    rep_ = other->rep_;
+    other->rep_ = tmp;
+  }
+  // Swaps two fields that may live on different arenas.
+  static void Swap(StringPieceField* lhs, Arena* lhs_arena,
+                   StringPieceField* rhs, Arena* rhs_arena);
+
+  size_t SpaceUsedExcludingSelfLong() const {
+    return rep_ == nullptr ? 0 : sizeof(Rep) + rep_->capacity;
+  }
+
+ private:
+  // The header of the buffer; the bytes follow it directly.
+  struct Rep {
+    uint32_t size;
+    uint32_t capacity;
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+  };
+
+  Rep* rep_ = nullptr;
+};
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_STRING_PIECE_FIELD_H__
@@ -0,0 +1,173 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/string_piece_field.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+TEST(StringPieceFieldTest, SetAndGet) {
+  StringPieceField field;
+  EXPECT_EQ(field.Get(), "");
+  EXPECT_EQ(field.SpaceUsedExcludingSelfLong(), 0);
+
+  field.Set("hello", nullptr);
+  EXPECT_EQ(field.Get(), "hello");
+  const char* data = field.Get().data();
+
+  // Values that fit reuse the buffer, including ones that alias it.
+  field.Set("bye", nullptr);
+  EXPECT_EQ(field.Get(), "bye");
+  EXPECT_EQ(field.Get().data(), data);
+  field.Set(field.Get().substr(1), nullptr);
+  EXPECT_EQ(field.Get(), "ye");
+
+  field.Clear();
+  EXPECT_EQ(field.Get(), "");
+  field.Set(std::string(100, 'x'), nullptr);
+  EXPECT_EQ(field.Get(), std::string(100, 'x'));
+  field.Destroy();
+  EXPECT_EQ(field.Get(), "");
+}
+
+TEST(StringPieceFieldTest, SwapAcrossArenas) {
+  Arena arena;
+  StringPieceField heap_field;
+  StringPieceField arena_field;
+  heap_field.Set("heap", nullptr);
+  arena_field.Set("arena", &arena);
+
+  StringPieceField::Swap(&heap_field, nullptr, &arena_field, &arena);
+  EXPECT_EQ(heap_field.Get(), "arena");
+  EXPECT_EQ(arena_field.Get(), "heap");
+  heap_field.Destroy();
+}
+
+TEST(StringPieceFieldTest, GeneratedAccessors) {
+  TestAllTypes message;
+  EXPECT_FALSE(message.has_optional_string_piece());
+  EXPECT_EQ(message.optional_string_piece(), "");
+
+  message.set_optional_string_piece("abc");
+  EXPECT_TRUE(message.has_optional_string_piece());
+  EXPECT_EQ(message.optional_string_piece(), "abc");
+
+  TestAllTypes copy(message);
+  EXPECT_EQ(copy.optional_string_piece(), "abc");
+
+  message.Clear();
+  EXPECT_FALSE(message.has_optional_string_piece());
+  EXPECT_EQ(message.optional_string_piece(), "");
+}
+
+TEST(StringPieceFieldTest, RoundTrip) {
+  TestAllTypes message;
+  message.set_optional_string_piece(std::string(300, 'a'));
+  std::string data = message.SerializeAsString();
+
+  TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(data));
+  EXPECT_TRUE(parsed.has_optional_string_piece());
+  EXPECT_EQ(parsed.optional_string_piece(), std::string(300, 'a'));
+  EXPECT_EQ(parsed.SerializeAsString(), data);
+
+  Arena arena;
+  auto* arena_message = Arena::CreateMessage<TestAllTypes>(&arena);
+  ASSERT_TRUE(arena_message->ParseFromString(data));
+  EXPECT_EQ(arena_message->optional_string_piece(), std::string(300, 'a'));
+  EXPECT_EQ(arena_message->SerializeAsString(), data);
+}
+
+TEST(StringPieceFieldTest, ArenaValuesNeedNoCleanup) {
+  Arena arena;
+  auto* message = Arena::CreateMessage<TestAllTypes>(&arena);
+  message->set_optional_string_piece("x");
+  const uint64_t used = arena.SpaceUsed();
+  // Each new value takes only its bytes and the small buffer header from the
+  // arena; no std::string and no cleanup node are allocated.
+  message->set_optional_string_piece(std::string(64, 'y'));
+  EXPECT_LE(arena.SpaceUsed() - used, 64 + 2 * sizeof(uint32_t) + 8);
+}
+
+TEST(StringPieceFieldTest, SwapMessagesAcrossArenas) {
+  Arena arena;
+  auto* arena_message = Arena::CreateMessage<TestAllTypes>(&arena);
+  arena_message->set_optional_string_piece("arena");
+  TestAllTypes heap_message;
+  heap_message.set_optional_string_piece("heap");
+
+  arena_message->Swap(&heap_message);
+  EXPECT_EQ(arena_message->optional_string_piece(), "heap");
+  EXPECT_EQ(heap_message.optional_string_piece(), "arena");
+}
+
+TEST(StringPieceFieldTest, Reflection) {
+  TestAllTypes message;
+  const Reflection* reflection = message.GetReflection();
+  const FieldDescriptor* field =
+      message.GetDescriptor()->FindFieldByName("optional_string_piece");
+  ASSERT_NE(field, nullptr);
+
+  reflection->SetString(&message, field, "reflected");
+  EXPECT_TRUE(reflection->HasField(message, field));
+  EXPECT_EQ(message.optional_string_piece(), "reflected");
+  EXPECT_EQ(reflection->GetString(message, field), "reflected");
+  std::string scratch;
+  EXPECT_EQ(reflection->GetStringReference(message, field, &scratch),
+            "reflected");
+  EXPECT_GT(message.SpaceUsedLong(), sizeof(message));
+
+  TestAllTypes other;
+  reflection->SwapFields(&message, &other, {field});
+  EXPECT_FALSE(message.has_optional_string_piece());
+  EXPECT_EQ(other.optional_string_piece(), "reflected");
+
+  reflection->ClearField(&other, field);
+  EXPECT_FALSE(other.has_optional_string_piece());
+  EXPECT_EQ(other.optional_string_piece(), "");
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
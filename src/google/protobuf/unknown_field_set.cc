@@ -62,31 +62,28 @@ const UnknownFieldSet& UnknownFieldSet::default_instance() {
 
 void UnknownFieldSet::ClearFallback() {
   GOOGLE_DCHECK(!fields_.empty());
+  Arena* arena = GetArena();
   int n = fields_.size();
   do {
-    (fields_)[--n].Delete();
+    fields_.Mutable(--n)->Delete(arena);
   } while (n > 0);
-  fields_.clear();
+  fields_.Clear();
 }
 
 void UnknownFieldSet::InternalMergeFrom(const UnknownFieldSet& other) {
-  int other_field_count = other.field_count();
-  if (other_field_count > 0) {
-    fields_.reserve(fields_.size() + other_field_count);
-    for (int i = 0; i < other_field_count; i++) {
-      fields_.push_back((other.fields_)[i]);
-      fields_.back().DeepCopy((other.fields_)[i]);
-    }
-  }
+  MergeFrom(other);
 }
 
 void UnknownFieldSet::MergeFrom(const UnknownFieldSet& other) {
   int other_field_count = other.field_count();
   if (other_field_count > 0) {
-    fields_.reserve(fields_.size() + other_field_count);
+    Arena* arena = GetArena();
+    fields_.Reserve(fields_.size() + other_field_count);
     for (int i = 0; i < other_field_count; i++) {
-      fields_.push_back((other.fields_)[i]);
-      fields_.back().DeepCopy((other.fields_)[i]);
+      const UnknownField& field = other.fields_.Get(i);
+      UnknownField* copy = fields_.AddAlreadyReserved();
+      *copy = field;
+      copy->DeepCopy(field, arena);
     }
   }
 }
@@ -94,14 +91,30 @@ void UnknownFieldSet::MergeFrom(const UnknownFieldSet& other) {
 // A specialized MergeFrom for performance when we are merging from an UFS that
 // is temporary and can be destroyed in the process.
 void UnknownFieldSet::MergeFromAndDestroy(UnknownFieldSet* other) {
+  if (GetArena() != other->GetArena()) {
+    // The fields of `other` are owned by another arena (or by the heap) and
+    // cannot be adopted.
+    MergeFrom(*other);
+    other->Clear();
+    return;
+  }
   if (fields_.empty()) {
-    fields_ = std::move(other->fields_);
+    fields_.InternalSwap(&other->fields_);
   } else {
-    fields_.insert(fields_.end(),
-                   std::make_move_iterator(other->fields_.begin()),
-                   std::make_move_iterator(other->fields_.end()));
+    fields_.Add(other->fields_.begin(), other->fields_.end());
+    // Ownership of the pointers has moved to this set.
+    other->fields_.Clear();
   }
-  other->fields_.clear();
+}
+
+void UnknownFieldSet::SwapFallback(UnknownFieldSet* other) {
+  GOOGLE_DCHECK_NE(GetArena(), other->GetArena());
+  UnknownFieldSet temp(other->GetArena());
+  temp.MergeFrom(*this);
+  Clear();
+  MergeFrom(*other);
+  other->Clear();
+  other->MergeFromAndDestroy(&temp);
 }
 
 void UnknownFieldSet::MergeToInternalMetadata(
@@ -112,7 +125,7 @@ void UnknownFieldSet::MergeToInternalMetadata(
 size_t UnknownFieldSet::SpaceUsedExcludingSelfLong() const {
   if (fields_.empty()) return 0;
 
-  size_t total_size = sizeof(UnknownField) * fields_.capacity();
+  size_t total_size = fields_.SpaceUsedExcludingSelfLong();
 
   for (const UnknownField& field : fields_) {
     switch (field.type()) {
@@ -140,7 +153,7 @@ void UnknownFieldSet::AddVarint(int number, uint64_t value) {
   field.number_ = number;
   field.SetType(UnknownField::TYPE_VARINT);
   field.data_.varint_ = value;
-  fields_.push_back(field);
+  fields_.Add(field);
 }
 
 void UnknownFieldSet::AddFixed32(int number, uint32_t value) {
@@ -148,7 +161,7 @@ void UnknownFieldSet::AddFixed32(int number, uint32_t value) {
   field.number_ = number;
   field.SetType(UnknownField::TYPE_FIXED32);
   field.data_.fixed32_ = value;
-  fields_.push_back(field);
+  fields_.Add(field);
 }
 
 void UnknownFieldSet::AddFixed64(int number, uint64_t value) {
@@ -156,15 +169,16 @@ void UnknownFieldSet::AddFixed64(int number, uint64_t value) {
   field.number_ = number;
   field.SetType(UnknownField::TYPE_FIXED64);
   field.data_.fixed64_ = value;
-  fields_.push_back(field);
+  fields_.Add(field);
 }
 
 std::string* UnknownFieldSet::AddLengthDelimited(int number) {
   UnknownField field;
   field.number_ = number;
   field.SetType(UnknownField::TYPE_LENGTH_DELIMITED);
-  field.data_.length_delimited_.string_value = new std::string;
-  fields_.push_back(field);
+  field.data_.length_delimited_.string_value =
+      Arena::Create<std::string>(GetArena());
+  fields_.Add(field);
   return field.data_.length_delimited_.string_value;
 }
 
@@ -173,49 +187,50 @@ UnknownFieldSet* UnknownFieldSet::AddGroup(int number) {
   UnknownField field;
   field.number_ = number;
   field.SetType(UnknownField::TYPE_GROUP);
-  field.data_.group_ = new UnknownFieldSet;
-  fields_.push_back(field);
+  field.data_.group_ = Arena::CreateMessage<UnknownFieldSet>(GetArena());
+  fields_.Add(field);
   return field.data_.group_;
 }
 
 void UnknownFieldSet::AddField(const UnknownField& field) {
-  fields_.push_back(field);
-  fields_.back().DeepCopy(field);
+  UnknownField* copy = fields_.Add();
+  *copy = field;
+  copy->DeepCopy(field, GetArena());
 }
 
 void UnknownFieldSet::DeleteSubrange(int start, int num) {
+  Arena* arena = GetArena();
   // Delete the specified fields.
   for (int i = 0; i < num; ++i) {
-    (fields_)[i + start].Delete();
+    fields_.Mutable(i + start)->Delete(arena);
   }
   // Slide down the remaining fields.
-  for (size_t i = start + num; i < fields_.size(); ++i) {
-    (fields_)[i - num] = (fields_)[i];
+  for (int i = start + num; i < fields_.size(); ++i) {
+    fields_[i - num] = fields_[i];
   }
   // Pop off the # of deleted fields.
-  for (int i = 0; i < num; ++i) {
-    fields_.pop_back();
-  }
+  fields_.Truncate(fields_.size() - num);
 }
 
 void UnknownFieldSet::DeleteByNumber(int number) {
-  size_t left = 0;  // The number of fields left after deletion.
-  for (size_t i = 0; i < fields_.size(); ++i) {
-    UnknownField* field = &(fields_)[i];
+  Arena* arena = GetArena();
+  int left = 0;  // The number of fields left after deletion.
+  for (int i = 0; i < fields_.size(); ++i) {
+    UnknownField* field = fields_.Mutable(i);
     if (field->number() == number) {
-      field->Delete();
+      field->Delete(arena);
     } else {
       if (i != left) {
-        (fields_)[left] = (fields_)[i];
+        fields_[left] = fields_[i];
       }
       ++left;
     }
   }
-  fields_.resize(left);
+  fields_.Truncate(left);
 }
 
 bool UnknownFieldSet::MergeFromCodedStream(io::CodedInputStream* input) {
-  UnknownFieldSet other;
+  UnknownFieldSet other(GetArena());
   if (internal::WireFormat::SkipMessage(input, &other) &&
       input->ConsumedEntireMessage()) {
     MergeFromAndDestroy(&other);
@@ -255,7 +270,8 @@ bool UnknownFieldSet::SerializeToCodedStream(
   google::protobuf::internal::WireFormat::SerializeUnknownFields(*this, output);
   return !output->HadError();
 }
-void UnknownField::Delete() {
+void UnknownField::Delete(Arena* arena) {
+  if (arena != nullptr) return;
   switch (type()) {
     case UnknownField::TYPE_LENGTH_DELIMITED:
       delete data_.length_delimited_.string_value;
@@ -268,15 +284,15 @@ void UnknownField::Delete() {
   }
 }
 
-void UnknownField::DeepCopy(const UnknownField& other) {
+void UnknownField::DeepCopy(const UnknownField& other, Arena* arena) {
   (void)other;  // Parameter is used by Google-internal code.
   switch (type()) {
     case UnknownField::TYPE_LENGTH_DELIMITED:
-      data_.length_delimited_.string_value =
-          new std::string(*data_.length_delimited_.string_value);
+      data_.length_delimited_.string_value = Arena::Create<std::string>(
+          arena, *data_.length_delimited_.string_value);
       break;
     case UnknownField::TYPE_GROUP: {
-      UnknownFieldSet* group = new UnknownFieldSet();
+      UnknownFieldSet* group = Arena::CreateMessage<UnknownFieldSet>(arena);
       group->InternalMergeFrom(*data_.group_);
       data_.group_ = group;
       break;
@@ -52,6 +52,7 @@
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/port.h"
+#include "google/protobuf/repeated_field.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -69,8 +70,73 @@ class MessageSetFieldSkipperUsingCord;
 // extension_set_heavy.cc
 }  // namespace internal
 
-class Message;       // message.h
-class UnknownField;  // below
+class Message;          // message.h
+class UnknownFieldSet;  // below
+
+// Represents one field in an UnknownFieldSet.
+class PROTOBUF_EXPORT UnknownField {
+ public:
+  enum Type {
+    TYPE_VARINT,
+    TYPE_FIXED32,
+    TYPE_FIXED64,
+    TYPE_LENGTH_DELIMITED,
+    TYPE_GROUP
+  };
+
+  // The field's field number, as seen on the wire.
+  inline int number() const;
+
+  // The field type.
+  inline Type type() const;
+
+  // Accessors -------------------------------------------------------
+  // Each method works only for UnknownFields of the corresponding type.
+
+  inline uint64_t varint() const;
+  inline uint32_t fixed32() const;
+  inline uint64_t fixed64() const;
+  inline const std::string& length_delimited() const;
+  inline const UnknownFieldSet& group() const;
+
+  inline void set_varint(uint64_t value);
+  inline void set_fixed32(uint32_t value);
+  inline void set_fixed64(uint64_t value);
+  inline void set_length_delimited(const std::string& value);
+  inline std::string* mutable_length_delimited();
+  inline UnknownFieldSet* mutable_group();
+
+  inline size_t GetLengthDelimitedSize() const;
+  uint8_t* InternalSerializeLengthDelimitedNoTag(
+      uint8_t* target, io::EpsCopyOutputStream* stream) const;
+
+
+  // If this UnknownField contains a pointer, delete it.  `arena` is the arena
+  // of the containing set; nothing is deleted if it is non-null.
+  void Delete(Arena* arena);
+
+  // Make a deep copy of any pointers in this UnknownField, allocating them on
+  // `arena`.
+  void DeepCopy(const UnknownField& other, Arena* arena);
+
+  // Set the wire type of this UnknownField. Should only be used when this
+  // UnknownField is being created.
+  inline void SetType(Type type);
+
+  union LengthDelimited {
+    std::string* string_value;
+  };
+
+  uint32_t number_;
+  uint32_t type_;
+  union {
+    uint64_t varint_;
+    uint32_t fixed32_;
+    uint64_t fixed64_;
+    mutable union LengthDelimited length_delimited_;
+    UnknownFieldSet* group_;
+  } data_;
+};
 
 // An UnknownFieldSet contains fields that were encountered while parsing a
 // message but were not defined by its type.  Keeping track of these can be
@@ -84,9 +150,18 @@ class UnknownField;  // below
 //
 // This class is necessarily tied to the protocol buffer wire format, unlike
 // the Reflection interface which is independent of any serialization scheme.
+//
+// The unknown fields of a message allocated on an arena are stored on the
+// same arena: the field array, the contents of length-delimited fields and
+// nested groups are all arena-allocated and are released together with the
+// arena rather than one by one.
 class PROTOBUF_EXPORT UnknownFieldSet {
  public:
   UnknownFieldSet();
+  // Creates a set whose contents are allocated on `arena`.  The set must not
+  // outlive the arena.  UnknownFieldSet(nullptr) is the same as
+  // UnknownFieldSet().
+  explicit UnknownFieldSet(Arena* arena);
   UnknownFieldSet(const UnknownFieldSet&) = delete;
   UnknownFieldSet& operator=(const UnknownFieldSet&) = delete;
   ~UnknownFieldSet();
@@ -112,9 +187,14 @@ class PROTOBUF_EXPORT UnknownFieldSet {
   static void MergeToInternalMetadata(const UnknownFieldSet& other,
                                       internal::InternalMetadata* metadata);
 
-  // Swaps the contents of some other UnknownFieldSet with this one.
+  // Swaps the contents of some other UnknownFieldSet with this one.  Sets on
+  // different arenas swap by copying.
   inline void Swap(UnknownFieldSet* x);
 
+  // Returns the arena the contents of this set are allocated on, or nullptr
+  // if they are heap-allocated.
+  Arena* GetArena() const { return fields_.GetArena(); }
+
   // Computes (an estimate of) the total number of bytes currently used for
   // storing the unknown fields in memory. Does NOT include
   // sizeof(*this) in the calculation.
@@ -185,10 +265,17 @@ class PROTOBUF_EXPORT UnknownFieldSet {
  private:
   // For InternalMergeFrom
   friend class UnknownField;
+  // Nested groups are created with Arena::CreateMessage() so that those on an
+  // arena need no cleanup.
+  friend class Arena;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+
   // Merges from other UnknownFieldSet. This method assumes, that this object
   // is newly created and has no fields.
   void InternalMergeFrom(const UnknownFieldSet& other);
   void ClearFallback();
+  void SwapFallback(UnknownFieldSet* other);
 
   template <typename MessageType,
             typename std::enable_if<
@@ -211,7 +298,7 @@ class PROTOBUF_EXPORT UnknownFieldSet {
     return MergeFromCodedStream(&coded_stream);
   }
 
-  std::vector<UnknownField> fields_;
+  RepeatedField<UnknownField> fields_;
 };
 
 namespace internal {
@@ -233,74 +320,13 @@ const char* UnknownFieldParse(uint64_t tag, UnknownFieldSet* unknown,
 
 }  // namespace internal
 
-// Represents one field in an UnknownFieldSet.
-class PROTOBUF_EXPORT UnknownField {
- public:
-  enum Type {
-    TYPE_VARINT,
-    TYPE_FIXED32,
-    TYPE_FIXED64,
-    TYPE_LENGTH_DELIMITED,
-    TYPE_GROUP
-  };
-
-  // The field's field number, as seen on the wire.
-  inline int number() const;
-
-  // The field type.
-  inline Type type() const;
-
-  // Accessors -------------------------------------------------------
-  // Each method works only for UnknownFields of the corresponding type.
-
-  inline uint64_t varint() const;
-  inline uint32_t fixed32() const;
-  inline uint64_t fixed64() const;
-  inline const std::string& length_delimited() const;
-  inline const UnknownFieldSet& group() const;
-
-  inline void set_varint(uint64_t value);
-  inline void set_fixed32(uint32_t value);
-  inline void set_fixed64(uint64_t value);
-  inline void set_length_delimited(const std::string& value);
-  inline std::string* mutable_length_delimited();
-  inline UnknownFieldSet* mutable_group();
-
-  inline size_t GetLengthDelimitedSize() const;
-  uint8_t* InternalSerializeLengthDelimitedNoTag(
-      uint8_t* target, io::EpsCopyOutputStream* stream) const;
-
-
-  // If this UnknownField contains a pointer, delete it.
-  void Delete();
-
-  // Make a deep copy of any pointers in this UnknownField.
-  void DeepCopy(const UnknownField& other);
-
-  // Set the wire type of this UnknownField. Should only be used when this
-  // UnknownField is being created.
-  inline void SetType(Type type);
-
-  union LengthDelimited {
-    std::string* string_value;
-  };
-
-  uint32_t number_;
-  uint32_t type_;
-  union {
-    uint64_t varint_;
-    uint32_t fixed32_;
-    uint64_t fixed64_;
-    mutable union LengthDelimited length_delimited_;
-    UnknownFieldSet* group_;
-  } data_;
-};
-
 // ===================================================================
 // inline implementations
 
 inline UnknownFieldSet::UnknownFieldSet() {}
 
+inline UnknownFieldSet::UnknownFieldSet(Arena* arena) : fields_(arena) {}
+
 inline UnknownFieldSet::~UnknownFieldSet() { Clear(); }
 
 inline void UnknownFieldSet::ClearAndFreeMemory() { Clear(); }
@@ -314,17 +340,21 @@ inline void UnknownFieldSet::Clear() {
 inline bool UnknownFieldSet::empty() const { return fields_.empty(); }
 
 inline void UnknownFieldSet::Swap(UnknownFieldSet* x) {
-  fields_.swap(x->fields_);
+  if (GetArena() == x->GetArena()) {
+    fields_.InternalSwap(&x->fields_);
+  } else {
+    SwapFallback(x);
+  }
 }
 
 inline int UnknownFieldSet::field_count() const {
-  return static_cast<int>(fields_.size());
+  return fields_.size();
 }
 inline const UnknownField& UnknownFieldSet::field(int index) const {
-  return (fields_)[static_cast<size_t>(index)];
+  return fields_.Get(index);
 }
 inline UnknownField* UnknownFieldSet::mutable_field(int index) {
-  return &(fields_)[static_cast<size_t>(index)];
+  return fields_.Mutable(index);
 }
 
 inline void UnknownFieldSet::AddLengthDelimited(int number,
@@ -51,9 +51,11 @@
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/repeated_field.h"
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/text_format.h"
 #include "google/protobuf/unittest.pb.h"
@@ -540,13 +542,15 @@ TEST_F(UnknownFieldSetTest, UnknownEnumValue) {
 TEST_F(UnknownFieldSetTest, SpaceUsedExcludingSelf) {
   UnknownFieldSet empty;
   empty.AddVarint(1, 0);
-  EXPECT_EQ(sizeof(UnknownField), empty.SpaceUsedExcludingSelf());
+  RepeatedField<UnknownField> shadow;
+  shadow.Add();
+  EXPECT_EQ(shadow.SpaceUsedExcludingSelf(), empty.SpaceUsedExcludingSelf());
 }
 
 TEST_F(UnknownFieldSetTest, SpaceUsed) {
-  // Keep shadow vectors to avoid making assumptions about its capacity growth.
-  // We imitate the push back calls here to determine the expected capacity.
-  std::vector<UnknownField> shadow_vector, shadow_vector_group;
+  // Keep shadow arrays to avoid making assumptions about their capacity
+  // growth.  We imitate the add calls here to determine the expected capacity.
+  RepeatedField<UnknownField> shadow_vector, shadow_vector_group;
   unittest::TestEmptyMessage empty_message;
 
   // Make sure an unknown field set has zero space used until a field is
@@ -556,8 +560,8 @@ TEST_F(UnknownFieldSetTest, SpaceUsed) {
   UnknownFieldSet* group = nullptr;
   const auto total = [&] {
     size_t result = base;
-    result += shadow_vector.capacity() * sizeof(UnknownField);
-    result += shadow_vector_group.capacity() * sizeof(UnknownField);
+    result += shadow_vector.SpaceUsedExcludingSelfLong();
+    result += shadow_vector_group.SpaceUsedExcludingSelfLong();
     if (str != nullptr) {
       result += sizeof(std::string);
       static const size_t sso_capacity = std::string().capacity();
@@ -574,29 +578,102 @@ TEST_F(UnknownFieldSetTest, SpaceUsed) {
 
   // Make sure each thing we add to the set increases the SpaceUsedLong().
   unknown_fields->AddVarint(1, 0);
-  shadow_vector.emplace_back();
+  shadow_vector.Add();
   EXPECT_EQ(total(), empty_message.SpaceUsedLong()) << "Var";
 
   str = unknown_fields->AddLengthDelimited(1);
-  shadow_vector.emplace_back();
+  shadow_vector.Add();
   EXPECT_EQ(total(), empty_message.SpaceUsedLong()) << "Str";
 
   str->assign(sizeof(std::string) + 1, 'x');
   EXPECT_EQ(total(), empty_message.SpaceUsedLong()) << "Str2";
 
   group = unknown_fields->AddGroup(1);
-  shadow_vector.emplace_back();
+  shadow_vector.Add();
   EXPECT_EQ(total(), empty_message.SpaceUsedLong()) << "Group";
 
   group->AddVarint(1, 0);
-  shadow_vector_group.emplace_back();
+  shadow_vector_group.Add();
   EXPECT_EQ(total(), empty_message.SpaceUsedLong()) << "Group2";
 
   unknown_fields->AddVarint(1, 0);
-  shadow_vector.emplace_back();
+  shadow_vector.Add();
   EXPECT_EQ(total(), empty_message.SpaceUsedLong()) << "Var2";
 }
 
+TEST_F(UnknownFieldSetTest, ArenaMessage) {
+  Arena arena;
+  auto* message = Arena::CreateMessage<unittest::TestEmptyMessage>(&arena);
+  ASSERT_TRUE(message->ParseFromString(all_fields_data_));
+
+  const UnknownFieldSet& unknown_fields = message->unknown_fields();
+  EXPECT_EQ(&arena, unknown_fields.GetArena());
+  bool saw_group = false;
+  for (int i = 0; i < unknown_fields.field_count(); i++) {
+    if (unknown_fields.field(i).type() == UnknownField::TYPE_GROUP) {
+      EXPECT_EQ(&arena, unknown_fields.field(i).group().GetArena());
+      saw_group = true;
+    }
+  }
+  EXPECT_TRUE(saw_group);
+  EXPECT_EQ(empty_message_.DebugString(), message->DebugString());
+
+  std::string data;
+  ASSERT_TRUE(message->SerializeToString(&data));
+  EXPECT_EQ(all_fields_data_, data);
+
+  // Fields can still be deleted and modified in place.
+  message->mutable_unknown_fields()->DeleteByNumber(
+      unittest::TestAllTypes::kOptionalInt32FieldNumber);
+  message->mutable_unknown_fields()->AddLengthDelimited(1000, "abc");
+  UnknownFieldSet* group = message->mutable_unknown_fields()->AddGroup(1001);
+  group->AddLengthDelimited(1, "def");
+  EXPECT_EQ(&arena, group->GetArena());
+  message->Clear();
+  EXPECT_TRUE(message->unknown_fields().empty());
+}
+
+TEST_F(UnknownFieldSetTest, MergeAcrossArenas) {
+  Arena arena;
+  UnknownFieldSet arena_fields(&arena);
+  arena_fields.MergeFrom(*unknown_fields_);
+  EXPECT_EQ(&arena, arena_fields.GetArena());
+  EXPECT_EQ(unknown_fields_->field_count(), arena_fields.field_count());
+
+  std::string expected, actual;
+  ASSERT_TRUE(unknown_fields_->SerializeToString(&expected));
+  ASSERT_TRUE(arena_fields.SerializeToString(&actual));
+  EXPECT_EQ(expected, actual);
+
+  // The fields of a set on another arena are copied, not adopted.
+  UnknownFieldSet heap_fields;
+  heap_fields.AddVarint(1, 2);
+  heap_fields.MergeFromAndDestroy(&arena_fields);
+  EXPECT_TRUE(arena_fields.empty());
+  ASSERT_EQ(unknown_fields_->field_count() + 1, heap_fields.field_count());
+  heap_fields.DeleteSubrange(0, 1);
+  ASSERT_TRUE(heap_fields.SerializeToString(&actual));
+  EXPECT_EQ(expected, actual);
+}
+
+TEST_F(UnknownFieldSetTest, SwapAcrossArenas) {
+  Arena arena;
+  UnknownFieldSet arena_fields(&arena);
+  arena_fields.AddLengthDelimited(1, "arena");
+  arena_fields.AddGroup(2)->AddVarint(3, 4);
+  UnknownFieldSet heap_fields;
+  heap_fields.AddLengthDelimited(5, "heap");
+
+  arena_fields.Swap(&heap_fields);
+  EXPECT_EQ(&arena, arena_fields.GetArena());
+  EXPECT_EQ(nullptr, heap_fields.GetArena());
+  ASSERT_EQ(1, arena_fields.field_count());
+  EXPECT_EQ("heap", arena_fields.field(0).length_delimited());
+  ASSERT_EQ(2, heap_fields.field_count());
+  EXPECT_EQ("arena", heap_fields.field(0).length_delimited());
+  EXPECT_EQ(nullptr, heap_fields.field(1).group().GetArena());
+  EXPECT_EQ(4, heap_fields.field(1).group().field(0).varint());
+}
 
 TEST_F(UnknownFieldSetTest, Empty) {
   UnknownFieldSet unknown_fields;
@@ -0,0 +1,509 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/util/columnar_batch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/compiled_field_accessor.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+namespace {
+
+size_t ValueSize(const FieldDescriptor* field) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return sizeof(int32_t);
+    case FieldDescriptor::CPPTYPE_INT64:
+      return sizeof(int64_t);
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return sizeof(uint32_t);
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return sizeof(uint64_t);
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return sizeof(float);
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return sizeof(double);
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return sizeof(bool);
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return sizeof(int);
+    case FieldDescriptor::CPPTYPE_STRING:
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      break;
+  }
+  return 0;
+}
+
+}  // namespace
+
+void ColumnarBatch::Column::Reset(size_t num_rows) {
+  validity_.assign((num_rows + 7) / 8, 0);
+  values_.clear();
+  offsets_.clear();
+  data_.clear();
+  if (is_string()) {
+    offsets_.resize(num_rows + 1);
+  } else {
+    values_.resize(num_rows * ValueSize(field_));
+  }
+}
+
+const ColumnarBatch::Column* ColumnarBatch::FindColumn(
+    absl::string_view path) const {
+  for (const Column& column : columns_) {
+    if (column.path() == path) return &column;
+  }
+  return nullptr;
+}
+
+ColumnarBatch::Column* ColumnarBatch::AddColumn(std::string path,
+                                                const FieldDescriptor* field) {
+  GOOGLE_CHECK(!field->is_repeated() &&
+               field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE)
+      << field->full_name() << " is not a leaf field.";
+  columns_.emplace_back();
+  Column& column = columns_.back();
+  column.path_ = std::move(path);
+  column.field_ = field;
+  column.Reset(num_rows_);
+  return &column;
+}
+
+// ===================================================================
+
+// A message type in the column tree.
+struct ColumnarExporter::Node {
+  // The message field that leads from the parent to this node; nullptr for
+  // the root.
+  const FieldDescriptor* field;
+  // The columns of this message's own leaf fields.
+  std::vector<int> columns;
+  std::vector<const FieldDescriptor*> leaves;
+  std::vector<std::unique_ptr<Node>> children;
+};
+
+// A Node bound to the Reflection of the messages being exported.
+struct ColumnarExporter::BoundNode {
+  const Reflection* reflection;
+  const FieldDescriptor* field;
+  // Read in place of the submessage when it is not present.
+  const Message* prototype;
+  std::vector<int> columns;
+  std::vector<CompiledFieldAccessor> accessors;
+  std::vector<BoundNode> children;
+};
+
+// Writes the values of a range of rows.  Fixed-width values and validity bits
+// go straight into the batch; string bytes are collected in range-local
+// buffers and concatenated once all ranges are done.
+class ColumnarExporter::RowWriter {
+ public:
+  RowWriter(ColumnarBatch* batch, size_t begin)
+      : batch_(batch), begin_(begin), data_(batch->columns_.size()) {}
+
+  void Write(const BoundNode& node, const Message& message, bool present,
+             size_t row) {
+    for (size_t i = 0; i < node.columns.size(); ++i) {
+      WriteLeaf(node.accessors[i], node.columns[i], message, present, row);
+    }
+    for (const BoundNode& child : node.children) {
+      bool child_present =
+          present && node.reflection->HasField(message, child.field);
+      Write(child,
+            child_present ? node.reflection->GetMessage(message, child.field)
+                          : *child.prototype,
+            child_present, row);
+    }
+  }
+
+  // Appends this range's string bytes to the batch and makes the offsets
+  // written by WriteLeaf() absolute.  Ranges must be finished in order.
+  void Finish(size_t end) {
+    for (size_t c = 0; c < batch_->columns_.size(); ++c) {
+      ColumnarBatch::Column& column = batch_->columns_[c];
+      if (!column.is_string()) continue;
+      const int64_t base = static_cast<int64_t>(column.data_.size());
+      for (size_t row = begin_; row < end; ++row) {
+        column.offsets_[row + 1] += base;
+      }
+      column.data_.append(data_[c]);
+    }
+  }
+
+ private:
+  template <typename T>
+  void Store(int column, size_t row, T value) {
+    std::memcpy(batch_->columns_[column].values_.data() + row * sizeof(T),
+                &value, sizeof(T));
+  }
+
+  void WriteLeaf(const CompiledFieldAccessor& accessor, int column,
+                 const Message& message, bool present, size_t row) {
+    const FieldDescriptor* field = accessor.field();
+    bool valid = present && (!field->has_presence() ||
+                             accessor.HasField(message));
+    if (valid) {
+      batch_->columns_[column].validity_[row / 8] |=
+          static_cast<uint8_t>(1u << (row % 8));
+    }
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_INT32:
+        Store(column, row, accessor.GetInt32(message));
+        break;
+      case FieldDescriptor::CPPTYPE_INT64:
+        Store(column, row, accessor.GetInt64(message));
+        break;
+      case FieldDescriptor::CPPTYPE_UINT32:
+        Store(column, row, accessor.GetUInt32(message));
+        break;
+      case FieldDescriptor::CPPTYPE_UINT64:
+        Store(column, row, accessor.GetUInt64(message));
+        break;
+      case FieldDescriptor::CPPTYPE_FLOAT:
+        Store(column, row, accessor.GetFloat(message));
+        break;
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        Store(column, row, accessor.GetDouble(message));
+        break;
+      case FieldDescriptor::CPPTYPE_BOOL:
+        Store(column, row, accessor.GetBool(message));
+        break;
+      case FieldDescriptor::CPPTYPE_ENUM:
+        Store(column, row, accessor.GetEnumValue(message));
+        break;
+      case FieldDescriptor::CPPTYPE_STRING: {
+        std::string& data = data_[column];
+        if (valid) data.append(accessor.GetStringReference(message, &scratch_));
+        batch_->columns_[column].offsets_[row + 1] =
+            static_cast<int64_t>(data.size());
+        break;
+      }
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        GOOGLE_LOG(FATAL) << "Message fields have no column.";
+    }
+  }
+
+  ColumnarBatch* batch_;
+  size_t begin_;
+  // Per column string bytes of this range.
+  std::vector<std::string> data_;
+  std::string scratch_;
+};
+
+// ===================================================================
+
+ColumnarExporter::ColumnarExporter(const Descriptor* descriptor)
+    : ColumnarExporter(descriptor, Options()) {}
+
+ColumnarExporter::ColumnarExporter(const Descriptor* descriptor,
+                                   const Options& options)
+    : descriptor_(descriptor), options_(options) {
+  GOOGLE_CHECK_GE(options_.max_threads, 1);
+  std::vector<const Descriptor*> ancestors;
+  root_ = BuildNode(descriptor, nullptr, "", &ancestors);
+}
+
+ColumnarExporter::~ColumnarExporter() {}
+
+std::unique_ptr<ColumnarExporter::Node> ColumnarExporter::BuildNode(
+    const Descriptor* descriptor, const FieldDescriptor* field,
+    const std::string& path, std::vector<const Descriptor*>* ancestors) {
+  std::unique_ptr<Node> node(new Node{field, {}, {}, {}});
+  ancestors->push_back(descriptor);
+  // A message's own fields get their columns before the fields of its
+  // submessages, so that columns end up in depth-first order.
+  std::vector<std::pair<const FieldDescriptor*, std::string>> submessages;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* child = descriptor->field(i);
+    if (child->is_repeated()) continue;
+    std::string child_path =
+        path.empty() ? child->name() : absl::StrCat(path, ".", child->name());
+    if (child->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (std::find(ancestors->begin(), ancestors->end(),
+                    child->message_type()) == ancestors->end()) {
+        submessages.emplace_back(child, std::move(child_path));
+      }
+      continue;
+    }
+    node->columns.push_back(static_cast<int>(paths_.size()));
+    node->leaves.push_back(child);
+    paths_.push_back(std::move(child_path));
+    leaves_.push_back(child);
+  }
+  for (const auto& submessage : submessages) {
+    node->children.push_back(BuildNode(submessage.first->message_type(),
+                                       submessage.first, submessage.second,
+                                       ancestors));
+  }
+  ancestors->pop_back();
+  return node;
+}
+
+void ColumnarExporter::BindNode(const Node& node, const Reflection* reflection,
+                                const Message* prototype, BoundNode* bound) {
+  bound->reflection = reflection;
+  bound->field = node.field;
+  bound->prototype = prototype;
+  bound->columns = node.columns;
+  for (const FieldDescriptor* leaf : node.leaves) {
+    bound->accessors.emplace_back(reflection, leaf);
+  }
+  // Submessages come from the same factory as the messages containing them,
+  // so the factory's prototypes have the Reflection they will use.
+  MessageFactory* factory = reflection->GetMessageFactory();
+  bound->children.resize(node.children.size());
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    const Message* child_prototype =
+        factory->GetPrototype(node.children[i]->field->message_type());
+    BindNode(*node.children[i], child_prototype->GetReflection(),
+             child_prototype, &bound->children[i]);
+  }
+}
+
+void ColumnarExporter::Export(absl::Span<const Message* const> messages,
+                              ColumnarBatch* batch) const {
+  const size_t num_rows = messages.size();
+  batch->num_rows_ = num_rows;
+  batch->columns_.resize(paths_.size());
+  for (size_t c = 0; c < paths_.size(); ++c) {
+    ColumnarBatch::Column& column = batch->columns_[c];
+    column.path_ = paths_[c];
+    column.field_ = leaves_[c];
+    column.Reset(num_rows);
+  }
+  if (num_rows == 0) return;
+
+  const Message& first = *messages[0];
+  GOOGLE_CHECK_EQ(first.GetDescriptor(), descriptor_)
+      << "Exporter for " << descriptor_->full_name() << " given "
+      << first.GetDescriptor()->full_name();
+  BoundNode root;
+  BindNode(*root_, first.GetReflection(), nullptr, &root);
+
+  // Split the rows into ranges that start on a validity byte boundary, so
+  // that no two threads write to the same byte.
+  size_t num_ranges = 1;
+  if (options_.max_threads > 1 && options_.min_rows_per_thread > 0) {
+    num_ranges = std::min(
+        static_cast<size_t>(options_.max_threads),
+        std::max<size_t>(
+            1, num_rows / static_cast<size_t>(options_.min_rows_per_thread)));
+  }
+  const size_t range_size = ((num_rows + num_ranges - 1) / num_ranges + 7) &
+                            ~static_cast<size_t>(7);
+
+  std::vector<std::unique_ptr<RowWriter>> writers;
+  std::vector<std::thread> threads;
+  for (size_t begin = 0; begin < num_rows; begin += range_size) {
+    const size_t end = std::min(num_rows, begin + range_size);
+    writers.emplace_back(new RowWriter(batch, begin));
+    RowWriter* writer = writers.back().get();
+    auto write_range = [&root, &messages, writer, begin, end] {
+      for (size_t row = begin; row < end; ++row) {
+        GOOGLE_DCHECK_EQ(messages[row]->GetReflection(), root.reflection);
+        writer->Write(root, *messages[row], true, row);
+      }
+    };
+    if (end == num_rows) {
+      write_range();
+    } else {
+      threads.emplace_back(write_range);
+    }
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  size_t begin = 0;
+  for (const auto& writer : writers) {
+    const size_t end = std::min(num_rows, begin + range_size);
+    writer->Finish(end);
+    begin = end;
+  }
+}
+
+// ===================================================================
+
+// A message type in the tree of the columns being imported.
+struct ColumnarImporter::Node {
+  const Reflection* reflection;
+  // The message field that leads from the parent to this node; nullptr for
+  // the root.
+  const FieldDescriptor* field;
+  // The columns of this message's own fields, and their accessors.
+  std::vector<int> columns;
+  std::vector<CompiledFieldAccessor> accessors;
+  // All columns at or below this node.  The submessage is created for a row
+  // if any of them is valid.
+  std::vector<int> subtree_columns;
+  std::vector<std::unique_ptr<Node>> children;
+};
+
+ColumnarImporter::ColumnarImporter(const Message* prototype)
+    : prototype_(prototype) {}
+
+ColumnarImporter::~ColumnarImporter() {}
+
+bool ColumnarImporter::Import(const ColumnarBatch& batch, Arena* arena,
+                              std::vector<Message*>* messages) const {
+  messages->reserve(messages->size() + batch.num_rows());
+  return ImportRows(batch, [this, arena, messages] {
+    messages->push_back(prototype_->New(arena));
+    return messages->back();
+  });
+}
+
+bool ColumnarImporter::ImportRows(
+    const ColumnarBatch& batch,
+    absl::FunctionRef<Message*()> new_message) const {
+  Node root{prototype_->GetReflection(), nullptr, {}, {}, {}, {}};
+  MessageFactory* factory = root.reflection->GetMessageFactory();
+  for (size_t c = 0; c < batch.columns().size(); ++c) {
+    const ColumnarBatch::Column& column = batch.columns()[c];
+    const std::vector<absl::string_view> names =
+        absl::StrSplit(column.path(), '.');
+    Node* node = &root;
+    const Descriptor* descriptor = prototype_->GetDescriptor();
+    for (size_t i = 0; i + 1 < names.size(); ++i) {
+      const FieldDescriptor* field = descriptor->FindFieldByName(names[i]);
+      if (field == nullptr || field->is_repeated() ||
+          field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+        GOOGLE_LOG(ERROR) << "Column " << column.path()
+                   << " does not name a field of "
+                   << prototype_->GetDescriptor()->full_name();
+        return false;
+      }
+      Node* child = nullptr;
+      for (const auto& existing : node->children) {
+        if (existing->field == field) child = existing.get();
+      }
+      if (child == nullptr) {
+        const Reflection* reflection =
+            factory->GetPrototype(field->message_type())->GetReflection();
+        node->children.emplace_back(
+            new Node{reflection, field, {}, {}, {}, {}});
+        child = node->children.back().get();
+      }
+      child->subtree_columns.push_back(static_cast<int>(c));
+      node = child;
+      descriptor = field->message_type();
+    }
+    const FieldDescriptor* field = descriptor->FindFieldByName(names.back());
+    if (field != column.field()) {
+      GOOGLE_LOG(ERROR) << "Column " << column.path() << " does not name field "
+                 << column.field()->full_name() << " of "
+                 << prototype_->GetDescriptor()->full_name();
+      return false;
+    }
+    node->columns.push_back(static_cast<int>(c));
+    node->accessors.emplace_back(node->reflection, field);
+  }
+
+  for (size_t row = 0; row < batch.num_rows(); ++row) {
+    Fill(root, batch, row, new_message());
+  }
+  return true;
+}
+
+void ColumnarImporter::Fill(const Node& node, const ColumnarBatch& batch,
+                            size_t row, Message* message) {
+  for (size_t i = 0; i < node.columns.size(); ++i) {
+    const ColumnarBatch::Column& column = batch.columns()[node.columns[i]];
+    if (!column.IsValid(row)) continue;
+    const CompiledFieldAccessor& accessor = node.accessors[i];
+    switch (column.field()->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_INT32:
+        accessor.SetInt32(message, column.values<int32_t>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_INT64:
+        accessor.SetInt64(message, column.values<int64_t>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_UINT32:
+        accessor.SetUInt32(message, column.values<uint32_t>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_UINT64:
+        accessor.SetUInt64(message, column.values<uint64_t>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_FLOAT:
+        accessor.SetFloat(message, column.values<float>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        accessor.SetDouble(message, column.values<double>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_BOOL:
+        accessor.SetBool(message, column.values<bool>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_ENUM:
+        accessor.SetEnumValue(message, column.values<int>()[row]);
+        break;
+      case FieldDescriptor::CPPTYPE_STRING:
+        accessor.SetString(message, std::string(column.GetString(row)));
+        break;
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        GOOGLE_LOG(FATAL) << "Message fields have no column.";
+    }
+  }
+  for (const auto& child : node.children) {
+    bool present = false;
+    for (int c : child->subtree_columns) {
+      if (batch.columns()[c].IsValid(row)) {
+        present = true;
+        break;
+      }
+    }
+    if (present) {
+      Fill(*child, batch, row,
+           node.reflection->MutableMessage(message, child->field));
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,295 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Defines ColumnarBatch, a struct-of-arrays representation of a batch of
+// messages, ColumnarExporter, which fills one from messages, and
+// ColumnarImporter, which turns one back into messages.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_COLUMNAR_BATCH_H__
+#define GOOGLE_PROTOBUF_UTIL_COLUMNAR_BATCH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/repeated_ptr_field.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// The values of a batch of messages, one column per leaf field.
+//
+// Every singular scalar, enum, string or bytes field reachable from the root
+// message through singular message fields becomes one column, named by the
+// dot-separated path of field names leading to it, e.g. "address.zip_code".
+// Columns appear in depth-first field declaration order.  Repeated fields,
+// maps and extensions have no column; a message field whose type already
+// appears on the path to it (a recursive field) is not descended into.
+//
+// The layout of a column follows the Apache Arrow conventions:
+//
+//  * validity() is a bitmap with one bit per row, least significant bit
+//    first.  A row is valid if all the messages on the path are present and
+//    the field itself is present (for fields without presence, present
+//    means that the enclosing message is).
+//  * Fixed-width columns store one value per row in values<T>(), where T is
+//    int32_t, int64_t, uint32_t, uint64_t, float, double, bool or, for enum
+//    fields, int.  Rows that are not valid hold the field's default value.
+//  * String and bytes columns store the bytes of all rows back to back in
+//    data(); row i spans [offsets()[i], offsets()[i + 1]).  Rows that are
+//    not valid are empty.
+//
+// Batches are usually filled by ColumnarExporter, but can also be built by
+// hand for ColumnarImporter:
+//
+//   ColumnarBatch batch(num_rows);
+//   ColumnarBatch::Column* id = batch.AddColumn("id", id_field);
+//   for (size_t row = 0; row < num_rows; ++row) {
+//     id->mutable_values<int64_t>()[row] = ids[row];
+//     id->SetValid(row);
+//   }
+class PROTOBUF_EXPORT ColumnarBatch {
+ public:
+  class PROTOBUF_EXPORT Column {
+   public:
+    const std::string& path() const { return path_; }
+    // The leaf field holding this column's values.
+    const FieldDescriptor* field() const { return field_; }
+    bool is_string() const {
+      return field_->cpp_type() == FieldDescriptor::CPPTYPE_STRING;
+    }
+
+    const uint8_t* validity() const { return validity_.data(); }
+    bool IsValid(size_t row) const {
+      return (validity_[row / 8] >> (row % 8)) & 1;
+    }
+
+    // Requires: !is_string() and T matches the field's type.
+    template <typename T>
+    const T* values() const {
+      GOOGLE_DCHECK(!is_string());
+      GOOGLE_DCHECK_EQ(values_.size() % sizeof(T), 0);
+      return reinterpret_cast<const T*>(values_.data());
+    }
+
+    // Requires: is_string().
+    const int64_t* offsets() const { return offsets_.data(); }
+    const std::string& data() const { return data_; }
+    absl::string_view GetString(size_t row) const {
+      return absl::string_view(data_).substr(
+          static_cast<size_t>(offsets_[row]),
+          static_cast<size_t>(offsets_[row + 1] - offsets_[row]));
+    }
+
+    // Mutable access, for building batches by hand.  The buffers are sized
+    // for the batch's rows by ColumnarBatch::AddColumn().
+    void SetValid(size_t row) {
+      validity_[row / 8] |= static_cast<uint8_t>(1u << (row % 8));
+    }
+    uint8_t* mutable_validity() { return validity_.data(); }
+    template <typename T>
+    T* mutable_values() {
+      GOOGLE_DCHECK(!is_string());
+      GOOGLE_DCHECK_EQ(values_.size() % sizeof(T), 0);
+      return reinterpret_cast<T*>(values_.data());
+    }
+    std::vector<int64_t>* mutable_offsets() { return &offsets_; }
+    std::string* mutable_data() { return &data_; }
+
+   private:
+    friend class ColumnarBatch;
+    friend class ColumnarExporter;
+
+    // Sizes the buffers for `num_rows` rows, all of them invalid.
+    void Reset(size_t num_rows);
+
+    std::string path_;
+    const FieldDescriptor* field_ = nullptr;
+    std::vector<uint8_t> validity_;
+    std::vector<char> values_;
+    std::vector<int64_t> offsets_;
+    std::string data_;
+  };
+
+  ColumnarBatch() = default;
+  // Creates a batch of `num_rows` rows and no columns.
+  explicit ColumnarBatch(size_t num_rows) : num_rows_(num_rows) {}
+
+  size_t num_rows() const { return num_rows_; }
+  const std::vector<Column>& columns() const { return columns_; }
+
+  // Returns the column for the given dot-separated field path, or nullptr.
+  const Column* FindColumn(absl::string_view path) const;
+
+  // Appends a column for the leaf `field` at `path` in which no row is
+  // valid.  The returned pointer is invalidated by the next AddColumn().
+  Column* AddColumn(std::string path, const FieldDescriptor* field);
+
+ private:
+  friend class ColumnarExporter;
+
+  size_t num_rows_ = 0;
+  std::vector<Column> columns_;
+};
+
+// Converts batches of messages of one type into ColumnarBatches.  The
+// column layout is computed once, from the descriptor, when the exporter is
+// created; fields are then read through CompiledFieldAccessors, so exporting
+// a row costs a handful of loads per column rather than a Reflection call.
+// Large batches can be split across several threads.
+//
+// Export() is const and may be called concurrently from several threads.
+class PROTOBUF_EXPORT ColumnarExporter {
+ public:
+  struct Options {
+    // Maximum number of threads Export() runs on, including the calling
+    // thread.
+    int max_threads = 1;
+    // Batches are only split so that every thread gets at least this many
+    // rows.
+    int min_rows_per_thread = 4096;
+  };
+
+  explicit ColumnarExporter(const Descriptor* descriptor);
+  ColumnarExporter(const Descriptor* descriptor, const Options& options);
+  ColumnarExporter(const ColumnarExporter&) = delete;
+  ColumnarExporter& operator=(const ColumnarExporter&) = delete;
+  ~ColumnarExporter();
+
+  const Descriptor* descriptor() const { return descriptor_; }
+
+  // Replaces the contents of `batch` with the columns of `messages`.  All
+  // messages must be of the exporter's type and share one Reflection, i.e.
+  // be all generated or all created by the same DynamicMessageFactory.
+  void Export(absl::Span<const Message* const> messages,
+              ColumnarBatch* batch) const;
+
+  template <typename T>
+  void Export(const RepeatedPtrField<T>& messages, ColumnarBatch* batch) const {
+    std::vector<const Message*> pointers(messages.pointer_begin(),
+                                         messages.pointer_end());
+    Export(pointers, batch);
+  }
+
+ private:
+  struct Node;
+  struct BoundNode;
+  class RowWriter;
+
+  std::unique_ptr<Node> BuildNode(const Descriptor* descriptor,
+                                  const FieldDescriptor* field,
+                                  const std::string& path,
+                                  std::vector<const Descriptor*>* ancestors);
+  static void BindNode(const Node& node, const Reflection* reflection,
+                       const Message* prototype, BoundNode* bound);
+
+  const Descriptor* descriptor_;
+  Options options_;
+  // Paths and leaf fields of the columns, in column order.
+  std::vector<std::string> paths_;
+  std::vector<const FieldDescriptor*> leaves_;
+  // Tree of the message fields that lead to the columns; root_ describes the
+  // exported type itself.
+  std::unique_ptr<Node> root_;
+};
+
+// Creates messages from the columns of ColumnarBatches, the inverse of
+// ColumnarExporter.  Each row becomes one message in which the fields whose
+// columns are valid in that row are set; submessages are created only for
+// rows in which at least one column below them is valid.  A batch may
+// contain any subset of the columns ColumnarExporter would produce.
+//
+// Messages are filled in a single pass over the rows, through
+// CompiledFieldAccessors, so has-bits are set directly rather than through
+// Reflection.  With an arena, all the messages of a batch and their
+// submessages are allocated on it; each string value is built on the heap and
+// moved into its field, so the character buffers stay on the heap.
+//
+// Import() is const and may be called concurrently from several threads.
+class PROTOBUF_EXPORT ColumnarImporter {
+ public:
+  // Messages are created with `prototype->New()`, so they are generated
+  // messages if `prototype` is a generated default instance and dynamic
+  // messages if it comes from a DynamicMessageFactory, which must outlive
+  // the importer.
+  explicit ColumnarImporter(const Message* prototype);
+  ColumnarImporter(const ColumnarImporter&) = delete;
+  ColumnarImporter& operator=(const ColumnarImporter&) = delete;
+  ~ColumnarImporter();
+
+  // Creates batch.num_rows() messages on `arena` (on the heap, owned by the
+  // caller, if `arena` is null) and appends them to `messages`.  Returns
+  // false, without creating any message, if a column's path does not name
+  // a leaf field of the importer's type or names a different field than the
+  // column's field().
+  bool Import(const ColumnarBatch& batch, Arena* arena,
+              std::vector<Message*>* messages) const;
+
+  // As above, but appends the messages to `messages`, on its arena.  T must
+  // be the generated type of the prototype.
+  template <typename T>
+  bool Import(const ColumnarBatch& batch, RepeatedPtrField<T>* messages) const {
+    GOOGLE_DCHECK_EQ(T::default_instance().GetReflection(),
+                     prototype_->GetReflection());
+    messages->Reserve(messages->size() + static_cast<int>(batch.num_rows()));
+    return ImportRows(batch,
+                      [messages]() -> Message* { return messages->Add(); });
+  }
+
+ private:
+  struct Node;
+
+  bool ImportRows(const ColumnarBatch& batch,
+                  absl::FunctionRef<Message*()> new_message) const;
+  static void Fill(const Node& node, const ColumnarBatch& batch, size_t row,
+                   Message* message);
+
+  const Message* prototype_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_COLUMNAR_BATCH_H__
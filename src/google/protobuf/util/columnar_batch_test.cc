@@ -0,0 +1,416 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/util/columnar_batch.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/arena.h"
+#include "google/protobuf/dynamic_message.h"
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+// Builds `count` messages that differ in which fields are set.
+std::vector<TestAllTypes> MakeMessages(int count) {
+  std::vector<TestAllTypes> messages(count);
+  for (int i = 0; i < count; ++i) {
+    TestAllTypes& message = messages[i];
+    if (i % 3 == 0) TestUtil::SetAllFields(&message);
+    if (i % 2 == 0) message.set_optional_int32(i);
+    if (i % 5 == 1) message.set_optional_string(absl::StrCat("row", i));
+    if (i % 7 == 2) message.mutable_optional_nested_message()->set_bb(-i);
+    if (i % 4 == 3) message.set_oneof_uint32(i);
+    if (i % 11 == 4) message.set_optional_nested_enum(TestAllTypes::BAR);
+  }
+  return messages;
+}
+
+// Checks every cell of `batch` against the result of navigating the column's
+// path through `messages` with plain Reflection calls.
+void ExpectMatchesReflection(const ColumnarBatch& batch,
+                             const std::vector<const Message*>& messages) {
+  ASSERT_EQ(batch.num_rows(), messages.size());
+  for (const ColumnarBatch::Column& column : batch.columns()) {
+    const std::vector<std::string> names = absl::StrSplit(column.path(), '.');
+    for (size_t row = 0; row < messages.size(); ++row) {
+      const Message* message = messages[row];
+      bool valid = true;
+      const FieldDescriptor* field = nullptr;
+      for (size_t i = 0; i < names.size(); ++i) {
+        field = message->GetDescriptor()->FindFieldByName(names[i]);
+        ASSERT_NE(field, nullptr) << column.path();
+        const Reflection* reflection = message->GetReflection();
+        if (field->has_presence() && !reflection->HasField(*message, field)) {
+          valid = false;
+        }
+        if (i + 1 < names.size()) {
+          message = &reflection->GetMessage(*message, field);
+        }
+      }
+      ASSERT_EQ(field, column.field());
+      SCOPED_TRACE(absl::StrCat(column.path(), " row ", row));
+      EXPECT_EQ(column.IsValid(row), valid);
+
+      const Reflection* reflection = message->GetReflection();
+      switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+          EXPECT_EQ(column.values<int32_t>()[row],
+                    reflection->GetInt32(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_INT64:
+          EXPECT_EQ(column.values<int64_t>()[row],
+                    reflection->GetInt64(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+          EXPECT_EQ(column.values<uint32_t>()[row],
+                    reflection->GetUInt32(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+          EXPECT_EQ(column.values<uint64_t>()[row],
+                    reflection->GetUInt64(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_FLOAT:
+          EXPECT_EQ(column.values<float>()[row],
+                    reflection->GetFloat(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+          EXPECT_EQ(column.values<double>()[row],
+                    reflection->GetDouble(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+          EXPECT_EQ(column.values<bool>()[row],
+                    reflection->GetBool(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_ENUM:
+          EXPECT_EQ(column.values<int>()[row],
+                    reflection->GetEnumValue(*message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_STRING:
+          EXPECT_EQ(column.GetString(row),
+                    valid ? reflection->GetString(*message, field) : "");
+          break;
+        case FieldDescriptor::CPPTYPE_MESSAGE:
+          ADD_FAILURE() << "Message column";
+      }
+    }
+  }
+}
+
+TEST(ColumnarExporterTest, Columns) {
+  ColumnarExporter exporter(TestAllTypes::descriptor());
+  ColumnarBatch batch;
+  exporter.Export(absl::Span<const Message* const>(), &batch);
+
+  EXPECT_EQ(batch.num_rows(), 0);
+  ASSERT_FALSE(batch.columns().empty());
+  EXPECT_EQ(batch.columns()[0].path(), "optional_int32");
+  EXPECT_NE(batch.FindColumn("optional_string"), nullptr);
+  EXPECT_NE(batch.FindColumn("default_string"), nullptr);
+  EXPECT_NE(batch.FindColumn("oneof_uint32"), nullptr);
+  EXPECT_NE(batch.FindColumn("optional_nested_message.bb"), nullptr);
+  EXPECT_NE(batch.FindColumn("optional_import_message.d"), nullptr);
+  EXPECT_EQ(batch.FindColumn("repeated_int32"), nullptr);
+  EXPECT_EQ(batch.FindColumn("optional_nested_message"), nullptr);
+  // The nested message's column comes after all of the root's own columns.
+  EXPECT_EQ(batch.columns().back().path(), "oneof_nested_message.bb");
+}
+
+TEST(ColumnarExporterTest, RecursiveMessage) {
+  using ::protobuf_unittest::TestRecursiveMessage;
+  ColumnarExporter exporter(TestRecursiveMessage::descriptor());
+  TestRecursiveMessage message;
+  message.mutable_a()->set_i(5);
+  const Message* messages[] = {&message};
+  ColumnarBatch batch;
+  exporter.Export(messages, &batch);
+
+  ASSERT_EQ(batch.columns().size(), 1);
+  EXPECT_EQ(batch.columns()[0].path(), "i");
+  EXPECT_FALSE(batch.columns()[0].IsValid(0));
+}
+
+TEST(ColumnarExporterTest, Generated) {
+  std::vector<TestAllTypes> messages = MakeMessages(100);
+  std::vector<const Message*> pointers;
+  for (const TestAllTypes& message : messages) pointers.push_back(&message);
+
+  ColumnarExporter exporter(TestAllTypes::descriptor());
+  ColumnarBatch batch;
+  exporter.Export(pointers, &batch);
+  ExpectMatchesReflection(batch, pointers);
+
+  const ColumnarBatch::Column* column = batch.FindColumn("optional_int32");
+  ASSERT_NE(column, nullptr);
+  EXPECT_TRUE(column->IsValid(0));
+  EXPECT_EQ(column->values<int32_t>()[2], 2);
+  EXPECT_FALSE(column->IsValid(1));
+  EXPECT_EQ(column->values<int32_t>()[1], 0);
+
+  column = batch.FindColumn("optional_string");
+  ASSERT_NE(column, nullptr);
+  EXPECT_EQ(column->GetString(0), "115");
+  EXPECT_EQ(column->GetString(1), "row1");
+  EXPECT_EQ(column->GetString(2), "");
+  EXPECT_EQ(column->offsets()[100], column->data().size());
+
+  column = batch.FindColumn("optional_nested_message.bb");
+  ASSERT_NE(column, nullptr);
+  EXPECT_TRUE(column->IsValid(9));
+  EXPECT_EQ(column->values<int32_t>()[9], -9);
+  EXPECT_FALSE(column->IsValid(1));
+}
+
+TEST(ColumnarExporterTest, RepeatedPtrField) {
+  RepeatedPtrField<TestAllTypes> messages;
+  for (TestAllTypes& message : MakeMessages(20)) {
+    *messages.Add() = message;
+  }
+
+  ColumnarExporter exporter(TestAllTypes::descriptor());
+  ColumnarBatch batch;
+  exporter.Export(messages, &batch);
+  ExpectMatchesReflection(
+      batch, std::vector<const Message*>(messages.pointer_begin(),
+                                         messages.pointer_end()));
+}
+
+TEST(ColumnarExporterTest, DynamicMessage) {
+  std::vector<TestAllTypes> messages = MakeMessages(50);
+  DynamicMessageFactory factory;
+  const Message* prototype = factory.GetPrototype(TestAllTypes::descriptor());
+  std::vector<std::unique_ptr<Message>> dynamic_messages;
+  std::vector<const Message*> pointers;
+  for (const TestAllTypes& message : messages) {
+    dynamic_messages.emplace_back(prototype->New());
+    ASSERT_TRUE(
+        dynamic_messages.back()->ParseFromString(message.SerializeAsString()));
+    pointers.push_back(dynamic_messages.back().get());
+  }
+
+  ColumnarExporter exporter(TestAllTypes::descriptor());
+  ColumnarBatch batch;
+  exporter.Export(pointers, &batch);
+  ExpectMatchesReflection(batch, pointers);
+}
+
+TEST(ColumnarExporterTest, Proto3) {
+  proto3_unittest::TestAllTypes zero, nonzero;
+  nonzero.set_optional_int32(3);
+  nonzero.mutable_optional_nested_message()->set_bb(4);
+  const Message* messages[] = {&zero, &nonzero};
+
+  ColumnarExporter exporter(proto3_unittest::TestAllTypes::descriptor());
+  ColumnarBatch batch;
+  exporter.Export(messages, &batch);
+  ExpectMatchesReflection(batch, {&zero, &nonzero});
+
+  // Fields without presence are valid whenever their message is present.
+  const ColumnarBatch::Column* column = batch.FindColumn("optional_int32");
+  ASSERT_NE(column, nullptr);
+  EXPECT_TRUE(column->IsValid(0));
+  EXPECT_TRUE(column->IsValid(1));
+  column = batch.FindColumn("optional_nested_message.bb");
+  ASSERT_NE(column, nullptr);
+  EXPECT_FALSE(column->IsValid(0));
+  EXPECT_TRUE(column->IsValid(1));
+}
+
+TEST(ColumnarExporterTest, MultipleThreads) {
+  std::vector<TestAllTypes> messages = MakeMessages(1001);
+  std::vector<const Message*> pointers;
+  for (const TestAllTypes& message : messages) pointers.push_back(&message);
+
+  ColumnarExporter::Options options;
+  options.max_threads = 4;
+  options.min_rows_per_thread = 100;
+  ColumnarExporter exporter(TestAllTypes::descriptor(), options);
+  ColumnarBatch batch;
+  exporter.Export(pointers, &batch);
+  ExpectMatchesReflection(batch, pointers);
+
+  // Exporting again into the same batch replaces its contents.
+  pointers.resize(37);
+  exporter.Export(pointers, &batch);
+  ExpectMatchesReflection(batch, pointers);
+}
+
+// Returns `message` without the fields ColumnarBatch has no column for.
+std::string ExportedFields(TestAllTypes message) {
+  const Reflection* reflection = message.GetReflection();
+  for (int i = 0; i < message.GetDescriptor()->field_count(); ++i) {
+    const FieldDescriptor* field = message.GetDescriptor()->field(i);
+    if (field->is_repeated()) reflection->ClearField(&message, field);
+  }
+  return message.SerializeAsString();
+}
+
+TEST(ColumnarImporterTest, RoundTrip) {
+  std::vector<TestAllTypes> messages = MakeMessages(200);
+  std::vector<const Message*> pointers;
+  for (const TestAllTypes& message : messages) pointers.push_back(&message);
+  ColumnarBatch batch;
+  ColumnarExporter(TestAllTypes::descriptor()).Export(pointers, &batch);
+
+  Arena arena;
+  ColumnarImporter importer(&TestAllTypes::default_instance());
+  std::vector<Message*> imported;
+  ASSERT_TRUE(importer.Import(batch, &arena, &imported));
+  ASSERT_EQ(imported.size(), messages.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_EQ(imported[i]->GetArena(), &arena);
+    EXPECT_EQ(imported[i]->SerializeAsString(), ExportedFields(messages[i]))
+        << "row " << i;
+  }
+}
+
+TEST(ColumnarImporterTest, RepeatedPtrField) {
+  std::vector<TestAllTypes> messages = MakeMessages(30);
+  std::vector<const Message*> pointers;
+  for (const TestAllTypes& message : messages) pointers.push_back(&message);
+  ColumnarBatch batch;
+  ColumnarExporter(TestAllTypes::descriptor()).Export(pointers, &batch);
+
+  Arena arena;
+  auto* imported = Arena::CreateMessage<RepeatedPtrField<TestAllTypes>>(&arena);
+  imported->Add()->set_optional_int32(-1);
+  ColumnarImporter importer(&TestAllTypes::default_instance());
+  ASSERT_TRUE(importer.Import(batch, imported));
+  ASSERT_EQ(imported->size(), messages.size() + 1);
+  EXPECT_EQ(imported->Get(0).optional_int32(), -1);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const TestAllTypes& message = imported->Get(static_cast<int>(i) + 1);
+    EXPECT_EQ(message.GetArena(), &arena);
+    EXPECT_EQ(message.SerializeAsString(), ExportedFields(messages[i]))
+        << "row " << i;
+  }
+}
+
+TEST(ColumnarImporterTest, DynamicMessage) {
+  std::vector<TestAllTypes> messages = MakeMessages(40);
+  std::vector<const Message*> pointers;
+  for (const TestAllTypes& message : messages) pointers.push_back(&message);
+  ColumnarBatch batch;
+  ColumnarExporter(TestAllTypes::descriptor()).Export(pointers, &batch);
+
+  DynamicMessageFactory factory;
+  ColumnarImporter importer(factory.GetPrototype(TestAllTypes::descriptor()));
+  std::vector<Message*> imported;
+  ASSERT_TRUE(importer.Import(batch, nullptr, &imported));
+  ASSERT_EQ(imported.size(), messages.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    std::unique_ptr<Message> message(imported[i]);
+    EXPECT_NE(message->GetReflection(),
+              TestAllTypes::default_instance().GetReflection());
+    EXPECT_EQ(message->SerializeAsString(), ExportedFields(messages[i]))
+        << "row " << i;
+  }
+}
+
+TEST(ColumnarImporterTest, HandBuiltBatch) {
+  const Descriptor* descriptor = TestAllTypes::descriptor();
+  ColumnarBatch batch(3);
+  ColumnarBatch::Column* column = batch.AddColumn(
+      "optional_int64", descriptor->FindFieldByName("optional_int64"));
+  column->mutable_values<int64_t>()[0] = 10;
+  column->mutable_values<int64_t>()[2] = 12;
+  column->SetValid(0);
+  column->SetValid(2);
+
+  const FieldDescriptor* bb =
+      TestAllTypes::NestedMessage::descriptor()->FindFieldByName("bb");
+  column = batch.AddColumn("optional_nested_message.bb", bb);
+  column->mutable_values<int32_t>()[1] = 21;
+  column->SetValid(1);
+
+  column = batch.AddColumn("optional_bytes",
+                           descriptor->FindFieldByName("optional_bytes"));
+  *column->mutable_data() = "abcdef";
+  *column->mutable_offsets() = {0, 2, 2, 6};
+  column->SetValid(0);
+  column->SetValid(1);
+  column->SetValid(2);
+
+  ColumnarImporter importer(&TestAllTypes::default_instance());
+  std::vector<Message*> imported;
+  ASSERT_TRUE(importer.Import(batch, nullptr, &imported));
+  ASSERT_EQ(imported.size(), 3);
+  std::vector<std::unique_ptr<TestAllTypes>> rows;
+  for (Message* message : imported) {
+    rows.emplace_back(static_cast<TestAllTypes*>(message));
+  }
+
+  EXPECT_EQ(rows[0]->optional_int64(), 10);
+  EXPECT_FALSE(rows[0]->has_optional_nested_message());
+  EXPECT_EQ(rows[0]->optional_bytes(), "ab");
+  EXPECT_FALSE(rows[1]->has_optional_int64());
+  EXPECT_TRUE(rows[1]->has_optional_nested_message());
+  EXPECT_EQ(rows[1]->optional_nested_message().bb(), 21);
+  EXPECT_TRUE(rows[1]->has_optional_bytes());
+  EXPECT_EQ(rows[1]->optional_bytes(), "");
+  EXPECT_EQ(rows[2]->optional_int64(), 12);
+  EXPECT_EQ(rows[2]->optional_bytes(), "cdef");
+}
+
+TEST(ColumnarImporterTest, UnknownColumn) {
+  ColumnarBatch batch(2);
+  batch.AddColumn("optional_nested_message.no_such_field",
+                  TestAllTypes::NestedMessage::descriptor()->FindFieldByName(
+                      "bb"));
+  ColumnarImporter importer(&TestAllTypes::default_instance());
+  std::vector<Message*> imported;
+  EXPECT_FALSE(importer.Import(batch, nullptr, &imported));
+  EXPECT_TRUE(imported.empty());
+
+  // A column whose path names a different field than the column's.
+  ColumnarBatch mismatched(2);
+  mismatched.AddColumn(
+      "optional_int32",
+      TestAllTypes::descriptor()->FindFieldByName("optional_int64"));
+  EXPECT_FALSE(importer.Import(mismatched, nullptr, &imported));
+  EXPECT_TRUE(imported.empty());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
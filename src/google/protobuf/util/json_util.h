@@ -43,6 +43,7 @@ namespace protobuf {
 namespace util {
 using JsonParseOptions = ::google::protobuf::json::ParseOptions;
 using JsonPrintOptions = ::google::protobuf::json::PrintOptions;
+using JsonResolverCache = ::google::protobuf::json::ResolverCache;
 
 using JsonOptions ABSL_DEPRECATED("use JsonPrintOptions instead") =
     JsonPrintOptions;
@@ -0,0 +1,516 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/util/message_fingerprint.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/arenastring.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/extension_set.h"
+#include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/string_piece_field.h"
+#include "google/protobuf/unknown_field_set.h"
+#include "absl/base/casts.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+namespace {
+
+using ::google::protobuf::internal::TcParseTableBase;
+using ::google::protobuf::internal::TcParser;
+namespace field_layout = ::google::protobuf::internal::field_layout;
+
+// A streaming 128-bit hash of a sequence of 64-bit words.  This is
+// MurmurHash3_x64_128 with a fixed seed, fed the words of the canonical
+// encoding two at a time; the 64-bit fingerprint is the low half.
+class Hasher {
+ public:
+  void AddWord(uint64_t word) {
+    ++num_words_;
+    if (!has_pending_) {
+      pending_ = word;
+      has_pending_ = true;
+      return;
+    }
+    has_pending_ = false;
+    MixBlock(pending_, word);
+  }
+
+  // Adds the length of `bytes`, then its contents as little-endian words,
+  // the last one padded with zeros.
+  void AddBytes(absl::string_view bytes) {
+    AddWord(bytes.size());
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+    size_t size = bytes.size();
+    for (; size >= 8; size -= 8) {
+      uint64_t word;
+      p = io::CodedInputStream::ReadLittleEndian64FromArray(p, &word);
+      AddWord(word);
+    }
+    if (size > 0) {
+      uint64_t word = 0;
+      for (size_t i = 0; i < size; ++i) word |= uint64_t{p[i]} << (8 * i);
+      AddWord(word);
+    }
+  }
+
+  absl::uint128 Finish() {
+    if (has_pending_) {
+      h1_ ^= MixK1(pending_);
+      has_pending_ = false;
+    }
+    const uint64_t length = num_words_ * 8;
+    uint64_t h1 = h1_ ^ length;
+    uint64_t h2 = h2_ ^ length;
+    h1 += h2;
+    h2 += h1;
+    h1 = FinalMix(h1);
+    h2 = FinalMix(h2);
+    h1 += h2;
+    h2 += h1;
+    return absl::MakeUint128(h2, h1);
+  }
+
+ private:
+  static constexpr uint64_t kSeed = 0x9ae16a3b2f90404fULL;
+  static constexpr uint64_t kC1 = 0x87c37b91114253d5ULL;
+  static constexpr uint64_t kC2 = 0x4cf5ad432745937fULL;
+
+  static uint64_t MixK1(uint64_t k1) {
+    return absl::rotl(k1 * kC1, 31) * kC2;
+  }
+  static uint64_t MixK2(uint64_t k2) {
+    return absl::rotl(k2 * kC2, 33) * kC1;
+  }
+  static uint64_t FinalMix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+
+  void MixBlock(uint64_t k1, uint64_t k2) {
+    h1_ ^= MixK1(k1);
+    h1_ = absl::rotl(h1_, 27) + h2_;
+    h1_ = h1_ * 5 + 0x52dce729;
+    h2_ ^= MixK2(k2);
+    h2_ = absl::rotl(h2_, 31) + h1_;
+    h2_ = h2_ * 5 + 0x38495ab5;
+  }
+
+  uint64_t h1_ = kSeed;
+  uint64_t h2_ = kSeed;
+  uint64_t pending_ = 0;
+  bool has_pending_ = false;
+  uint64_t num_words_ = 0;
+};
+
+// Every field in the canonical encoding starts with a header word holding its
+// number and one of these kinds.  Field numbers are positive, so headers are
+// never zero and a zero word can end each message.
+enum FieldKind : uint64_t {
+  kSingular = 0,
+  kRepeated = 1,
+  kMap = 2,
+  kUnknownVarint = 3,
+  kUnknownFixed32 = 4,
+  kUnknownFixed64 = 5,
+  kUnknownLengthDelimited = 6,
+  kUnknownGroup = 7,
+};
+
+constexpr uint64_t kEndOfMessage = 0;
+
+uint64_t FieldHeader(uint32_t number, FieldKind kind) {
+  return (uint64_t{number} << 3) | kind;
+}
+
+// Values are hashed as a single word: 32-bit types (including float and
+// enums) by their zero-extended bits, 64-bit types by their bits, and bool as
+// 0 or 1.  The table and reflection paths must agree on these.
+template <typename T>
+uint64_t ValueWord(T value) {
+  static_assert(sizeof(T) <= sizeof(uint64_t), "");
+  return static_cast<uint64_t>(value);
+}
+
+}  // namespace
+
+class MessageFingerprint::Walker {
+ public:
+  explicit Walker(const Options& options) : options_(options) {}
+
+  // Adds the fields, extensions and unknown fields of `message`, followed by
+  // kEndOfMessage.
+  void AddMessage(const Message& message, Hasher* hasher) {
+    const Descriptor* descriptor = message.GetDescriptor();
+    const Reflection* reflection = message.GetReflection();
+    if (descriptor->options().message_set_wire_format()) {
+      std::vector<const FieldDescriptor*> fields;
+      reflection->ListFields(message, &fields);
+      for (const FieldDescriptor* field : fields) {
+        AddField(message, field, hasher);
+      }
+    } else {
+      const TcParseTableBase* table = reflection->GetTcParseTable();
+      TcParser::ForEachPresentField(
+          &message, table,
+          [&](uint32_t field_num, const TcParseTableBase::FieldEntry& entry,
+              const void* base) {
+            if (AddTableField(field_num, entry, base, hasher)) return;
+            // Maps, and fields the table leaves to the reflection-based
+            // fallback parser.
+            AddField(message, descriptor->FindFieldByNumber(field_num),
+                     hasher);
+          });
+      if (descriptor->extension_range_count() > 0) {
+        // Extensions come after all regular fields, so that the result does
+        // not depend on whether the table-driven walk is used.
+        std::vector<const FieldDescriptor*> extensions;
+        reflection->GetExtensionSet(message).AppendToList(
+            descriptor, reflection->descriptor_pool_, &extensions);
+        for (const FieldDescriptor* field : extensions) {
+          AddField(message, field, hasher);
+        }
+      }
+    }
+    if (!options_.ignore_unknown_fields) {
+      AddUnknownFields(reflection->GetUnknownFields(message), hasher);
+    }
+    hasher->AddWord(kEndOfMessage);
+  }
+
+ private:
+  // Adds a field described by a parse table entry.  Returns false if the
+  // entry's representation is not handled here, in which case nothing was
+  // added.
+  bool AddTableField(uint32_t field_num,
+                     const TcParseTableBase::FieldEntry& entry,
+                     const void* base, Hasher* hasher) {
+    const uint16_t type_card = entry.type_card;
+    const uint16_t card = type_card & field_layout::kFcMask;
+    const uint16_t rep = type_card & field_layout::kRepMask;
+    switch (type_card & field_layout::kFkMask) {
+      case field_layout::kFkVarint:
+      case field_layout::kFkPackedVarint:
+        if (rep == field_layout::kRep8Bits) {
+          AddNumericField<bool>(field_num, card, base, entry.offset, hasher);
+        } else if (rep == field_layout::kRep32Bits) {
+          AddNumericField<uint32_t>(field_num, card, base, entry.offset,
+                                    hasher);
+        } else {
+          AddNumericField<uint64_t>(field_num, card, base, entry.offset,
+                                    hasher);
+        }
+        return true;
+
+      case field_layout::kFkFixed:
+      case field_layout::kFkPackedFixed:
+        if (rep == field_layout::kRep32Bits) {
+          AddNumericField<uint32_t>(field_num, card, base, entry.offset,
+                                    hasher);
+        } else {
+          AddNumericField<uint64_t>(field_num, card, base, entry.offset,
+                                    hasher);
+        }
+        return true;
+
+      case field_layout::kFkString:
+        if (card == field_layout::kFcRepeated) {
+          if (rep != field_layout::kRepSString) return false;
+          const auto& field =
+              TcParser::RefAt<RepeatedPtrField<std::string>>(base,
+                                                             entry.offset);
+          if (field.empty()) return true;
+          hasher->AddWord(FieldHeader(field_num, kRepeated));
+          hasher->AddWord(field.size());
+          for (const std::string& value : field) hasher->AddBytes(value);
+          return true;
+        }
+        if (rep == field_layout::kRepAString) {
+          AddStringField(
+              field_num, card,
+              TcParser::RefAt<internal::ArenaStringPtr>(base, entry.offset)
+                  .Get(),
+              hasher);
+          return true;
+        }
+        if (rep == field_layout::kRepSPiece) {
+          AddStringField(
+              field_num, card,
+              TcParser::RefAt<internal::StringPieceField>(base, entry.offset)
+                  .Get(),
+              hasher);
+          return true;
+        }
+        return false;
+
+      case field_layout::kFkMessage: {
+        if (rep != field_layout::kRepMessage &&
+            rep != field_layout::kRepGroup) {
+          return false;
+        }
+        if (card == field_layout::kFcRepeated) {
+          const auto& field =
+              TcParser::RefAt<RepeatedPtrField<Message>>(base, entry.offset);
+          if (field.empty()) return true;
+          hasher->AddWord(FieldHeader(field_num, kRepeated));
+          hasher->AddWord(field.size());
+          for (const Message& value : field) AddMessage(value, hasher);
+          return true;
+        }
+        const Message* value =
+            TcParser::RefAt<const Message*>(base, entry.offset);
+        if (value == nullptr) return true;
+        hasher->AddWord(FieldHeader(field_num, kSingular));
+        AddMessage(*value, hasher);
+        return true;
+      }
+
+      default:
+        return false;
+    }
+  }
+
+  template <typename T>
+  void AddNumericField(uint32_t field_num, uint16_t card, const void* base,
+                       uint32_t offset, Hasher* hasher) {
+    if (card == field_layout::kFcRepeated) {
+      const auto& field = TcParser::RefAt<RepeatedField<T>>(base, offset);
+      if (field.empty()) return;
+      hasher->AddWord(FieldHeader(field_num, kRepeated));
+      hasher->AddWord(field.size());
+      for (T value : field) hasher->AddWord(ValueWord(value));
+      return;
+    }
+    T value = TcParser::RefAt<T>(base, offset);
+    // Without explicit presence, only non-default values are set.
+    if (card == field_layout::kFcSingular && value == 0) return;
+    hasher->AddWord(FieldHeader(field_num, kSingular));
+    hasher->AddWord(ValueWord(value));
+  }
+
+  void AddStringField(uint32_t field_num, uint16_t card,
+                      absl::string_view value, Hasher* hasher) {
+    if (card == field_layout::kFcSingular && value.empty()) return;
+    hasher->AddWord(FieldHeader(field_num, kSingular));
+    hasher->AddBytes(value);
+  }
+
+  // Adds `field` of `message` through reflection, if it is set.
+  void AddField(const Message& message, const FieldDescriptor* field,
+                Hasher* hasher) {
+    const Reflection* reflection = message.GetReflection();
+    if (field->is_map()) {
+      AddMapField(message, field, hasher);
+    } else if (field->is_repeated()) {
+      int size = reflection->FieldSize(message, field);
+      if (size == 0) return;
+      hasher->AddWord(FieldHeader(field->number(), kRepeated));
+      hasher->AddWord(size);
+      for (int i = 0; i < size; ++i) AddValue(message, field, i, hasher);
+    } else if (reflection->HasField(message, field)) {
+      hasher->AddWord(FieldHeader(field->number(), kSingular));
+      AddValue(message, field, -1, hasher);
+    }
+  }
+
+  // Map entries are hashed on their own and the results added up, so that
+  // the order of the entries does not matter.
+  void AddMapField(const Message& message, const FieldDescriptor* field,
+                   Hasher* hasher) {
+    const Reflection* reflection = message.GetReflection();
+    int size = reflection->FieldSize(message, field);
+    if (size == 0) return;
+    const FieldDescriptor* key = field->message_type()->map_key();
+    const FieldDescriptor* value = field->message_type()->map_value();
+    absl::uint128 sum = 0;
+    for (int i = 0; i < size; ++i) {
+      const Message& map_entry =
+          reflection->GetRepeatedMessage(message, field, i);
+      Hasher entry_hasher;
+      AddValue(map_entry, key, -1, &entry_hasher);
+      AddValue(map_entry, value, -1, &entry_hasher);
+      sum += entry_hasher.Finish();
+    }
+    hasher->AddWord(FieldHeader(field->number(), kMap));
+    hasher->AddWord(size);
+    hasher->AddWord(absl::Uint128Low64(sum));
+    hasher->AddWord(absl::Uint128High64(sum));
+  }
+
+  // Adds the value of a singular field, or the element at `index` of a
+  // repeated one.
+  void AddValue(const Message& message, const FieldDescriptor* field,
+                int index, Hasher* hasher) {
+    const Reflection* r = message.GetReflection();
+    const bool repeated = field->is_repeated();
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_INT32:
+        hasher->AddWord(ValueWord(static_cast<uint32_t>(
+            repeated ? r->GetRepeatedInt32(message, field, index)
+                     : r->GetInt32(message, field))));
+        return;
+      case FieldDescriptor::CPPTYPE_INT64:
+        hasher->AddWord(ValueWord(static_cast<uint64_t>(
+            repeated ? r->GetRepeatedInt64(message, field, index)
+                     : r->GetInt64(message, field))));
+        return;
+      case FieldDescriptor::CPPTYPE_UINT32:
+        hasher->AddWord(ValueWord(
+            repeated ? r->GetRepeatedUInt32(message, field, index)
+                     : r->GetUInt32(message, field)));
+        return;
+      case FieldDescriptor::CPPTYPE_UINT64:
+        hasher->AddWord(ValueWord(
+            repeated ? r->GetRepeatedUInt64(message, field, index)
+                     : r->GetUInt64(message, field)));
+        return;
+      case FieldDescriptor::CPPTYPE_FLOAT:
+        hasher->AddWord(ValueWord(absl::bit_cast<uint32_t>(
+            repeated ? r->GetRepeatedFloat(message, field, index)
+                     : r->GetFloat(message, field))));
+        return;
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        hasher->AddWord(ValueWord(absl::bit_cast<uint64_t>(
+            repeated ? r->GetRepeatedDouble(message, field, index)
+                     : r->GetDouble(message, field))));
+        return;
+      case FieldDescriptor::CPPTYPE_BOOL:
+        hasher->AddWord(ValueWord(
+            repeated ? r->GetRepeatedBool(message, field, index)
+                     : r->GetBool(message, field)));
+        return;
+      case FieldDescriptor::CPPTYPE_ENUM:
+        hasher->AddWord(ValueWord(static_cast<uint32_t>(
+            repeated ? r->GetRepeatedEnumValue(message, field, index)
+                     : r->GetEnumValue(message, field))));
+        return;
+      case FieldDescriptor::CPPTYPE_STRING: {
+        std::string scratch;
+        hasher->AddBytes(
+            repeated
+                ? r->GetRepeatedStringReference(message, field, index, &scratch)
+                : r->GetStringReference(message, field, &scratch));
+        return;
+      }
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        AddMessage(repeated ? r->GetRepeatedMessage(message, field, index)
+                            : r->GetMessage(message, field),
+                   hasher);
+        return;
+    }
+  }
+
+  // Unknown fields are added in field number order, keeping the relative
+  // order of fields with the same number.
+  void AddUnknownFields(const UnknownFieldSet& fields, Hasher* hasher) {
+    if (fields.empty()) return;
+    std::vector<int> order(fields.field_count());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return fields.field(a).number() < fields.field(b).number();
+    });
+    for (int i : order) {
+      const UnknownField& field = fields.field(i);
+      const uint32_t number = static_cast<uint32_t>(field.number());
+      switch (field.type()) {
+        case UnknownField::TYPE_VARINT:
+          hasher->AddWord(FieldHeader(number, kUnknownVarint));
+          hasher->AddWord(field.varint());
+          break;
+        case UnknownField::TYPE_FIXED32:
+          hasher->AddWord(FieldHeader(number, kUnknownFixed32));
+          hasher->AddWord(field.fixed32());
+          break;
+        case UnknownField::TYPE_FIXED64:
+          hasher->AddWord(FieldHeader(number, kUnknownFixed64));
+          hasher->AddWord(field.fixed64());
+          break;
+        case UnknownField::TYPE_LENGTH_DELIMITED:
+          hasher->AddWord(FieldHeader(number, kUnknownLengthDelimited));
+          hasher->AddBytes(field.length_delimited());
+          break;
+        case UnknownField::TYPE_GROUP:
+          hasher->AddWord(FieldHeader(number, kUnknownGroup));
+          AddUnknownFields(field.group(), hasher);
+          hasher->AddWord(kEndOfMessage);
+          break;
+      }
+    }
+  }
+
+  const Options& options_;
+};
+
+uint64_t MessageFingerprint::Fingerprint64(const Message& message) {
+  return Fingerprint64(message, Options());
+}
+
+uint64_t MessageFingerprint::Fingerprint64(const Message& message,
+                                           const Options& options) {
+  return absl::Uint128Low64(Fingerprint128(message, options));
+}
+
+absl::uint128 MessageFingerprint::Fingerprint128(const Message& message) {
+  return Fingerprint128(message, Options());
+}
+
+absl::uint128 MessageFingerprint::Fingerprint128(const Message& message,
+                                                 const Options& options) {
+  Hasher hasher;
+  Walker(options).AddMessage(message, &hasher);
+  return hasher.Finish();
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,99 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Defines MessageFingerprint, which hashes the contents of messages.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_MESSAGE_FINGERPRINT_H__
+#define GOOGLE_PROTOBUF_UTIL_MESSAGE_FINGERPRINT_H__
+
+#include <cstdint>
+
+#include "google/protobuf/message.h"
+#include "absl/numeric/int128.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Computes 64- or 128-bit fingerprints of messages, for deduplication and
+// cache keys.  Unlike hashing the output of SerializeAsString(), which is not
+// canonical (see MessageLite::SerializeAsString()), fingerprinting hashes a
+// canonical form of the message directly, without building it in memory:
+//
+//  * Fields are hashed in field number order, followed by extensions in
+//    field number order and then unknown fields, grouped by field number
+//    but otherwise in the order they were parsed.
+//  * Map entries are hashed independently and combined, so the order of the
+//    entries does not matter.
+//  * A field is hashed if it is set in the sense of Reflection::ListFields():
+//    fields with presence are hashed when set, even to their default value;
+//    fields without presence only when they differ from their default value.
+//  * Floating point values are hashed by their bits, so 0.0 and -0.0 differ
+//    while NaNs with the same bits are equal.
+//
+// As a result, equal messages of the same type have equal fingerprints
+// however they were built (generated or dynamic, parsed or filled in by
+// hand), in any process and on any platform.  The type itself is not part of
+// the fingerprint: callers that mix types should combine it with the type's
+// full name.  Fingerprints are not cryptographic and must not be used where
+// an adversary could pick colliding messages.
+//
+// Messages are walked using the same tables as the table-driven parser, with
+// a fallback to reflection for fields the tables do not describe (maps,
+// extensions, and a few field representations).
+class PROTOBUF_EXPORT MessageFingerprint {
+ public:
+  struct Options {
+    // If true, unknown fields (of the message and of all its submessages)
+    // are not hashed, so messages that differ only in unknown fields have
+    // equal fingerprints.
+    bool ignore_unknown_fields = false;
+  };
+
+  static uint64_t Fingerprint64(const Message& message);
+  static uint64_t Fingerprint64(const Message& message, const Options& options);
+  static absl::uint128 Fingerprint128(const Message& message);
+  static absl::uint128 Fingerprint128(const Message& message,
+                                      const Options& options);
+
+ private:
+  class Walker;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_MESSAGE_FINGERPRINT_H__
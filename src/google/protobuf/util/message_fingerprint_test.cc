@@ -0,0 +1,307 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "google/protobuf/util/message_fingerprint.h"
+
+#include <memory>
+#include <string>
+
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/map_unittest.pb.h"
+#include <gtest/gtest.h>
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_mset.pb.h"
+#include "google/protobuf/unittest_mset_wire_format.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+#include "google/protobuf/unknown_field_set.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllExtensions;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestEmptyMessage;
+using ::protobuf_unittest::TestMap;
+
+TEST(MessageFingerprintTest, EqualMessagesHaveEqualFingerprints) {
+  TestAllTypes a, b;
+  TestUtil::SetAllFields(&a);
+  TestUtil::SetAllFields(&b);
+  EXPECT_EQ(MessageFingerprint::Fingerprint64(a),
+            MessageFingerprint::Fingerprint64(b));
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+  EXPECT_EQ(MessageFingerprint::Fingerprint64(a),
+            absl::Uint128Low64(MessageFingerprint::Fingerprint128(a)));
+  EXPECT_NE(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(TestAllTypes()));
+}
+
+TEST(MessageFingerprintTest, DifferentValuesHaveDifferentFingerprints) {
+  TestAllTypes base;
+  TestUtil::SetAllFields(&base);
+  const absl::uint128 fingerprint = MessageFingerprint::Fingerprint128(base);
+
+  TestAllTypes message = base;
+  message.set_optional_int32(message.optional_int32() + 1);
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+
+  message = base;
+  message.set_optional_float(-message.optional_float());
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+
+  message = base;
+  message.mutable_optional_string()->push_back('x');
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+
+  message = base;
+  message.mutable_optional_nested_message()->set_bb(12345);
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+
+  message = base;
+  message.set_repeated_int64(1, 0);
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+
+  message = base;
+  message.mutable_repeated_nested_message()->SwapElements(0, 1);
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+
+  message = base;
+  message.clear_oneof_field();
+  EXPECT_NE(fingerprint, MessageFingerprint::Fingerprint128(message));
+}
+
+TEST(MessageFingerprintTest, FieldBoundariesAreUnambiguous) {
+  TestAllTypes a, b;
+  a.add_repeated_string("ab");
+  a.add_repeated_string("c");
+  b.add_repeated_string("a");
+  b.add_repeated_string("bc");
+  EXPECT_NE(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+
+  a.Clear();
+  b.Clear();
+  a.mutable_optional_nested_message();
+  a.set_optional_int32(1);
+  b.set_optional_int32(1);
+  EXPECT_NE(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+}
+
+TEST(MessageFingerprintTest, ExplicitPresence) {
+  TestAllTypes message;
+  const absl::uint128 empty = MessageFingerprint::Fingerprint128(message);
+  message.set_optional_int32(0);
+  EXPECT_NE(empty, MessageFingerprint::Fingerprint128(message));
+
+  proto3_unittest::TestAllTypes proto3;
+  const absl::uint128 proto3_empty = MessageFingerprint::Fingerprint128(proto3);
+  proto3.set_optional_int32(0);
+  proto3.set_optional_string("");
+  EXPECT_EQ(proto3_empty, MessageFingerprint::Fingerprint128(proto3));
+  proto3.set_optional_float(-0.0f);
+  EXPECT_NE(proto3_empty, MessageFingerprint::Fingerprint128(proto3));
+}
+
+TEST(MessageFingerprintTest, SurvivesRoundTrip) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(message.SerializeAsString()));
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(message),
+            MessageFingerprint::Fingerprint128(parsed));
+
+  TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  TestAllExtensions parsed_extensions;
+  ASSERT_TRUE(
+      parsed_extensions.ParseFromString(extensions.SerializeAsString()));
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(extensions),
+            MessageFingerprint::Fingerprint128(parsed_extensions));
+  EXPECT_NE(MessageFingerprint::Fingerprint128(extensions),
+            MessageFingerprint::Fingerprint128(TestAllExtensions()));
+}
+
+TEST(MessageFingerprintTest, DynamicMessageMatchesGenerated) {
+  DynamicMessageFactory factory;
+  {
+    TestAllTypes message;
+    TestUtil::SetAllFields(&message);
+    std::unique_ptr<Message> dynamic(
+        factory.GetPrototype(TestAllTypes::descriptor())->New());
+    ASSERT_TRUE(dynamic->ParseFromString(message.SerializeAsString()));
+    EXPECT_EQ(MessageFingerprint::Fingerprint128(message),
+              MessageFingerprint::Fingerprint128(*dynamic));
+  }
+  {
+    TestMap message;
+    (*message.mutable_map_int32_int32())[1] = 2;
+    (*message.mutable_map_string_string())["a"] = "b";
+    (*message.mutable_map_int32_foreign_message())[3].set_c(4);
+    std::unique_ptr<Message> dynamic(
+        factory.GetPrototype(TestMap::descriptor())->New());
+    ASSERT_TRUE(dynamic->ParseFromString(message.SerializeAsString()));
+    EXPECT_EQ(MessageFingerprint::Fingerprint128(message),
+              MessageFingerprint::Fingerprint128(*dynamic));
+  }
+}
+
+TEST(MessageFingerprintTest, MapOrderDoesNotMatter) {
+  TestMap a, b;
+  for (int i = 0; i < 100; ++i) {
+    (*a.mutable_map_int32_int32())[i] = i * 3;
+    (*b.mutable_map_int32_int32())[99 - i] = (99 - i) * 3;
+    (*a.mutable_map_string_string())[std::to_string(i)] = "x";
+    (*b.mutable_map_string_string())[std::to_string(99 - i)] = "x";
+  }
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+
+  (*b.mutable_map_int32_int32())[5] = 0;
+  EXPECT_NE(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+
+  // Swapping values between keys changes the fingerprint, even though the
+  // multisets of keys and of values are the same.
+  TestMap c, d;
+  (*c.mutable_map_int32_int32())[1] = 10;
+  (*c.mutable_map_int32_int32())[2] = 20;
+  (*d.mutable_map_int32_int32())[1] = 20;
+  (*d.mutable_map_int32_int32())[2] = 10;
+  EXPECT_NE(MessageFingerprint::Fingerprint128(c),
+            MessageFingerprint::Fingerprint128(d));
+}
+
+TEST(MessageFingerprintTest, UnknownFields) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  TestEmptyMessage unknown;
+  ASSERT_TRUE(unknown.ParseFromString(message.SerializeAsString()));
+
+  EXPECT_NE(MessageFingerprint::Fingerprint128(unknown),
+            MessageFingerprint::Fingerprint128(TestEmptyMessage()));
+
+  MessageFingerprint::Options options;
+  options.ignore_unknown_fields = true;
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(unknown, options),
+            MessageFingerprint::Fingerprint128(TestEmptyMessage(), options));
+
+  // Only the relative order of unknown fields with the same number matters.
+  TestEmptyMessage a, b;
+  a.GetReflection()->MutableUnknownFields(&a)->AddVarint(1, 1);
+  a.GetReflection()->MutableUnknownFields(&a)->AddVarint(2, 2);
+  a.GetReflection()->MutableUnknownFields(&a)->AddVarint(2, 3);
+  b.GetReflection()->MutableUnknownFields(&b)->AddVarint(2, 2);
+  b.GetReflection()->MutableUnknownFields(&b)->AddVarint(1, 1);
+  b.GetReflection()->MutableUnknownFields(&b)->AddVarint(2, 3);
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+  b.GetReflection()->MutableUnknownFields(&b)->mutable_field(2)->set_varint(
+      2);
+  b.GetReflection()->MutableUnknownFields(&b)->mutable_field(0)->set_varint(
+      3);
+  EXPECT_NE(MessageFingerprint::Fingerprint128(a),
+            MessageFingerprint::Fingerprint128(b));
+}
+
+// Fingerprints are meant to be stored and compared across processes and
+// releases, so the values for a fixed message are pinned.  A change here
+// means every stored fingerprint is invalidated.
+TEST(MessageFingerprintTest, Golden) {
+  TestAllTypes all_types;
+  all_types.set_optional_int32(101);
+  all_types.set_optional_sint64(-102);
+  all_types.set_optional_double(-0.0);
+  all_types.set_optional_bool(false);
+  all_types.set_optional_string("hello");
+  all_types.mutable_optional_nested_message()->set_bb(118);
+  all_types.mutable_optionalgroup()->set_a(117);
+  all_types.add_repeated_fixed32(1);
+  all_types.add_repeated_fixed32(2);
+  all_types.add_repeated_string("");
+  all_types.add_repeated_nested_enum(TestAllTypes::BAZ);
+  all_types.set_oneof_bytes("oneof");
+  UnknownFieldSet* unknown =
+      all_types.GetReflection()->MutableUnknownFields(&all_types);
+  unknown->AddVarint(1000, 7);
+  unknown->AddFixed64(1001, 0x0123456789abcdefULL);
+  unknown->AddLengthDelimited(1000, "unknown");
+  unknown->AddGroup(1002)->AddFixed32(1, 3);
+
+  EXPECT_EQ(absl::MakeUint128(0x329585cfbedc6346ULL, 0xc847424ba7b97fb5ULL),
+            MessageFingerprint::Fingerprint128(all_types));
+  EXPECT_EQ(0xc847424ba7b97fb5ULL,
+            MessageFingerprint::Fingerprint64(all_types));
+
+  MessageFingerprint::Options options;
+  options.ignore_unknown_fields = true;
+  EXPECT_EQ(absl::MakeUint128(0x525bc51d685ac28fULL, 0xe147adc05402722aULL),
+            MessageFingerprint::Fingerprint128(all_types, options));
+  EXPECT_EQ(0xe147adc05402722aULL,
+            MessageFingerprint::Fingerprint64(all_types, options));
+
+  TestMap map;
+  (*map.mutable_map_int32_int32())[1] = 10;
+  (*map.mutable_map_int32_int32())[-2] = 20;
+  (*map.mutable_map_string_string())["key"] = "value";
+  (*map.mutable_map_int32_foreign_message())[3].set_c(4);
+  map.GetReflection()->MutableUnknownFields(&map)->AddVarint(1000, 1);
+
+  EXPECT_EQ(absl::MakeUint128(0x0e88c7ae217d3054ULL, 0x3d2beec6b824c3caULL),
+            MessageFingerprint::Fingerprint128(map));
+  EXPECT_EQ(0x3d2beec6b824c3caULL, MessageFingerprint::Fingerprint64(map));
+
+  EXPECT_EQ(absl::MakeUint128(0xa49b8cc103821187ULL, 0xa4601c721e1ca12aULL),
+            MessageFingerprint::Fingerprint128(TestEmptyMessage()));
+}
+
+TEST(MessageFingerprintTest, MessageSet) {
+  proto2_wireformat_unittest::TestMessageSet message;
+  message
+      .MutableExtension(
+          protobuf_unittest::TestMessageSetExtension1::message_set_extension)
+      ->set_i(123);
+  proto2_wireformat_unittest::TestMessageSet parsed;
+  ASSERT_TRUE(parsed.ParseFromString(message.SerializeAsString()));
+  EXPECT_EQ(MessageFingerprint::Fingerprint128(message),
+            MessageFingerprint::Fingerprint128(parsed));
+  EXPECT_NE(MessageFingerprint::Fingerprint128(message),
+            MessageFingerprint::Fingerprint128(
+                proto2_wireformat_unittest::TestMessageSet()));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google